@@ -0,0 +1,133 @@
+/*
+ * Copyright (c) 2014-2015, Hewlett-Packard Development Company, LP.
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details. You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * HP designates this particular file as subject to the "Classpath" exception
+ * as provided by HP in the LICENSE.txt file that accompanied this code.
+ */
+#ifndef FOEDUS_ASSORTED_HARDWARE_TRANSACTION_HPP_
+#define FOEDUS_ASSORTED_HARDWARE_TRANSACTION_HPP_
+
+#include <stdint.h>
+
+/**
+ * @file foedus/assorted/hardware_transaction.hpp
+ * @ingroup ASSORTED
+ * @brief Hardware transactional memory (Intel RTM) primitives.
+ * @details
+ * These are equivalent to _xbegin()/_xend()/_xabort()/_xtest() in immintrin.h.
+ * We don't use the intrinsics because they require -mrtm, which would let the compiler
+ * assume RTM everywhere. Instead, we emit the instructions ourselves and check
+ * is_rtm_supported() at runtime before using them. Calling rtm_begin() etc on a CPU without
+ * RTM raises SIGILL.
+ *
+ * On AArch64, is_rtm_supported() always returns false and the other methods must not be called.
+ */
+namespace foedus {
+namespace assorted {
+
+/** Returned by rtm_begin() when the hardware transaction has started. */
+const uint32_t kRtmStarted = ~0U;
+/** Set in the abort status when rtm_abort() was called. See rtm_abort_code(). */
+const uint32_t kRtmAbortExplicit = 1U << 0;
+/** Set in the abort status when the transaction may succeed on a retry. */
+const uint32_t kRtmAbortRetry = 1U << 1;
+/** Set in the abort status when another core touched our read/write set. */
+const uint32_t kRtmAbortConflict = 1U << 2;
+/** Set in the abort status when our read/write set overflowed the cache. */
+const uint32_t kRtmAbortCapacity = 1U << 3;
+
+/**
+ * @brief Returns whether this CPU supports RTM (CPUID.07H.EBX.RTM[bit 11]).
+ * @ingroup ASSORTED
+ */
+inline bool is_rtm_supported() {
+#ifndef __aarch64__
+  uint32_t eax, ebx, ecx, edx;
+  asm volatile("cpuid" : "=a" (eax), "=b" (ebx), "=c" (ecx), "=d" (edx) : "a" (0U));
+  if (eax < 7U) {
+    return false;
+  }
+  asm volatile("cpuid" : "=a" (eax), "=b" (ebx), "=c" (ecx), "=d" (edx) : "a" (7U), "c" (0U));
+  return (ebx & (1U << 11)) != 0;
+#else  // __aarch64__
+  return false;
+#endif  // __aarch64__
+}
+
+/**
+ * @brief Starts a hardware transaction (XBEGIN).
+ * @return kRtmStarted if the transaction has started. Otherwise, the transaction was aborted
+ * and the control came back here with the abort status.
+ * @ingroup ASSORTED
+ */
+inline uint32_t rtm_begin() {
+  uint32_t status = kRtmStarted;
+#ifndef __aarch64__
+  // xbegin rel32=0. On abort, the CPU jumps to the next instruction with status in eax.
+  asm volatile(".byte 0xc7, 0xf8; .long 0" : "+a" (status) :: "memory");
+#endif  // __aarch64__
+  return status;
+}
+
+/**
+ * @brief Commits the current hardware transaction (XEND).
+ * @ingroup ASSORTED
+ */
+inline void rtm_end() {
+#ifndef __aarch64__
+  asm volatile(".byte 0x0f, 0x01, 0xd5" ::: "memory");
+#endif  // __aarch64__
+}
+
+/**
+ * @brief Aborts the current hardware transaction (XABORT) with the given code.
+ * @tparam CODE 8-bit code that will be returned by rtm_abort_code() on the abort status
+ * @details
+ * This does nothing when not in a hardware transaction.
+ * @ingroup ASSORTED
+ */
+template <uint8_t CODE>
+inline void rtm_abort() {
+#ifndef __aarch64__
+  asm volatile(".byte 0xc6, 0xf8, %P0" :: "i" (CODE) : "memory");
+#endif  // __aarch64__
+}
+
+/**
+ * @brief Returns the code given to rtm_abort() from the abort status.
+ * Meaningful only when kRtmAbortExplicit is set.
+ * @ingroup ASSORTED
+ */
+inline uint8_t rtm_abort_code(uint32_t status) {
+  return static_cast<uint8_t>(status >> 24);
+}
+
+/**
+ * @brief Returns whether we are in a hardware transaction (XTEST).
+ * @ingroup ASSORTED
+ */
+inline bool rtm_test() {
+#ifndef __aarch64__
+  uint8_t ret;
+  asm volatile(".byte 0x0f, 0x01, 0xd6; setnz %0" : "=r" (ret) :: "memory");
+  return ret != 0;
+#else  // __aarch64__
+  return false;
+#endif  // __aarch64__
+}
+
+}  // namespace assorted
+}  // namespace foedus
+
+#endif  // FOEDUS_ASSORTED_HARDWARE_TRANSACTION_HPP_
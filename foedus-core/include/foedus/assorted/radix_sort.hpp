@@ -0,0 +1,57 @@
+/*
+ * Copyright (c) 2014-2015, Hewlett-Packard Development Company, LP.
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details. You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * HP designates this particular file as subject to the "Classpath" exception
+ * as provided by HP in the LICENSE.txt file that accompanied this code.
+ */
+#ifndef FOEDUS_ASSORTED_RADIX_SORT_HPP_
+#define FOEDUS_ASSORTED_RADIX_SORT_HPP_
+
+#include <stdint.h>
+
+namespace foedus {
+namespace assorted {
+
+/**
+ * @brief Sorts 128-bit unsigned integers in ascending order with LSD radix sort.
+ * @ingroup ASSORTED
+ * @details
+ * The log gleaner packs its sort keys (key, epoch, ordinal, position) into 128-bit integers,
+ * so a radix sort with 8-bit digits replaces comparison sorts there.
+ * Digits that are the same in all entries, such as the high bytes of small array offsets or
+ * the compressed epoch in a snapshot of a few epochs, are detected from the histograms and
+ * skipped. Small inputs fall back to std::sort.
+ *
+ * When threads > 1 and the input is large enough, the entries are first scattered by their most
+ * significant digit that differs, then the helper threads sort the resulting buckets in parallel.
+ *
+ * @param[in,out] data the integers to sort. Sorted in place.
+ * @param[in] buffer work memory of at least count integers. Its content is overwritten.
+ * @param[in] count number of integers in data.
+ * @param[in] presorted_low_bits number of least significant bits by which data is already
+ * sorted, for example because they hold the original index of each entry. We skip digits in
+ * these bits; the sort is stable, so the result is same as sorting all 128 bits.
+ * @param[in] threads number of threads to use, including the calling thread.
+ */
+void radix_sort_uint128(
+  __uint128_t* data,
+  __uint128_t* buffer,
+  uint32_t count,
+  uint16_t presorted_low_bits = 0,
+  uint16_t threads = 1);
+
+}  // namespace assorted
+}  // namespace foedus
+
+#endif  // FOEDUS_ASSORTED_RADIX_SORT_HPP_
@@ -30,6 +30,8 @@
 #include "foedus/storage/storage_id.hpp"
 #include "foedus/thread/thread_id.hpp"
 
+struct aiocb;
+
 namespace foedus {
 namespace cache {
 /**
@@ -76,6 +78,28 @@ class SnapshotFileSet CXX11_FINAL : public DefaultInitializable {
   ErrorCode read_page(storage::SnapshotPagePointer page_id, void* out);
   /** Read contiguous pages in one shot */
   ErrorCode read_pages(storage::SnapshotPagePointer page_id_begin, uint32_t page_count, void* out);
+  /**
+   * Same as read_pages() except that this reads fewer pages without errors when the file ends.
+   * @param[out] read_count Number of pages read.
+   */
+  ErrorCode read_pages_upto(
+    storage::SnapshotPagePointer page_id_begin,
+    uint32_t max_count,
+    void* out,
+    uint32_t* read_count);
+  /**
+   * Asynchronously reads one page. Check the completion with poll_page_read().
+   * @see fs::DirectIoFile::read_async()
+   */
+  ErrorCode read_page_async(
+    storage::SnapshotPagePointer page_id,
+    void* out,
+    struct aiocb* control);
+  /** Checks the completion of read_page_async(). */
+  ErrorCode poll_page_read(
+    storage::SnapshotPagePointer page_id,
+    struct aiocb* control,
+    bool* completed);
 
   friend std::ostream&    operator<<(std::ostream& o, const SnapshotFileSet& v);
 
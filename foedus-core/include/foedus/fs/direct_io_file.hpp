@@ -28,6 +28,9 @@
 #include "foedus/fs/path.hpp"
 #include "foedus/memory/fwd.hpp"
 
+struct aiocb;
+struct iovec;
+
 namespace foedus {
 namespace fs {
 
@@ -115,6 +118,35 @@ class DirectIoFile {
   ErrorCode       read(uint64_t desired_bytes, const foedus::memory::AlignedMemorySlice& slice);
   /** A version that receives a raw pointer that has to be aligned (be careful to use this ver). */
   ErrorCode       read_raw(uint64_t desired_bytes, void* buffer);
+  /**
+   * Same as read_raw() except that reaching the end of file is not an error.
+   * @param[out] read_bytes Number of bytes read, which is less than desired_bytes only
+   * when the file ends before that.
+   */
+  ErrorCode       read_raw_upto(uint64_t desired_bytes, void* buffer, uint64_t* read_bytes);
+
+  /**
+   * @brief Asynchronously reads the given amount of contents at the given offset (aio_read()).
+   * @param[in] offset Byte offset in the file to read from. This doesn't use nor move the
+   * current position, so other reads/seeks can be issued while this read is in flight.
+   * @param[in] desired_bytes Number of bytes to read.
+   * @param[out] buffer Memory to read into. As this is Direct-IO, it must be aligned.
+   * @param[out] control Control block of this read. The caller must keep it at the same address
+   * and not touch buffer until poll_async_read() says the read completed.
+   * @pre is_opened()
+   */
+  ErrorCode       read_async(
+    uint64_t offset,
+    uint64_t desired_bytes,
+    void* buffer,
+    struct aiocb* control);
+  /**
+   * @brief Checks if the read issued by read_async() has completed.
+   * @param[in,out] control Control block given to read_async().
+   * @param[out] completed Whether the read has completed, successfully or not.
+   * @return Error of the read if it has completed unsuccessfully, including short reads.
+   */
+  ErrorCode       poll_async_read(struct aiocb* control, bool* completed);
 
   /**
    * @brief Sequentially write the given amount of contents from the current position.
@@ -130,6 +162,17 @@ class DirectIoFile {
   ErrorCode       write(uint64_t desired_bytes, const foedus::memory::AlignedMemorySlice& slice);
   /** A version that receives a raw pointer that has to be aligned (be careful to use this ver). */
   ErrorCode       write_raw(uint64_t desired_bytes, const void* buffer);
+  /**
+   * @brief Sequentially write the given buffers in one vectored write (writev()).
+   * @param[in] vector_count Number of buffers. At most IOV_MAX.
+   * @param[in,out] vectors Buffers to write out. As this is Direct-IO, all addresses and
+   * lengths must be aligned. This method might modify the elements when the underlying
+   * filesystem splits the write.
+   * @details
+   * This saves copying or issuing separate writes for buffers that are not contiguous in memory,
+   * such as logs in several threads' private buffers.
+   */
+  ErrorCode       write_vectored(uint32_t vector_count, struct iovec* vectors);
 
   /**
    * @brief Discard the content of the file after the given offset.
@@ -69,6 +69,12 @@ class LogManager CXX11_FINAL : public virtual Initializable {
    */
   LoggerRef   get_logger(LoggerId logger_id);
 
+  /**
+   * Returns the total bytes all loggers have made durable since start-up.
+   * This is just a statistic to estimate the write load. Not exact.
+   */
+  uint64_t    get_durable_bytes() const;
+
   /**
    * @brief Returns the durable epoch of the entire engine.
    * @invariant current_global_epoch > durable_global_epoch
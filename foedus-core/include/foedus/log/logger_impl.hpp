@@ -18,6 +18,7 @@
 #ifndef FOEDUS_LOG_LOGGER_IMPL_HPP_
 #define FOEDUS_LOG_LOGGER_IMPL_HPP_
 #include <stdint.h>
+#include <sys/uio.h>
 
 #include <atomic>
 #include <iosfwd>
@@ -65,6 +66,7 @@ struct LoggerControlBlock {
     wakeup_cond_.initialize();
     epoch_history_mutex_.initialize();
     stop_requested_ = false;
+    durable_bytes_ = 0;
     epoch_history_head_ = 0;
     epoch_history_count_ = 0;
   }
@@ -139,6 +141,12 @@ struct LoggerControlBlock {
    */
   std::atomic< uint64_t >         current_file_durable_offset_;
 
+  /**
+   * Total bytes this logger has made durable since start-up, across log files.
+   * Just a statistic for the epoch chime to estimate the write load.
+   */
+  std::atomic< uint64_t >         durable_bytes_;
+
   /** Whether this logger should terminate */
   std::atomic<bool>               stop_requested_;
 
@@ -164,9 +172,23 @@ struct LoggerControlBlock {
  * @details
  * This is a private implementation-details of \ref LOG, thus file name ends with _impl.
  * Do not include this header from a client program unless you know what you are doing.
+ *
+ * @par Vectored writes
+ * The logger does not issue a write for each piece of logs. It instead accumulates
+ * the epoch marker, the padded 4kb blocks in fill_buffer_, and the aligned ranges of threads'
+ * buffers in write_vectors_, then writes them out in one vectored write per epoch.
+ * Aligned ranges are directly passed from the threads' buffers, which are already allocated
+ * in NUMA-local hugepages, so the only copies are the padded blocks at both ends.
  */
 class Logger final : public DefaultInitializable, public LoggerRef {
  public:
+  enum Constants {
+    /** Number of 4kb blocks in fill_buffer_. When we run out of them, we flush the writes. */
+    kFillBlocks = 64,
+    /** Max number of buffers in one vectored write. Must be within IOV_MAX. */
+    kMaxWriteVectors = 256,
+  };
+
   Logger(
     Engine* engine,
     LoggerControlBlock* control_block,
@@ -255,6 +277,19 @@ class Logger final : public DefaultInitializable, public LoggerRef {
     uint64_t from_offset,
     uint64_t upto_offset);
 
+  /**
+   * Takes a 4kb block from fill_buffer_ and appends it to the pending writes.
+   * The caller populates the block before flush_writes().
+   */
+  ErrorCode   append_fill_block(char** block);
+  /** Appends an aligned range in a thread's buffer to the pending writes. */
+  ErrorCode   append_write(const char* data, uint64_t bytes);
+  /**
+   * Writes out all pending writes in one vectored write.
+   * Threads must not reuse their buffers for the logs until this method returns.
+   */
+  ErrorCode   flush_writes();
+
   /** Check invariants. This method is wiped out in NDEBUG. */
   void        assert_consistent();
   /** Sanity check on logs to write out. This method is wiped out in NDEBUG. */
@@ -277,8 +312,14 @@ class Logger final : public DefaultInitializable, public LoggerRef {
    * commited-but-non-durable log)
    * In these cases, we need to pad it to 4kb. So, we copy the thread's buffer's content to this
    * buffer and fill the rest (at the end or at the beginning, or both).
+   * This buffer consists of kFillBlocks blocks so that one vectored write can contain
+   * many padded blocks.
    */
   memory::AlignedMemory           fill_buffer_;
+  /** Number of blocks in fill_buffer_ used by the pending writes. */
+  uint32_t                        fill_blocks_used_;
+  /** Pending writes. Each element points to either fill_buffer_ or a thread's buffer. */
+  std::vector< struct iovec >     write_vectors_;
 
   /**
    * @brief The log file this logger is currently appending to.
@@ -44,6 +44,8 @@ class LoggerRef : public Attachable<LoggerControlBlock> {
 
   /** Returns this logger's durable epoch. */
   Epoch       get_durable_epoch() const;
+  /** Returns the total bytes this logger has made durable since start-up. */
+  uint64_t    get_durable_bytes() const;
 
   /**
    * @brief Wakes up this logger if it is sleeping.
@@ -54,6 +54,7 @@ class NumaCoreMemory CXX11_FINAL : public DefaultInitializable {
     char* xct_write_access_memory_;
     char* xct_lock_free_read_access_memory_;
     char* xct_lock_free_write_access_memory_;
+    char* xct_page_read_access_memory_;
   };
 
   NumaCoreMemory() CXX11_FUNC_DELETE;
@@ -113,14 +114,20 @@ class NumaCoreMemory CXX11_FINAL : public DefaultInitializable {
   static uint64_t calculate_local_small_memory_size(const EngineOptions& options);
 
  private:
-  /** Called when there no local free pages. */
+  /**
+   * Called when there no local free pages.
+   * Cores pass their core-local ordinal as the home shard so that cores on the same node
+   * usually don't contend on the pool's lock.
+   */
   static ErrorCode  grab_free_pages_from_node(
     PagePoolOffsetChunk* free_chunk,
-    memory::PagePool *pool);
+    memory::PagePool *pool,
+    uint16_t home_shard);
   /** Called when there are too many local free pages. */
   static void       release_free_pages_to_node(
     PagePoolOffsetChunk* free_chunk,
-    memory::PagePool *pool);
+    memory::PagePool *pool,
+    uint16_t home_shard);
 
   Engine* const           engine_;
 
@@ -210,6 +210,11 @@ class PagePool CXX11_FINAL : public virtual Initializable {
    * To avoid that, we respect this value in most places.
    */
   uint32_t              get_recommended_pages_per_grab() const;
+  /**
+   * @returns the number of shards the free pages are distributed to.
+   * Decided by the owner's initialize() and shared with all engines via the control block.
+   */
+  uint16_t              get_shard_count() const;
   Stat                  get_stat() const;
   std::string           get_debug_pool_name() const;
   /** Call this anytime after attach() */
@@ -225,8 +230,22 @@ class PagePool CXX11_FINAL : public virtual Initializable {
    * Callers usually maintain one PagePoolOffsetChunk for its private use and
    * calls this method when the size() goes below some threshold (eg 10%)
    * so as to get size() about 50%.
+   *
+   * The free pages are kept in a few shards. This overload starts from the shard
+   * that corresponds to the CPU the caller is running on.
    */
   ErrorCode   grab(uint32_t desired_grab_count, PagePoolOffsetChunk *chunk);
+  /**
+   * @brief Same as above except the caller specifies its home shard.
+   * @param[in] desired_grab_count we grab this number of free pages at most
+   * @param[in,out] chunk we \e append the grabbed free pages to this chunk
+   * @param[in] home_shard we first grab from this shard (modulo get_shard_count()), then
+   * steal from sibling shards if it doesn't have enough free pages.
+   * @details
+   * Each core passes its core-local ordinal so that cores on the same node
+   * usually take different locks.
+   */
+  ErrorCode   grab(uint32_t desired_grab_count, PagePoolOffsetChunk *chunk, uint16_t home_shard);
   /**
    * Grab only one page. More expensive, but handy in some situation.
    */
@@ -243,6 +262,14 @@ class PagePool CXX11_FINAL : public virtual Initializable {
    * so as to get size() about 50%.
    */
   void        release(uint32_t desired_release_count, PagePoolOffsetChunk* chunk);
+  /**
+   * Same as above except the caller specifies its home shard.
+   * If the home shard has no room, the remaining pages are spilled to sibling shards.
+   */
+  void        release(
+    uint32_t desired_release_count,
+    PagePoolOffsetChunk* chunk,
+    uint16_t home_shard);
   void        release(uint32_t desired_release_count, PagePoolOffsetDynamicChunk* chunk);
 
   /** Overload for PagePoolOffsetAndEpochChunk. */
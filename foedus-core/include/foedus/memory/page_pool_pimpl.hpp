@@ -20,6 +20,7 @@
 
 #include <stdint.h>
 
+#include <algorithm>
 #include <iosfwd>
 #include <string>
 
@@ -36,32 +37,82 @@
 
 namespace foedus {
 namespace memory {
+/**
+ * @brief One shard of the free page queue in a page pool.
+ * @ingroup MEMORY
+ * @details
+ * The free pool is split into a few shards, each of which is a circular queue on its own
+ * sub-range of the free pool array, protected by its own lock.
+ * Cores on the same node have different home shards, so they usually don't contend with
+ * each other. When the home shard runs out of free pages (or has no room for released pages),
+ * the caller steals from (or spills to) sibling shards.
+ * Each shard occupies its own cachelines to avoid false sharing.
+ */
+struct PagePoolShard {
+  // this is backed by shared memory. not instantiation. just reinterpret_cast.
+  PagePoolShard() = delete;
+  ~PagePoolShard() = delete;
+
+  /** Inclusive head of the circular queue, relative to the beginning of the shard. */
+  uint64_t                        head_;
+  /** Number of free pages in this shard. */
+  uint64_t                        count_;
+  /** grab()/release() on this shard are protected with this lock. */
+  soc::SharedMutex                lock_;
+
+  char                            padding_[128 - 16 - sizeof(soc::SharedMutex)];
+};
+
 /** Shared data in PagePoolPimpl. */
 struct PagePoolControlBlock {
   // this is backed by shared memory. not instantiation. just reinterpret_cast.
   PagePoolControlBlock() = delete;
   ~PagePoolControlBlock() = delete;
 
+  enum Constants {
+    /** Maximal number of shards in one page pool. */
+    kMaxShards = 16,
+    /**
+     * A shard has at least this many pages, so that an ordinary grab from a core-private
+     * chunk is usually satisfied by one shard. Small pools thus have only one shard.
+     */
+    kMinPagesPerShard = 1 << 12,
+  };
+
   void initialize() {
-    lock_.initialize();
+    for (uint16_t i = 0; i < kMaxShards; ++i) {
+      shards_[i].lock_.initialize();
+    }
   }
   void uninitialize() {
-    lock_.uninitialize();
+    for (uint16_t i = 0; i < kMaxShards; ++i) {
+      shards_[i].lock_.uninitialize();
+    }
   }
 
-  /** Inclusive head of the circular queue. Be aware of wrapping around. */
-  uint64_t                        free_pool_head_;
-  /** Number of free pages. */
-  uint64_t                        free_pool_count_;
-
-  /** just for debugging/logging. concise description of this pool instance. eg "VolatilePool-3". */
-  assorted::FixedString<60>       debug_pool_name_;
+  /**
+   * Shards of the free pool. Only the first shard_count_ entries are used.
+   * The lock of each shard is not contentious at all because we pack many pointers in a chunk
+   * and cores start from different shards.
+   */
+  PagePoolShard                   shards_[kMaxShards];
 
   /**
-   * grab()/release() are protected with this lock.
-   * This lock is not contentious at all because we pack many pointers in a chunk.
+   * Size of PagePoolPimpl::free_pool_. Set by the engine that owns the pool when it initializes
+   * the pool. Engines that merely attach to the pool read it from here rather than calculating
+   * it from their own options so that all of them agree on the shard layout.
    */
-  soc::SharedMutex                lock_;
+  uint64_t                        free_pool_capacity_;
+  /**
+   * Size of each shard's sub-range in free_pool_. The last shard might be smaller.
+   * Set by the owner like free_pool_capacity_.
+   */
+  uint64_t                        shard_capacity_;
+  /** Number of shards in use, [1, kMaxShards]. Set by the owner like free_pool_capacity_. */
+  uint16_t                        shard_count_;
+
+  /** just for debugging/logging. concise description of this pool instance. eg "VolatilePool-3". */
+  assorted::FixedString<60>       debug_pool_name_;
 };
 
 /**
@@ -83,43 +134,98 @@ class PagePoolPimpl final : public DefaultInitializable {
   ErrorStack  initialize_once() override;
   ErrorStack  uninitialize_once() override;
 
-  ErrorCode           grab(uint32_t desired_grab_count, PagePoolOffsetChunk *chunk);
+  ErrorCode           grab(
+    uint32_t desired_grab_count,
+    PagePoolOffsetChunk *chunk,
+    uint16_t home_shard);
 
   template <typename CHUNK>
-  void                release_impl(uint32_t desired_release_count, CHUNK* chunk);
-  void                release(uint32_t desired_release_count, PagePoolOffsetChunk *chunk);
-  void                release(uint32_t desired_release_count, PagePoolOffsetDynamicChunk* chunk);
-  void                release(uint32_t desired_release_count, PagePoolOffsetAndEpochChunk* chunk);
+  void                release_impl(
+    uint32_t desired_release_count,
+    CHUNK* chunk,
+    uint16_t home_shard);
+  void                release(
+    uint32_t desired_release_count,
+    PagePoolOffsetChunk *chunk,
+    uint16_t home_shard);
+  void                release(
+    uint32_t desired_release_count,
+    PagePoolOffsetDynamicChunk* chunk,
+    uint16_t home_shard);
+  void                release(
+    uint32_t desired_release_count,
+    PagePoolOffsetAndEpochChunk* chunk,
+    uint16_t home_shard);
 
-  ErrorCode           grab_one(PagePoolOffset *offset);
-  void                release_one(PagePoolOffset offset);
+  ErrorCode           grab_one(PagePoolOffset *offset, uint16_t home_shard);
+  void                release_one(PagePoolOffset offset, uint16_t home_shard);
   const LocalPageResolver& get_resolver() const { return resolver_; }
   PagePool::Stat      get_stat() const;
-  uint64_t&           free_pool_head() { return control_block_->free_pool_head_;}
-  uint64_t            free_pool_head() const { return control_block_->free_pool_head_;}
-  uint64_t            get_free_pool_capacity() const { return free_pool_capacity_; }
-  uint64_t  get_free_pool_count() const { return control_block_->free_pool_count_;}
-  void      increase_free_pool_count(uint64_t op) { control_block_->free_pool_count_ += op; }
-  void      decrease_free_pool_count(uint64_t op) {
-    ASSERT_ND(control_block_->free_pool_count_ >= op);
-    control_block_->free_pool_count_ -= op;
+  uint64_t            get_free_pool_capacity() const {
+    return control_block_->free_pool_capacity_;
   }
-  /** Not thread safe. Use it after taking a lock. */
-  void                assert_free_pool() const {
+  uint16_t            get_shard_count() const { return control_block_->shard_count_; }
+  /** @return the home shard of the calling thread when the caller didn't specify one */
+  uint16_t            get_current_shard() const;
+
+  PagePoolShard&      get_shard(uint16_t shard) { return control_block_->shards_[shard]; }
+  const PagePoolShard& get_shard(uint16_t shard) const { return control_block_->shards_[shard]; }
+  /** @return index in free_pool_ where the given shard's sub-range begins */
+  uint64_t            get_shard_begin(uint16_t shard) const {
+    return shard * control_block_->shard_capacity_;
+  }
+  /** @return the number of entries in the given shard's sub-range of free_pool_ */
+  uint64_t            get_shard_capacity(uint16_t shard) const {
+    ASSERT_ND(shard < get_shard_count());
+    uint64_t begin = get_shard_begin(shard);
+    return std::min<uint64_t>(
+      control_block_->shard_capacity_,
+      control_block_->free_pool_capacity_ - begin);
+  }
+  /** Sum of free pages in all shards. Not thread safe, so the value might be a bit stale. */
+  uint64_t            get_free_pool_count() const;
+
+  /**
+   * Grabs at most the given number of pages from the shard.
+   * Not thread safe. Use it after taking the lock of the shard.
+   * @return the number of pages actually grabbed
+   */
+  uint64_t            grab_from_shard(
+    uint16_t shard,
+    uint64_t desired_grab_count,
+    PagePoolOffsetChunk *chunk);
+  /**
+   * Appends at most the given number of pages to the tail of the shard.
+   * Not thread safe. Use it after taking the lock of the shard.
+   * @return the number of pages actually released
+   */
+  template <typename CHUNK>
+  uint64_t            release_to_shard(
+    uint16_t shard,
+    uint64_t desired_release_count,
+    CHUNK* chunk);
+
+  /** Not thread safe. Use it after taking the lock of the shard. */
 #ifndef NDEBUG
-    const uint64_t free_count = get_free_pool_count();
-    const uint64_t free_head = free_pool_head();
-    for (uint64_t i = 0; i < free_count; ++i) {
-      uint64_t index = free_head + i;
-      while (index >= free_pool_capacity_) {
-        index -= free_pool_capacity_;
+  void                assert_free_pool(uint16_t shard) const {
+    const PagePoolShard& s = get_shard(shard);
+    const uint64_t begin = get_shard_begin(shard);
+    const uint64_t capacity = get_shard_capacity(shard);
+    ASSERT_ND(s.count_ <= capacity);
+    ASSERT_ND(s.head_ < capacity);
+    for (uint64_t i = 0; i < s.count_; ++i) {
+      uint64_t index = s.head_ + i;
+      while (index >= capacity) {
+        index -= capacity;
       }
-      PagePoolOffset* address = free_pool_ + index;
+      PagePoolOffset* address = free_pool_ + begin + index;
       ASSERT_ND(*address >= pages_for_free_pool_);
       ASSERT_ND(*address < pool_size_);
     }
-#endif  // NDEBUG
   }
+#else  // NDEBUG
+  void                assert_free_pool(uint16_t /*shard*/) const {}
+#endif  // NDEBUG
 
   std::string         get_debug_pool_name() const {
     if (control_block_) {
@@ -175,11 +281,15 @@ class PagePoolPimpl final : public DefaultInitializable {
   uint64_t                        pages_for_free_pool_;
 
   /**
-   * We maintain free pages as a simple circular queue.
+   * We maintain free pages as circular queues, one for each shard.
    * We append new/released pages to tail while we eat from head.
    */
   PagePoolOffset*                 free_pool_;
-  /** Size of free_pool_. Immutable once initialized. */
+  /**
+   * Size of free_pool_ calculated from this engine's options.
+   * Used only by the owner to initialize PagePoolControlBlock::free_pool_capacity_.
+   * Use get_free_pool_capacity() otherwise.
+   */
   uint64_t                        free_pool_capacity_;
 };
 static_assert(
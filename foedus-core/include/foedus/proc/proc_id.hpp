@@ -21,6 +21,7 @@
 #include <stdint.h>
 
 #include <utility>
+#include <vector>
 
 #include "foedus/error_stack.hpp"
 #include "foedus/fwd.hpp"
@@ -118,6 +119,27 @@ typedef ErrorStack (*Proc)(const ProcArguments& args);
  */
 typedef std::pair<ProcName, Proc> ProcAndName;
 
+/**
+ * @brief Signature of the entry function a shared library of user procedures must export.
+ * @ingroup PROC
+ * @details
+ * ProcManager dlopen()s the libraries specified in ProcOptions, looks up a function of
+ * the name kProcLibraryEntryName, and calls it to receive the procedures defined in the library.
+ * The function must have C linkage so that its name is not mangled. For example:
+ * @code{.cpp}
+ * extern "C" void foedus_list_procs(std::vector<foedus::proc::ProcAndName>* out) {
+ *   out->push_back(foedus::proc::ProcAndName("my_proc", &my_proc));
+ * }
+ * @endcode
+ */
+typedef void (*ProcLibraryEntry)(std::vector<ProcAndName>* out);
+
+/**
+ * Name of the entry function each shared library of user procedures must export.
+ * @ingroup PROC
+ */
+const char* const kProcLibraryEntryName = "foedus_list_procs";
+
 }  // namespace proc
 }  // namespace foedus
 #endif  // FOEDUS_PROC_PROC_ID_HPP_
@@ -18,6 +18,8 @@
 #ifndef FOEDUS_PROC_PROC_MANAGER_HPP_
 #define FOEDUS_PROC_PROC_MANAGER_HPP_
 
+#include <stdint.h>
+
 #include <string>
 #include <vector>
 
@@ -25,6 +27,7 @@
 #include "foedus/initializable.hpp"
 #include "foedus/proc/fwd.hpp"
 #include "foedus/proc/proc_id.hpp"
+#include "foedus/thread/thread_id.hpp"
 
 namespace foedus {
 namespace proc {
@@ -51,9 +54,35 @@ class ProcManager CXX11_FINAL : public virtual Initializable {
    * @param[in] name Name of the procedure that has been registered via one of the following methods
    * @param[out] out Function pointer of the procedure.
    * @return Error if the given procedure name is not found.
+   * @details
+   * The function pointer of a procedure loaded from a shared library becomes invalid once
+   * reload_shared_libraries() replaces the library. Workers thus look it up and invoke it
+   * between begin_invocation() and end_invocation().
    */
   ErrorStack  get_proc(const ProcName& name, Proc* out);
 
+  /**
+   * @brief Declares that the given worker starts running procedures of this SOC.
+   * @param[in] thread_id The calling worker thread in this SOC.
+   * @pre This engine is an SOC engine (child engine), not the master.
+   * @details
+   * Until end_invocation(), reload_shared_libraries() waits instead of replacing procedures.
+   * If a reload is in progress, this waits until it completes.
+   * Worker threads call this around get_proc() and the invocations of the procedures, once
+   * per impersonation or per batch of TaskQueue requests.
+   * This only writes a flag in the worker's own control block, which reload_shared_libraries()
+   * scans, so workers don't contend with each other.
+   */
+  void        begin_invocation(thread::ThreadId thread_id);
+  /** @see begin_invocation() */
+  void        end_invocation(thread::ThreadId thread_id);
+  /**
+   * Returns a number that changes whenever reload_shared_libraries() replaces the procedures
+   * of this SOC. Workers that cache function pointers look them up again when this changes.
+   * @pre This engine is an SOC engine (child engine), not the master.
+   */
+  uint64_t    get_generation() const;
+
   /**
    * @brief Pre-register a function pointer as a user procedure so that all SOCs will have it
    * when they are forked.
@@ -96,6 +125,36 @@ class ProcManager CXX11_FINAL : public virtual Initializable {
    */
   ErrorStack  emulated_register(const ProcAndName& proc_and_name);
 
+  /**
+   * @brief Re-loads the shared libraries specified in ProcOptions and replaces all
+   * procedures of the previously loaded libraries with the procedures of the new ones.
+   * @pre Engine is initialized.
+   * @pre Either this is a child SOC engine whose type is not kChildEmulated (local mode),
+   * or this is a master engine whose child SOCs are of kChildEmulated type (emulated mode).
+   * @pre If this is called from a procedure, the procedure is not from a shared library.
+   * @details
+   * Child SOC engines load the libraries of their NUMA node during initialization.
+   * This method lets the user deploy new versions of the libraries without restarting the engine.
+   * In local mode, this reloads the libraries of the current SOC and takes effect only in it,
+   * just like local_register(). In emulated mode, all SOCs reside in this process, so
+   * this reloads the libraries of all NUMA nodes and takes effect in all SOCs,
+   * just like emulated_register().
+   *
+   * This first loads the new libraries while the old ones are still loaded. We dlopen() a
+   * private copy of each library file because dlopen() of the same path would return the
+   * old image. If any of them fails to load, this returns the error without changing anything.
+   * Then, this waits until no worker in the SOCs is running a procedure (see begin_invocation()),
+   * and rebuilds their procedures: procedures of the old libraries are all dropped,
+   * even if the new libraries don't have them any more, then those of the new libraries are added.
+   * Other procedures, eg pre-registered ones, are kept as they are.
+   * Libraries newly placed in shared_library_dir_pattern_ are also loaded, and procedures of
+   * libraries removed from there are dropped.
+   * Finally, this unloads the old libraries.
+   * Deploy a new library by renaming it to the path (eg install(1)) rather than overwriting
+   * the file, which would corrupt the old image while it is in use.
+   */
+  ErrorStack  reload_shared_libraries();
+
   /** For debug uses only. Returns a summary of procedures registered in this engine */
   std::string describe_registered_procs() const;
 
@@ -18,6 +18,8 @@
 #ifndef FOEDUS_PROC_PROC_MANAGER_PIMPL_HPP_
 #define FOEDUS_PROC_PROC_MANAGER_PIMPL_HPP_
 
+#include <atomic>
+#include <map>
 #include <string>
 #include <vector>
 
@@ -27,6 +29,7 @@
 #include "foedus/proc/proc_id.hpp"
 #include "foedus/soc/shared_memory_repo.hpp"
 #include "foedus/soc/shared_mutex.hpp"
+#include "foedus/thread/thread_id.hpp"
 
 namespace foedus {
 namespace proc {
@@ -41,6 +44,8 @@ struct ProcManagerControlBlock {
   void initialize() {
     lock_.initialize();
     count_ = 0;
+    reloading_.store(false);
+    generation_.store(0);
   }
   void uninitialize() {
     lock_.uninitialize();
@@ -50,9 +55,31 @@ struct ProcManagerControlBlock {
    * Mutex to protect data.
    * Read access via process ID does not need a lock (because we only append to the last).
    * Modifications and reads via name (because it's sorted) needs to take a lock.
+   * reload_shared_libraries() rewrites the whole array, so it also waits until no worker
+   * is in an invocation (see ThreadControlBlock::in_proc_invocation_).
    */
   soc::SharedMutex  lock_;
   LocalProcId       count_;
+
+  /**
+   * While this is true, reload_shared_libraries() is rebuilding the procedures.
+   * Workers only read this, so it stays in their caches except during reloads.
+   */
+  std::atomic<bool>     reloading_;
+  /**
+   * Incremented whenever reload_shared_libraries() rebuilds the procedures, so that
+   * workers that cache function pointers (eg TaskQueue) look them up again.
+   */
+  std::atomic<uint64_t> generation_;
+};
+
+/** A shared library of user procedures dlopen()-ed for a NUMA node. */
+struct LoadedSharedLibrary {
+  /** Path of the library as listed in ProcOptions */
+  std::string                 path_;
+  void*                       handle_;
+  /** Procedures the library handed over. Their names are owned by the library. */
+  std::vector< ProcAndName >  procs_;
 };
 
 /**
@@ -85,12 +112,71 @@ class ProcManagerPimpl final : public DefaultInitializable {
   ErrorStack  pre_register(const ProcAndName& proc_and_name);
   ErrorStack  local_register(const ProcAndName& proc_and_name);
   ErrorStack  emulated_register(const ProcAndName& proc_and_name);
+  ErrorStack  reload_shared_libraries();
+  void        begin_invocation(thread::ThreadId thread_id);
+  void        end_invocation(thread::ThreadId thread_id);
+  uint64_t    get_generation() const;
   SharedData* get_local_data();
   const SharedData* get_local_data() const;
 
   static LocalProcId find_by_name(const ProcName& name, SharedData* shared_data);
   static LocalProcId insert(const ProcAndName& proc_and_name, SharedData* shared_data);
 
+  /** Returns the paths of shared libraries to load in the given node, as per ProcOptions. */
+  std::vector< std::string > list_shared_libraries(soc::SocId node) const;
+  /**
+   * @brief Loads the shared libraries of the given node and receives their procedures.
+   * @param[in] node NUMA node whose library path patterns we use
+   * @param[in,out] copies If null, we dlopen() the libraries as they are.
+   * Otherwise, we dlopen() a private copy of each library so that we get a new image even
+   * while the old one is still loaded. Copies made for another node are reused.
+   * This is a map from the path of a library to the path of its copy.
+   * @param[out] out Libraries we loaded. Empty if this returns an error.
+   */
+  ErrorStack  open_shared_libraries(
+    soc::SocId node,
+    std::map< std::string, std::string >* copies,
+    std::vector< LoadedSharedLibrary >* out);
+  /** dlopen() the file at load_path as the library at path and receives its procedures. */
+  static ErrorStack open_shared_library(
+    const std::string& path,
+    const std::string& load_path,
+    LoadedSharedLibrary* out);
+  /** Makes a private copy of the library at path in the same folder. */
+  static ErrorStack copy_shared_library(const std::string& path, std::string* copy_path);
+  /** dlclose() all the given libraries and clears the vector. */
+  static void       close_shared_libraries(std::vector< LoadedSharedLibrary >* libraries);
+
+  /** Returns the in-invocation flag of the given worker. */
+  std::atomic<bool>* get_invocation_flag(thread::ThreadId thread_id) const;
+  /**
+   * @brief Prohibits new invocations in the SOC and waits until the running ones finish.
+   * @details
+   * This scans the in-invocation flags of all workers in the SOC.
+   * If this thread is itself running a procedure of the SOC, we don't wait for it.
+   * That procedure must not come from a library we reload.
+   */
+  void              quiesce(soc::SocId node) const;
+  /** Allows invocations in the SOC again. */
+  static void       resume(SharedData* shared_data);
+  /**
+   * @brief Computes the procedures of the SOC after replacing libraries.
+   * @param[in] shared_data The SOC. Its lock must be taken.
+   * @param[in] old_libraries Libraries the SOC has loaded so far. Their procedures are dropped
+   * even if the new libraries do not define them any more.
+   * @param[in] new_libraries Libraries to replace them. Their procedures are added.
+   * @param[out] out All procedures of the SOC after the replacement
+   * @return kErrorCodeProcProcAlreadyExists if a new procedure has the same name as
+   * another procedure.
+   */
+  static ErrorStack build_procs(
+    const SharedData& shared_data,
+    const std::vector< LoadedSharedLibrary >& old_libraries,
+    const std::vector< LoadedSharedLibrary >& new_libraries,
+    std::vector< ProcAndName >* out);
+  /** Overwrites the procedures of a quiesced SOC. Its lock must be taken. */
+  static void       replace_procs(const std::vector< ProcAndName >& procs, SharedData* shared_data);
+
   Engine* const               engine_;
   std::vector< ProcAndName >  pre_registered_procs_;
   /**
@@ -46,6 +46,7 @@ struct  SnapshotMetadata;
 struct  SnapshotOptions;
 class   SnapshotWriter;
 class   SortedBuffer;
+struct  StorageSelection;
 }  // namespace snapshot
 }  // namespace foedus
 #endif  // FOEDUS_SNAPSHOT_FWD_HPP_
@@ -18,6 +18,8 @@
 #ifndef FOEDUS_SNAPSHOT_LOG_BUFFER_HPP_
 #define FOEDUS_SNAPSHOT_LOG_BUFFER_HPP_
 
+#include <aio.h>
+
 #include <iosfwd>
 #include <string>
 
@@ -104,7 +106,7 @@ class SortedBuffer {
     return relative_pos + offset_;
   }
 
-  /** Returns the buffer memory. */
+  /** Returns the buffer memory. It might be a different memory after wind(). */
   const char* get_buffer() const { return buffer_; }
 
   /** Returns the size of buffer memory. */
@@ -162,6 +164,7 @@ class SortedBuffer {
    * @pre next_absolute_pos >= get_offset() : we allow foward-only iteration.
    * @pre next_absolute_pos <= get_offset() + get_buffer_size() : we allow contiguous-read only.
    * @post get_offset() + get_buffer_size() > next_absolute_pos >= get_offset()
+   * @post get_buffer() might have changed. Callers must not keep the previous one.
    * @return File I/O related errors only
    */
   virtual ErrorCode     wind(uint64_t next_absolute_pos) = 0;
@@ -191,7 +194,8 @@ class SortedBuffer {
   }
 
  protected:
-  char* const         buffer_;
+  /** Current window. DumpFileSortedBuffer switches it to the read-ahead buffer in wind(). */
+  char*               buffer_;
   const uint64_t      buffer_size_;
   /** see get_offset() */
   uint64_t            offset_;
@@ -243,6 +247,16 @@ class InMemorySortedBuffer CXX11_FINAL : public SortedBuffer {
  * @details
  * When the reducer's buffer becomes full, it sorts all entries in it and dumps it to a file
  * (sorted run file). This stream sequentially reads from the file.
+ *
+ * @par Read-ahead
+ * If a read-ahead buffer is given, this object double-buffers the file.
+ * While the composer consumes the current window, an asynchronous read (aio_read(), same as
+ * snapshot page reads) loads the next window into the read-ahead buffer. The next window starts
+ * read_ahead_overlap_ bytes before the end of the current one because the caller usually winds
+ * to a position a bit before the end. wind() then waits for the read and just swaps the two
+ * buffers, without copying anything. Only when the caller retains more than the overlap, wind()
+ * discards the read-ahead and synchronously reads the window again.
+ * Thus I/O on hundreds of sorted runs overlaps with merging.
  */
 class DumpFileSortedBuffer CXX11_FINAL : public SortedBuffer {
  public:
@@ -250,23 +264,59 @@ class DumpFileSortedBuffer CXX11_FINAL : public SortedBuffer {
    * wraps the given file as a buffer. note that this object does \b NOT take ownership of
    * anything given to this constructor. it doesn't delete/open file or memory. it's caller's
    * responsibility (in other words, this object is just a view. so is InMemorySortedBuffer).
+   * @param[in] file the sorted run file, opened for read
+   * @param[in] io_buffer the window of this buffer
+   * @param[in] read_ahead_buffer if valid, used to asynchronously read the next window.
+   * Its size must be same as io_buffer.
    */
-  DumpFileSortedBuffer(fs::DirectIoFile *file, memory::AlignedMemorySlice io_buffer);
-  ~DumpFileSortedBuffer() CXX11_OVERRIDE {}
+  DumpFileSortedBuffer(
+    fs::DirectIoFile *file,
+    memory::AlignedMemorySlice io_buffer,
+    memory::AlignedMemorySlice read_ahead_buffer = memory::AlignedMemorySlice());
+  ~DumpFileSortedBuffer() CXX11_OVERRIDE;
 
   std::string to_string() const CXX11_OVERRIDE;
   ErrorCode   wind(uint64_t next_absolute_pos) CXX11_OVERRIDE;
   void        describe(std::ostream* o) const CXX11_OVERRIDE;
 
+  /**
+   * Reads the first window from the file, then starts reading ahead if enabled.
+   * @pre nothing has been read from the file yet
+   */
+  ErrorCode   read_first_window();
+
   fs::DirectIoFile*                 get_file()      const { return file_; }
+  /** Returns the current window. This and the read-ahead buffer swap in wind(). */
   const memory::AlignedMemorySlice& get_io_buffer() const { return io_buffer_; }
+  bool        is_read_ahead_enabled() const { return read_ahead_buffer_.is_valid(); }
+  uint64_t    get_read_ahead_overlap() const { return read_ahead_overlap_; }
 
  private:
   enum Constants {
     kAlignment = 1 << 12,
+    /** The overlap is at least this, the largest log, unless the window is too small. */
+    kMinReadAheadOverlap = 1 << 16,
   };
   fs::DirectIoFile* const           file_;
-  memory::AlignedMemorySlice const  io_buffer_;
+  memory::AlignedMemorySlice        io_buffer_;
+  memory::AlignedMemorySlice        read_ahead_buffer_;
+
+  /**
+   * The next window read ahead starts at this many bytes before the end of the current window.
+   * 1/16 of the window, at least kMinReadAheadOverlap and at most half of the window.
+   */
+  uint64_t                          read_ahead_overlap_;
+  /** Whether the read-ahead is in flight and read_ahead_control_ is in use. */
+  bool                              read_ahead_active_;
+  /** The absolute byte position the last read-ahead started from. */
+  uint64_t                          read_ahead_offset_;
+  /** Control block of the read-ahead. It must stay at this address while in flight. */
+  struct aiocb                      read_ahead_control_;
+
+  /** Issues an asynchronous read of the next window into the read-ahead buffer. */
+  ErrorCode   start_read_ahead();
+  /** Waits for the current read-ahead, if any, and returns its result. */
+  ErrorCode   wait_read_ahead();
 };
 
 }  // namespace snapshot
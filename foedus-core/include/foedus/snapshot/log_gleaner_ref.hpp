@@ -50,6 +50,7 @@ class LogGleanerRef : public Attachable<LogGleanerControlBlock> {
   uint16_t increment_completed_mapper_count();
   uint16_t increment_error_count();
   uint16_t increment_exit_count();
+  void     add_read_ahead_log_bytes(uint64_t bytes);
 
   bool is_all_exitted() const;
   bool is_all_completed() const;
@@ -57,6 +58,7 @@ class LogGleanerRef : public Attachable<LogGleanerControlBlock> {
   uint16_t get_mappers_count() const;
   uint16_t get_reducers_count() const;
   uint16_t get_all_count() const;
+  uint64_t get_read_ahead_log_bytes() const;
 
  protected:
   storage::PartitionerMetadata* partitioner_metadata_;
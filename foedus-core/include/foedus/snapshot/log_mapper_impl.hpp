@@ -21,8 +21,10 @@
 
 #include <iosfwd>
 #include <string>
+#include <vector>
 
 #include "foedus/compiler.hpp"
+#include "foedus/epoch.hpp"
 #include "foedus/fwd.hpp"
 #include "foedus/initializable.hpp"
 #include "foedus/fs/fwd.hpp"
@@ -58,6 +60,16 @@ namespace snapshot {
  * exists (see LogGleaner).
  *  \li Mappers send logs to corresponding reducers with a compact metadata for each storage.
  *
+ * @section MAPPER_READ_AHEAD Reading logs ahead of snapshots
+ * When SnapshotOptions::log_mapper_read_ahead_ is true, the snapshot daemon of each node calls
+ * read_ahead_durable_logs() of its mappers while the engine is not taking a snapshot.
+ * This reads logs that became durable since the last snapshot into the IO buffer, continuing
+ * from where the previous call stopped, until the buffer becomes full.
+ * When the next snapshot starts, handle_process() uses the buffer as its first read if the
+ * snapshot's log range starts at the same position. Otherwise the buffer is just discarded.
+ * The daemon thread launches and joins mapper threads, so the two never use the buffer
+ * at the same time.
+ *
  * @section MAPPER_OPTIMIZATION Possible Optimization
  * The log gleaner so far simply reads from log files.
  * We have a plan to optimize its behavior when we have a large amount of DRAM by directly reading
@@ -82,6 +94,15 @@ class LogMapper final : public MapReduceBase {
   }
   friend std::ostream&    operator<<(std::ostream& o, const LogMapper& v);
 
+  /**
+   * @brief Reads logs that became durable after the given epoch into the IO buffer.
+   * @param[in] base_epoch epoch of the last snapshot, which the next snapshot will start from
+   * @details
+   * Called by the snapshot daemon while the engine is not taking a snapshot.
+   * @see MAPPER_READ_AHEAD
+   */
+  ErrorStack  read_ahead_durable_logs(Epoch base_epoch);
+
  protected:
   ErrorStack  handle_process() override;
 
@@ -193,9 +214,25 @@ class LogMapper final : public MapReduceBase {
     uint64_t to_infile(uint64_t inbuf) const { return inbuf + buf_infile_aligned_; }
   };
 
+  /** Logs read_ahead_durable_logs() has put in io_buffer_. */
+  struct ReadAheadStatus {
+    /** base_epoch of the last call. We skip the call when this and durable_bytes_ are same. */
+    Epoch::EpochInteger base_epoch_;
+    /** LoggerRef::get_durable_bytes() as of the last call. */
+    uint64_t durable_bytes_;
+    log::LogFileOrdinal file_ordinal_;
+    /** 4kb-aligned offset in the file that corresponds to the beginning of io_buffer_. */
+    uint64_t buf_infile_aligned_;
+    /** 4kb-aligned bytes already read to io_buffer_. 0 means io_buffer_ has nothing to reuse. */
+    uint64_t size_inbuf_aligned_;
+  };
+
   /** buffer to read from file. */
   memory::AlignedMemory   io_buffer_;
 
+  /** Written only by read_ahead_durable_logs() and consumed by handle_process(). */
+  ReadAheadStatus         read_ahead_;
+
   /** memory for Bucket. */
   memory::AlignedMemory   buckets_memory_;
 
@@ -218,7 +255,8 @@ class LogMapper final : public MapReduceBase {
   memory::AlignedMemory   presort_reordered_;
 
   /**
-   * Slice of tmp_memory_ used as send buffer.
+   * Slice of tmp_memory_ used as send buffer for reducers on other NUMA nodes.
+   * Log entries for the reducer on the same node are stitched directly in its buffer.
    * Size is kSendBufferSize (1MB).
    */
   memory::AlignedMemorySlice  tmp_send_buffer_slice_;
@@ -260,6 +298,21 @@ class LogMapper final : public MapReduceBase {
   /** just for reporting. */
   uint64_t                processed_log_count_;
 
+  /**
+   * Copy of Snapshot::selective_ of the current snapshot.
+   * When true, the tight loop checks StorageSelection of each log's storage.
+   */
+  bool                    selective_;
+  /** Copy of Snapshot::max_storage_id_ of the current snapshot. */
+  storage::StorageId      selective_max_storage_id_;
+  /** StorageSelection of each storage in shared memory. */
+  StorageSelection*       storage_selections_;
+  /**
+   * Number of logs of deferred storages this mapper has seen, indexed by storage ID.
+   * Added to StorageSelection::pending_logs_ when this mapper completes.
+   */
+  std::vector<uint64_t>   deferred_log_counts_;
+
   /**
    * A stupidly simple hashtable for BucketHashList.
    * Key is StorageId. 256 entries for the last 1 byte of StorageId (StorageId & 0xFF).
@@ -287,6 +340,15 @@ class LogMapper final : public MapReduceBase {
    */
   bool        bucket_log(storage::StorageId storage_id, uint64_t pos) ALWAYS_INLINE;
 
+  /**
+   * Used only in selective snapshots.
+   * @return whether the log should go to reducers. false if the log is already in a snapshot
+   * or its storage is deferred in this snapshot, in which case we just count it.
+   */
+  bool        select_log(const log::LogHeader* header) ALWAYS_INLINE;
+  /** Adds up deferred_log_counts_ to the shared StorageSelection::pending_logs_. */
+  void        flush_deferred_log_counts();
+
   /**
    * Add a new bucket for the specified storage.
    * This method is only occasionally called.
@@ -169,6 +169,8 @@ struct LogReducerControlBlock {
     buffer_status_[0].store(0U);
     buffer_status_[1].store(0U);
     total_storage_count_ = 0;
+    in_memory_sorted_runs_ = 0;
+    dumped_sorted_runs_ = 0;
   }
   void uninitialize() {
   }
@@ -208,6 +210,15 @@ struct LogReducerControlBlock {
    */
   std::atomic<uint32_t> total_storage_count_;
 
+  /**
+   * Number of sorted runs this reducer kept in memory in the current snapshot.
+   * Just for monitoring and testing.
+   * @see SnapshotOptions::log_reducer_in_memory_runs_mb_
+   */
+  std::atomic<uint32_t> in_memory_sorted_runs_;
+  /** Number of sorted runs this reducer dumped to files in the current snapshot. */
+  std::atomic<uint32_t> dumped_sorted_runs_;
+
   /** ID of this reducer (or numa node ID). not mutable, just for convenience. */
   uint16_t              id_;
 };
@@ -308,23 +319,28 @@ class LogReducer final : public MapReduceBase {
    * Context object used throughout merge_sort().
    */
   struct MergeContext {
-    explicit MergeContext(uint32_t dumped_files_count_);
+    MergeContext(uint32_t sorted_runs_count, uint32_t dumped_files_count);
     ~MergeContext();
 
     /**
-     * Number of sorted runs dumped to files.
+     * Number of sorted runs, either dumped to files or kept in memory.
      * After populating sorted_buffers_, this number should be come sorted_buffers_.size() - 1
      * because of the in-memory sorted buffer.
      */
+    const uint32_t                            sorted_runs_count_;
+    /** Number of sorted runs dumped to files. */
     const uint32_t                            dumped_files_count_;
     memory::AlignedMemory                     io_memory_;
     std::vector< memory::AlignedMemorySlice > io_buffers_;
+    /** Read-ahead buffers of DumpFileSortedBuffer. Index is same as io_buffers_ */
+    std::vector< memory::AlignedMemorySlice > read_ahead_buffers_;
 
     /**
      * @brief stream objects that keep reading storage blocks.
      * @details
      * The first one is always the InMemorySortedBuffer (based on last_buffer_).
-     * Others are DumpFileSortedBuffer for the sorted run files.
+     * Others are DumpFileSortedBuffer for the sorted run files, or InMemorySortedBuffer for
+     * sorted runs kept in memory, in the order of sorted runs.
      * Dummy block is automatically skipped.
      * If storage_id_ is zero, it means that the stream reached the end.
      */
@@ -407,13 +423,31 @@ class LogReducer final : public MapReduceBase {
   memory::AlignedMemory   writer_intermediate_memory_;
 
   /**
-   * How many buffers written out as a temporary file.
+   * How many buffers written out as a temporary file or kept in memory as a sorted run.
    * If this number is zero when all mappers complete, the reducer does not bother writing out
    * the last and only buffer to file.
    * For now, this value should be always same as current_buffer_.
    */
   uint32_t      sorted_runs_;
 
+  /** In-memory sorted runs are allocated in this unit, not in hugepages */
+  enum { kInMemoryRunAlignment = 1 << 12 };
+  /** A sorted run kept in memory. Same format as a sorted run file except filler blocks. */
+  struct InMemoryRun {
+    /** Allocated for the bytes of logs in the reducer buffer it came from, thus might be larger */
+    memory::AlignedMemory memory_;
+    /** Byte size of the sorted run */
+    uint64_t              bytes_;
+  };
+  /**
+   * Sorted runs kept in memory. Index is the sorted run. Null if the sorted run was dumped to
+   * a file. Released when merge_sort() is done.
+   * @see SnapshotOptions::log_reducer_in_memory_runs_mb_
+   */
+  std::vector< std::unique_ptr<InMemoryRun> > in_memory_runs_;
+  /** Total bytes of memory allocated for in_memory_runs_ */
+  uint64_t      in_memory_runs_bytes_;
+
   void expand_if_needed(
     uint64_t required_size,
     memory::AlignedMemory *memory,
@@ -423,6 +457,11 @@ class LogReducer final : public MapReduceBase {
 
   fs::Path get_sorted_run_file_path(uint32_t sorted_run) const;
 
+  /** Allocates dump_io_buffer_ on this reducer's node. */
+  void        allocate_dump_io_buffer();
+  /** Forgets all sorted runs and releases in-memory runs. Called before and after each snapshot. */
+  void        clear_sorted_runs();
+
   /**
    * Sorts and dumps another buffer (buffers_[sorted_runs_ % 2]).
    * @pre buffers_[sorted_runs_ % 2] is closed for new writers
@@ -467,6 +506,29 @@ class LogReducer final : public MapReduceBase {
     uint32_t* out_longest_key_length,
     uint32_t* written_count);
 
+  /**
+   * Alternative of the file I/O in dump_buffer() when the sorted run fits in
+   * SnapshotOptions::log_reducer_in_memory_runs_mb_.
+   * Sorts each storage and copies the result to a new InMemoryRun.
+   */
+  ErrorStack dump_buffer_in_memory(
+    char* buffer_base,
+    uint64_t buffer_bytes,
+    const std::map<storage::StorageId, std::vector<BufferPosition> >& blocks);
+
+  /**
+   * Copies the sorted logs of one storage to the destination, prefixed by the block header.
+   * @return the number of bytes written, including the block header.
+   */
+  uint64_t dump_buffer_sort_storage_copy(
+    const LogBuffer &buffer,
+    storage::StorageId storage_id,
+    const BufferPosition* sorted_logs,
+    uint32_t shortest_key_length,
+    uint32_t longest_key_length,
+    uint32_t log_count,
+    char* destination) const;
+
   /**
    * Fourth sub routine of dump_buffer().
    * Write the sorted logs to the file.
@@ -52,6 +52,10 @@ class LogReducerRef {
   std::string to_string() const;
   void        clear();
   uint32_t    get_total_storage_count() const;
+  /** Number of sorted runs kept in memory in the current (or last) snapshot */
+  uint32_t    get_in_memory_sorted_runs() const;
+  /** Number of sorted runs dumped to files in the current (or last) snapshot */
+  uint32_t    get_dumped_sorted_runs() const;
   storage::Page* get_root_info_pages() { return root_info_pages_; }
   friend std::ostream&    operator<<(std::ostream& o, const LogReducerRef& v);
 
@@ -79,6 +83,38 @@ class LogReducerRef {
     uint32_t shortest_key_length,
     uint32_t longest_key_length);
 
+  /**
+   * @brief Reserves a contiguous space for a block of log entries in this reducer's buffer.
+   * @param[in] send_buffer_size byte count of the log entries the caller will write
+   * @param[out] buffer_index the reducer buffer that contains the reserved space
+   * @return where the caller writes the log entries. Space for the block header precedes it.
+   * @details
+   * This is the first half of append_log_chunk(). A mapper on the same NUMA node as this
+   * reducer uses it to stitch log entries directly into the reducer's buffer without
+   * an intermediate send buffer. The caller must call commit_log_chunk() soon, because
+   * the reducer can't switch buffers until then.
+   */
+  char* reserve_log_chunk(uint64_t send_buffer_size, uint32_t* buffer_index);
+  /**
+   * @brief Writes the block header for log entries in a space reserved by reserve_log_chunk()
+   * and lets the reducer consume the block.
+   * @param[in] storage_id all log entries are of this storage
+   * @param[in] buffer_index returned by reserve_log_chunk()
+   * @param[in] destination returned by reserve_log_chunk(), now containing the log entries
+   * @param[in] log_count number of log entries written
+   * @param[in] send_buffer_size byte count written. Must be same as reserved.
+   * @param[in] shortest_key_length [masstree/hash] shortest key length in the log entries
+   * @param[in] longest_key_length [masstree/hash] longest key length in the log entries
+   */
+  void commit_log_chunk(
+    storage::StorageId storage_id,
+    uint32_t buffer_index,
+    char* destination,
+    uint32_t log_count,
+    uint64_t send_buffer_size,
+    uint32_t shortest_key_length,
+    uint32_t longest_key_length);
+
  protected:
   const Snapshot& get_cur_snapshot() const;
   uint64_t  get_buffer_size() const;
@@ -87,6 +87,8 @@ class MergeSort CXX11_FINAL : public DefaultInitializable {
   enum Constants {
     /** This is a theoretical max. additionally it must be less than buffer_capacity_ */
     kMaxMergedPosition = 1 << 23,
+    /** Number of least significant bits in SortEntry that store the MergedPosition */
+    kPositionBits = 23,
     /** 1024 logs per chunk */
     kLogChunk = 1 << 10,
     /** Suppose each log is 50 bytes: 1k*256*50b=12.5 MB worth logs to sort per batch. */
@@ -302,7 +304,8 @@ class MergeSort CXX11_FINAL : public DefaultInitializable {
     uint16_t inputs_count,
     uint16_t max_original_pages,
     memory::AlignedMemory* const work_memory,
-    uint16_t chunk_batch_size = kDefaultChunkBatch);
+    uint16_t chunk_batch_size = kDefaultChunkBatch,
+    uint16_t sort_threads = 1);
 
   /**
    * @brief Executes merge-sort on several thousands of logs and provides the result as a batch.
@@ -425,6 +428,8 @@ class MergeSort CXX11_FINAL : public DefaultInitializable {
   const uint16_t                max_original_pages_;
   /** how many chunks one batch has */
   const uint16_t                chunk_batch_size_;
+  /** Number of threads, including the caller, to sort a large batch. */
+  const uint16_t                sort_threads_;
   /** Working memory to be used in this class. Automatically expanded if needed. */
   memory::AlignedMemory* const  work_memory_;
 
@@ -441,10 +446,22 @@ class MergeSort CXX11_FINAL : public DefaultInitializable {
   SortEntry*                    sort_entries_;
   /** Index is MergedPosition */
   PositionEntry*                position_entries_;
+  /** Scratch space of the radix sort on sort_entries_. Same capacity as sort_entries_ */
+  SortEntry*                    sort_buffer_;
   /** kMaxLevels + 1 of original pages. some storage type needs fewer pages. */
   storage::Page*                original_pages_;
   /** index is 0 to inputs_count_ - 1 */
   InputStatus*                  inputs_status_;
+  /**
+   * Loser tree (tournament tree) to pick the input whose chunk-last-key is the smallest.
+   * Node n (1 <= n < inputs_count_) has the loser of the match between node 2n and 2n+1,
+   * where node inputs_count_ + i is the leaf of input-i. Node 0 has the overall winner.
+   * Inputs that are ended or in the last chunk are kInvalidInput, which loses to any input.
+   * pick_chunks() builds it once and then replays only the path of the input it advanced,
+   * so picking each chunk costs O(log inputs_count_) comparisons rather than O(inputs_count_).
+   * Index is 0 to inputs_count_ - 1.
+   */
+  InputIndex*                   loser_tree_;
 
   /** trivial case of next_batch(). */
   void next_batch_one_input();
@@ -471,6 +488,22 @@ class MergeSort CXX11_FINAL : public DefaultInitializable {
    */
   InputIndex determine_min_input() const;
 
+  /** @return the input itself if it can be a batch-threshold. kInvalidInput otherwise */
+  InputIndex get_min_input_candidate(InputIndex input) const;
+  /**
+   * @return whether left precedes right as the batch-threshold.
+   * Same as determine_min_input(), kInvalidInput never precedes others, and the smaller index
+   * precedes in a tie.
+   */
+  bool       precedes_as_min_input(InputIndex left, InputIndex right) const;
+  /**
+   * Builds the subtree of loser_tree_ under the node.
+   * @return the winner of the subtree
+   */
+  InputIndex build_loser_tree(uint32_t node);
+  /** Re-evaluates the matches along the path of the input after its chunk has moved. */
+  void       replay_loser_tree(InputIndex input);
+
   /**
    * subroutine of next_batch for Step a and b.
    * Pick up to kChunkBatch chunks from inputs whose chunk-last-key is the smallest among inputs.
@@ -521,14 +554,16 @@ inline bool is_hash_log_type(uint16_t log_type) {
     log_type == log::kLogCodeHashOverwrite
     || log_type == log::kLogCodeHashInsert
     || log_type == log::kLogCodeHashDelete
-    || log_type == log::kLogCodeHashUpdate;
+    || log_type == log::kLogCodeHashUpdate
+    || log_type == log::kLogCodeHashAdd;
 }
 inline bool is_masstree_log_type(uint16_t log_type) {
   return
     log_type == log::kLogCodeMasstreeInsert
     || log_type == log::kLogCodeMasstreeDelete
     || log_type == log::kLogCodeMasstreeUpdate
-    || log_type == log::kLogCodeMasstreeOverwrite;
+    || log_type == log::kLogCodeMasstreeOverwrite
+    || log_type == log::kLogCodeMasstreeAdd;
 }
 
 inline MergeSort::GroupifyResult MergeSort::groupify(uint32_t begin, uint32_t limit) const {
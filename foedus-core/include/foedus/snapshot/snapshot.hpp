@@ -45,6 +45,8 @@ struct Snapshot {
   /**
    * This snapshot was taken on top of previous snapshot that is valid_until this epoch.
    * If this is the first snapshot, this is an invalid epoch.
+   * When some storage was deferred in previous snapshots, this is the oldest
+   * storage::Metadata::last_snapshot_epoch_ of them.
    */
   Epoch base_epoch_;
 
@@ -57,12 +59,19 @@ struct Snapshot {
   /** Largest storage ID as of starting to take the snapshot. */
   storage::StorageId max_storage_id_;
 
+  /**
+   * Whether mappers must check StorageSelection of each storage up to max_storage_id_.
+   * False if all storages are included in this snapshot and start from base_epoch_.
+   */
+  bool selective_;
+
   friend std::ostream& operator<<(std::ostream& o, const Snapshot& v);
   void clear() {
     id_ = 0;
     base_epoch_ = INVALID_EPOCH;
     valid_until_epoch_ = INVALID_EPOCH;
     max_storage_id_ = 0;
+    selective_ = false;
   }
 };
 }  // namespace snapshot
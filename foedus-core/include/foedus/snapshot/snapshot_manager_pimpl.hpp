@@ -62,6 +62,7 @@ struct LogGleanerControlBlock {
     completed_mapper_count_ = 0;
     error_count_ = 0;
     exit_count_ = 0;
+    read_ahead_log_bytes_ = 0;
     gleaning_ = false;
     cancelled_ = false;
   }
@@ -108,6 +109,13 @@ struct LogGleanerControlBlock {
   */
   std::atomic<uint16_t>           exit_count_;
 
+  /**
+  * Bytes of log files mappers did not have to read in this snapshot because they had
+  * already read them ahead of the snapshot. Just for reporting and testing.
+  * @see SnapshotOptions::log_mapper_read_ahead_
+  */
+  std::atomic<uint64_t>           read_ahead_log_bytes_;
+
   /** Total number of mappers. Not a mutable information, just for convenience. */
   uint16_t                        mappers_count_;
   /** Total number of mappers. Not a mutable information, just for convenience. */
@@ -205,7 +213,7 @@ class SnapshotManagerPimpl final : public DefaultInitializable {
  public:
   SnapshotManagerPimpl() = delete;
   explicit SnapshotManagerPimpl(Engine* engine)
-    : engine_(engine), local_reducer_(nullptr) {}
+    : engine_(engine), storage_selections_(nullptr), local_reducer_(nullptr) {}
   ErrorStack  initialize_once() override;
   ErrorStack  uninitialize_once() override;
 
@@ -261,8 +269,11 @@ class SnapshotManagerPimpl final : public DefaultInitializable {
   /**
    * handle_snapshot() calls this when it should start snapshotting.
    * In other words, this function is the main routine of snapshotting.
+   * @param[out] new_snapshot the snapshot taken
+   * @param[in] recovery whether restart manager calls this during restart, in which case
+   * the snapshot includes all storages regardless of their snapshot thresholds.
    */
-  ErrorStack  handle_snapshot_triggered(Snapshot *new_snapshot);
+  ErrorStack  handle_snapshot_triggered(Snapshot *new_snapshot, bool recovery = false);
 
   /**
    * @brief Main routine for snapshot_thread_ in child engines.
@@ -283,6 +294,27 @@ class SnapshotManagerPimpl final : public DefaultInitializable {
     const Snapshot& new_snapshot,
     std::map<storage::StorageId, storage::SnapshotPagePointer>* new_root_page_pointers);
 
+  /**
+   * Sub-routine of handle_snapshot_triggered(), invoked before glean_logs().
+   * Decides which storages this snapshot defers based on their
+   * storage::Metadata::SnapshotThresholds, fills StorageSelection of each storage,
+   * and sets the base epoch of the new snapshot.
+   * @param[in,out] new_snapshot valid_until_epoch_ and max_storage_id_ must be already set
+   * @param[in] recovery whether this is the snapshot during restart, which defers nothing
+   */
+  void        select_storages(Snapshot* new_snapshot, bool recovery);
+  /**
+   * Sub-routine of handle_snapshot_triggered(), invoked after glean_logs().
+   * Sets storage::Metadata::last_snapshot_epoch_ of each storage according to whether
+   * the storage was deferred and still has pending logs.
+   */
+  void        settle_storage_selection(const Snapshot& new_snapshot);
+  /**
+   * @return whether some storage has logs that are durable but are not in the latest snapshot
+   * although the global snapshot epoch is already at the durable epoch.
+   */
+  bool        has_deferred_storages() const;
+
   /**
    * Sub-routine of handle_snapshot_triggered().
    * Write out a snapshot metadata file that contains metadata of all storages
@@ -322,6 +354,9 @@ class SnapshotManagerPimpl final : public DefaultInitializable {
 
   SnapshotManagerControlBlock*  control_block_;
 
+  /** How the current snapshot treats each storage. Shared memory, indexed by storage ID. */
+  StorageSelection*             storage_selections_;
+
   /**
    * All previously taken snapshots.
    * Access to this data must be protected with mutex.
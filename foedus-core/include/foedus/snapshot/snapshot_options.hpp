@@ -41,6 +41,8 @@ struct SnapshotOptions CXX11_FINAL : public virtual externalize::Externalizable
     kDefaultLogReducerBufferMb            = 256,
     kDefaultLogReducerDumpIoBufferMb      = 8,
     kDefaultLogReducerReadIoBufferKb      = 1024,
+    kDefaultLogReducerSortThreads         = 1,
+    kDefaultLogReducerInMemoryRunsMb      = 0,
     kDefaultSnapshotWriterPagePoolSizeMb  = 128,
     kDefaultSnapshotWriterIntermediatePoolSizeMb  = 16,
   };
@@ -102,6 +104,20 @@ struct SnapshotOptions CXX11_FINAL : public virtual externalize::Externalizable
    */
   bool                                log_mapper_sort_before_send_;
 
+  /**
+   * Whether mappers read durable logs into their IO buffer while the engine is not taking
+   * a snapshot.
+   * When true, the snapshot daemon of each node keeps reading logs that became durable since
+   * the last snapshot, at most log_mapper_io_buffer_mb_ per mapper.
+   * When the next snapshot starts, mappers process the logs already in their buffer without
+   * reading them again, so the snapshot spends less time on log file I/O.
+   * This is a best-effort optimization. Mappers read the logs as usual when the buffer does not
+   * correspond to the snapshot's log range, such as after a selective snapshot.
+   * default is false.
+   * @see LogGleanerRef::get_read_ahead_log_bytes()
+   */
+  bool                                log_mapper_read_ahead_;
+
   /**
    * The size in MB of a buffer to store log entries in reducer (partition).
    * Each reducer receives log entries from all mappers, so the right size is likely much
@@ -121,11 +137,37 @@ struct SnapshotOptions CXX11_FINAL : public virtual externalize::Externalizable
 
   /**
    * The size in KB of a buffer in reducer to read one temporary file.
-   * Note that the total memory consumption is this number times the number of temporary files.
-   * It's a merge-sort.
+   * Each temporary file also has a read-ahead buffer of the same size, which is filled in
+   * background while the reducer merges. Note that the total memory consumption is thus twice
+   * this number times the number of temporary files. It's a merge-sort.
    */
   uint32_t                            log_reducer_read_io_buffer_kb_;
 
+  /**
+   * Number of threads, including the reducer itself, that sort a batch of log entries in
+   * reducer. The reducer spawns the helper threads only for large batches, so this matters
+   * when log_reducer_buffer_mb_ is large and the reducer's NUMA node has idle cores.
+   * 1 (default) means the reducer sorts alone.
+   */
+  uint16_t                            log_reducer_sort_threads_;
+
+  /**
+   * The total size in MB of sorted runs each reducer keeps in memory rather than writing them
+   * to temporary files.
+   * When the reducer buffer becomes full, the reducer sorts it and, if the sorted run fits within
+   * this budget, copies it to a memory of the exact size and gives it to composers directly
+   * at the end. It spills the sorted run to a file as usual only when the budget is exhausted.
+   * With frequent small snapshots, all logs of one snapshot usually fit in a few sorted runs,
+   * so this saves all file I/O of dumping and merging.
+   * 0 (default) means the reducer always dumps sorted runs to files.
+   * @note Only the memory of each in-memory sorted run is sized to the logs it holds.
+   * The reducer buffer itself is not sized adaptively. It is always log_reducer_buffer_mb_,
+   * and a sorted run is at most half of it.
+   * LogReducerRef::get_in_memory_sorted_runs() and LogReducerRef::get_dumped_sorted_runs()
+   * tell how the last snapshot used this budget.
+   */
+  uint32_t                            log_reducer_in_memory_runs_mb_;
+
   /**
    * The size in MB of one snapshot writer, which holds data pages modified in the snapshot
    * and them sequentially dumps them to a file for each storage.
@@ -0,0 +1,76 @@
+/*
+ * Copyright (c) 2014-2015, Hewlett-Packard Development Company, LP.
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details. You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * HP designates this particular file as subject to the "Classpath" exception
+ * as provided by HP in the LICENSE.txt file that accompanied this code.
+ */
+#ifndef FOEDUS_SNAPSHOT_STORAGE_SELECTION_HPP_
+#define FOEDUS_SNAPSHOT_STORAGE_SELECTION_HPP_
+
+#include <stdint.h>
+
+#include <cstring>
+
+#include "foedus/epoch.hpp"
+
+namespace foedus {
+namespace snapshot {
+/**
+ * @brief Tells mappers how to treat the logs of one storage in the current snapshot.
+ * @ingroup SNAPSHOT
+ * @details
+ * A storage whose storage::Metadata::SnapshotThresholds::snapshot_trigger_threshold_ is
+ * non-zero is snapshotted only after it accumulates that many log records.
+ * Until then, the snapshot manager \e defers the storage: its logs stay in the log files,
+ * its volatile pages are not dropped, and its root snapshot page stays as of
+ * storage::Metadata::last_snapshot_epoch_.
+ * When the storage is finally snapshotted, mappers read its logs from that epoch, which might
+ * be older than the previous snapshot, so the snapshot's base epoch is the minimum of them.
+ *
+ * The snapshot manager fills this object for each storage before it launches the gleaner,
+ * and mappers add up pending_logs_ of deferred storages as they scan the logs.
+ * This object is placed in shared memory, one for each storage ID.
+ */
+struct StorageSelection {
+  enum Constants {
+    /**
+     * A storage is never deferred for more than this number of epochs.
+     * Mappers and reducers compress epochs relative to the base epoch into 16 bits,
+     * and we don't want to keep too many volatile pages and log files alive, either.
+     */
+    kMaxDeferredEpochs = 1 << 12,
+  };
+
+  /**
+   * Logs of this storage in this epoch or before are already in a snapshot.
+   * Mappers skip them. Invalid if the storage has never been snapshotted.
+   */
+  Epoch::EpochInteger from_epoch_;
+  /** Whether the current snapshot skips this storage, carrying its logs forward. */
+  uint32_t            deferred_;
+  /**
+   * Number of log records of this storage that are not in any snapshot yet.
+   * Counted by mappers only while the storage is deferred.
+   */
+  uint64_t            pending_logs_;
+
+  void initialize() { std::memset(this, 0, sizeof(*this)); }
+
+  Epoch get_from_epoch() const { return Epoch(from_epoch_); }
+  bool  is_deferred() const { return deferred_ != 0; }
+};
+
+}  // namespace snapshot
+}  // namespace foedus
+#endif  // FOEDUS_SNAPSHOT_STORAGE_SELECTION_HPP_
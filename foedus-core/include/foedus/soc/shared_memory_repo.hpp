@@ -281,6 +281,19 @@ struct GlobalMemoryAnchors {
    */
   storage::StorageId*                       storage_name_sort_memory_;
 
+  /**
+   * Root snapshot pages of each storage in the last few snapshots, used by transactions
+   * pinned to a snapshot.
+   * The size is sizeof(storage::SnapshotRootHistory) * StorageOptions::max_storages_.
+   */
+  storage::SnapshotRootHistory*             snapshot_root_history_memory_;
+
+  /**
+   * How the current snapshot treats the logs of each storage, used by selective snapshotting.
+   * The size is sizeof(snapshot::StorageSelection) * StorageOptions::max_storages_.
+   */
+  snapshot::StorageSelection*               storage_selection_memory_;
+
   /**
    * Status of each storage instance is stored in this shared memory.
    * The size for one storage must be within 4kb. If the storage type requires more than 4kb,
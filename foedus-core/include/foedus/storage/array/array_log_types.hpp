@@ -30,6 +30,7 @@
 #include "foedus/log/log_type.hpp"
 #include "foedus/storage/record.hpp"
 #include "foedus/storage/storage_id.hpp"
+#include "foedus/storage/value_type.hpp"
 #include "foedus/storage/array/array_id.hpp"
 #include "foedus/storage/array/array_metadata.hpp"
 #include "foedus/storage/array/array_storage.hpp"
@@ -143,35 +144,6 @@ struct ArrayOverwriteLogType : public ArrayCommonUpdateLogType {
   friend std::ostream& operator<<(std::ostream& o, const ArrayOverwriteLogType& v);
 };
 
-/** Used in ArrayIncrementLogType. */
-enum ValueType {
-  kUnknown = 0,
-  kI8 = 1,
-  kI16,
-  kI32,
-  kU8,
-  kU16,
-  kU32,
-  kFloat,
-  kBool,
-  // above are 32bits or less, below are 64 bits
-  kI64,
-  kU64,
-  kDouble,
-};
-template <typename T> ValueType to_value_type();
-template <> inline ValueType to_value_type<bool>() { return kBool; }
-template <> inline ValueType to_value_type<int8_t>() { return kI8; }
-template <> inline ValueType to_value_type<int16_t>() { return kI16; }
-template <> inline ValueType to_value_type<int32_t>() { return kI32; }
-template <> inline ValueType to_value_type<int64_t>() { return kI64; }
-template <> inline ValueType to_value_type<uint8_t>() { return kU8; }
-template <> inline ValueType to_value_type<uint16_t>() { return kU16; }
-template <> inline ValueType to_value_type<uint32_t>() { return kU32; }
-template <> inline ValueType to_value_type<uint64_t>() { return kU64; }
-template <> inline ValueType to_value_type<float>() { return kFloat; }
-template <> inline ValueType to_value_type<double>() { return kDouble ; }
-
 /**
  * @brief Log type of array-storage's increment operation.
  * @ingroup ARRAY LOGTYPE
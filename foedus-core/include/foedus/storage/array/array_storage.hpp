@@ -305,6 +305,30 @@ class ArrayStorage CXX11_FINAL : public Storage<ArrayStorageControlBlock> {
     T value,
     uint16_t payload_offset);
 
+  /**
+   * @brief Blindly adds a value to some data in primitive type, eg a hot counter.
+   * @param[in] context Thread context
+   * @param[in] offset The offset in this array
+   * @param[in] addendum The value to add.
+   * @param[in] payload_offset We add to this byte position of the record.
+   * @tparam T primitive type. All integers and floats are allowed.
+   * @pre payload_offset + sizeof(T) <= get_payload_size()
+   * @pre offset < get_array_size()
+   * @details
+   * Same signature as MasstreeStorage::add_record() and HashStorage::add_record().
+   * Array records are never deleted or resized, so this is exactly increment_record_oneshot():
+   * it emits an ArrayIncrementLogType without a read-set, and the array composer sums up
+   * such logs of the same record.
+   */
+  template <typename T>
+  ErrorCode  add_record(
+    thread::Thread* context,
+    ArrayOffset offset,
+    T addendum,
+    uint16_t payload_offset) {
+    return increment_record_oneshot<T>(context, offset, addendum, payload_offset);
+  }
+
 
   friend std::ostream& operator<<(std::ostream& o, const ArrayStorage& v);
 
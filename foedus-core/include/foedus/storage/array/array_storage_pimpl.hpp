@@ -25,6 +25,8 @@
 #include "foedus/attachable.hpp"
 #include "foedus/compiler.hpp"
 #include "foedus/cxx11.hpp"
+#include "foedus/engine.hpp"
+#include "foedus/error_code.hpp"
 #include "foedus/fwd.hpp"
 #include "foedus/assorted/const_div.hpp"
 #include "foedus/memory/fwd.hpp"
@@ -32,6 +34,7 @@
 #include "foedus/storage/fwd.hpp"
 #include "foedus/storage/storage.hpp"
 #include "foedus/storage/storage_id.hpp"
+#include "foedus/storage/storage_manager.hpp"
 #include "foedus/storage/array/array_id.hpp"
 #include "foedus/storage/array/array_metadata.hpp"
 #include "foedus/storage/array/array_page_impl.hpp"
@@ -40,6 +43,7 @@
 #include "foedus/storage/array/fwd.hpp"
 #include "foedus/thread/fwd.hpp"
 #include "foedus/thread/thread.hpp"
+#include "foedus/xct/xct.hpp"
 
 namespace foedus {
 namespace storage {
@@ -115,6 +119,10 @@ class ArrayStoragePimpl final {
   }
   uint16_t    get_payload_size() const { return get_meta().payload_size_; }
   ArrayOffset get_array_size() const { return get_meta().array_size_; }
+  /**
+   * In a xct::kPinnedSnapshot transaction, *out is null if the storage was empty or did not
+   * exist as of the pinned snapshot. Readers then see zero-cleared records.
+   */
   ErrorCode   get_root_page(thread::Thread* context, bool for_write, ArrayPage** out) ALWAYS_INLINE;
   ErrorStack  verify_single_thread(thread::Thread* context);
   ErrorStack  verify_single_thread(thread::Thread* context, ArrayPage* page);
@@ -338,12 +346,27 @@ inline ErrorCode ArrayStoragePimpl::get_root_page(
   thread::Thread* context,
   bool for_write,
   ArrayPage** out) {
+  DualPagePointer* root_pointer = &control_block_->root_page_pointer_;
+  DualPagePointer pinned_root;
+  if (UNLIKELY(context->get_current_xct().is_pinned_to_snapshot())) {
+    CHECK_ERROR_CODE(engine_->get_storage_manager()->get_pinned_root_pointer(
+      context,
+      get_id(),
+      for_write,
+      &pinned_root));
+    if (pinned_root.snapshot_pointer_ == 0) {
+      // the storage was empty or did not exist as of the pinned snapshot
+      *out = nullptr;
+      return kErrorCodeOk;
+    }
+    root_pointer = &pinned_root;
+  }
   return context->follow_page_pointer(
     nullptr,
     false,
     for_write,
     true,
-    &control_block_->root_page_pointer_,
+    root_pointer,
     reinterpret_cast<Page**>(out),
     nullptr,
     0);
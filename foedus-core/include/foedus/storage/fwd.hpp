@@ -34,6 +34,8 @@ struct  PageVersion;
 class   Partitioner;
 struct  PartitionerMetadata;
 struct  Record;
+struct  RecordFilter;
+struct  SnapshotRootHistory;
 struct  StorageControlBlock;
 class   StorageFactory;
 class   StorageManager;
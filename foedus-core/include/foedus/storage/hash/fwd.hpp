@@ -29,6 +29,7 @@ struct  ComposedBins;
 struct  ComposedBinsBuffer;
 struct  ComposedBinsMergedStream;
 struct  DataPageBloomFilter;
+struct  HashAddLogType;
 struct  HashCombo;
 class   HashComposer;
 struct  HashComposedBinsPage;
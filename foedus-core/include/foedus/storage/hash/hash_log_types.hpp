@@ -29,6 +29,7 @@
 #include "foedus/log/log_type.hpp"
 #include "foedus/storage/record.hpp"
 #include "foedus/storage/storage_id.hpp"
+#include "foedus/storage/value_type.hpp"
 #include "foedus/storage/hash/fwd.hpp"
 #include "foedus/storage/hash/hash_hashinate.hpp"
 #include "foedus/storage/hash/hash_id.hpp"
@@ -163,7 +164,8 @@ struct HashCommonLogType : public log::RecordLogType {
     ASSERT_ND(header_.log_type_code_ == log::kLogCodeHashOverwrite
       || header_.log_type_code_ == log::kLogCodeHashInsert
       || header_.log_type_code_ == log::kLogCodeHashDelete
-      || header_.log_type_code_ == log::kLogCodeHashUpdate);
+      || header_.log_type_code_ == log::kLogCodeHashUpdate
+      || header_.log_type_code_ == log::kLogCodeHashAdd);
     ASSERT_ND(hash_ == hashinate(get_key(), key_length_));
   }
 
@@ -431,6 +433,89 @@ struct HashOverwriteLogType : public HashCommonLogType {
   friend std::ostream& operator<<(std::ostream& o, const HashOverwriteLogType& v);
 };
 
+/**
+ * @brief Log type of hash-storage's blind add operation.
+ * @ingroup HASH LOGTYPE
+ * @details
+ * This is similar to overwrite, but the payload part contains the \e addendum, which is added
+ * to the current value when applied. We remember its ValueType in reserved_.
+ * Transactions emit this log without reading the record, so precommit must check
+ * is_applicable() after locking the record.
+ * @see foedus::storage::masstree::MasstreeAddLogType
+ */
+struct HashAddLogType : public HashCommonLogType {
+  LOG_TYPE_NO_CONSTRUCT(HashAddLogType)
+
+  template <typename PAYLOAD>
+  void            populate(
+    StorageId   storage_id,
+    const void* key,
+    uint16_t    key_length,
+    uint8_t     bin_bits,
+    HashValue   hash,
+    PAYLOAD     addendum,
+    uint16_t    payload_offset) {
+    log::LogCode type = log::kLogCodeHashAdd;
+    populate_base(
+      type,
+      storage_id,
+      key,
+      key_length,
+      bin_bits,
+      hash,
+      &addendum,
+      payload_offset,
+      sizeof(PAYLOAD));
+    reserved_ = to_value_type<PAYLOAD>();
+  }
+
+  ValueType       get_value_type() const { return static_cast<ValueType>(reserved_); }
+
+  /**
+   * @returns whether this log can be applied to the record, which must be locked.
+   * The record might have been deleted or shrunk after the transaction located it.
+   */
+  bool            is_applicable(const xct::RwLockableXctId* owner_id) const ALWAYS_INLINE {
+    ASSERT_ND(owner_id->is_keylocked());
+    if (owner_id->xct_id_.is_deleted()) {
+      return false;
+    }
+    const uint16_t* lengthes = reinterpret_cast<const uint16_t*>(owner_id + 1);
+    return lengthes[3] >= payload_offset_ + payload_count_;
+  }
+
+  void            apply_record(
+    thread::Thread* /*context*/,
+    StorageId /*storage_id*/,
+    xct::RwLockableXctId* owner_id,
+    char* data) ALWAYS_INLINE {
+    ASSERT_ND(!owner_id->xct_id_.is_deleted());
+    ASSERT_ND(!owner_id->xct_id_.is_next_layer());
+    ASSERT_ND(!owner_id->xct_id_.is_moved());
+
+    uint16_t key_length_aligned = get_key_length_aligned();
+    assert_record_and_log_keys(owner_id, data);
+
+#ifndef NDEBUG
+    uint16_t* lengthes = reinterpret_cast<uint16_t*>(owner_id + 1);
+    ASSERT_ND(payload_offset_ + payload_count_ <= lengthes[3]);  // aren't we over-running?
+#endif  // NDEBUG
+
+    add_value(get_value_type(), data + key_length_aligned + payload_offset_, get_payload());
+  }
+
+  void            assert_valid() ALWAYS_INLINE {
+    assert_valid_generic();
+    assert_type();
+    ASSERT_ND(header_.log_length_ == calculate_log_length(key_length_, payload_count_));
+    ASSERT_ND(header_.get_type() == log::kLogCodeHashAdd);
+    ASSERT_ND(get_value_type() >= kI8 && get_value_type() <= kDouble);
+    ASSERT_ND(payload_count_ == get_value_type_size(get_value_type()));
+  }
+
+  friend std::ostream& operator<<(std::ostream& o, const HashAddLogType& v);
+};
+
 }  // namespace hash
 }  // namespace storage
 }  // namespace foedus
@@ -584,6 +584,56 @@ class HashStorage CXX11_FINAL : public Storage<HashStorageControlBlock> {
     const HashCombo& combo,
     PAYLOAD* value,
     uint16_t payload_offset);
+
+  // add_record() methods
+
+  /**
+   * @brief Blindly adds a value to some data in primitive type, eg a hot counter.
+   * @param[in] context Thread context
+   * @param[in] key Arbitrary length of key.
+   * @param[in] key_length Byte size of key.
+   * @param[in] addendum The value to add.
+   * @param[in] payload_offset We add to this byte position of the record.
+   * @pre payload_offset + sizeof(PAYLOAD) must be within the record's actual payload size
+   * (returns kErrorCodeStrTooShortPayload if not)
+   * @tparam PAYLOAD primitive type of the payload. all integers and floats are allowed.
+   * @details
+   * Unlike increment_record(), this method doesn't read the current value, thus doesn't
+   * add the record to the read-set. Concurrent transactions adding to the same record don't
+   * abort each other. They only serialize on the record lock during their precommit.
+   * If the record is deleted or shrunk after this method, the transaction aborts at precommit.
+   */
+  template <typename PAYLOAD>
+  inline ErrorCode add_record(
+    thread::Thread* context,
+    const void* key,
+    uint16_t key_length,
+    PAYLOAD addendum,
+    uint16_t payload_offset) {
+    HashCombo c(combo(key, key_length));
+    return add_record(context, key, key_length, c, addendum, payload_offset);
+  }
+
+  /** Overlord to receive key as a primitive type. */
+  template <typename KEY, typename PAYLOAD>
+  inline ErrorCode add_record(
+    thread::Thread* context,
+    KEY key,
+    PAYLOAD addendum,
+    uint16_t payload_offset) {
+    HashCombo c(combo<KEY>(&key));
+    return add_record(context, &key, sizeof(key), c, addendum, payload_offset);
+  }
+
+  /** If you have already computed HashCombo, use this. */
+  template <typename PAYLOAD>
+  ErrorCode       add_record(
+    thread::Thread* context,
+    const void* key,
+    uint16_t key_length,
+    const HashCombo& combo,
+    PAYLOAD addendum,
+    uint16_t payload_offset);
 };
 }  // namespace hash
 }  // namespace storage
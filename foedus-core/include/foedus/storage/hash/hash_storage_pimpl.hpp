@@ -284,8 +284,20 @@ class HashStoragePimpl final : public Attachable<HashStorageControlBlock> {
     PAYLOAD* value,
     uint16_t payload_offset);
 
+  /** @see foedus::storage::hash::HashStorage::add_record() */
+  template <typename PAYLOAD>
+  ErrorCode   add_record(
+    thread::Thread* context,
+    const void* key,
+    uint16_t key_length,
+    const HashCombo& combo,
+    PAYLOAD addendum,
+    uint16_t payload_offset);
+
   /**
    * Retrieves the root page of this storage.
+   * In a xct::kPinnedSnapshot transaction, *root is null if the storage was empty or did not
+   * exist as of the pinned snapshot.
    */
   ErrorCode   get_root_page(
     thread::Thread* context,
@@ -317,7 +329,7 @@ class HashStoragePimpl final : public Attachable<HashStorageControlBlock> {
    * thus *bin_head!= null.
    *
    * If the search is a for-read search and also the corresponding data page or its ascendants
-   * do not exist yet, *bin_head returns null.
+   * (or even the root page in a pinned snapshot) do not exist yet, *bin_head returns null.
    * In that case, you can just return "not found" as a result.
    * locate_bin() internally adds a pointer set to protect the result, too.
    *
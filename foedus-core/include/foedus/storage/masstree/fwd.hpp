@@ -25,6 +25,7 @@
 namespace foedus {
 namespace storage {
 namespace masstree {
+struct  MasstreeAddLogType;
 class   MasstreeBorderPage;
 struct  MasstreeCommonLogType;
 struct  MasstreeCreateLogType;
@@ -61,6 +61,15 @@ namespace masstree {
  * doesn't match occasionally, that's fine. We just use it to loosely guide the choice of page
  * boundaries in snapshot pages.
  *
+ * @par Same page format as volatile pages
+ * Snapshot border pages use exactly the same MasstreeBorderPage format as volatile pages;
+ * there is no prefix-compressed or variable-width-slice format just for snapshot pages.
+ * Volatile pages are installed as byte copies of snapshot pages, readers search snapshot pages
+ * in place, and cursors rebuild keys from the per-layer slices, so a separate format would
+ * change every reader of border pages, not only this composer. Keys with long common prefixes
+ * thus still go through one layer per 8 bytes. Snapshot pages are dense only because the
+ * composer fills them almost 100%.
+ *
  * @note
  * This is a private implementation-details of \ref MASSTREE, thus file name ends with _impl.
  * Do not include this header from a client program. There is no case client program needs to
@@ -239,12 +248,19 @@ class MasstreeComposeContext {
       return contains_slice(slice);
     }
     bool needs_to_consume_original(KeySlice slice, KeyLength key_length) const {
-      return has_next_original()
-        && (
-          next_original_slice_ < slice
-          || (next_original_slice_ == slice
-              && next_original_remainder_ > kSliceLen
-              && key_length > (layer_ + 1U) * kSliceLen));
+      if (!has_next_original() || next_original_slice_ > slice) {
+        return false;
+      } else if (next_original_slice_ < slice) {
+        return true;
+      }
+      // Same slice. Records of the same slice are ordered by remainder length, and the
+      // record of the same key must be consumed, too, so that delete/overwrite/update find it
+      // as the tail record.
+      KeyLength remainder = key_length - layer_ * kSliceLen;
+      if (remainder > kSliceLen) {
+        return true;  // either a shorter key or the next layer we will go down
+      }
+      return next_original_remainder_ <= remainder;
     }
 
     friend std::ostream& operator<<(std::ostream& o, const PathLevel& v);
@@ -30,6 +30,7 @@
 #include "foedus/assorted/endianness.hpp"
 #include "foedus/storage/fwd.hpp"
 #include "foedus/storage/page.hpp"
+#include "foedus/storage/record_filter.hpp"
 #include "foedus/storage/storage_id.hpp"
 #include "foedus/storage/masstree/fwd.hpp"
 #include "foedus/storage/masstree/masstree_id.hpp"
@@ -71,6 +72,26 @@ namespace masstree {
  * The only drawback is that we consume them in a little bit generous way, but shouldn't be a
  * big issue.
  * All of them are returned to the pool in destructor.
+ *
+ * @par Predicate/Projection Pushdown
+ * Call set_filter() before open() to let the cursor skip records that do not satisfy a
+ * RecordFilter while it iterates over each border page. get_projected_payload() then returns
+ * only the range of payload the filter projects.
+ * In serializable transactions, a non-matching record in a volatile page is still protected by
+ * a read-set because a concurrent transaction might update it to match the predicate.
+ * Non-matching records are never returned to the caller, so the caller does not touch
+ * their payloads beyond the fields the filter compares.
+ *
+ * @par Page-level Read-set
+ * A serializable scan usually takes one read-set per record it reads, so a large scan easily
+ * hits XctOptions::max_read_set_size_. Call set_page_level_read_set() before open() to
+ * protect each border page with one page-level read-set (xct::PageReadAccess) instead.
+ * This applies only to pages whose records are all older than the previous epoch.
+ * Other pages, eg ones with hot records, fall back to per-record read-sets.
+ * The page-level read-set is verified at commit time, so the transaction aborts when any
+ * record in the page, not only the ones we returned, has been modified.
+ * Hence, this suits large scans over mostly-cold data, such as reporting transactions.
+ * This is ignored for cursors opened for writes.
  */
 class MasstreeCursor CXX11_FINAL {
  public:
@@ -131,6 +152,9 @@ class MasstreeCursor CXX11_FINAL {
     /** only when stable_ indicates that this page is a moved page */
     MovedPageSearchStatus moved_page_search_status_;
 
+    /** only for border. whether all records in the page are protected by a page read-set. */
+    bool      page_read_protected_;
+
     /**
      * Upto which separator we are done. only for interior.
      * If forward search, we followed a pointer before this separator.
@@ -188,6 +212,22 @@ class MasstreeCursor CXX11_FINAL {
   bool              is_for_writes() const { return for_writes_; }
   bool              is_forward_cursor() const { return forward_cursor_; }
 
+  /**
+   * @brief Sets a predicate/projection this cursor evaluates for each record.
+   * @param[in] filter The filter, which must outlive this cursor. nullptr to disable filtering.
+   * @pre Must be called before open().
+   */
+  void              set_filter(const RecordFilter* filter) { filter_ = filter; }
+  const RecordFilter* get_filter() const { return filter_; }
+
+  /**
+   * @brief Sets whether this cursor protects each border page with a page-level read-set.
+   * @pre Must be called before open().
+   * @see Page-level Read-set in the class comment
+   */
+  void              set_page_level_read_set(bool value) { page_level_read_set_ = value; }
+  bool              is_page_level_read_set() const { return page_level_read_set_; }
+
   ErrorCode   open(
     const char* begin_key = CXX11_NULLPTR,
     KeyLength begin_key_length = kKeyLengthExtremum,
@@ -291,6 +331,21 @@ class MasstreeCursor CXX11_FINAL {
     ASSERT_ND(is_valid_record());
     return cur_payload_length_;
   }
+  /** Returns the range of payload projected by the filter. Whole payload without a filter. */
+  const char* get_projected_payload() const ALWAYS_INLINE {
+    ASSERT_ND(is_valid_record());
+    if (filter_ == CXX11_NULLPTR) {
+      return cur_payload_;
+    }
+    return filter_->project(cur_payload_, cur_payload_length_);
+  }
+  PayloadLength  get_projected_payload_length() const ALWAYS_INLINE {
+    ASSERT_ND(is_valid_record());
+    if (filter_ == CXX11_NULLPTR) {
+      return cur_payload_length_;
+    }
+    return filter_->get_projected_length(cur_payload_length_);
+  }
 
   /**
    * @brief Moves the cursor to next record.
@@ -325,6 +380,12 @@ class MasstreeCursor CXX11_FINAL {
   thread::Thread* const context_;
   xct::Xct* const current_xct_;
 
+  /** Predicate/projection set by set_filter(). nullptr if not filtering. */
+  const RecordFilter* filter_;
+
+  /** Set by set_page_level_read_set(). */
+  bool        page_level_read_set_;
+
   bool        for_writes_;
   bool        forward_cursor_;
   bool        end_inclusive_;
@@ -412,6 +473,10 @@ class MasstreeCursor CXX11_FINAL {
    * You can't use this method to "peek" cur record. Be careful!
    */
   ErrorCode fetch_cur_record_logical(MasstreeBorderPage* page, SlotIndex record);
+  /** next() without evaluating the filter */
+  ErrorCode next_unfiltered();
+  /** Moves on while the current record does not satisfy the filter. */
+  ErrorCode skip_filtered_records();
   void      check_end_key();
   bool      is_cur_key_next_layer() const { return cur_key_location_.observed_.is_next_layer(); }
   KeyCompareResult compare_cur_key_aginst_search_key(KeySlice slice, uint8_t layer) const;
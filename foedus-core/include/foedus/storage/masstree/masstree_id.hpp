@@ -173,10 +173,16 @@ const uint32_t kBorderPageDataPartSize
     - kBorderPageAdditionalHeaderSize
     - kBorderPageMaxSlots * sizeof(KeySlice);
 
+/**
+ * Saturating value of MasstreeBorderPage::sequential_splits_.
+ * @ingroup MASSTREE
+ */
+const uint8_t kMaxSequentialSplits = 0xFFU;
+
 /** Offset of data_ member in MasstreeBorderPage */
 const DataOffset kBorderPageDataPartOffset
   = kCommonPageHeaderSize
-  + 8U  // next_offset_, consecutive_inserts_, dummy_
+  + 8U  // next_offset_, consecutive_inserts_, sequential_splits_, dummy_
   + kBorderPageMaxSlots * sizeof(KeySlice);  // slices_
 
 /**
@@ -30,6 +30,7 @@
 #include "foedus/storage/page.hpp"
 #include "foedus/storage/record.hpp"
 #include "foedus/storage/storage_id.hpp"
+#include "foedus/storage/value_type.hpp"
 #include "foedus/storage/masstree/fwd.hpp"
 #include "foedus/storage/masstree/masstree_id.hpp"
 #include "foedus/storage/masstree/masstree_metadata.hpp"
@@ -472,6 +473,72 @@ struct MasstreeOverwriteLogType : public MasstreeCommonLogType {
   friend std::ostream& operator<<(std::ostream& o, const MasstreeOverwriteLogType& v);
 };
 
+/**
+ * @brief Log type of masstree-storage's blind add operation.
+ * @ingroup MASSTREE LOGTYPE
+ * @details
+ * Unlike overwrite logs that increment_record() emits, this log remembers the \e addendum
+ * rather than the value after addition, which is added to the current value when applied.
+ * Transactions thus don't have to read the record, so concurrent adds on a hot record
+ * serialize only on the record lock during precommit. The payload part contains the addendum.
+ * We remember its ValueType in reserved_.
+ *
+ * Because the transaction didn't read the record, precommit must check is_applicable()
+ * after locking the record.
+ */
+struct MasstreeAddLogType : public MasstreeCommonLogType {
+  LOG_TYPE_NO_CONSTRUCT(MasstreeAddLogType)
+
+  template <typename PAYLOAD>
+  void            populate(
+    StorageId   storage_id,
+    const void* key,
+    KeyLength   key_length,
+    PAYLOAD     addendum,
+    PayloadLength payload_offset) {
+    log::LogCode type = log::kLogCodeMasstreeAdd;
+    ASSERT_ND(key_length > 0U);
+    populate_base(type, storage_id, key, key_length, &addendum, payload_offset, sizeof(PAYLOAD));
+    reserved_ = to_value_type<PAYLOAD>();
+  }
+
+  ValueType       get_value_type() const { return static_cast<ValueType>(reserved_); }
+
+  /**
+   * @returns whether this log can be applied to the record, which must be locked.
+   * The record might have been deleted or shrunk after the transaction located it.
+   */
+  bool            is_applicable(const xct::RwLockableXctId* owner_id) const ALWAYS_INLINE {
+    ASSERT_ND(owner_id->is_keylocked());
+    if (owner_id->xct_id_.is_deleted() || owner_id->xct_id_.is_next_layer()) {
+      return false;
+    }
+    const uint16_t* lengthes = reinterpret_cast<const uint16_t*>(owner_id + 1);
+    return lengthes[3] >= payload_offset_ + payload_count_;
+  }
+
+  void            apply_record(
+    thread::Thread* /*context*/,
+    StorageId /*storage_id*/,
+    xct::RwLockableXctId* owner_id,
+    char* data) const ALWAYS_INLINE {
+    RecordAddresses addresses = apply_record_prepare(owner_id, data);
+    ASSERT_ND(!owner_id->xct_id_.is_deleted());
+    ASSERT_ND(*addresses.record_payload_count_ >= payload_count_ + payload_offset_);
+    add_value(get_value_type(), addresses.record_payload_ + payload_offset_, get_payload());
+  }
+
+  void            assert_valid() const ALWAYS_INLINE {
+    assert_valid_generic();
+    ASSERT_ND(header_.log_length_ == calculate_log_length(key_length_, payload_count_));
+    ASSERT_ND(header_.get_type() == log::kLogCodeMasstreeAdd);
+    ASSERT_ND(get_value_type() >= kI8 && get_value_type() <= kDouble);
+    ASSERT_ND(payload_count_ == get_value_type_size(get_value_type()));
+  }
+
+  friend std::ostream& operator<<(std::ostream& o, const MasstreeAddLogType& v);
+};
+
 
 }  // namespace masstree
 }  // namespace storage
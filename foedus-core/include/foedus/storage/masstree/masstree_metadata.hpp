@@ -89,6 +89,9 @@ struct MasstreeMetadata CXX11_FINAL : public Metadata {
    * Once it passes this value, it goes on until it really becomes full
    * (otherwise there is no point.. the border pages keep splitting without necessity).
    * When the page is not receiving sequential inserts, there are also no points to split early.
+   * A page "seems to receive sequential inserts" when its records are sorted, the new key is
+   * appended at the end, and the page itself was created by a no-record-split
+   * (see MasstreeBorderPage::should_split_early()). Hence, random inserts never split early.
    * The default is 0, which means we never consider early split.
    */
   uint16_t border_early_split_threshold_;
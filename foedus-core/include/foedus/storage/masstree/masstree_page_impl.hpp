@@ -621,6 +621,32 @@ class MasstreeBorderPage final : public MasstreePage {
    * If this is a snapshot page, this is always true.
    */
   bool        is_consecutive_inserts() const { return consecutive_inserts_; }
+  uint8_t     get_sequential_splits() const { return sequential_splits_; }
+
+  /**
+   * @brief Whether we should split this page before it becomes full to accommodate a new record.
+   * @param[in] new_index the index of the new record, which is the current key count
+   * @param[in] new_slice slice of the new record
+   * @param[in] early_split_threshold MasstreeMetadata::border_early_split_threshold_
+   * @pre is_locked()
+   * @details
+   * We split early only when this page seems to receive sequential inserts, which we judge by
+   * not only consecutive_inserts_ of this page but also the history of its key range.
+   * A page that receives random inserts never splits early because that would just
+   * produce more half-empty pages.
+   */
+  bool        should_split_early(
+    SlotIndex new_index,
+    KeySlice new_slice,
+    uint16_t early_split_threshold) const {
+    // SplitBorder does nothing for a page with only one record. We would retry forever.
+    if (new_index < 2U || new_index != early_split_threshold) {
+      return false;
+    } else if (!consecutive_inserts_ || sequential_splits_ == 0) {
+      return false;
+    }
+    return new_slice > get_slice(new_index - 1);
+  }
 
   DataOffset  get_next_offset() const { return next_offset_; }
   void        increase_next_offset(DataOffset length) {
@@ -1010,9 +1036,18 @@ class MasstreeBorderPage final : public MasstreePage {
    * If this is a snapshot page, this is always true.
    */
   bool        consecutive_inserts_;         // +1 -> 83
+  /**
+   * How many no-record-splits (NRS) happened in a row in the lineage of this page,
+   * saturating at kMaxSequentialSplits. A page created by NRS as the right foster twin
+   * inherits the count plus one, while a usual split halves it.
+   * A non-zero value means this key range has been receiving appends at its right end,
+   * which we use to adapt split decisions to the insert pattern.
+   * @see SplitBorder
+   */
+  uint8_t     sequential_splits_;           // +1 -> 84
 
   /** To make the following part a multiply of 8-bytes. */
-  char        dummy_[5];                    // +5 -> 88
+  char        dummy_[4];                    // +4 -> 88
 
   /**
    * Key slice of this page. Unlike other information in the slots and records,
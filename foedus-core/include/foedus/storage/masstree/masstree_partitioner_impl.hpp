@@ -90,6 +90,13 @@ namespace masstree {
  * issue later. We just need advanced algorithm to enumerate branch pages and determine owners.
  * Let's keep it simple for now, and work on this later.
  *
+ * @par Load balancing
+ * To mitigate the skew, we estimate the number of volatile pages under each pointer with
+ * the same random sampling and move some partitions from overloaded nodes to underloaded nodes.
+ * Once there is a snapshot, partition keys are fixed to the separators in its root page,
+ * but the assignments are re-balanced in each snapshot based on the current volatile pages,
+ * which roughly represent the records modified since the previous snapshot.
+ *
  * @note
  * This is a private implementation-details of \ref MASSTREE, thus file name ends with _impl.
  * Do not include this header from a client program. There is no case client program needs to
@@ -97,6 +104,10 @@ namespace masstree {
  */
 class MasstreePartitioner final {
  public:
+  enum Constants {
+    /** Node loads that differ by at most 1/this of the total load are considered balanced */
+    kRebalanceToleranceInverse = 16,
+  };
   explicit MasstreePartitioner(Partitioner* parent);
 
   ErrorStack  design_partition(const Partitioner::DesignPartitionArguments& args);
@@ -118,6 +129,21 @@ class MasstreePartitioner final {
    * be now changing.
    */
   ErrorStack  design_partition_first(const MasstreeIntermediatePage* root);
+  /**
+   * When there is a previous snapshot. Partition keys are the separators in the root page of
+   * the previous snapshot, and data_ already has the previous assignments.
+   * We estimate the load of each partition from the current volatile pages, which
+   * are mostly the pages modified after the previous snapshot, and rebalance the assignments.
+   * @param[in] root a stable copy of the root volatile page.
+   */
+  ErrorStack  design_partition_rebalance(const MasstreeIntermediatePage* root);
+  /**
+   * Moves partitions from the most loaded node to the least loaded node until
+   * the difference is within 1/kRebalanceToleranceInverse of the total load, so that
+   * all reducers finish their work at about the same time.
+   * @param[in] loads estimated load of each partition
+   */
+  void        balance_assignments(const std::vector<uint64_t>& loads);
 
   void sort_batch_8bytes(const Partitioner::SortBatchArguments& args) const;
   void sort_batch_general(const Partitioner::SortBatchArguments& args) const;
@@ -158,12 +184,16 @@ struct OwnerSamples {
     std::memset(occurrences_, 0, sizeof(uint32_t) * nodes * subtrees);
     assignments_ = new uint32_t[subtrees];
     std::memset(assignments_, 0, sizeof(uint32_t) * subtrees);
+    loads_ = new uint64_t[subtrees];
+    std::memset(loads_, 0, sizeof(uint64_t) * subtrees);
   }
   ~OwnerSamples() {
     delete[] occurrences_;
     occurrences_ = nullptr;
     delete[] assignments_;
     assignments_ = nullptr;
+    delete[] loads_;
+    loads_ = nullptr;
   }
 
   /** number of nodes */
@@ -174,6 +204,8 @@ struct OwnerSamples {
   uint32_t*       occurrences_;
   /** node_id to be the owner of the subtree */
   uint32_t*       assignments_;
+  /** estimated number of volatile pages in the subtree */
+  uint64_t*       loads_;
 
   void increment(uint32_t node, uint32_t subtree_id) {
     ASSERT_ND(node < nodes_);
@@ -187,6 +219,11 @@ struct OwnerSamples {
   }
 
   uint32_t get_assignment(uint32_t subtree_id) const { return assignments_[subtree_id]; }
+  uint64_t get_load(uint32_t subtree_id) const { return loads_[subtree_id]; }
+  void set_load(uint32_t subtree_id, uint64_t load) {
+    ASSERT_ND(subtree_id < subtrees_);
+    loads_[subtree_id] = load;
+  }
 
   /** Determine assignments based on the samples */
   void assign_owners();
@@ -226,7 +263,8 @@ inline const MasstreeCommonLogType* resolve_log(
   ASSERT_ND(rec->header_.get_type() == log::kLogCodeMasstreeInsert
     || rec->header_.get_type() == log::kLogCodeMasstreeDelete
     || rec->header_.get_type() == log::kLogCodeMasstreeUpdate
-    || rec->header_.get_type() == log::kLogCodeMasstreeOverwrite);
+    || rec->header_.get_type() == log::kLogCodeMasstreeOverwrite
+    || rec->header_.get_type() == log::kLogCodeMasstreeAdd);
   return rec;
 }
 
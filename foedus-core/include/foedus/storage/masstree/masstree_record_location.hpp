@@ -70,6 +70,14 @@ struct RecordLocation {
     MasstreeBorderPage* page,
     SlotIndex index,
     bool intended_for_write);
+
+  /**
+   * Populates the result with XID only, without taking any readset or lock.
+   * The caller must protect the record in some other way, eg a page-level read-set,
+   * or a blind write that precommit checks after locking the record.
+   * @see foedus::xct::PageReadAccess
+   */
+  void populate_protected(MasstreeBorderPage* page, SlotIndex index);
 };
 
 }  // namespace masstree
@@ -43,6 +43,7 @@ namespace masstree {
  * \li The page turns out to already contain a satisfying physical record for the key.
  * \li The page turns out to be already moved.
  * \li The page turns out to need page-split to accomodate the record.
+ * This includes early split for sequential inserts, see MasstreeBorderPage::should_split_early().
  *
  * When the 2nd or 3rd case (or 1st case with too-short payload space) happens,
  * the caller will do something else (e.g. split/follow-foster) and retry.
@@ -83,6 +84,12 @@ struct ReserveRecords final : public xct::SysxctFunctor {
    * @see MasstreeMetadata::should_aggresively_create_next_layer()
    */
   const bool                  should_aggresively_create_next_layer_;
+  /**
+   * Key count at which a page receiving sequential inserts splits before it becomes full.
+   * @see MasstreeMetadata::border_early_split_threshold_
+   * @see MasstreeBorderPage::should_split_early()
+   */
+  const uint16_t              early_split_threshold_;
   /**
    * [Out]
    */
@@ -96,7 +103,8 @@ struct ReserveRecords final : public xct::SysxctFunctor {
     const void* suffix,
     PayloadLength payload_count,
     bool should_aggresively_create_next_layer,
-    SlotIndex hint_check_from)
+    SlotIndex hint_check_from,
+    uint16_t early_split_threshold = 0)
     : xct::SysxctFunctor(),
       context_(context),
       target_(target),
@@ -106,6 +114,7 @@ struct ReserveRecords final : public xct::SysxctFunctor {
       payload_count_(payload_count),
       hint_check_from_(hint_check_from),
       should_aggresively_create_next_layer_(should_aggresively_create_next_layer),
+      early_split_threshold_(early_split_threshold),
       out_split_needed_(false) {
   }
   virtual ErrorCode run(xct::SysxctWorkspace* sysxct_workspace) override;
@@ -18,6 +18,7 @@
 #ifndef FOEDUS_STORAGE_MASSTREE_MASSTREE_SPLIT_IMPL_HPP_
 #define FOEDUS_STORAGE_MASSTREE_MASSTREE_SPLIT_IMPL_HPP_
 
+#include "foedus/epoch.hpp"
 #include "foedus/error_code.hpp"
 #include "foedus/storage/storage_id.hpp"
 #include "foedus/storage/masstree/fwd.hpp"
@@ -38,6 +39,17 @@ namespace masstree {
  * When a border page becomes full or close to full, we split the page into two border pages.
  * The new pages are placed as tentative foster twins of the page.
  *
+ * If many records in the page are deleted or the page is fragmented by record expansions,
+ * we instead \e compact the page: the foster-minor is an empty-range page, and the foster-major
+ * receives all records except committed deletions that are already in the snapshot.
+ * Newer deletions must stay until a snapshot covers them, otherwise drop_volatiles() could drop
+ * the page and readers would see the deleted records live in the snapshot page.
+ * This is done in RCU fashion rather than in-place because concurrent transactions
+ * optimistically read the records, but it consumes no new separator in the parent
+ * (see Adopt::adopt_case_a()). Deleted records that belong to
+ * concurrent transactions are tracked via the moved bit as usual. If they can't be found in the
+ * new page, the transactions simply abort.
+ *
  * This does nothing and returns kErrorCodeOk in the following cases:
  * \li The page turns out to be already split.
  *
@@ -107,6 +119,16 @@ struct SplitBorder final : public xct::SysxctFunctor {
     * is equal or larger than the largest slice in this page.
     */
     bool no_record_split_;
+    /**
+    * whether we compact the page rather than splitting it. In this case, mid_slice_ is the
+    * low-fence of the page, so that the foster-minor is empty-range.
+    */
+    bool compact_records_;
+    /**
+    * Compaction drops committed deletions of this epoch or older, which is the snapshot epoch
+    * when we decided the strategy. Invalid if there is no snapshot yet.
+    */
+    Epoch reclaimable_until_;
     SlotIndex original_key_count_;
     KeySlice smallest_slice_;
     KeySlice largest_slice_;
@@ -122,15 +144,28 @@ struct SplitBorder final : public xct::SysxctFunctor {
    */
   void decide_strategy(SplitStrategy* out) const;
 
+  /**
+   * @brief Subroutine of decide_strategy() to tell whether compacting this page
+   * gives enough room, in which case we don't have to split it.
+   * @details
+   * This is just an estimate because we haven't locked the records yet.
+   * Compaction is anyway always possible because it only shrinks the records.
+   * @param[in] reclaimable_until see SplitStrategy::reclaimable_until_
+   */
+  bool should_compact(Epoch reclaimable_until) const;
+
   /** Subroutine to lock existing records in target_ */
   ErrorCode lock_existing_records(xct::SysxctWorkspace* sysxct_workspace);
 
   /**
    * @brief Subroutine to construct a new page.
+   * @param[in] reclaimable_until skips committed deletions of this epoch or older (for
+   * compaction). Invalid to keep all records.
    */
   void migrate_records(
     KeySlice inclusive_from,
     KeySlice inclusive_to,
+    Epoch reclaimable_until,
     MasstreeBorderPage* dest) const;
 };
 
@@ -535,6 +535,44 @@ class MasstreeStorage CXX11_FINAL : public Storage<MasstreeStorageControlBlock>
     PAYLOAD* value,
     PayloadLength payload_offset);
 
+  // add_record() methods
+
+  /**
+   * @brief Blindly adds a value to some data in primitive type, eg a hot counter.
+   * @param[in] context Thread context
+   * @param[in] key Arbitrary length of key that is lexicographically (big-endian) evaluated.
+   * @param[in] key_length Byte size of key.
+   * @param[in] addendum The value to add.
+   * @param[in] payload_offset We add to this byte position of the record.
+   * @pre payload_offset + sizeof(PAYLOAD) must be within the record's actual payload size
+   * (returns kErrorCodeStrTooShortPayload if not)
+   * @tparam PAYLOAD primitive type of the payload. all integers and floats are allowed.
+   * @details
+   * Unlike increment_record(), this method doesn't read the current value, thus doesn't
+   * add the record to the read-set. Concurrent transactions adding to the same record don't
+   * abort each other. They only serialize on the record lock during their precommit.
+   * Transactions that read the record still see the change as usual.
+   * If the record is deleted or shrunk after this method, the transaction aborts at precommit.
+   */
+  template <typename PAYLOAD>
+  ErrorCode   add_record(
+    thread::Thread* context,
+    const void* key,
+    KeyLength key_length,
+    PAYLOAD addendum,
+    PayloadLength payload_offset);
+
+  /**
+   * @brief For primitive key.
+   * @see add_record()
+   */
+  template <typename PAYLOAD>
+  ErrorCode   add_record_normalized(
+    thread::Thread* context,
+    KeySlice key,
+    PAYLOAD addendum,
+    PayloadLength payload_offset);
+
   // TODO(Hideaki): Extend/shrink/update methods for payload. A bit faster than delete + insert.
 
   ErrorStack  verify_single_thread(thread::Thread* context);
@@ -117,6 +117,11 @@ class MasstreeStoragePimpl final : public Attachable<MasstreeStorageControlBlock
   }
   DualPagePointer* get_first_root_pointer_address() { return &control_block_->root_page_pointer_; }
 
+  /**
+   * Returns the root page of the first layer.
+   * In a xct::kPinnedSnapshot transaction, *root is null if the storage was empty or did not
+   * exist as of the pinned snapshot. Callers then return an empty result.
+   */
   ErrorCode get_first_root(
     thread::Thread* context,
     bool for_write,
@@ -134,19 +139,26 @@ class MasstreeStoragePimpl final : public Attachable<MasstreeStorageControlBlock
     KeySlice  slice,
     MasstreeBorderPage** border) ALWAYS_INLINE;
 
-  /** Identifies page and record for the key */
+  /**
+   * Identifies page and record for the key.
+   * If physical_only, we don't take read-set or lock on the found record, so the caller must
+   * protect what it observed in some other way (see add_general()).
+   * The absence of the key is protected by page version set either way.
+   */
   ErrorCode locate_record(
     thread::Thread* context,
     const void* key,
     KeyLength key_length,
     bool for_writes,
-    RecordLocation* result);
+    RecordLocation* result,
+    bool physical_only = false);
   /** Identifies page and record for the normalized key */
   ErrorCode locate_record_normalized(
     thread::Thread* context,
     KeySlice key,
     bool for_writes,
-    RecordLocation* result);
+    RecordLocation* result,
+    bool physical_only = false);
 
   /**
    * Like locate_record(), this is also a logical operation.
@@ -229,6 +241,20 @@ class MasstreeStoragePimpl final : public Attachable<MasstreeStorageControlBlock
     PAYLOAD* value,
     PayloadLength payload_offset);
 
+  /**
+   * implementation of add_record family. use with locate_record(physical_only=true).
+   * If the record looks deleted or too short, we observe it again with a read-set so that
+   * the error is protected. Otherwise, precommit checks MasstreeAddLogType::is_applicable().
+   */
+  template <typename PAYLOAD>
+  ErrorCode add_general(
+    thread::Thread* context,
+    const RecordLocation& location,
+    const void* be_key,
+    KeyLength key_length,
+    PAYLOAD addendum,
+    PayloadLength payload_offset);
+
   /** These are defined in masstree_storage_verify.cpp */
   ErrorStack verify_single_thread(thread::Thread* context);
   ErrorStack verify_single_thread_layer(
@@ -275,12 +301,16 @@ class MasstreeStoragePimpl final : public Attachable<MasstreeStorageControlBlock
    * In other words, always !pointer->is_both_null().
    * It either reads an existing volatile/snapshot page or creates a volatile page
    * from existing snapshot page.
+   * Give the intermediate page that contains the pointer as parent if there is one.
+   * When it is in B-tree level 1, a snapshot cache miss then reads
+   * Metadata::SnapshotThresholds::snapshot_read_extent_ border pages in one I/O.
    */
   ErrorCode follow_page(
     thread::Thread* context,
     bool for_writes,
     storage::DualPagePointer* pointer,
-    MasstreePage** page);
+    MasstreePage** page,
+    const MasstreeIntermediatePage* parent = nullptr);
   /** Follows to next layer's root page. */
   ErrorCode follow_layer(
     thread::Thread* context,
@@ -22,6 +22,7 @@
 
 #include "foedus/assert_nd.hpp"
 #include "foedus/cxx11.hpp"
+#include "foedus/epoch.hpp"
 #include "foedus/assorted/fixed_string.hpp"
 #include "foedus/externalize/externalizable.hpp"
 #include "foedus/storage/fwd.hpp"
@@ -58,11 +59,20 @@ namespace storage {
 struct Metadata {
   /** Tuning parameters related to snapshotting. */
   struct SnapshotThresholds {
-    SnapshotThresholds() : snapshot_trigger_threshold_(0), snapshot_keep_threshold_(0) {}
+    enum Constants {
+      /** Max value of snapshot_read_extent_. 64kb per read. */
+      kMaxSnapshotReadExtent = 16,
+    };
+    SnapshotThresholds()
+      : snapshot_trigger_threshold_(0), snapshot_keep_threshold_(0), snapshot_read_extent_(0) {}
     /**
-     * [Not implemented yet] If this storage has more than this number of volatile pages,
-     * log gleaner will soon start to drop some of the volatile pages.
-     * Default is 0, meaning this storage has no such threshold.
+     * If this is non-zero, the snapshot manager snapshots this storage only after it has
+     * accumulated this number of log records since its last snapshot, carrying its logs
+     * forward to later snapshots until then. See snapshot::StorageSelection.
+     * This is useful to avoid re-writing snapshot pages of a storage that receives only a
+     * trickle of updates. Sequential storages ignore this threshold.
+     * xct::kPinnedSnapshot transactions can't read this storage while it is deferred.
+     * Default is 0, meaning this storage is included in every snapshot.
      */
     uint32_t        snapshot_trigger_threshold_;
     /**
@@ -74,13 +84,38 @@ struct Metadata {
      * Checkout the derived metadata class.
      */
     uint32_t        snapshot_keep_threshold_;
+    /**
+     * Number of contiguous snapshot pages read in one I/O when a leaf page of this storage
+     * misses the snapshot cache, at most kMaxSnapshotReadExtent.
+     * Pages are still 4kb and the snapshot cache still caches each page separately,
+     * but leaf pages the composers write next to each other (array leaves and masstree border
+     * pages under the same parent level) are then read as one larger extent
+     * and installed in the snapshot cache together. This is useful for read-mostly
+     * storages on devices where one 64kb read costs about as much as one 4kb read.
+     * Only misses on a pointer from the leaves' parent level use this, so misses on other pages
+     * and on other storages still read one page.
+     * Only array and masstree storages use this. Sequential storages already read their
+     * snapshot pages in bulk without the snapshot cache.
+     * Default is 0, meaning only the missed page is read.
+     */
+    uint32_t        snapshot_read_extent_;
   };
 
   Metadata()
-    : id_(0), type_(kInvalidStorage), name_(""), root_snapshot_page_id_(0), snapshot_thresholds_() {
+    : id_(0),
+    type_(kInvalidStorage),
+    name_(""),
+    root_snapshot_page_id_(0),
+    snapshot_thresholds_(),
+    last_snapshot_epoch_(Epoch::kEpochInvalid) {
   }
   Metadata(StorageId id, StorageType type, const StorageName& name)
-    : id_(id), type_(type), name_(name), root_snapshot_page_id_(0), snapshot_thresholds_() {}
+    : id_(id),
+    type_(type),
+    name_(name),
+    root_snapshot_page_id_(0),
+    snapshot_thresholds_(),
+    last_snapshot_epoch_(Epoch::kEpochInvalid) {}
   Metadata(
     StorageId id,
     StorageType type,
@@ -90,7 +125,8 @@ struct Metadata {
     type_(type),
     name_(name),
     root_snapshot_page_id_(root_snapshot_page_id),
-    snapshot_thresholds_() {}
+    snapshot_thresholds_(),
+    last_snapshot_epoch_(Epoch::kEpochInvalid) {}
 
   /** to_string operator of all Metadata objects. */
   static std::string describe(const Metadata& metadata);
@@ -112,6 +148,14 @@ struct Metadata {
   SnapshotPagePointer root_snapshot_page_id_;
 
   SnapshotThresholds  snapshot_thresholds_;
+
+  /**
+   * valid_until epoch of the latest snapshot that contains all logs of this storage,
+   * which is older than the latest snapshot while the snapshot manager defers this storage.
+   * Invalid until this storage is snapshotted for the first time.
+   * Only the snapshot manager sets this value.
+   */
+  Epoch::EpochInteger last_snapshot_epoch_;
 };
 
 struct MetadataSerializer : public virtual externalize::Externalizable {
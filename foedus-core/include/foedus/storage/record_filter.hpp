@@ -0,0 +1,205 @@
+/*
+ * Copyright (c) 2014-2015, Hewlett-Packard Development Company, LP.
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details. You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * HP designates this particular file as subject to the "Classpath" exception
+ * as provided by HP in the LICENSE.txt file that accompanied this code.
+ */
+#ifndef FOEDUS_STORAGE_RECORD_FILTER_HPP_
+#define FOEDUS_STORAGE_RECORD_FILTER_HPP_
+
+#include <stdint.h>
+
+#include <cstring>
+
+#include "foedus/compiler.hpp"
+
+namespace foedus {
+namespace storage {
+/**
+ * @brief A simple predicate and projection on record payloads that cursors evaluate
+ * while they iterate over a page.
+ * @ingroup STORAGE
+ * @details
+ * Analytical scans often read only a few bytes out of wide records and filter on
+ * fixed-offset fields. Instead of returning every record and letting the caller filter them,
+ * cursors receive this object and skip non-matching records in their page loop.
+ * Only the cachelines that contain the compared fields are touched for non-matching records.
+ *
+ * @par Predicate
+ * A conjunction of up to kMaxTerms terms. Each term compares an unsigned integer
+ * of 1, 2, 4, or 8 bytes at a fixed payload offset (in native endian) with a constant.
+ * A record whose payload is too short to contain the field does not match.
+ * No terms means every record matches.
+ *
+ * @par Projection
+ * A byte range of the payload the caller is interested in.
+ * Cursors expose the range as the projected payload, clipped to the payload length.
+ * Zero projection_length_ means the whole payload.
+ *
+ * @par Example
+ * @code{.cpp}
+ * RecordFilter filter;
+ * filter.clear();
+ * filter.add_term(16, 4, RecordFilter::kGreaterEqual, 100);  // uint32_t at offset 16 >= 100
+ * filter.set_projection(40, 8);  // we need only bytes 40-47
+ * cursor.set_filter(&filter);
+ * @endcode
+ *
+ * This object is a POD so that it can be passed as a task input or placed in shared memory.
+ */
+struct RecordFilter {
+  /** Comparison operator of a term. field OP operand. */
+  enum Operator {
+    kEqual = 0,
+    kNotEqual,
+    kLess,
+    kLessEqual,
+    kGreater,
+    kGreaterEqual,
+  };
+  enum Constants {
+    /** Maximum number of terms in one predicate */
+    kMaxTerms = 4,
+  };
+
+  /** One comparison in the predicate. */
+  struct Term {
+    /** Byte offset of the field in payload */
+    uint16_t  offset_;
+    /** Byte size of the field. 1, 2, 4, or 8 */
+    uint8_t   width_;
+    /** Operator */
+    uint8_t   operator_;
+    uint32_t  filler_;
+    /** The constant to compare the field with */
+    uint64_t  operand_;
+  };
+
+  /** Number of valid entries in terms_ */
+  uint16_t  term_count_;
+  /** Byte offset of the projected range in payload */
+  uint16_t  projection_offset_;
+  /** Byte length of the projected range in payload. 0 means the whole payload */
+  uint16_t  projection_length_;
+  uint16_t  filler_;
+  Term      terms_[kMaxTerms];
+
+  /** Makes this filter accept all records and project the whole payload. */
+  void clear() { std::memset(this, 0, sizeof(*this)); }
+
+  /**
+   * Adds a term to the predicate.
+   * @return false if there are already kMaxTerms terms or the width is not 1, 2, 4, or 8.
+   */
+  bool add_term(uint16_t offset, uint8_t width, Operator op, uint64_t operand) {
+    if (term_count_ >= kMaxTerms || (width != 1U && width != 2U && width != 4U && width != 8U)) {
+      return false;
+    }
+    Term& term = terms_[term_count_];
+    term.offset_ = offset;
+    term.width_ = width;
+    term.operator_ = op;
+    term.filler_ = 0;
+    term.operand_ = operand;
+    ++term_count_;
+    return true;
+  }
+
+  /** Zero length means the whole payload, in which case offset is ignored. */
+  void set_projection(uint16_t offset, uint16_t length) {
+    projection_offset_ = length > 0 ? offset : 0;
+    projection_length_ = length;
+  }
+
+  bool has_predicate() const { return term_count_ > 0; }
+  bool has_projection() const { return projection_length_ > 0; }
+
+  /** @return whether the given payload satisfies all terms */
+  bool evaluate(const char* payload, uint16_t payload_length) const ALWAYS_INLINE {
+    for (uint16_t i = 0; i < term_count_; ++i) {
+      const Term& term = terms_[i];
+      if (UNLIKELY(term.offset_ + term.width_ > payload_length)) {
+        return false;
+      }
+      const char* field = payload + term.offset_;
+      uint64_t value;
+      switch (term.width_) {
+      case 1:
+        value = *reinterpret_cast<const uint8_t*>(field);
+        break;
+      case 2:
+        value = *reinterpret_cast<const uint16_t*>(field);
+        break;
+      case 4:
+        value = *reinterpret_cast<const uint32_t*>(field);
+        break;
+      default:
+        value = *reinterpret_cast<const uint64_t*>(field);
+        break;
+      }
+      bool satisfied;
+      switch (term.operator_) {
+      case kEqual:
+        satisfied = value == term.operand_;
+        break;
+      case kNotEqual:
+        satisfied = value != term.operand_;
+        break;
+      case kLess:
+        satisfied = value < term.operand_;
+        break;
+      case kLessEqual:
+        satisfied = value <= term.operand_;
+        break;
+      case kGreater:
+        satisfied = value > term.operand_;
+        break;
+      default:
+        satisfied = value >= term.operand_;
+        break;
+      }
+      if (!satisfied) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  /** @return the beginning of the projected range in the given payload */
+  const char* project(const char* payload, uint16_t payload_length) const ALWAYS_INLINE {
+    if (!has_projection()) {
+      return payload;
+    } else if (projection_offset_ >= payload_length) {
+      return payload + payload_length;
+    }
+    return payload + projection_offset_;
+  }
+
+  /** @return byte length of the projected range in a payload of the given length */
+  uint16_t get_projected_length(uint16_t payload_length) const ALWAYS_INLINE {
+    if (!has_projection()) {
+      return payload_length;
+    } else if (projection_offset_ >= payload_length) {
+      return 0;
+    } else if (projection_offset_ + projection_length_ > payload_length) {
+      return payload_length - projection_offset_;
+    } else {
+      return projection_length_;
+    }
+  }
+};
+
+}  // namespace storage
+}  // namespace foedus
+#endif  // FOEDUS_STORAGE_RECORD_FILTER_HPP_
@@ -30,6 +30,7 @@
 #include "foedus/epoch.hpp"
 #include "foedus/memory/fwd.hpp"
 #include "foedus/storage/page.hpp"
+#include "foedus/storage/record_filter.hpp"
 #include "foedus/storage/storage_id.hpp"
 #include "foedus/storage/sequential/fwd.hpp"
 #include "foedus/storage/sequential/sequential_id.hpp"
@@ -41,6 +42,66 @@
 namespace foedus {
 namespace storage {
 namespace sequential {
+/**
+ * @brief A unit of work in a partitioned scan over a sequential storage.
+ * @ingroup SEQUENTIAL
+ * @details
+ * SequentialCursor::design_scan_partitions() splits a sequential storage into
+ * per-node, per-page-range units of this struct. Each unit reads only pages in one NUMA node,
+ * so it should run on a worker thread of that node, for example by passing it as the
+ * task_input of thread::ThreadPool::impersonate_on_numa_node().
+ * This is a POD so that it can be copied to the task input memory as it is.
+ *
+ * Snapshot pages of a node are identified by their ordinals counted over all head pointers
+ * of the node in the order of the root pages. Volatile pages are identified by the in-node
+ * ordinal of the thread that appended them.
+ * Units designed for the same storage are disjoint and cover all records in the storage.
+ *
+ * @par Stale units
+ * The ordinals and the boundary between snapshot and volatile pages are valid only for the
+ * storage image the units were designed for. A new snapshot moves records from volatile pages
+ * to new snapshot pages and might drop old head pointers, and a truncation hides old records.
+ * Each unit thus remembers the root snapshot page, the snapshot epoch, and the truncate epoch
+ * as of design_scan_partitions(). A cursor on a unit whose storage has changed since then
+ * fails with kErrorCodeStrSequentialScanPartitionStale. Then design the units again and redo
+ * the whole scan, including units that already succeeded.
+ */
+struct SequentialScanPartition {
+  /** The NUMA node whose pages this unit reads. */
+  uint16_t  node_;
+  /** Inclusive beginning of in-node thread ordinals whose volatile pages this unit reads. */
+  uint16_t  volatile_thread_begin_;
+  /** Exclusive end of in-node thread ordinals whose volatile pages this unit reads. */
+  uint16_t  volatile_thread_end_;
+  /**
+   * 1 if design_scan_partitions() designed this unit, in which case the cursor checks that
+   * the storage image is still the one below. 0 in a unit that reads the whole storage.
+   */
+  uint16_t  designed_;
+  /** Snapshot epoch the unit was designed for. 0 if there was no snapshot. */
+  Epoch::EpochInteger snapshot_epoch_;
+  /** SequentialStorage::get_truncate_epoch() when the unit was designed. */
+  Epoch::EpochInteger truncate_epoch_;
+  /** Root snapshot page of the storage the unit was designed for. 0 if there was none. */
+  SnapshotPagePointer root_snapshot_page_id_;
+  /** Inclusive beginning of ordinals of snapshot pages in the node this unit reads. */
+  uint64_t  snapshot_page_begin_;
+  /**
+   * Exclusive end of ordinals of snapshot pages in the node this unit reads.
+   * The last unit of each node has kSequentialScanAllPages here, which means up to the end of
+   * this node's pages in the snapshot the unit was designed for. It never reads pages of a
+   * later snapshot; the cursor rejects the unit as stale once a new snapshot is taken, and the
+   * partitions must be designed again.
+   */
+  uint64_t  snapshot_page_end_;
+};
+
+/**
+ * Represents the end of a node's snapshot pages in SequentialScanPartition::snapshot_page_end_.
+ * @ingroup SEQUENTIAL
+ */
+const uint64_t kSequentialScanAllPages = 0xFFFFFFFFFFFFFFFFULL;
+
 /**
  * @brief A cursor interface to read tuples from a sequential storage.
  * @ingroup SEQUENTIAL
@@ -87,6 +148,11 @@ namespace sequential {
  * We should measure OCC vs lock in this case and most likely implement lock.
  * The lock must be a bit more complicated than usual because insertion threads should not take
  * locks frequently (too expensive then).
+ *
+ * @par Predicate/Projection Pushdown
+ * set_filter() gives a RecordFilter to the iterators this cursor returns.
+ * The iterators then skip records that do not satisfy it in the same loop that skips
+ * records out of the epoch range, and expose the projected range via get_cur_projected_raw().
  */
 class SequentialCursor {
  public:
@@ -137,8 +203,64 @@ class SequentialCursor {
     Epoch to_epoch = INVALID_EPOCH,
     int32_t node_filter = -1);
 
+  /**
+   * @brief Constructs a cursor to read tuples only in the given unit of a partitioned scan.
+   * @param[in] context Thread context of the transaction. Should be a thread in partition.node_
+   * to read local snapshot files and volatile pages.
+   * @param[in] storage The sequential storage to read from
+   * @param[in,out] buffer The buffer to read a number of snapshot pages in a batch.
+   * @param[in] buffer_size Byte size of buffer. Must be at least 4kb.
+   * @param[in] partition The unit of work designed by design_scan_partitions()
+   * @param[in] from_epoch Inclusive beginning of epochs to read.
+   * @param[in] to_epoch Exclusive end of epochs to read.
+   * @details
+   * Other parameters are same as the other constructor. The cursor is equivalent to a cursor
+   * with node_filter=partition.node_, except that it skips pages outside of the partition.
+   * next_batch() fails with kErrorCodeStrSequentialScanPartitionStale if the storage has
+   * changed since the partition was designed. See SequentialScanPartition.
+   */
+  SequentialCursor(
+    thread::Thread* context,
+    const sequential::SequentialStorage& storage,
+    void* buffer,
+    uint64_t buffer_size,
+    const SequentialScanPartition& partition,
+    Epoch from_epoch = INVALID_EPOCH,
+    Epoch to_epoch = INVALID_EPOCH);
+
   ~SequentialCursor();
 
+  /**
+   * @brief Splits the given storage into units of work for a parallel scan.
+   * @param[in] context Thread context to read root pages of the storage
+   * @param[in] storage The sequential storage to scan
+   * @param[in] partitions_per_node The number of units per NUMA node, usually the number
+   * of worker threads in each node that will run the scan.
+   * @param[out] out Receives the designed units. Each node gets exactly partitions_per_node units.
+   * @details
+   * Snapshot pages of each node are evenly split by their page counts, and volatile pages are
+   * split by the threads that appended them. Run each unit with a cursor constructed
+   * from it, ideally in parallel on the unit's node as follows.
+   * @code{.cpp}
+   * std::vector<SequentialScanPartition> partitions;
+   * CHECK_ERROR_CODE(SequentialCursor::design_scan_partitions(context, storage, 8, &partitions));
+   * for (const SequentialScanPartition& partition : partitions) {
+   *   pool->impersonate_on_numa_node(partition.node_, "my_scan", &partition,
+   *     sizeof(partition), &sessions[i]);
+   * }
+   * @endcode
+   * Designing is cheap because it reads only root pages of the storage.
+   * The units are valid only until the next snapshot or truncation of the storage.
+   * After that, cursors on them fail with kErrorCodeStrSequentialScanPartitionStale.
+   * When context is in a xct::kPinnedSnapshot transaction, the units are designed for the
+   * pinned snapshot and should be scanned by transactions pinned to the same snapshot.
+   */
+  static ErrorCode design_scan_partitions(
+    thread::Thread* context,
+    const sequential::SequentialStorage& storage,
+    uint16_t partitions_per_node,
+    std::vector<SequentialScanPartition>* out);
+
   thread::Thread*                       get_context() const { return context_;}
   const sequential::SequentialStorage&  get_storage() const { return storage_; }
 
@@ -147,6 +269,13 @@ class SequentialCursor {
   /** @return Exclusive end of epochs to read. */
   Epoch     get_to_epoch() const { return to_epoch_; }
 
+  /**
+   * @brief Sets a predicate/projection evaluated by iterators returned from next_batch().
+   * @param[in] filter The filter, which must outlive this cursor. nullptr to disable filtering.
+   */
+  void      set_filter(const RecordFilter* filter) { filter_ = filter; }
+  const RecordFilter* get_filter() const { return filter_; }
+
   /**
    * @brief Returns a batch of records as an iterator.
    * @param[out] out an iterator over returned records.
@@ -154,6 +283,8 @@ class SequentialCursor {
    * It \e might return an empty batch even when this cursor has more records to return.
    * Invoke is_valid() to check it. This method does nothing if is_valid() is already false.
    * Each batch is guaranteed to be from one node, and actually from one page.
+   * @return kErrorCodeStrSequentialScanPartitionStale if the cursor reads a partition whose
+   * storage has changed since it was designed.
    */
   ErrorCode next_batch(SequentialRecordIterator* out);
 
@@ -224,7 +355,21 @@ class SequentialCursor {
     std::vector<SequentialPage*>  volatile_cur_pages_;
   };
 
+  /** The constructor both public constructors delegate to. */
+  SequentialCursor(
+    thread::Thread* context,
+    const sequential::SequentialStorage& storage,
+    void* buffer,
+    uint64_t buffer_size,
+    OrderMode order_mode,
+    Epoch from_epoch,
+    Epoch to_epoch,
+    int32_t node_filter,
+    const SequentialScanPartition& partition);
+
   ErrorCode init_states();
+  /** Subroutine of init_states() to reject a partition designed for another storage image. */
+  ErrorCode check_partition(SnapshotPagePointer root_snapshot_page_id) const;
 
   /// subroutines of next_batch().
   ErrorCode next_batch_snapshot(SequentialRecordIterator* out, bool* found);
@@ -286,11 +431,16 @@ class SequentialCursor {
    */
   Epoch                         truncate_epoch_;
 
+  /** Predicate/projection given to iterators. nullptr if not filtering. */
+  const RecordFilter*           filter_;
   const int32_t                 node_filter_;
+  /** The unit of partitioned scan. A whole unit of node_filter_ if not partitioned. */
+  const SequentialScanPartition partition_;
   const uint16_t                node_count_;
   const OrderMode               order_mode_;
   /**
-   * True when either the isolation level is SI, or to_epoch_ is up to the previous snapshot epoch.
+   * True when either the isolation level is SI or kPinnedSnapshot,
+   * or to_epoch_ is up to the previous snapshot epoch.
    * When this is true, we just read snapshot pages without any concern on concurrency control.
    */
   bool                          snapshot_only_;
@@ -383,7 +533,11 @@ struct SequentialRecordBatch CXX11_FINAL {
 class SequentialRecordIterator CXX11_FINAL {
  public:
   SequentialRecordIterator();
-  SequentialRecordIterator(const SequentialRecordBatch* batch, Epoch from_epoch, Epoch to_epoch);
+  SequentialRecordIterator(
+    const SequentialRecordBatch* batch,
+    Epoch from_epoch,
+    Epoch to_epoch,
+    const RecordFilter* filter = CXX11_NULLPTR);
 
   void        reset() {
     std::memset(this, 0, sizeof(SequentialRecordIterator));
@@ -402,11 +556,14 @@ class SequentialRecordIterator CXX11_FINAL {
       cur_record_length_ = batch_->get_record_length(cur_record_);
       cur_record_epoch_ = batch_->get_epoch_from_offset(cur_offset_);
       ASSERT_ND(cur_record_epoch_.is_valid());
-      if (LIKELY(in_epoch_range(cur_record_epoch_))) {
+      if (UNLIKELY(!in_epoch_range(cur_record_epoch_))) {
+        // we have to skip this record
+        ++stat_skipped_records_;
+      } else if (filter_ && !filter_->evaluate(get_cur_record_raw(), cur_record_length_)) {
+        ++stat_filtered_records_;
+      } else {
         break;
       }
-      // we have to skip this record
-      ++stat_skipped_records_;
     }
   }
   uint16_t    get_cur_record_length() const ALWAYS_INLINE {
@@ -437,6 +594,21 @@ class SequentialRecordIterator CXX11_FINAL {
     ASSERT_ND(is_valid());
     return batch_->get_payload_from_offset(cur_offset_);
   }
+  /** Returns the range of the current record projected by the filter. */
+  const char* get_cur_projected_raw() const ALWAYS_INLINE {
+    ASSERT_ND(is_valid());
+    if (filter_ == CXX11_NULLPTR) {
+      return get_cur_record_raw();
+    }
+    return filter_->project(get_cur_record_raw(), cur_record_length_);
+  }
+  uint16_t    get_cur_projected_length() const ALWAYS_INLINE {
+    ASSERT_ND(is_valid());
+    if (filter_ == CXX11_NULLPTR) {
+      return cur_record_length_;
+    }
+    return filter_->get_projected_length(cur_record_length_);
+  }
   const xct::RwLockableXctId* get_cur_record_owner_id() const ALWAYS_INLINE {
     ASSERT_ND(is_valid());
     return batch_->get_owner_id_from_offset(cur_offset_);
@@ -447,6 +619,8 @@ class SequentialRecordIterator CXX11_FINAL {
 
   /** @returns number of records we skipped so far due to from/to epoch */
   uint16_t    get_stat_skipped_records() const { return stat_skipped_records_; }
+  /** @returns number of records we skipped so far because they didn't satisfy the filter */
+  uint16_t    get_stat_filtered_records() const { return stat_filtered_records_; }
   /** @returns total number of records in this batch */
   uint16_t    get_record_count() const { return record_count_; }
 
@@ -454,15 +628,16 @@ class SequentialRecordIterator CXX11_FINAL {
 
  private:
   const SequentialRecordBatch* batch_;  // +8 -> 8
-  Epoch     from_epoch_;                // +4 -> 12
-  Epoch     to_epoch_;                  // +4 -> 16
-  Epoch     cur_record_epoch_;          // +4 -> 20
-  uint16_t  record_count_;              // +2 -> 22
-  uint16_t  cur_record_;                // +2 -> 24
-  uint16_t  cur_record_length_;         // +2 -> 26
-  uint16_t  cur_offset_;                // +2 -> 28
-  uint16_t  stat_skipped_records_;      // +2 -> 30
-  uint16_t  filler_;                    // +2 -> 32
+  const RecordFilter* filter_;          // +8 -> 16
+  Epoch     from_epoch_;                // +4 -> 20
+  Epoch     to_epoch_;                  // +4 -> 24
+  Epoch     cur_record_epoch_;          // +4 -> 28
+  uint16_t  record_count_;              // +2 -> 30
+  uint16_t  cur_record_;                // +2 -> 32
+  uint16_t  cur_record_length_;         // +2 -> 34
+  uint16_t  cur_offset_;                // +2 -> 36
+  uint16_t  stat_skipped_records_;      // +2 -> 38
+  uint16_t  stat_filtered_records_;     // +2 -> 40
 };
 
 STATIC_SIZE_CHECK(sizeof(SequentialRecordBatch), kPageSize)
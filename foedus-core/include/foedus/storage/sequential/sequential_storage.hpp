@@ -75,6 +75,27 @@ class SequentialStorage CXX11_FINAL : public Storage<SequentialStorageControlBlo
    */
   ErrorCode  append_record(thread::Thread* context, const void *payload, uint16_t payload_count);
 
+  /**
+   * @brief Append many records to this sequential storage at once.
+   * @param[in] context Thread context
+   * @param[in] payloads Array of record_count pointers, each of which we copy from.
+   * @param[in] payload_counts Array of record_count lengths of the payloads.
+   * @param[in] record_count Number of records to append.
+   * @return kErrorCodeInvalidParameter if any payload is null or empty,
+   * kErrorCodeStrTooLongPayload if any payload_counts[i] >= kMaxPayload.
+   * @details
+   * Semantically same as calling append_record() for each record, but this method
+   * checks all parameters and the capacity of the write-set upfront, so that it either
+   * appends all of them or none of them. When the transaction commits, the records are
+   * appended to the tail pages privately owned by this thread, in this order.
+   * Like append_record(), this does not involve any locks or atomic operations.
+   */
+  ErrorCode  append_records(
+    thread::Thread* context,
+    const void* const* payloads,
+    const uint16_t* payload_counts,
+    uint32_t record_count);
+
   /**
    * Used to apply the effect of appending to volatile list.
    */
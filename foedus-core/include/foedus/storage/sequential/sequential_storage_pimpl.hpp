@@ -41,6 +41,7 @@
 #include "foedus/storage/sequential/sequential_page_impl.hpp"
 #include "foedus/storage/sequential/sequential_storage.hpp"
 #include "foedus/thread/fwd.hpp"
+#include "foedus/xct/xct_id.hpp"
 
 namespace foedus {
 namespace storage {
@@ -76,6 +77,13 @@ struct SequentialStorageControlBlock final {
   /** @copydoc foedus::storage::sequential::SequentialMetadata::truncate_epoch_ */
   std::atomic< Epoch::EpochInteger >  cur_truncate_epoch_;
 
+  /**
+   * Serializes concurrent truncate-operations. Taken in an ownerless fashion because
+   * truncate() is a metadata operation that runs without a thread context.
+   * Append-operations never touch it.
+   */
+  xct::McsWwLock        truncate_lock_;
+
   /**
    * Points to pages that store thread-private head pages to store thread-private volatile pages.
    * Each page can contain 2^10 pointers (as the node is implicit, PagePoolOffset suffices)
@@ -187,6 +195,18 @@ class SequentialStoragePimpl final : public Attachable<SequentialStorageControlB
     const void *payload,
     uint16_t payload_count);
 
+  /**
+   * @brief Appends a new volatile page to the tail of this thread's list and returns it.
+   * @details
+   * The list is private to the thread, thus installing the page needs no atomic operations.
+   * We only need to make sure that a concurrent scanner following the head/next pointers
+   * never sees an uninitialized page, which a release fence before publishing takes care of.
+   */
+  SequentialPage* install_new_tail_page(
+    thread::Thread* context,
+    SequentialPage* cur_tail,
+    memory::PagePoolOffset* tail_pointer);
+
   /**
    * @brief Traverse all pages and call back the handler for every page.
    * @details
@@ -0,0 +1,123 @@
+/*
+ * Copyright (c) 2014-2015, Hewlett-Packard Development Company, LP.
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details. You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * HP designates this particular file as subject to the "Classpath" exception
+ * as provided by HP in the LICENSE.txt file that accompanied this code.
+ */
+#ifndef FOEDUS_STORAGE_SNAPSHOT_ROOT_HISTORY_HPP_
+#define FOEDUS_STORAGE_SNAPSHOT_ROOT_HISTORY_HPP_
+
+#include <stdint.h>
+
+#include <cstring>
+
+#include "foedus/assert_nd.hpp"
+#include "foedus/epoch.hpp"
+#include "foedus/assorted/atomic_fences.hpp"
+#include "foedus/storage/storage_id.hpp"
+
+namespace foedus {
+namespace storage {
+/**
+ * @brief Remembers the root snapshot pages of one storage in the last few snapshots.
+ * @ingroup STORAGE
+ * @details
+ * Transactions pinned to a snapshot (xct::kPinnedSnapshot) must keep reading the same
+ * snapshot image even after the snapshot manager installs a newer snapshot and overwrites
+ * the root pointer in the storage control block.
+ * Snapshot pages themselves are immutable, so the only thing we have to remember is the
+ * root page as of each snapshot epoch. This object keeps the roots of the last
+ * StorageOptions::snapshot_root_history_size_ snapshots.
+ *
+ * There is only one writer, the snapshot manager on master engine, so install() needs no lock.
+ * Readers use a seqlock-like protocol: the epoch of a slot is invalidated while the root is
+ * being overwritten, and readers re-check the epoch after reading the root.
+ * This object is placed in shared memory, one for each storage ID.
+ */
+struct SnapshotRootHistory {
+  enum Constants {
+    /** Max value of StorageOptions::snapshot_root_history_size_. */
+    kMaxSlots = 16,
+  };
+  struct Slot {
+    /** valid_until_epoch of the snapshot. Invalid while the slot is unused or being written */
+    Epoch::EpochInteger epoch_;
+    /**
+     * Metadata::last_snapshot_epoch_ of the storage as of the snapshot, which is older than
+     * epoch_ if the snapshot deferred the storage. Then root_ doesn't reflect all logs
+     * up to epoch_.
+     */
+    Epoch::EpochInteger root_epoch_;
+    /** Root snapshot page of the storage in the snapshot. 0 if the storage was empty */
+    SnapshotPagePointer root_;
+  };
+
+  /** Number of snapshots we remember, StorageOptions::snapshot_root_history_size_ */
+  uint16_t  slot_count_;
+  Slot      slots_[kMaxSlots];
+
+  void initialize(uint16_t slot_count) {
+    ASSERT_ND(slot_count > 0);
+    ASSERT_ND(slot_count <= kMaxSlots);
+    std::memset(this, 0, sizeof(*this));
+    slot_count_ = slot_count;
+  }
+
+  /** Called only by the snapshot manager after it installed a new snapshot. */
+  void install(Epoch snapshot_epoch, SnapshotPagePointer root, Epoch root_epoch) {
+    ASSERT_ND(snapshot_epoch.is_valid());
+    uint16_t victim = 0;
+    for (uint16_t i = 1; i < slot_count_; ++i) {
+      Epoch cur(slots_[i].epoch_);
+      if (!cur.is_valid() || (Epoch(slots_[victim].epoch_).is_valid() &&
+        cur < Epoch(slots_[victim].epoch_))) {
+        victim = i;
+      }
+    }
+    Slot& slot = slots_[victim];
+    slot.epoch_ = Epoch::kEpochInvalid;
+    assorted::memory_fence_release();
+    slot.root_ = root;
+    slot.root_epoch_ = root_epoch.value();
+    assorted::memory_fence_release();
+    slot.epoch_ = snapshot_epoch.value();
+  }
+
+  /**
+   * @param[in] snapshot_epoch valid_until_epoch of the snapshot we are pinned to
+   * @param[out] root root snapshot page as of the snapshot
+   * @param[out] root_epoch the epoch root reflects all logs up to. See Slot::root_epoch_
+   * @return whether this object still remembers the snapshot
+   */
+  bool find(Epoch snapshot_epoch, SnapshotPagePointer* root, Epoch* root_epoch) const {
+    for (uint16_t i = 0; i < slot_count_; ++i) {
+      const Slot& slot = slots_[i];
+      if (slot.epoch_ != snapshot_epoch.value()) {
+        continue;
+      }
+      assorted::memory_fence_acquire();
+      *root = slot.root_;
+      *root_epoch = Epoch(slot.root_epoch_);
+      assorted::memory_fence_acquire();
+      if (slot.epoch_ == snapshot_epoch.value()) {
+        return true;
+      }
+    }
+    return false;
+  }
+};
+
+}  // namespace storage
+}  // namespace foedus
+#endif  // FOEDUS_STORAGE_SNAPSHOT_ROOT_HISTORY_HPP_
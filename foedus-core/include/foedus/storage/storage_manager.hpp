@@ -20,6 +20,8 @@
 #include <string>
 
 #include "foedus/cxx11.hpp"
+#include "foedus/epoch.hpp"
+#include "foedus/error_code.hpp"
 #include "foedus/fwd.hpp"
 #include "foedus/initializable.hpp"
 #include "foedus/snapshot/fwd.hpp"
@@ -248,6 +250,33 @@ class StorageManager CXX11_FINAL : public virtual Initializable {
     xct::RwLockableXctId* old_address,
     xct::WriteXctAccess* write_set);
 
+  /**
+   * @brief Remembers the current root snapshot pages of all existing storages as of the
+   * given snapshot.
+   * @details
+   * Called only by the snapshot manager after it installed a new snapshot, before it publishes
+   * the new snapshot epoch.
+   * @see SnapshotRootHistory
+   */
+  void        remember_snapshot_roots(Epoch snapshot_epoch);
+
+  /**
+   * @brief Returns a root pointer for a transaction pinned to a snapshot.
+   * @param[in] context the thread running a xct::kPinnedSnapshot transaction
+   * @param[in] id the storage to read
+   * @param[in] for_write whether the caller wants to modify the storage. Always rejected
+   * @param[out] out only the snapshot_pointer_ is set. Following it never reaches volatile pages.
+   * 0 if the storage was empty or did not exist as of the pinned snapshot.
+   * @return kErrorCodeXctPinnedSnapshotReadOnly if for_write,
+   * kErrorCodeXctPinnedSnapshotExpired if the pinned snapshot itself is no longer remembered,
+   * kErrorCodeXctPinnedSnapshotDeferred if the pinned snapshot deferred the storage.
+   */
+  ErrorCode   get_pinned_root_pointer(
+    thread::Thread* context,
+    StorageId id,
+    bool for_write,
+    DualPagePointer* out);
+
   /** Returns pimpl object. Use this only if you know what you are doing. */
   StorageManagerPimpl* get_pimpl() { return pimpl_; }
 
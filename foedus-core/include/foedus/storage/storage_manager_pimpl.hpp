@@ -113,6 +113,13 @@ class StorageManagerPimpl final : public DefaultInitializable {
     xct::WriteXctAccess *write);
   ErrorStack  clone_all_storage_metadata(snapshot::SnapshotMetadata *metadata);
 
+  void        remember_snapshot_roots(Epoch snapshot_epoch);
+  ErrorCode   get_pinned_root_pointer(
+    thread::Thread* context,
+    StorageId id,
+    bool for_write,
+    DualPagePointer* out);
+
   uint32_t    get_max_storages() const;
 
   Engine* const           engine_;
@@ -133,6 +140,13 @@ class StorageManagerPimpl final : public DefaultInitializable {
    * This is why get_storage(string) is more expensive.
    */
   storage::StorageId*     storage_name_sort_;
+
+  /**
+   * Root snapshot pages of each storage in the last few snapshots, indexed by StorageId.
+   * Written only by the snapshot manager (and restart), read by pinned-snapshot transactions.
+   * [0] is not a storage. It remembers the epochs of the snapshots we remember.
+   */
+  SnapshotRootHistory*    snapshot_root_histories_;
 };
 
 static_assert(
@@ -31,6 +31,7 @@ struct StorageOptions CXX11_FINAL : public virtual externalize::Externalizable {
     kDefaultMaxStorages = 1 << 9,
     kDefaultPartitionerDataMemoryMb = 1,
     kDefaultHotThreshold = 256,  // OCC by default (for test cases and benchamrks that don't set it)
+    kDefaultSnapshotRootHistorySize = 4,
   };
   /**
    * Constructs option values with default values.
@@ -55,6 +56,15 @@ struct StorageOptions CXX11_FINAL : public virtual externalize::Externalizable {
    */
   uint64_t                hot_threshold_;
 
+  /**
+   * Number of recent snapshots whose root pages the engine remembers for each storage,
+   * 1 to SnapshotRootHistory::kMaxSlots.
+   * An xct::kPinnedSnapshot transaction can keep reading while fewer than this number of
+   * new snapshots are taken. After that, its reads fail with kErrorCodeXctPinnedSnapshotExpired.
+   * Increase this value when long analytical transactions run while snapshots are frequent.
+   */
+  uint16_t                snapshot_root_history_size_;
+
   EXTERNALIZABLE(StorageOptions);
 };
 }  // namespace storage
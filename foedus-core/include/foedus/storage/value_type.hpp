@@ -0,0 +1,155 @@
+/*
+ * Copyright (c) 2014-2015, Hewlett-Packard Development Company, LP.
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details. You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * HP designates this particular file as subject to the "Classpath" exception
+ * as provided by HP in the LICENSE.txt file that accompanied this code.
+ */
+#ifndef FOEDUS_STORAGE_VALUE_TYPE_HPP_
+#define FOEDUS_STORAGE_VALUE_TYPE_HPP_
+#include <stdint.h>
+
+#include <cstring>
+
+#include "foedus/assert_nd.hpp"
+#include "foedus/compiler.hpp"
+
+/**
+ * @file foedus/storage/value_type.hpp
+ * @brief Primitive value types that log types can remember to apply arithmetics on payloads.
+ * @ingroup STORAGE
+ */
+namespace foedus {
+namespace storage {
+
+/**
+ * @brief Primitive type of a value in a payload.
+ * @ingroup STORAGE
+ * @details
+ * Used in log types that modify a value without relying on the current value,
+ * eg array::ArrayIncrementLogType, masstree::MasstreeAddLogType, and hash::HashAddLogType.
+ */
+enum ValueType {
+  kUnknown = 0,
+  kI8 = 1,
+  kI16,
+  kI32,
+  kU8,
+  kU16,
+  kU32,
+  kFloat,
+  kBool,
+  // above are 32bits or less, below are 64 bits
+  kI64,
+  kU64,
+  kDouble,
+};
+template <typename T> ValueType to_value_type();
+template <> inline ValueType to_value_type<bool>() { return kBool; }
+template <> inline ValueType to_value_type<int8_t>() { return kI8; }
+template <> inline ValueType to_value_type<int16_t>() { return kI16; }
+template <> inline ValueType to_value_type<int32_t>() { return kI32; }
+template <> inline ValueType to_value_type<int64_t>() { return kI64; }
+template <> inline ValueType to_value_type<uint8_t>() { return kU8; }
+template <> inline ValueType to_value_type<uint16_t>() { return kU16; }
+template <> inline ValueType to_value_type<uint32_t>() { return kU32; }
+template <> inline ValueType to_value_type<uint64_t>() { return kU64; }
+template <> inline ValueType to_value_type<float>() { return kFloat; }
+template <> inline ValueType to_value_type<double>() { return kDouble ; }
+
+/** @returns byte size of the given value type. 0 for kUnknown. */
+inline uint16_t get_value_type_size(ValueType value_type) {
+  switch (value_type) {
+    case kI8:
+    case kU8:
+    case kBool:
+      return 1U;
+    case kI16:
+    case kU16:
+      return 2U;
+    case kI32:
+    case kU32:
+    case kFloat:
+      return 4U;
+    case kI64:
+    case kU64:
+    case kDouble:
+      return 8U;
+    default:
+      return 0;
+  }
+}
+
+/**
+ * Adds the value in addendum to the value in destination, both of which might be unaligned
+ * (eg payload_offset in hash/masstree can be arbitrary).
+ */
+template <typename T>
+inline void add_unaligned_value(void* destination, const void* addendum) {
+  T value;
+  T added;
+  std::memcpy(&value, destination, sizeof(T));
+  std::memcpy(&added, addendum, sizeof(T));
+  value += added;
+  std::memcpy(destination, &value, sizeof(T));
+}
+
+/**
+ * @brief Adds a value of the given type to another.
+ * @param[in] value_type primitive type of both values
+ * @param[in,out] destination (in) the current value, (out) the value after addition
+ * @param[in] addendum the added value
+ * @ingroup STORAGE
+ */
+inline void add_value(ValueType value_type, void* destination, const void* addendum) {
+  switch (value_type) {
+    case kI8:
+      add_unaligned_value<int8_t>(destination, addendum);
+      break;
+    case kI16:
+      add_unaligned_value<int16_t>(destination, addendum);
+      break;
+    case kI32:
+      add_unaligned_value<int32_t>(destination, addendum);
+      break;
+    case kBool:
+    case kU8:
+      add_unaligned_value<uint8_t>(destination, addendum);
+      break;
+    case kU16:
+      add_unaligned_value<uint16_t>(destination, addendum);
+      break;
+    case kU32:
+      add_unaligned_value<uint32_t>(destination, addendum);
+      break;
+    case kFloat:
+      add_unaligned_value<float>(destination, addendum);
+      break;
+    case kI64:
+      add_unaligned_value<int64_t>(destination, addendum);
+      break;
+    case kU64:
+      add_unaligned_value<uint64_t>(destination, addendum);
+      break;
+    case kDouble:
+      add_unaligned_value<double>(destination, addendum);
+      break;
+    default:
+      ASSERT_ND(false);
+      break;
+  }
+}
+
+}  // namespace storage
+}  // namespace foedus
+#endif  // FOEDUS_STORAGE_VALUE_TYPE_HPP_
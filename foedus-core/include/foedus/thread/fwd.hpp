@@ -29,6 +29,9 @@ class   GrabFreeVolatilePagesScope;
 struct  ImpersonateSession;
 class   Rendezvous;
 class   StoppableThread;
+class   TaskQueue;
+struct  TaskQueueRequest;
+struct  TaskQueueResult;
 class   Thread;
 struct  ThreadControlBlock;
 class   ThreadGroup;
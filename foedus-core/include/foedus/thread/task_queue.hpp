@@ -0,0 +1,205 @@
+/*
+ * Copyright (c) 2014-2015, Hewlett-Packard Development Company, LP.
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details. You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * HP designates this particular file as subject to the "Classpath" exception
+ * as provided by HP in the LICENSE.txt file that accompanied this code.
+ */
+#ifndef FOEDUS_THREAD_TASK_QUEUE_HPP_
+#define FOEDUS_THREAD_TASK_QUEUE_HPP_
+#include <stdint.h>
+
+#include <iosfwd>
+
+#include "foedus/cxx11.hpp"
+#include "foedus/error_code.hpp"
+#include "foedus/error_stack.hpp"
+#include "foedus/proc/proc_id.hpp"
+#include "foedus/thread/fwd.hpp"
+#include "foedus/thread/impersonate_session.hpp"
+
+namespace foedus {
+namespace thread {
+
+/**
+ * @brief One request in a TaskQueue, placed in the task input memory of the serving thread.
+ * @ingroup THREADPOOL
+ */
+struct TaskQueueRequest {
+  enum Constants {
+    kSize = 1 << 9,
+    kMaxInputSize = kSize - sizeof(proc::ProcName) - 8,
+  };
+  proc::ProcName  proc_name_;
+  uint32_t        input_len_;
+  uint32_t        filler_;
+  char            input_[kMaxInputSize];
+};
+
+/**
+ * @brief Result of one request in a TaskQueue, placed in the task output memory of the serving
+ * thread.
+ * @ingroup THREADPOOL
+ */
+struct TaskQueueResult {
+  enum Constants {
+    kSize = 1 << 9,
+    kMaxOutputSize = kSize - 8,
+  };
+  /** Error code of the procedure. Only the code, not the whole stack. */
+  ErrorCode       result_;
+  uint32_t        output_len_;
+  char            output_[kMaxOutputSize];
+};
+
+/**
+ * @brief A queue of small procedure invocations served by one impersonated thread.
+ * @ingroup THREADPOOL
+ * @details
+ * @par Overview
+ * ThreadPool#impersonate() gives a whole thread to one procedure invocation, and the
+ * client and the thread hand over the input, the output, and the status for each invocation.
+ * For short RPC-style transactions, this handshake is a noticeable fraction of the work.
+ * A TaskQueue instead impersonates a thread once (ThreadPool#impersonate_task_queue()),
+ * then the client pushes many requests to the thread without locks.
+ *
+ * @par Protocol
+ * This is a single-producer single-consumer ring of kSlots requests placed in the task input
+ * memory of the thread, and the results are placed in the task output memory.
+ * push() copies the request to the ring and publishes the number of pushed requests.
+ * It wakes up the thread only when the thread has found the queue empty and might be sleeping,
+ * so a busy thread and the client share no write other than the counters.
+ * The thread serves all published requests as one batch, then publishes the number of completed
+ * requests and signals the client only once per batch.
+ * pop() returns results in the order of push(). It reads the shared counter only when
+ * all results it knew of have been popped.
+ * A slot is reused only after its result is popped, so push() fails with
+ * kErrorCodeThrTaskQueueFull when there are kSlots requests whose results are not popped yet.
+ *
+ * Each request runs as a procedure (\ref PROC) whose input/output is at most
+ * TaskQueueRequest::kMaxInputSize / TaskQueueResult::kMaxOutputSize bytes.
+ * The procedure receives the serving thread as its context, just like impersonate().
+ *
+ * @par Interleaving snapshot cache misses
+ * A request that misses the snapshot cache usually blocks the serving thread during the
+ * disk read, and all requests behind it wait, too.
+ * With set_interleave_cache_misses(), the serving thread instead issues an asynchronous read
+ * for the missed page, aborts the transaction of the request, and serves the following requests
+ * while the read is in flight (kErrorCodeCacheMissPending internally).
+ * Once the page is installed in the snapshot cache, the request runs again from the beginning.
+ *
+ * @par Restart, not resume
+ * We can't suspend the procedure in the middle as C++11 has no coroutines, so a suspended
+ * request is restarted rather than resumed, which costs little for short transactions.
+ * The procedures in such a queue must thus be restartable, just like they are on race aborts:
+ * no side effects other than the transaction before it commits, and propagate the error
+ * code of the storage operations as-is.
+ * Only the first transaction of a procedure is suspended this way. Once it has committed,
+ * later transactions of the procedure read missed pages synchronously.
+ * A request suspended too many times reads the page synchronously so that it makes progress.
+ *
+ * @par Execution order
+ * Without interleaving, requests run in the order of push().
+ * With interleaving, they \b don't: a suspended request runs again only after the requests
+ * pushed after it, so they might not see its effects, and it might see theirs.
+ * Results are still popped in the order of push(), which does not imply the execution order.
+ * If a request depends on the effects of an earlier one (eg insert then read the same record),
+ * pop() the earlier result before pushing the dependent request, or use a queue without
+ * interleaving.
+ *
+ * @par Copy/Move
+ * Same as ImpersonateSession, this object is not copy-able.
+ */
+class TaskQueue CXX11_FINAL {
+ public:
+  enum Constants {
+    /** Max number of requests whose results are not popped yet. */
+    kSlots = 1 << 10,
+  };
+
+  TaskQueue() : pushed_(0), popped_(0), completed_(0), interleave_cache_misses_(false) {}
+  ~TaskQueue() { close(); }
+
+  // Not copy-able
+  TaskQueue(const TaskQueue& other) CXX11_FUNC_DELETE;
+  TaskQueue& operator=(const TaskQueue& other) CXX11_FUNC_DELETE;
+
+  /** Returns if this queue is attached to a thread, or ThreadPool#impersonate_task_queue(). */
+  bool        is_open() const { return session_.is_valid(); }
+  /** Number of requests whose results are not popped yet. */
+  uint32_t    get_pending_count() const { return pushed_ - popped_; }
+
+  bool        is_interleave_cache_misses() const { return interleave_cache_misses_; }
+  /**
+   * Whether the serving thread runs other requests while a request waits for a snapshot page.
+   * Default is false. This must be set before opening the queue.
+   * Requests then might run out of push() order.
+   * @see the class comment for the requirements on the procedures and the execution order.
+   */
+  void        set_interleave_cache_misses(bool value) { interleave_cache_misses_ = value; }
+
+  /**
+   * @brief Asynchronously requests the serving thread to run the procedure.
+   * @param[in] proc_name the name of the procedure to run.
+   * @param[in] input input data of arbitrary format for the procedure.
+   * @param[in] input_size byte size of the input. At most TaskQueueRequest::kMaxInputSize.
+   * @details
+   * With set_interleave_cache_misses(), requests might run out of push() order.
+   * See "Execution order" in the class comment.
+   * @return kErrorCodeThrTaskQueueFull if there are kSlots pending requests. In that case,
+   * pop() some results and retry.
+   */
+  ErrorCode   push(const proc::ProcName& proc_name, const void* input, uint32_t input_size);
+
+  /**
+   * @brief Waits for the oldest pending request and retrieves its result.
+   * @details
+   * Results are returned in the order of push() even when the requests ran in another order.
+   * @param[out] result error code of the procedure.
+   * @param[out] output if not null, the output of the procedure is copied to this buffer,
+   * which must be at least TaskQueueResult::kMaxOutputSize bytes or the output size the
+   * procedure is known to emit.
+   * @param[out] output_size if not null, receives the byte size of the output.
+   * @return kErrorCodeInvalidParameter if there is no pending request.
+   */
+  ErrorCode   pop(
+    ErrorCode* result,
+    void* output = CXX11_NULLPTR,
+    uint32_t* output_size = CXX11_NULLPTR);
+
+  /**
+   * @brief Lets the serving thread finish the pending requests and releases it.
+   * @details
+   * Results that are not popped yet are discarded.
+   * This method is idempotent. Actually, this is also called from the destructor.
+   * @return error of the serving thread itself, not of each request.
+   */
+  ErrorStack  close();
+
+  friend std::ostream& operator<<(std::ostream& o, const TaskQueue& v);
+
+  /** The impersonation of the serving thread. */
+  ImpersonateSession  session_;
+  /** Number of requests pushed so far. Only the client updates it. */
+  uint32_t            pushed_;
+  /** Number of results popped so far. Only the client updates it. */
+  uint32_t            popped_;
+  /** Number of completed requests as of last time we checked the serving thread. */
+  uint32_t            completed_;
+  /** @see set_interleave_cache_misses() */
+  bool                interleave_cache_misses_;
+};
+
+}  // namespace thread
+}  // namespace foedus
+#endif  // FOEDUS_THREAD_TASK_QUEUE_HPP_
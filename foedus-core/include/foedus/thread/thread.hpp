@@ -97,6 +97,21 @@ class Thread CXX11_FINAL : public virtual Initializable {
   uint64_t      get_snapshot_cache_misses() const;
   /** [statistics] resets the above two */
   void          reset_snapshot_cache_counts() const;
+  /**
+   * [statistics] count of transactions this thread committed in a hardware transaction without
+   * taking record locks. @see xct::XctOptions::htm_precommit_max_write_set_size_
+   */
+  uint64_t      get_htm_elided_commits() const;
+  /** Called by xct::XctManager when it committed a transaction in a hardware transaction */
+  void          increment_htm_elided_commits();
+  /**
+   * [statistics] per-lock statistics of WW locks this thread took, an array of
+   * xct::kMcsWwLockStatSlots entries. Unused entries have a zero lock address.
+   * Maintained only when xct::XctOptions::enable_mcs_ww_lock_stats_ is set.
+   */
+  const xct::McsWwLockStat* get_mcs_ww_lock_stats() const;
+  /** [statistics] resets the above */
+  void          reset_mcs_ww_lock_stats() const;
 
   /** Shorthand for get_global_volatile_page_resolver.resolve_offset() */
   storage::Page* resolve(storage::VolatilePagePointer ptr) const;
@@ -123,6 +138,9 @@ class Thread CXX11_FINAL : public virtual Initializable {
 
   /**
    * Find the given page in snapshot cache, reading it if not found.
+   * When this thread serves an interleaved TaskQueue, this might instead start reading
+   * the page asynchronously and return kErrorCodeCacheMissPending.
+   * @see TaskQueue::set_interleave_cache_misses()
    */
   ErrorCode     find_or_read_a_snapshot_page(
     storage::SnapshotPagePointer page_id,
@@ -18,14 +18,18 @@
 #ifndef FOEDUS_THREAD_THREAD_PIMPL_HPP_
 #define FOEDUS_THREAD_THREAD_PIMPL_HPP_
 
+#include <aio.h>
+
 #include <atomic>
 #include <thread>
 
 #include "foedus/fixed_error_stack.hpp"
 #include "foedus/initializable.hpp"
+#include "foedus/assorted/cacheline.hpp"
 #include "foedus/cache/fwd.hpp"
 #include "foedus/cache/snapshot_file_set.hpp"
 #include "foedus/log/thread_log_buffer.hpp"
+#include "foedus/memory/aligned_memory.hpp"
 #include "foedus/memory/fwd.hpp"
 #include "foedus/memory/page_resolver.hpp"
 #include "foedus/proc/proc_id.hpp"
@@ -51,6 +55,7 @@ struct ThreadControlBlock {
   ~ThreadControlBlock() = delete;
 
   void initialize(ThreadId my_thread_id) {
+    in_proc_invocation_.store(false);
     status_ = kNotInitialized;
     mcs_block_current_ = 0;
     mcs_rw_async_mapping_current_ = 0;
@@ -60,6 +65,12 @@ struct ThreadControlBlock {
     input_len_ = 0;
     output_len_ = 0;
     proc_result_.clear();
+    task_queue_mode_ = false;
+    task_queue_interleaved_ = false;
+    task_queue_closed_.store(false);
+    task_queue_pushed_.store(0);
+    task_queue_completed_.store(0);
+    task_queue_sleeping_.store(false);
     wakeup_cond_.initialize();
     task_mutex_.initialize();
     task_complete_cond_.initialize();
@@ -67,11 +78,28 @@ struct ThreadControlBlock {
     my_thread_id_ = my_thread_id;
     stat_snapshot_cache_hits_ = 0;
     stat_snapshot_cache_misses_ = 0;
+    stat_task_queue_suspensions_ = 0;
+    stat_htm_elided_commits_ = 0;
+    reset_mcs_ww_lock_stats();
+  }
+  void reset_mcs_ww_lock_stats() {
+    for (uint32_t i = 0; i < xct::kMcsWwLockStatSlots; ++i) {
+      mcs_ww_lock_stats_[i].reset(0);
+    }
   }
   void uninitialize() {
     task_mutex_.uninitialize();
   }
 
+  /**
+   * Whether this thread is running procedures, between proc::ProcManager::begin_invocation()
+   * and proc::ProcManager::end_invocation(). Only this thread writes it, and
+   * reload_shared_libraries() scans it. It is the first member so that it has its own
+   * cacheline; clients of this thread frequently write the following variables.
+   */
+  std::atomic<bool>   in_proc_invocation_;
+  char                in_proc_invocation_pad_[assorted::kCachelineSize - sizeof(std::atomic<bool>)];
+
   /**
    * How many MCS blocks we allocated in this thread's current xct.
    * reset to 0 at each transaction begin.
@@ -131,6 +159,26 @@ struct ThreadControlBlock {
   /** Error code as the result of the procedure */
   FixedErrorStack     proc_result_;
 
+  /**
+   * Whether the current impersonation serves a TaskQueue rather than running proc_name_.
+   * The following task_queue_ variables are used only in that case.
+   */
+  bool                task_queue_mode_;
+  /** @see TaskQueue::set_interleave_cache_misses() */
+  bool                task_queue_interleaved_;
+  /** Set by the client to let the thread return after serving all pushed requests. */
+  std::atomic<bool>   task_queue_closed_;
+  /** Number of requests the client has pushed. Only the client updates it. */
+  std::atomic<uint32_t> task_queue_pushed_;
+  /** Number of requests the thread has completed. Only the thread updates it, once per batch. */
+  std::atomic<uint32_t> task_queue_completed_;
+  /**
+   * Set by the thread while it might sleep on wakeup_cond_ for new requests.
+   * TaskQueue::push() signals wakeup_cond_ only when this is set, so that a busy thread
+   * and the client don't exchange a write on every request.
+   */
+  std::atomic<bool>   task_queue_sleeping_;
+
   /**
    * When the current task has been completed, the thread signals this.
    */
@@ -144,6 +192,32 @@ struct ThreadControlBlock {
 
   uint64_t            stat_snapshot_cache_hits_;
   uint64_t            stat_snapshot_cache_misses_;
+  /** Number of times an interleaved TaskQueue suspended a request on a snapshot cache miss */
+  uint64_t            stat_task_queue_suspensions_;
+  /** Number of transactions this thread committed in a hardware transaction without locks */
+  uint64_t            stat_htm_elided_commits_;
+
+  /**
+   * Per-lock statistics of WW locks this thread took, direct-mapped by lock address.
+   * Written only by this thread. Maintained only when XctOptions::enable_mcs_ww_lock_stats_.
+   */
+  xct::McsWwLockStat  mcs_ww_lock_stats_[xct::kMcsWwLockStatSlots];
+};
+
+/**
+ * @brief A snapshot page read that a task queue request is waiting for.
+ * @ingroup THREAD
+ * @details
+ * The aio control block must stay at the same address while the read is in flight,
+ * so these are kept in a fixed array in ThreadPimpl and never moved.
+ * @see TaskQueue::set_interleave_cache_misses()
+ */
+struct PendingSnapshotRead {
+  bool                          active_;
+  storage::SnapshotPagePointer  page_id_;
+  /** The snapshot pool page we read into. Installed to the snapshot cache on completion. */
+  memory::PagePoolOffset        offset_;
+  struct aiocb                  control_;
 };
 
 /**
@@ -176,19 +250,72 @@ class ThreadPimpl final : public DefaultInitializable {
    * it and re-sets current_task_ when it's done. It exists when exit_requested_ is set.
    */
   void        handle_tasks();
+  /**
+   * Sub-routine of handle_tasks() when the current impersonation is a TaskQueue.
+   * Serves the requests in the queue until the client closes it.
+   */
+  ErrorStack  handle_task_queue();
+  /**
+   * Runs one request in the task queue and writes out its result.
+   * @param[in] index the request's ordinal in the queue.
+   * @param[in] defer_cache_miss whether the request can be suspended on a snapshot cache miss.
+   * @param[in,out] cached_name name of the procedure we looked up most recently.
+   * @param[in,out] cached_proc the procedure we looked up most recently.
+   * @param[in,out] cached_generation proc::ProcManager::get_generation() when we looked it up.
+   * We look it up again if the procedures were reloaded since then.
+   * @param[out] missed_page the snapshot page the request waits for if suspended.
+   * @return false if the request was suspended. It must be run again after the read.
+   * @pre The caller is in proc::ProcManager::begin_invocation(), once per batch.
+   */
+  bool        run_task_queue_request(
+    uint32_t index,
+    bool defer_cache_miss,
+    proc::ProcName* cached_name,
+    proc::Proc* cached_proc,
+    uint64_t* cached_generation,
+    storage::SnapshotPagePointer* missed_page);
+  /**
+   * Installs the snapshot pages whose asynchronous reads have completed to the snapshot cache.
+   * @param[in] wait whether to wait for at least one completion if none has completed yet.
+   */
+  ErrorCode   complete_snapshot_reads(bool wait);
+  bool        is_snapshot_read_pending(storage::SnapshotPagePointer page_id) const;
+  /**
+   * Called when the current transaction commits or aborts.
+   * An interleaved TaskQueue restarts the whole procedure after a deferred cache miss,
+   * which is safe only while the procedure's first transaction is running.
+   */
+  void        on_xct_end() { defer_snapshot_cache_miss_ = false; }
   /** initializes the thread's policy/priority */
   void        set_thread_schedule();
   bool        is_stop_requested() const;
 
-  /** @copydoc foedus::thread::Thread::find_or_read_a_snapshot_page() */
+  /**
+   * Same as foedus::thread::Thread::find_or_read_a_snapshot_page() except that a cache miss
+   * reads read_extent pages in one I/O. See get_snapshot_read_extent().
+   */
   ErrorCode   find_or_read_a_snapshot_page(
     storage::SnapshotPagePointer page_id,
+    uint32_t read_extent,
     storage::Page** out);
-  /** @copydoc foedus::thread::Thread::find_or_read_snapshot_pages_batch() */
+  /**
+   * Same as foedus::thread::Thread::find_or_read_snapshot_pages_batch() except that a cache miss
+   * on page_ids[i] reads read_extents[i] pages in one I/O. read_extents might be null,
+   * meaning each miss reads only the missed page.
+   */
   ErrorCode   find_or_read_snapshot_pages_batch(
     uint16_t batch_size,
     const storage::SnapshotPagePointer* page_ids,
+    const uint32_t* read_extents,
     storage::Page** out);
+  /**
+   * Returns how many pages a snapshot cache miss on a child of the given page should read
+   * in one I/O. This is the storage::Metadata::SnapshotThresholds::snapshot_read_extent_
+   * of the parent's storage if the parent's children are leaf pages the composers write
+   * next to each other (children of an array page in level-1 or of a masstree intermediate
+   * page in B-tree level 1), otherwise 1. The parent might be null, which returns 1.
+   */
+  uint32_t    get_snapshot_read_extent(const storage::Page* parent) const;
 
   /** @copydoc foedus::thread::Thread::read_a_snapshot_page() */
   ErrorCode   read_a_snapshot_page(
@@ -236,7 +363,28 @@ class ThreadPimpl final : public DefaultInitializable {
     storage::Page** out);
   ErrorCode on_snapshot_cache_miss(
     storage::SnapshotPagePointer page_id,
+    uint32_t read_extent,
     memory::PagePoolOffset* pool_offset);
+  /**
+   * Subroutine of on_snapshot_cache_miss() when the caller asked for more than one page.
+   * Reads the missed page and the following pages in the extent in one I/O,
+   * copies the missed page to the given page, and hands the rest to
+   * install_read_ahead_snapshot_pages().
+   */
+  ErrorCode read_a_snapshot_extent(
+    storage::SnapshotPagePointer page_id,
+    uint32_t extent,
+    storage::Page* page);
+  /**
+   * If the given page is a leaf page, installs the following leaf pages of the same storage
+   * to the snapshot cache.
+   * This is just a read-ahead, so it silently stops when something goes wrong.
+   */
+  void      install_read_ahead_snapshot_pages(
+    storage::SnapshotPagePointer page_id,
+    const storage::Page* page,
+    const storage::Page* following_pages,
+    uint32_t following_count);
 
   /**
    * @brief Subroutine of install_a_volatile_page() and follow_page_pointer() to atomically place
@@ -336,6 +484,10 @@ class ThreadPimpl final : public DefaultInitializable {
   const ThreadGlobalOrdinal global_ordinal_;
   /** shortcut for engine_->get_options().xct_.mcs_implementation_type_ == simple */
   bool                    simple_mcs_rw_;
+  /** shortcut for engine_->get_options().xct_.mcs_ww_numa_handover_limit_ */
+  uint16_t                mcs_ww_numa_handover_limit_;
+  /** shortcut for engine_->get_options().xct_.enable_mcs_ww_lock_stats_ */
+  bool                    mcs_ww_lock_stats_enabled_;
 
   /**
    * Private memory repository of this thread.
@@ -379,6 +531,24 @@ class ThreadPimpl final : public DefaultInitializable {
    */
   cache::SnapshotFileSet  snapshot_file_set_;
 
+  enum Constants {
+    /** Max number of asynchronous snapshot page reads in flight in this thread. */
+    kMaxPendingSnapshotReads = 16,
+  };
+  /**
+   * Whether on_snapshot_cache_miss() issues an asynchronous read and returns
+   * kErrorCodeCacheMissPending instead of reading the page synchronously.
+   * Set only while running a request in an interleaved TaskQueue, and cleared by on_xct_end()
+   * so that only the procedure's first transaction is deferred.
+   */
+  bool                    defer_snapshot_cache_miss_;
+  uint16_t                pending_snapshot_read_count_;
+  /** The page on_snapshot_cache_miss() most recently returned kErrorCodeCacheMissPending for. */
+  storage::SnapshotPagePointer deferred_page_id_;
+  PendingSnapshotRead     pending_snapshot_reads_[kMaxPendingSnapshotReads];
+  /** Buffer for read_a_snapshot_extent(). Allocated when it's first used. */
+  memory::AlignedMemory   snapshot_read_extent_buffer_;
+
   ThreadControlBlock*     control_block_;
   void*                   task_input_memory_;
   void*                   task_output_memory_;
@@ -421,6 +591,13 @@ class ThreadPimplMcsAdaptor {
   ThreadId      get_my_id() const { return pimpl_->id_; }
   ThreadGroupId get_my_numa_node() const { return pimpl_->numa_node_; }
   std::atomic<bool>* me_waiting() { return &pimpl_->control_block_->mcs_waiting_; }
+  uint16_t      get_ww_numa_handover_limit() const { return pimpl_->mcs_ww_numa_handover_limit_; }
+  xct::McsWwLockStat* get_ww_lock_stat(const xct::McsWwLock* lock) {
+    if (LIKELY(!pimpl_->mcs_ww_lock_stats_enabled_)) {
+      return nullptr;
+    }
+    return xct::find_mcs_ww_lock_stat(pimpl_->control_block_->mcs_ww_lock_stats_, lock);
+  }
 
   xct::McsWwBlock* get_ww_my_block(xct::McsBlockIndex index) {
     ASSERT_ND(index > 0);
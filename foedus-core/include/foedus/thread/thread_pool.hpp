@@ -64,6 +64,8 @@ namespace thread {
  * thread that continues until the completion of the procedure.
  *  \li \b Impersonation (ThreadPool#impersonate()) is an action to create a session for the
  * given procedure.
+ *  \li \b Task queue (TaskQueue) is a session that runs many small procedures pushed by the
+ * client without per-procedure handshakes, which suits short RPC-style transactions.
  *
  * In order to start a user transaction or a series of user transactions on some thread,
  * the user first defines the procedure as a function as defined in \ref PROC.
@@ -233,6 +235,17 @@ class ThreadPool CXX11_FINAL : public virtual Initializable {
     return session.get_result();
   }
 
+  /**
+   * @brief Impersonate as one of pre-allocated threads in the given NUMA node to serve
+   * the task queue.
+   * @param[in] node the NUMA node of the thread. Its NUMA-local data is often the target of
+   * the requests, so the client program usually picks it.
+   * @param[out] queue the queue to open. On success, the client can push requests to it.
+   * @return whether successfully impersonated.
+   * @see TaskQueue
+   */
+  bool impersonate_task_queue_on_numa_node(ThreadGroupId node, TaskQueue* queue);
+
   /** Returns the pimpl of this object. Use it only when you know what you are doing. */
   ThreadPoolPimpl*    get_pimpl() const { return pimpl_; }
 
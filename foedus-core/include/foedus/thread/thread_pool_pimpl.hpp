@@ -63,6 +63,8 @@ class ThreadPoolPimpl final : public DefaultInitializable {
     uint64_t task_input_size,
     ImpersonateSession *session);
 
+  bool impersonate_task_queue_on_numa_node(ThreadGroupId node, TaskQueue* queue);
+
   ThreadGroupRef*     get_group(ThreadGroupId numa_node) { return &groups_[numa_node]; }
   ThreadGroup*        get_local_group() const { return local_group_; }
   ThreadRef*          get_thread(ThreadId id);
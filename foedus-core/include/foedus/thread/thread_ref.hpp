@@ -55,6 +55,12 @@ class ThreadRef CXX11_FINAL {
     const void* task_input,
     uint64_t task_input_size,
     ImpersonateSession *session);
+  /**
+   * Conditionally try to occupy this thread to serve the given task queue.
+   * @return whether successfully impersonated.
+   * @see TaskQueue
+   */
+  bool          try_impersonate_task_queue(TaskQueue* queue);
 
   Engine*       get_engine() const { return engine_; }
   ThreadId      get_thread_id() const { return id_; }
@@ -76,10 +82,23 @@ class ThreadRef CXX11_FINAL {
   uint64_t      get_snapshot_cache_hits() const;
   uint64_t      get_snapshot_cache_misses() const;
   void          reset_snapshot_cache_counts() const;
+  /** [statistics] count of requests an interleaved TaskQueue suspended on cache misses */
+  uint64_t      get_task_queue_suspensions() const;
+  /** @copydoc foedus::thread::Thread::get_htm_elided_commits() */
+  uint64_t      get_htm_elided_commits() const;
+  /** @copydoc foedus::thread::Thread::get_mcs_ww_lock_stats() */
+  const xct::McsWwLockStat* get_mcs_ww_lock_stats() const;
 
   friend std::ostream& operator<<(std::ostream& o, const ThreadRef& v);
 
  private:
+  bool          try_impersonate_impl(
+    const proc::ProcName& proc_name,
+    const void* task_input,
+    uint64_t task_input_size,
+    const TaskQueue* task_queue,
+    ImpersonateSession *session);
+
   Engine*               engine_;
 
   /** Unique ID of this thread. */
@@ -37,6 +37,8 @@ struct  McsRwExtendedBlock;
 struct  McsRwAsyncMapping;
 struct  McsWwLock;
 struct  McsWwBlock;
+struct  McsWwLockStat;
+struct  PageReadAccess;
 struct  PointerAccess;
 struct  ReadXctAccess;
 class   RetrospectiveLockList;
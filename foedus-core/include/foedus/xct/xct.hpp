@@ -83,8 +83,10 @@ class Xct {
     hot_threshold_for_this_xct_ = default_hot_threshold_for_this_xct_;
     rll_threshold_for_this_xct_ = default_rll_threshold_for_this_xct_;
     isolation_level_ = isolation_level;
+    pinned_snapshot_epoch_ = INVALID_EPOCH;
     pointer_set_size_ = 0;
     page_version_set_size_ = 0;
+    page_read_set_size_ = 0;
     read_set_size_ = 0;
     write_set_size_ = 0;
     lock_free_read_set_size_ = 0;
@@ -147,18 +149,28 @@ class Xct {
   }
   /** Returns the level of isolation for this transaction. */
   IsolationLevel      get_isolation_level() const { return isolation_level_; }
+  /** Returns if this transaction reads only from a pinned snapshot. @see kPinnedSnapshot */
+  bool                is_pinned_to_snapshot() const { return isolation_level_ == kPinnedSnapshot; }
+  /** Returns the valid_until_epoch of the snapshot this transaction is pinned to. */
+  Epoch               get_pinned_snapshot_epoch() const { return pinned_snapshot_epoch_; }
+  void                set_pinned_snapshot_epoch(Epoch epoch) { pinned_snapshot_epoch_ = epoch; }
   /** Returns the ID of this transaction, but note that it is not issued until commit time! */
   const XctId&        get_id() const { return id_; }
   thread::Thread*     get_thread_context() { return context_; }
   thread::ThreadId    get_thread_id() const { return thread_id_; }
   uint32_t            get_pointer_set_size() const { return pointer_set_size_; }
   uint32_t            get_page_version_set_size() const { return page_version_set_size_; }
+  uint32_t            get_page_read_set_size() const { return page_read_set_size_; }
   uint32_t            get_read_set_size() const { return read_set_size_; }
   uint32_t            get_write_set_size() const { return write_set_size_; }
   uint32_t            get_lock_free_read_set_size() const { return lock_free_read_set_size_; }
   uint32_t            get_lock_free_write_set_size() const { return lock_free_write_set_size_; }
+  uint32_t            get_max_lock_free_write_set_size() const {
+    return max_lock_free_write_set_size_;
+  }
   const PointerAccess*   get_pointer_set() const { return pointer_set_; }
   const PageVersionAccess*  get_page_version_set() const { return page_version_set_; }
+  const PageReadAccess*     get_page_read_set() const { return page_read_set_; }
   ReadXctAccess*      get_read_set()  { return read_set_; }
   WriteXctAccess*     get_write_set() { return write_set_; }
   LockFreeReadXctAccess* get_lock_free_read_set() { return lock_free_read_set_; }
@@ -225,6 +237,35 @@ class Xct {
     const storage::PageVersion* version_address,
     storage::PageVersionStatus observed);
 
+  /**
+   * @brief Tries to protect all records in the given page with one page-level read-set.
+   * @param[in] version_address Address of the page version
+   * @param[in] observed Stable page version as of reading record_count
+   * @param[in] key_count_address Address of the key count of the page, which inserts increment
+   * @param[in] first_owner_id_address Address of the owner_id of the first record
+   * @param[in] owner_id_stride Distance in bytes between owner_ids of adjacent records
+   * @param[in] record_count Number of records in the page as of observed
+   * @param[out] added Whether this method took a page-level read-set. When this returns false,
+   * the caller must use per-record read-sets and the page version set as usual.
+   * @pre The page is a volatile page that is never swapped, and the caller has not read
+   * any record in it yet.
+   * @details
+   * This method takes a page-level read-set only when all records in the page are old enough,
+   * see PageReadAccess. Otherwise, or if the page-level read-set is full, it does nothing.
+   * Records protected by the page-level read-set need no read-set, so the caller can just
+   * observe their XctId with spin_while_being_written().
+   * In non-serializable transactions, this does nothing but sets added to true.
+   * @see PageReadAccess
+   */
+  ErrorCode           add_to_page_read_set(
+    const storage::PageVersion* version_address,
+    storage::PageVersionStatus observed,
+    const uint16_t* key_count_address,
+    const RwLockableXctId* first_owner_id_address,
+    int32_t owner_id_stride,
+    uint16_t record_count,
+    bool* added);
+
   /**
    * @brief The general logic invoked for every record read.
    * @param[in] intended_for_write Hints whether the record will be written after this read
@@ -444,6 +485,9 @@ class Xct {
   /** Level of isolation for this transaction. */
   IsolationLevel      isolation_level_;
 
+  /** Epoch of the snapshot this transaction reads from. Valid only in kPinnedSnapshot. */
+  Epoch               pinned_snapshot_epoch_;
+
   /** Whether the object is an active transaction. */
   bool                active_;
 
@@ -517,6 +561,10 @@ class Xct {
   PageVersionAccess*  page_version_set_;
   uint32_t            page_version_set_size_;
 
+  PageReadAccess*     page_read_set_;
+  uint32_t            page_read_set_size_;
+  uint32_t            max_page_read_set_size_;
+
   /**
    * CLL (current-lock-list) of this thread.
    * @see foedus::xct::CurrentLockList
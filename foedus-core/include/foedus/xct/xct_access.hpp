@@ -22,6 +22,7 @@
 #include <iosfwd>
 
 #include "foedus/compiler.hpp"
+#include "foedus/epoch.hpp"
 #include "foedus/log/fwd.hpp"
 #include "foedus/memory/fwd.hpp"
 #include "foedus/storage/fwd.hpp"
@@ -79,6 +80,68 @@ struct PageVersionAccess {
   storage::PageVersionStatus observed_;
 };
 
+/**
+ * @brief Represents a record of reading \e all records in a page during a transaction.
+ * @ingroup XCT
+ * @details
+ * A scan that reads many records in a page can take one of this instead of one ReadXctAccess
+ * per record plus a PageVersionAccess for the page.
+ * We don't remember the XctId of each record. Instead, we take this only when
+ * all records in the page were written before threshold_epoch_, which is one epoch older
+ * than the current global epoch as of the access. Any transaction that modifies a record after
+ * the access commits in threshold_epoch_ or later, because the epoch chime waits for
+ * in-commit transactions of threshold_epoch_.one_less() before it advances the epoch
+ * to the current global epoch as of the access.
+ * Hence, the page is unchanged iff the page version is unchanged (no split, move, etc),
+ * the key count is unchanged, all records are still older than threshold_epoch_ and not being
+ * written, and the number of next-layer records is unchanged (the NextLayer bit is set without
+ * changing the epoch).
+ * We must check the key count separately because inserting a new record only increments the
+ * key count, not the page version. Otherwise, we would miss a record inserted and committed
+ * after the access, which is a phantom.
+ *
+ * The owner_ids of the records are at a fixed stride from each other, so that this class
+ * does not depend on the page layout of each storage type.
+ * @par POD
+ * This is a POD struct. Default destructor/copy-constructor/assignment operator work fine.
+ */
+struct PageReadAccess {
+  friend std::ostream& operator<<(std::ostream& o, const PageReadAccess& v);
+
+  /** Address to the page version. */
+  const storage::PageVersion* address_;
+
+  /** Value of the page version as of the access. */
+  storage::PageVersionStatus  observed_;
+
+  /** Number of records covered by this access, which is the key count as of the access. */
+  uint16_t                    record_count_;
+
+  /** Number of next-layer records among them as of the access. */
+  uint16_t                    next_layer_count_;
+
+  /** Distance in bytes from the owner_id of a record to that of the next record. */
+  int32_t                     owner_id_stride_;
+
+  /** Address of the owner_id of the first record. */
+  const RwLockableXctId*      first_owner_id_address_;
+
+  /** Address to the key count of the page. It must be still record_count_ at commit. */
+  const uint16_t*             key_count_address_;
+
+  /** All records were written before this epoch as of the access. */
+  Epoch                       threshold_epoch_;
+
+  /** The largest XctId among the records as of the access. */
+  XctId                       max_observed_;
+
+  const RwLockableXctId* get_owner_id_address(uint16_t index) const ALWAYS_INLINE {
+    return reinterpret_cast<const RwLockableXctId*>(
+      reinterpret_cast<const char*>(first_owner_id_address_)
+        + static_cast<int64_t>(owner_id_stride_) * index);
+  }
+};
+
 /** Base of ReadXctAccess and WriteXctAccess. No virtual anything. POD. */
 struct RecordXctAccess {
   /** The storage we accessed. */
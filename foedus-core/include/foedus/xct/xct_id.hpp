@@ -84,6 +84,27 @@ enum IsolationLevel {
    * Choose this level if you want full correctness.
    */
   kSerializable,
+
+  /**
+   * @brief Read-only snapshot isolation for long analytical transactions.
+   * @details
+   * The transaction is pinned to the latest snapshot as of begin_xct(). All reads start from
+   * the root snapshot pages of that snapshot and never follow volatile pages.
+   * Because snapshot pages are immutable, the transaction takes no read-set, pointer-set,
+   * or page-version-set at all, so it never hits XctOptions::max_read_set_size_ and never
+   * aborts by conflicts with OLTP transactions, however long it runs.
+   * The transaction keeps seeing the same image even if a new snapshot is taken while it runs.
+   * The engine remembers roots of the last storage::StorageOptions::snapshot_root_history_size_
+   * snapshots. If even more snapshots are taken, reads fail with
+   * kErrorCodeXctPinnedSnapshotExpired.
+   * A storage that was empty or did not exist as of the pinned snapshot just looks empty.
+   * Reads of a storage the pinned snapshot deferred (see
+   * storage::Metadata::SnapshotThresholds::snapshot_trigger_threshold_) fail with
+   * kErrorCodeXctPinnedSnapshotDeferred because its image is older than the other storages'.
+   * begin_xct() fails with kErrorCodeXctNoSnapshotToPin if no snapshot has been taken yet.
+   * Writes fail with kErrorCodeXctPinnedSnapshotReadOnly.
+   */
+  kPinnedSnapshot,
 };
 
 /**
@@ -185,6 +206,10 @@ struct McsWwBlockData {
    * We so far need only 16-bits each, but reserved more bits for future use.
    * We previously used union for this, but it caused many "accidentally non-access-once" bugs.
    * We thus avoid using union. Not saying that union is wrong, but it's prone to such coding.
+   *
+   * The highest 16-bits are used only in McsWwBlock::successor_ of the lock owner.
+   * They count how many times the successor has been bypassed by NUMA-aware handovers.
+   * The lock word itself never has these bits. See McsWwImpl::release().
    */
   uint64_t word_;
 
@@ -194,8 +219,19 @@ struct McsWwBlockData {
     word |= block;
     return word;
   }
+  static uint64_t combine(
+    uint32_t thread_id,
+    McsBlockIndex block,
+    uint16_t bypass_count) ALWAYS_INLINE {
+    uint64_t word = bypass_count;
+    word <<= 48;
+    return word | combine(thread_id, block);
+  }
   static uint32_t decompose_thread_id(uint64_t word) ALWAYS_INLINE {
-    return static_cast<uint32_t>((word >> 32) & 0xFFFFFFFFUL);
+    return static_cast<uint32_t>((word >> 32) & 0xFFFFUL);
+  }
+  static uint16_t decompose_bypass_count(uint64_t word) ALWAYS_INLINE {
+    return static_cast<uint16_t>(word >> 48);
   }
   static McsBlockIndex decompose_block(uint64_t word) ALWAYS_INLINE {
     return static_cast<McsBlockIndex>(word & 0xFFFFFFFFUL);
@@ -250,6 +286,10 @@ struct McsWwBlockData {
   inline McsBlockIndex  get_block_relaxed() const ALWAYS_INLINE {
     return McsWwBlockData::decompose_block(word_);
   }
+  /** Same as above. Only meaningful in McsWwBlock::successor_. */
+  inline uint16_t       get_bypass_count_relaxed() const ALWAYS_INLINE {
+    return McsWwBlockData::decompose_bypass_count(word_);
+  }
   void clear() ALWAYS_INLINE { word_ = 0; }
   void clear_atomic() ALWAYS_INLINE { assorted::atomic_store_seq_cst<uint64_t>(&word_, 0); }
   void clear_release() ALWAYS_INLINE { assorted::atomic_store_release<uint64_t>(&word_, 0); }
@@ -308,6 +348,63 @@ struct McsWwBlock {
   }
 };
 
+/**
+ * @brief Handover and wait-time statistics of one WW lock observed by one thread.
+ * @ingroup XCT
+ * @details
+ * Each thread keeps kMcsWwLockStatSlots of these in its control block, direct-mapped by
+ * the address of the lock. When another lock maps to the same slot, the slot is reset for
+ * the new lock. Hot locks thus tend to stay. Collected only when
+ * XctOptions::enable_mcs_ww_lock_stats_ is set.
+ * Handover counters are incremented by the thread that releases the lock.
+ */
+struct McsWwLockStat {
+  /** Address of the lock this slot is for. 0 if unused. */
+  uintptr_t lock_address_;
+  /** Number of acquisitions, whether contended or not. */
+  uint64_t  acquires_;
+  /** Number of acquisitions that had to wait in the queue. */
+  uint64_t  contended_acquires_;
+  /** Total RDTSC cycles spent in the queue by contended acquisitions. */
+  uint64_t  wait_cycles_;
+  /** Number of releases that handed the lock to a waiter in the same NUMA node. */
+  uint64_t  local_handovers_;
+  /** Number of releases that handed the lock to a waiter in another NUMA node. */
+  uint64_t  remote_handovers_;
+  /** Number of local handovers that bypassed remote waiters. Also counted as local. */
+  uint64_t  bypassed_handovers_;
+
+  void reset(uintptr_t lock_address) {
+    lock_address_ = lock_address;
+    acquires_ = 0;
+    contended_acquires_ = 0;
+    wait_cycles_ = 0;
+    local_handovers_ = 0;
+    remote_handovers_ = 0;
+    bypassed_handovers_ = 0;
+  }
+
+  friend std::ostream& operator<<(std::ostream& o, const McsWwLockStat& v);
+};
+
+/** Number of McsWwLockStat each thread keeps. Must be a power of 2. */
+const uint32_t kMcsWwLockStatSlots = 64;
+
+/**
+ * Returns the slot for the given lock in a thread's McsWwLockStat array,
+ * resetting the slot if it was used for another lock.
+ */
+inline McsWwLockStat* find_mcs_ww_lock_stat(McsWwLockStat* slots, const void* lock) {
+  const uintptr_t address = reinterpret_cast<uintptr_t>(lock);
+  // locks are often at the same offset of different pages. fibonacci hashing spreads them.
+  const uint64_t hashed = static_cast<uint64_t>(address) * 0x9E3779B97F4A7C15ULL;
+  McsWwLockStat* slot = slots + ((hashed >> 40) & (kMcsWwLockStatSlots - 1U));
+  if (slot->lock_address_ != address) {
+    slot->reset(address);
+  }
+  return slot;
+}
+
 /**
  * @brief An exclusive-only (WW) MCS lock data structure.
  * @ingroup XCT
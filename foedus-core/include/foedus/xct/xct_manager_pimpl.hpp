@@ -32,11 +32,17 @@
 #include "foedus/xct/retrospective_lock_list.hpp"  // to inline CurrentLockListIteratorForWriteSet
 #include "foedus/xct/xct_access.hpp"               // same above. iterator must be fast...
 #include "foedus/xct/xct_id.hpp"
+#include "foedus/xct/xct_options.hpp"
 
 namespace foedus {
 namespace xct {
 /** Shared data in XctManagerPimpl. */
 struct XctManagerControlBlock {
+  enum Constants {
+    /** Number of buckets in commit_latency_histogram_ */
+    kCommitLatencyBuckets = 32,
+  };
+
   // this is backed by shared memory. not instantiation. just reinterpret_cast.
   XctManagerControlBlock() = delete;
   ~XctManagerControlBlock() = delete;
@@ -45,6 +51,10 @@ struct XctManagerControlBlock {
     current_global_epoch_advanced_.initialize();
     epoch_chime_wakeup_.initialize();
     new_transaction_paused_ = false;
+    for (uint16_t i = 0; i < kCommitLatencyBuckets; ++i) {
+      commit_latency_histogram_[i] = 0;
+    }
+    epoch_advance_interval_us_ = 0;
   }
   void uninitialize() {
   }
@@ -88,6 +98,75 @@ struct XctManagerControlBlock {
    * This is used only once per several minutes, so no need for optimization. Keep it simple!
    */
   std::atomic<bool>                 new_transaction_paused_;
+
+  /**
+   * Number of wait_for_commit() calls since the epoch chime checked last time, bucketized
+   * by the latency. Bucket-i counts latencies in [2^i, 2^(i+1)) microseconds, bucket-0 also
+   * counts 0us. Maintained only when XctOptions::epoch_advance_target_latency_us_ is set.
+   */
+  std::atomic<uint32_t>             commit_latency_histogram_[kCommitLatencyBuckets];
+  /**
+   * The interval between epoch advancements the adaptive epoch chime currently uses.
+   * 0 if the epoch chime uses the fixed interval. Just for monitoring.
+   */
+  std::atomic<uint32_t>             epoch_advance_interval_us_;
+};
+
+/**
+ * @brief Decides the interval between epoch advancements when
+ * XctOptions::epoch_advance_target_latency_us_ is set.
+ * @details
+ * The epoch chime calls observe() every kEpochsPerObservation epochs with the bytes loggers
+ * made durable and the latency of wait_for_commit() calls since the previous call.
+ * The interval is kept within [XctOptions::epoch_advance_min_interval_us_,
+ * target latency / 2] because a transaction waits for its own epoch and
+ * the grace epoch before loggers flush its logs.
+ * \li If the 99th-percentile latency exceeds the target, halve the interval.
+ * \li Otherwise, if loggers write a lot per epoch, lengthen the interval by 25% while
+ * the latency is within 75% of the target, so that each epoch makes a larger group commit.
+ * \li Otherwise (light load), move the interval half way back to
+ * XctOptions::epoch_advance_interval_ms_. Under light load, the epoch chime also advances
+ * the epoch as soon as a transaction waits for commit.
+ *
+ * This object is used only by the epoch chime thread, so it needs no synchronization.
+ */
+class EpochChimeTuner final {
+ public:
+  enum Constants {
+    /** observe() is called for every this number of epochs */
+    kEpochsPerObservation = 8,
+    /** If loggers write less than this per epoch on average, we consider it light load */
+    kLightLoadBytesPerEpoch = 1 << 20,
+  };
+
+  explicit EpochChimeTuner(const XctOptions& options);
+
+  uint32_t  get_interval_us() const { return interval_us_; }
+  bool      is_light_load() const { return light_load_; }
+
+  /**
+   * @param[in] durable_bytes bytes made durable by all loggers in the epochs
+   * @param[in] epochs number of epochs since the previous call
+   * @param[in] loggers number of loggers in the engine
+   * @param[in] histogram wait_for_commit() latencies, XctManagerControlBlock::kCommitLatencyBuckets
+   */
+  void      observe(uint64_t durable_bytes, uint32_t epochs, uint16_t loggers,
+                    const uint32_t* histogram);
+
+  /**
+   * @return upper bound in microseconds of the given percentile of the latencies in the
+   * histogram. 0 if the histogram is empty.
+   */
+  static uint64_t get_percentile_us(const uint32_t* histogram, uint16_t percentile);
+
+ private:
+  uint32_t  min_interval_us_;
+  uint32_t  max_interval_us_;
+  /** epoch_advance_interval_ms_ within the range */
+  uint32_t  base_interval_us_;
+  uint32_t  target_latency_us_;
+  uint32_t  interval_us_;
+  bool      light_load_;
 };
 
 /**
@@ -100,7 +179,7 @@ struct XctManagerControlBlock {
 class XctManagerPimpl final : public DefaultInitializable {
  public:
   XctManagerPimpl() = delete;
-  explicit XctManagerPimpl(Engine* engine) : engine_(engine) {}
+  explicit XctManagerPimpl(Engine* engine) : engine_(engine), htm_precommit_enabled_(false) {}
   ErrorStack  initialize_once() override;
   ErrorStack  uninitialize_once() override;
 
@@ -140,6 +219,26 @@ class XctManagerPimpl final : public DefaultInitializable {
    * See [TU2013] for the full protocol in this case.
    */
   ErrorCode   precommit_xct_readwrite(thread::Thread* context, Epoch *commit_epoch);
+  /**
+   * @brief Tries phase 1-3 of precommit_xct() as one hardware transaction without locks.
+   * @param[in] context thread context
+   * @param[out] commit_epoch commit epoch of this transaction if committed
+   * @param[out] result kErrorCodeOk if committed, kErrorCodeXctRaceAbort if the transaction
+   * must abort. Set only when this method returns true.
+   * @return whether the outcome was decided. false if the caller must fall back to the
+   * usual protocol with locks.
+   * @pre htm_precommit_enabled_
+   * @details
+   * This elides the record locks of precommit_xct_lock(). The lock words of the write-set are
+   * in the read-set of the hardware transaction, so any thread that locks them aborts us.
+   * We also write a dummy lock mark to them within the hardware transaction so that apply sees
+   * keylocked records, and clear it before commit. Nobody else can observe the mark.
+   * A hardware transaction can not span only the lock phase, so this covers verify and apply,
+   * too. Logging in the hardware transaction (eg DVLOG in debug builds with verbose logging)
+   * aborts it, in which case we just fall back to locks.
+   * @see XctOptions::htm_precommit_max_write_set_size_
+   */
+  bool        precommit_xct_elided(thread::Thread* context, Epoch* commit_epoch, ErrorCode* result);
 
   /** used from precommit_xct_lock() to track moved record */
   bool        precommit_xct_lock_track_write(thread::Thread* context, WriteXctAccess* entry);
@@ -187,6 +286,12 @@ class XctManagerPimpl final : public DefaultInitializable {
   bool        precommit_xct_verify_pointer_set(thread::Thread* context);
   /** Returns false if there is any page version conflict */
   bool        precommit_xct_verify_page_version_set(thread::Thread* context);
+  /**
+   * Returns false if there is any conflict in page-level read-set.
+   * @param[in] context thread context
+   * @param[in,out] max_observed the largest XctId observed in the pages is stored into this.
+   */
+  bool        precommit_xct_verify_page_read_set(thread::Thread* context, XctId* max_observed);
   /**
    * @brief Phase 3 of precommit_xct()
    * @param[in] context thread context
@@ -207,7 +312,8 @@ class XctManagerPimpl final : public DefaultInitializable {
   /**
    * @brief Main routine for epoch_chime_thread_.
    * @details
-   * This method keeps advancing global_epoch with the interval configured in XctOptions.
+   * This method keeps advancing global_epoch with the interval configured in XctOptions,
+   * or adjusted by EpochChimeTuner if XctOptions::epoch_advance_target_latency_us_ is set.
    * This method exits when this object's uninitialize() is called.
    */
   void        handle_epoch_chime();
@@ -224,6 +330,12 @@ class XctManagerPimpl final : public DefaultInitializable {
   Engine* const                 engine_;
   XctManagerControlBlock*       control_block_;
 
+  /**
+   * Whether precommit_xct_readwrite() tries precommit_xct_elided().
+   * XctOptions::htm_precommit_max_write_set_size_ is set and this CPU supports RTM.
+   */
+  bool                          htm_precommit_enabled_;
+
   /**
    * This thread keeps advancing the current_global_epoch_.
    * Launched only in master engine.
@@ -84,6 +84,17 @@ class McsAdaptorConcept {
   /** Returns the atomic bool var on whether current thread is waiting for some lock */
   std::atomic<bool>* me_waiting();
 
+  /**
+   * Returns how many times a waiter of WW locks can be bypassed by NUMA-aware handovers.
+   * 0 means strict FIFO handover. @see XctOptions::mcs_ww_numa_handover_limit_
+   */
+  uint16_t get_ww_numa_handover_limit() const;
+  /**
+   * Returns this thread's statistics slot for the given WW lock,
+   * or nullptr if we don't collect statistics. @see McsWwLockStat
+   */
+  McsWwLockStat* get_ww_lock_stat(const McsWwLock* lock);
+
   /** Returns the bool var on whether other thread is waiting for some lock */
   std::atomic<bool>* other_waiting(thread::ThreadId id);
 
@@ -133,6 +144,7 @@ struct McsMockThread {
     mcs_ww_blocks_ = std::move(rhs.mcs_ww_blocks_);
     mcs_rw_blocks_ = std::move(rhs.mcs_rw_blocks_);
     mcs_rw_async_mappings_ = std::move(rhs.mcs_rw_async_mappings_);
+    mcs_ww_lock_stats_ = std::move(rhs.mcs_ww_lock_stats_);
     mcs_block_current_ = rhs.mcs_block_current_;
     mcs_waiting_.store(rhs.mcs_waiting_.load());  // mainly due to this guy, this is NOT a move
   }
@@ -140,6 +152,10 @@ struct McsMockThread {
     mcs_ww_blocks_.resize(max_block_count);
     mcs_rw_blocks_.resize(max_block_count);
     mcs_rw_async_mappings_.resize(max_block_count);
+    mcs_ww_lock_stats_.resize(kMcsWwLockStatSlots);
+    for (uint32_t i = 0; i < kMcsWwLockStatSlots; ++i) {
+      mcs_ww_lock_stats_[i].reset(0);
+    }
     mcs_rw_async_mapping_current_ = 0;
     mcs_block_current_ = 0;
     mcs_waiting_ = false;
@@ -159,6 +175,7 @@ struct McsMockThread {
   std::vector<McsWwBlock>   mcs_ww_blocks_;
   std::vector< RW_BLOCK > mcs_rw_blocks_;
   std::vector<xct::McsRwAsyncMapping> mcs_rw_async_mappings_;
+  std::vector<McsWwLockStat>  mcs_ww_lock_stats_;
   uint32_t                mcs_rw_async_mapping_current_;
   uint32_t                mcs_block_current_;
   std::atomic<bool>       mcs_waiting_;
@@ -253,6 +270,8 @@ struct McsMockContext {
     uint32_t max_lock_count) {
     max_block_count_ = max_block_count;
     max_lock_count_ = max_lock_count;
+    ww_numa_handover_limit_ = 0;
+    ww_lock_stats_enabled_ = false;
     // + 1U for index-0 (which is not used), and +1U for ceiling
     pages_per_node_ = (max_lock_count_ / kMcsMockDataPageLocksPerPage) + 1U + 1U;
     nodes_.resize(nodes);
@@ -288,6 +307,10 @@ struct McsMockContext {
   uint32_t max_block_count_;
   uint32_t max_lock_count_;
   uint32_t pages_per_node_;
+  /** Counterpart of XctOptions::mcs_ww_numa_handover_limit_. 0 after init(). */
+  uint16_t ww_numa_handover_limit_;
+  /** Counterpart of XctOptions::enable_mcs_ww_lock_stats_. false after init(). */
+  bool     ww_lock_stats_enabled_;
   std::vector< McsMockNode<RW_BLOCK> >    nodes_;
   /**
    * All locks managed by this objects are placed in these memory regions.
@@ -327,6 +350,13 @@ class McsMockAdaptor {
   thread::ThreadId      get_my_id() const { return id_; }
   thread::ThreadGroupId get_my_numa_node() const { return numa_node_; }
   std::atomic<bool>* me_waiting() { return &me_->mcs_waiting_; }
+  uint16_t get_ww_numa_handover_limit() const { return context_->ww_numa_handover_limit_; }
+  McsWwLockStat* get_ww_lock_stat(const McsWwLock* lock) {
+    if (!context_->ww_lock_stats_enabled_) {
+      return nullptr;
+    }
+    return find_mcs_ww_lock_stat(me_->mcs_ww_lock_stats_.data(), lock);
+  }
 
   McsWwBlock* get_ww_my_block(McsBlockIndex index) {
     ASSERT_ND(index <= me_->mcs_block_current_);
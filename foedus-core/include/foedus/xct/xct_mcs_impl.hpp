@@ -177,6 +177,16 @@ class McsImpl {  // TODO(Hideaki) should be renamed to McsRwImpl
  * @details
  * This is exactly same as MCSg. Most places in our codebase now use RW locks,
  * but still there are a few WW-only places, such as page-lock (well, so far).
+ *
+ * @par NUMA-aware handover
+ * When ADAPTOR::get_ww_numa_handover_limit() is non-zero, release() prefers a waiter in the
+ * releaser's NUMA node. If the direct successor is in another node, it looks for a waiter
+ * in its own node a few entries further in the queue and moves it to the front.
+ * The bypassed waiters keep their order. How many times the waiter at the front of the
+ * bypassed ones has been bypassed is carried in the successor word of the lock owner,
+ * and once it reaches the limit the lock goes to that waiter.
+ * This is a restricted version of cohort locks that doesn't need any additional field
+ * in the lock word or queue nodes.
  */
 template<typename ADAPTOR>
 class McsWwImpl {
@@ -203,6 +213,14 @@ class McsWwImpl {
   void           release(McsWwLock* lock, McsBlockIndex block_index);
 
  private:
+  /**
+   * Sub-routine of release() for NUMA-aware handover.
+   * Looks for a waiter in this node after the given (remote) successor, and if found,
+   * moves it to the front and hands the lock over to it.
+   * @return whether we handed the lock over. If false, nothing has been changed.
+   */
+  bool           handover_to_local_waiter(McsWwBlockData successor);
+
   ADAPTOR adaptor_;
 };
 
@@ -43,10 +43,16 @@ struct XctOptions CXX11_FINAL : public virtual externalize::Externalizable {
     kDefaultMaxLockFreeReadSetSize = 1 << 8,
     /** Default value for max_lock_free_write_set_size_. */
     kDefaultMaxLockFreeWriteSetSize = 4 << 10,
+    /** Default value for max_page_read_set_size_. */
+    kDefaultMaxPageReadSetSize = 4 << 10,
     /** Default value for local_work_memory_size_mb_. */
     kDefaultLocalWorkMemorySizeMb = 2,
     /** Default value for epoch_advance_interval_ms_. */
     kDefaultEpochAdvanceIntervalMs = 20,
+    /** Default value for epoch_advance_target_latency_us_. 0 means fixed intervals. */
+    kDefaultEpochAdvanceTargetLatencyUs = 0,
+    /** Default value for epoch_advance_min_interval_us_. */
+    kDefaultEpochAdvanceMinIntervalUs = 1000,
     kMcsImplementationTypeSimple = 0,
     kMcsImplementationTypeExtended = 1,
     kDefaultHotThreshold = 256,  // OCC by default (for test cases and benchamrks that don't set it)
@@ -91,6 +97,16 @@ struct XctOptions CXX11_FINAL : public virtual externalize::Externalizable {
    */
   uint32_t    max_lock_free_write_set_size_;
 
+  /**
+   * @brief The maximum number of page-level read-set one transaction can have.
+   * @details
+   * Default is 4K pages.
+   * This is the number of border pages a serializable scan protects with one entry per page,
+   * see foedus::xct::PageReadAccess. When this is full, scans fall back to per-record read-set.
+   * We pre-allocate this much memory for each NumaCoreMemory. So, don't make it too large.
+   */
+  uint32_t    max_page_read_set_size_;
+
   /**
    * @brief Size of local and temporary work memory one transaction can use during transaction.
    * @details
@@ -111,6 +127,30 @@ struct XctOptions CXX11_FINAL : public virtual externalize::Externalizable {
    */
   uint32_t    epoch_advance_interval_ms_;
 
+  /**
+   * @brief Target 99th-percentile latency of XctManager::wait_for_commit() in microseconds.
+   * Non-zero value enables adaptive intervals between epoch advancements.
+   * @details
+   * Default is 0, which means the epoch chime always uses epoch_advance_interval_ms_.
+   * When this is set, the epoch chime measures the latency of wait_for_commit() calls and
+   * the bytes loggers write per epoch, then adjusts the interval between
+   * epoch_advance_min_interval_us_ and half of this value.
+   * \li Under light write load, waiting transactions advance the epoch immediately and
+   * the interval drifts back to epoch_advance_interval_ms_.
+   * \li Under heavy write load, the interval grows as far as the latency stays within the target
+   * so that each epoch makes a larger group commit. Waiting transactions don't cut it short.
+   * \li Whenever the latency exceeds the target, the interval is halved.
+   */
+  uint32_t    epoch_advance_target_latency_us_;
+
+  /**
+   * @brief The shortest interval in microseconds between epoch advancements the adaptive
+   * epoch chime might choose.
+   * @details
+   * Default is 1 ms. Used only when epoch_advance_target_latency_us_ is set.
+   */
+  uint32_t    epoch_advance_min_interval_us_;
+
   /**
    * @brief Whether to use Retrospective Lock List (RLL) after aborts
    * @details
@@ -162,6 +202,54 @@ struct XctOptions CXX11_FINAL : public virtual externalize::Externalizable {
    * @see foedus::xct::McsImpl
    */
   uint16_t    mcs_implementation_type_;
+
+  /**
+   * @brief How many times a WW (MCSg) lock can be handed over to a waiter in the releaser's
+   * NUMA node ahead of a waiter in another node. 0 disables NUMA-aware handover.
+   * @details
+   * Default is 0, which means strict FIFO handover.
+   * When this is set, a releasing thread whose direct successor is in another node looks
+   * for a waiter in its own node a few entries further in the queue, and moves it to the front.
+   * This keeps a hot lock and the data it protects within one node longer.
+   * Each waiter can be bypassed at most this many times, so no waiter starves.
+   *
+   * @attention This applies only to WW locks, which are the page locks
+   * (storage::PageVersion) and a few ownerless locks such as the truncate lock of
+   * sequential storages. Record locks are RW locks (McsRwLock) in all storages.
+   * Their release path is unchanged and always hands over in FIFO order.
+   * So this option does not help contention on hot records, such as the warehouse and
+   * district rows of TPC-C. It only helps contention on page locks, eg splits and
+   * inserts to one masstree page.
+   * @see foedus::xct::McsWwImpl::release()
+   */
+  uint16_t    mcs_ww_numa_handover_limit_;
+
+  /**
+   * @brief Whether to collect per-lock handover and wait-time statistics of WW (MCSg) locks.
+   * @details
+   * Default is false.
+   * When enabled, each thread counts acquisitions, waiting cycles, and handovers of the locks
+   * it takes in a small direct-mapped table. See foedus::xct::McsWwLockStat
+   * and foedus::thread::Thread::get_mcs_ww_lock_stats().
+   * @attention Like mcs_ww_numa_handover_limit_, this covers only WW locks (page locks).
+   * Record locks are RW locks, and this option doesn't count them.
+   */
+  bool        enable_mcs_ww_lock_stats_;
+
+  /**
+   * @brief Largest write-set for which precommit tries to elide record locks with hardware
+   * transactional memory (Intel RTM). 0 disables it.
+   * @details
+   * Default is 0.
+   * When this is set and the CPU supports RTM, precommit of a read-write transaction whose
+   * write-set is at most this size and that holds no locks yet first runs
+   * lock-verify-apply as one hardware transaction without taking MCS locks.
+   * If the hardware transaction aborts for reasons other than a verification failure
+   * (conflicts, capacity, locked records, etc), precommit falls back to the usual protocol
+   * with locks. On CPUs without RTM, precommit always takes locks.
+   * @see foedus::xct::XctManagerPimpl::precommit_xct_elided()
+   */
+  uint16_t    htm_precommit_max_write_set_size_;
 };
 }  // namespace xct
 }  // namespace foedus
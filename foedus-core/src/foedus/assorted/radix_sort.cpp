@@ -0,0 +1,199 @@
+/*
+ * Copyright (c) 2014-2015, Hewlett-Packard Development Company, LP.
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details. You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * HP designates this particular file as subject to the "Classpath" exception
+ * as provided by HP in the LICENSE.txt file that accompanied this code.
+ */
+#include "foedus/assorted/radix_sort.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "foedus/assert_nd.hpp"
+#include "foedus/compiler.hpp"
+
+namespace foedus {
+namespace assorted {
+
+/** Bits per digit */
+const uint16_t kRadixBits = 8;
+const uint32_t kRadixBuckets = 1U << kRadixBits;
+const uint16_t kMaxDigits = 128 / kRadixBits;
+/** Below this number of entries, std::sort is faster than setting up histograms. */
+const uint32_t kRadixSortMinCount = 1U << 8;
+/** Below this number of entries, launching helper threads doesn't pay off. */
+const uint32_t kParallelRadixSortMinCount = 1U << 16;
+
+inline uint32_t get_digit(__uint128_t value, uint16_t shift) ALWAYS_INLINE;
+inline uint32_t get_digit(__uint128_t value, uint16_t shift) {
+  return static_cast<uint32_t>(value >> shift) & (kRadixBuckets - 1U);
+}
+
+inline uint16_t get_digit_count(uint16_t presorted_low_bits) {
+  ASSERT_ND(presorted_low_bits < 128U);
+  return (128U - presorted_low_bits + kRadixBits - 1U) / kRadixBits;
+}
+
+/**
+ * Sequential LSD radix sort on the given number of digits above presorted_low_bits.
+ * The result is always in data.
+ */
+void radix_sort_sequential(
+  __uint128_t* data,
+  __uint128_t* buffer,
+  uint32_t count,
+  uint16_t presorted_low_bits,
+  uint16_t digits) {
+  if (count < kRadixSortMinCount) {
+    // the higher digits are same in all entries, so comparing all bits is equivalent
+    std::sort(data, data + count);
+    return;
+  }
+
+  ASSERT_ND(digits <= kMaxDigits);
+  uint32_t histograms[kMaxDigits][kRadixBuckets];
+  std::memset(histograms, 0, sizeof(histograms[0]) * digits);
+  for (uint32_t i = 0; i < count; ++i) {
+    const __uint128_t value = data[i];
+    for (uint16_t d = 0; d < digits; ++d) {
+      ++histograms[d][get_digit(value, presorted_low_bits + d * kRadixBits)];
+    }
+  }
+
+  __uint128_t* from = data;
+  __uint128_t* to = buffer;
+  for (uint16_t d = 0; d < digits; ++d) {
+    const uint16_t shift = presorted_low_bits + d * kRadixBits;
+    const uint32_t* histogram = histograms[d];
+    if (histogram[get_digit(from[0], shift)] == count) {
+      continue;  // every entry has the same digit here. nothing to do
+    }
+
+    uint32_t offsets[kRadixBuckets];
+    uint32_t total = 0;
+    for (uint32_t b = 0; b < kRadixBuckets; ++b) {
+      offsets[b] = total;
+      total += histogram[b];
+    }
+    ASSERT_ND(total == count);
+    for (uint32_t i = 0; i < count; ++i) {
+      const __uint128_t value = from[i];
+      to[offsets[get_digit(value, shift)]++] = value;
+    }
+    std::swap(from, to);
+  }
+
+  if (from != data) {
+    std::memcpy(data, from, sizeof(__uint128_t) * count);
+  }
+}
+
+/**
+ * Parallel part of radix_sort_uint128(). Each thread takes a bucket scattered to buffer by the
+ * top digit, sorts it by the lower digits, then copies it back to data.
+ */
+void radix_sort_buckets(
+  __uint128_t* data,
+  __uint128_t* buffer,
+  const uint32_t* begins,
+  uint16_t presorted_low_bits,
+  uint16_t digits,
+  std::atomic<uint32_t>* next_bucket) {
+  while (true) {
+    const uint32_t b = (*next_bucket)++;
+    if (b >= kRadixBuckets) {
+      break;
+    }
+    const uint32_t begin = begins[b];
+    const uint32_t count = begins[b + 1U] - begin;
+    if (count == 0) {
+      continue;
+    }
+    radix_sort_sequential(buffer + begin, data + begin, count, presorted_low_bits, digits);
+    std::memcpy(data + begin, buffer + begin, sizeof(__uint128_t) * count);
+  }
+}
+
+void radix_sort_uint128(
+  __uint128_t* data,
+  __uint128_t* buffer,
+  uint32_t count,
+  uint16_t presorted_low_bits,
+  uint16_t threads) {
+  const uint16_t digits = get_digit_count(presorted_low_bits);
+  if (threads <= 1U || count < kParallelRadixSortMinCount) {
+    radix_sort_sequential(data, buffer, count, presorted_low_bits, digits);
+    return;
+  }
+
+  // Find the most significant digit that differs among entries.
+  __uint128_t differences = 0;
+  for (uint32_t i = 1; i < count; ++i) {
+    differences |= data[i] ^ data[0];
+  }
+  differences >>= presorted_low_bits;
+  if (differences == 0) {
+    return;
+  }
+  uint16_t top_digit = 0;
+  while ((differences >> kRadixBits) != 0) {
+    differences >>= kRadixBits;
+    ++top_digit;
+  }
+  ASSERT_ND(top_digit < digits);
+
+  // Scatter by the top digit to buffer. This is the first pass of MSD radix sort.
+  const uint16_t top_shift = presorted_low_bits + top_digit * kRadixBits;
+  uint32_t histogram[kRadixBuckets];
+  std::memset(histogram, 0, sizeof(histogram));
+  for (uint32_t i = 0; i < count; ++i) {
+    ++histogram[get_digit(data[i], top_shift)];
+  }
+  uint32_t begins[kRadixBuckets + 1U];
+  uint32_t offsets[kRadixBuckets];
+  begins[0] = 0;
+  for (uint32_t b = 0; b < kRadixBuckets; ++b) {
+    offsets[b] = begins[b];
+    begins[b + 1U] = begins[b] + histogram[b];
+  }
+  ASSERT_ND(begins[kRadixBuckets] == count);
+  for (uint32_t i = 0; i < count; ++i) {
+    const __uint128_t value = data[i];
+    buffer[offsets[get_digit(value, top_shift)]++] = value;
+  }
+
+  // Then each bucket is sorted by the remaining digits independently, and copied back to data.
+  std::atomic<uint32_t> next_bucket(0);
+  std::vector<std::thread> helpers;
+  for (uint16_t t = 1; t < threads; ++t) {
+    helpers.emplace_back(
+      radix_sort_buckets,
+      data,
+      buffer,
+      begins,
+      presorted_low_bits,
+      top_digit,
+      &next_bucket);
+  }
+  radix_sort_buckets(data, buffer, begins, presorted_low_bits, top_digit, &next_bucket);
+  for (auto& helper : helpers) {
+    helper.join();
+  }
+}
+
+}  // namespace assorted
+}  // namespace foedus
@@ -124,6 +124,48 @@ ErrorCode SnapshotFileSet::read_pages(
   return kErrorCodeOk;
 }
 
+ErrorCode SnapshotFileSet::read_pages_upto(
+  storage::SnapshotPagePointer page_id_begin,
+  uint32_t max_count,
+  void* out,
+  uint32_t* read_count) {
+  *read_count = 0;
+  fs::DirectIoFile* file;
+  CHECK_ERROR_CODE(get_or_open_file(page_id_begin, &file));
+  storage::SnapshotLocalPageId local_page_id_begin
+    = storage::extract_local_page_id_from_snapshot_pointer(page_id_begin);
+  CHECK_ERROR_CODE(
+    file->seek(local_page_id_begin * sizeof(storage::Page), fs::DirectIoFile::kDirectIoSeekSet));
+  uint64_t read_bytes;
+  CHECK_ERROR_CODE(file->read_raw_upto(sizeof(storage::Page) * max_count, out, &read_bytes));
+  *read_count = read_bytes / sizeof(storage::Page);
+  return kErrorCodeOk;
+}
+
+ErrorCode SnapshotFileSet::read_page_async(
+  storage::SnapshotPagePointer page_id,
+  void* out,
+  struct aiocb* control) {
+  fs::DirectIoFile* file;
+  CHECK_ERROR_CODE(get_or_open_file(page_id, &file));
+  storage::SnapshotLocalPageId local_page_id
+    = storage::extract_local_page_id_from_snapshot_pointer(page_id);
+  return file->read_async(
+    local_page_id * sizeof(storage::Page),
+    sizeof(storage::Page),
+    out,
+    control);
+}
+
+ErrorCode SnapshotFileSet::poll_page_read(
+  storage::SnapshotPagePointer page_id,
+  struct aiocb* control,
+  bool* completed) {
+  fs::DirectIoFile* file;
+  CHECK_ERROR_CODE(get_or_open_file(page_id, &file));
+  return file->poll_async_read(control, completed);
+}
+
 std::ostream& operator<<(std::ostream& o, const SnapshotFileSet& v) {
   o << "<SnapshotFileSet>";
   for (const auto& snapshot : v.files_) {
@@ -17,9 +17,14 @@
  */
 #include "foedus/fs/direct_io_file.hpp"
 
+#include <aio.h>
+#include <errno.h>
 #include <fcntl.h>
 #include <glog/logging.h>
+#include <sys/uio.h>
 
+#include <algorithm>
+#include <cstring>
 #include <ostream>
 #include <sstream>
 #include <string>
@@ -213,6 +218,93 @@ ErrorCode  DirectIoFile::read_raw(uint64_t desired_bytes, void* buffer) {
   return kErrorCodeOk;
 }
 
+ErrorCode  DirectIoFile::read_raw_upto(
+  uint64_t desired_bytes,
+  void* buffer,
+  uint64_t* read_bytes) {
+  ASSERT_ND(!emulation_.null_device_);
+  *read_bytes = 0;
+  if (!is_opened()) {
+    LOG(ERROR) << "File not opened yet, or closed. this=" << *this;
+    return kErrorCodeFsNotOpened;
+  }
+
+  uint64_t total_read = 0;
+  while (total_read < desired_bytes) {
+    char* position = reinterpret_cast<char*>(buffer) + total_read;
+    ASSERT_ND(is_odirect_aligned(position));
+    ssize_t ret = ::read(descriptor_, position, desired_bytes - total_read);
+    if (ret == 0) {
+      break;  // end of file. this is not an error here
+    } else if (ret < 0) {
+      LOG(ERROR) << "DirectIoFile::read_raw_upto(): error. this=" << *this
+        << ", total_read=" << total_read << ", desired_bytes=" << desired_bytes
+        << ", err=" << assorted::os_error();
+      return kErrorCodeFsTooShortRead;
+    } else if (!emulation_.disable_direct_io_ && !is_odirect_aligned(ret)) {
+      LOG(ERROR) << "DirectIoFile::read_raw_upto(): non-aligned read. this=" << *this
+        << ", total_read=" << total_read << ", read_bytes=" << ret;
+      return kErrorCodeFsResultNotAligned;
+    }
+    total_read += ret;
+    current_offset_ += ret;
+  }
+  if (emulation_.emulated_read_kb_cycles_ > 0) {
+    debugging::wait_rdtsc_cycles(emulation_.emulated_read_kb_cycles_ * (total_read >> 10));
+  }
+  *read_bytes = total_read;
+  return kErrorCodeOk;
+}
+
+ErrorCode  DirectIoFile::read_async(
+  uint64_t offset,
+  uint64_t desired_bytes,
+  void* buffer,
+  struct aiocb* control) {
+  ASSERT_ND(!emulation_.null_device_);
+  if (!is_opened()) {
+    LOG(ERROR) << "File not opened yet, or closed. this=" << *this;
+    return kErrorCodeFsNotOpened;
+  }
+  ASSERT_ND(is_odirect_aligned(offset));
+  ASSERT_ND(is_odirect_aligned(desired_bytes));
+  ASSERT_ND(is_odirect_aligned(buffer));
+  std::memset(control, 0, sizeof(struct aiocb));
+  control->aio_fildes = descriptor_;
+  control->aio_offset = offset;
+  control->aio_buf = buffer;
+  control->aio_nbytes = desired_bytes;
+  control->aio_sigevent.sigev_notify = SIGEV_NONE;
+  if (::aio_read(control) != 0) {
+    LOG(ERROR) << "DirectIoFile::read_async(): error. this=" << *this
+      << ", offset=" << offset << ", desired_bytes=" << desired_bytes
+      << ", err=" << assorted::os_error();
+    return kErrorCodeFsTooShortRead;
+  }
+  return kErrorCodeOk;
+}
+
+ErrorCode  DirectIoFile::poll_async_read(struct aiocb* control, bool* completed) {
+  int status = ::aio_error(control);
+  if (status == EINPROGRESS) {
+    *completed = false;
+    return kErrorCodeOk;
+  }
+  *completed = true;
+  ssize_t read_bytes = ::aio_return(control);
+  if (status != 0 || read_bytes < 0
+    || static_cast<uint64_t>(read_bytes) < control->aio_nbytes) {
+    LOG(ERROR) << "DirectIoFile::poll_async_read(): error. this=" << *this
+      << ", offset=" << control->aio_offset << ", desired_bytes=" << control->aio_nbytes
+      << ", read_bytes=" << read_bytes << ", err=" << assorted::os_error(status);
+    return kErrorCodeFsTooShortRead;
+  }
+  if (emulation_.emulated_read_kb_cycles_ > 0) {
+    debugging::wait_rdtsc_cycles(emulation_.emulated_read_kb_cycles_ * (read_bytes >> 10));
+  }
+  return kErrorCodeOk;
+}
+
 ErrorCode  DirectIoFile::write(uint64_t desired_bytes, const memory::AlignedMemory& buffer) {
   return write(desired_bytes, memory::AlignedMemorySlice(
     const_cast<memory::AlignedMemory*>(&buffer)));
@@ -293,6 +385,75 @@ ErrorCode  DirectIoFile::write_raw(uint64_t desired_bytes, const void* buffer) {
   return kErrorCodeOk;
 }
 
+ErrorCode  DirectIoFile::write_vectored(uint32_t vector_count, struct iovec* vectors) {
+  if (!is_opened()) {
+    LOG(ERROR) << "File not opened yet, or closed. this=" << *this;
+    return kErrorCodeFsNotOpened;
+  }
+
+  uint64_t desired_bytes = 0;
+  for (uint32_t i = 0; i < vector_count; ++i) {
+    ASSERT_ND(is_odirect_aligned(vectors[i].iov_base));
+    ASSERT_ND(is_odirect_aligned(vectors[i].iov_len));
+    desired_bytes += vectors[i].iov_len;
+  }
+  if (desired_bytes == 0 || emulation_.null_device_) {
+    return kErrorCodeOk;
+  }
+
+  VLOG(1) << "DirectIoFile::write_vectored(). desired_bytes=" << desired_bytes
+    << ", vector_count=" << vector_count;
+  uint64_t total_written = 0;
+  uint32_t cur = 0;
+  while (total_written < desired_bytes) {
+    // skip buffers that are fully written. writev() doesn't like too many of them
+    while (vectors[cur].iov_len == 0) {
+      ++cur;
+      ASSERT_ND(cur < vector_count);
+    }
+    ssize_t written_bytes = ::writev(descriptor_, vectors + cur, vector_count - cur);
+    if (written_bytes < 0) {
+      LOG(ERROR) << "DirectIoFile::write_vectored(): error. this=" << *this
+        << ", total_written=" << total_written << ", desired_bytes=" << desired_bytes
+        << ", written_bytes=" << written_bytes << ", err=" << assorted::os_error();
+      return kErrorCodeFsWriteFail;
+    } else if (static_cast<uint64_t>(written_bytes) > desired_bytes - total_written) {
+      LOG(ERROR) << "DirectIoFile::write_vectored(): wtf? this=" << *this
+        << ", total_written=" << total_written << ", desired_bytes=" << desired_bytes
+        << ", written_bytes=" << written_bytes << ", err=" << assorted::os_error();
+      return kErrorCodeFsExcessWrite;
+    } else if (!emulation_.disable_direct_io_ && !is_odirect_aligned(written_bytes)) {
+      LOG(FATAL) << "DirectIoFile::write_vectored(): wtf2? this=" << *this
+        << ", total_written=" << total_written << ", desired_bytes=" << desired_bytes
+        << ", written_bytes=" << written_bytes << ", err=" << assorted::os_error();
+      return kErrorCodeFsResultNotAligned;
+    }
+
+    total_written += written_bytes;
+    current_offset_ += written_bytes;
+    if (total_written < desired_bytes) {
+      LOG(INFO) << "Interesting. POSIX writev() didn't complete the writes in one call."
+        << " total_written=" << total_written << ", desired_bytes=" << desired_bytes;
+      // consume the written part from the buffers, then retry from there
+      uint64_t consumed = written_bytes;
+      for (; consumed > 0; ++cur) {
+        ASSERT_ND(cur < vector_count);
+        uint64_t len = std::min<uint64_t>(consumed, vectors[cur].iov_len);
+        vectors[cur].iov_base = reinterpret_cast<char*>(vectors[cur].iov_base) + len;
+        vectors[cur].iov_len -= len;
+        consumed -= len;
+        if (vectors[cur].iov_len > 0) {
+          break;
+        }
+      }
+    }
+  }
+  if (emulation_.emulated_write_kb_cycles_ > 0) {
+    debugging::wait_rdtsc_cycles(emulation_.emulated_write_kb_cycles_ * (desired_bytes >> 10));
+  }
+  return kErrorCodeOk;
+}
+
 ErrorCode  DirectIoFile::truncate(uint64_t new_length, bool sync) {
   if (!is_odirect_aligned(new_length)) {
     LOG(ERROR) << "DirectIoFile::truncate(): non-aligned input is given. "
@@ -50,6 +50,13 @@ LoggerRef   LogManager::get_logger(LoggerId logger_id) {
   ASSERT_ND(logger_id < pimpl_->logger_refs_.size());
   return pimpl_->logger_refs_[logger_id];
 }
+uint64_t    LogManager::get_durable_bytes() const {
+  uint64_t total = 0;
+  for (const LoggerRef& logger : pimpl_->logger_refs_) {
+    total += logger.get_durable_bytes();
+  }
+  return total;
+}
 
 ErrorStack LogManager::refresh_global_durable_epoch() {
   return pimpl_->refresh_global_durable_epoch();
@@ -119,11 +119,14 @@ ErrorStack Logger::initialize_once() {
 
   // grab a buffer to pad incomplete blocks for direct file I/O
   CHECK_ERROR(engine_->get_memory_manager()->get_local_memory()->allocate_numa_memory(
-    FillerLogType::kLogWriteUnitSize, &fill_buffer_));
+    FillerLogType::kLogWriteUnitSize * kFillBlocks, &fill_buffer_));
   ASSERT_ND(!fill_buffer_.is_null());
-  ASSERT_ND(fill_buffer_.get_size() >= FillerLogType::kLogWriteUnitSize);
+  ASSERT_ND(fill_buffer_.get_size() >= FillerLogType::kLogWriteUnitSize * kFillBlocks);
   ASSERT_ND(fill_buffer_.get_alignment() >= FillerLogType::kLogWriteUnitSize);
   LOG(INFO) << "Logger-" << id_ << " grabbed a padding buffer. size=" << fill_buffer_.get_size();
+  fill_blocks_used_ = 0;
+  write_vectors_.clear();
+  write_vectors_.reserve(kMaxWriteVectors);
   CHECK_ERROR(write_dummy_epoch_mark());
 
   // log file and buffer prepared. let's launch the logger thread
@@ -223,6 +226,8 @@ ErrorStack Logger::update_durable_epoch(Epoch new_durable_epoch, bool had_any_lo
     if (!fs::fsync(current_file_path_, true)) {
       return ERROR_STACK_MSG(kErrorCodeFsSyncFailed, to_string().c_str());
     }
+    control_block_->durable_bytes_
+      += current_file_->get_current_offset() - control_block_->current_file_durable_offset_;
     control_block_->current_file_durable_offset_ = current_file_->get_current_offset();
     VLOG(0) << "Logger-" << id_ << " fsynced the current file ("
       << control_block_->current_file_durable_offset_ << "  bytes so far) and its folder";
@@ -255,6 +260,7 @@ ErrorStack Logger::update_durable_epoch(Epoch new_durable_epoch, bool had_any_lo
 }
 ErrorStack Logger::write_dummy_epoch_mark() {
   CHECK_ERROR(log_epoch_switch(get_durable_epoch()));
+  WRAP_ERROR_CODE(flush_writes());
   LOG(INFO) << "Logger-" << id_ << " wrote out a dummy epoch marker at the beginning";
   CHECK_ERROR(update_durable_epoch(get_durable_epoch(), true));  // flush the epoch mark immediately
   return kRetOk;
@@ -266,9 +272,12 @@ ErrorStack Logger::log_epoch_switch(Epoch new_epoch) {
     << ". marked_epoch_=" << control_block_->marked_epoch_ << " new_epoch=" << new_epoch;
   DVLOG(1) << *this;
 
-  // Use fill buffer to write out the epoch mark log
+  // Use fill buffer to write out the epoch mark log. This is the first write in the epoch,
+  // so the current offset of the file is the offset of the epoch mark.
   std::lock_guard<std::mutex> guard(epoch_switch_mutex_);
-  char* buf = reinterpret_cast<char*>(fill_buffer_.get_block());
+  ASSERT_ND(write_vectors_.empty());
+  char* buf;
+  WRAP_ERROR_CODE(append_fill_block(&buf));
   EpochMarkerLogType* epoch_marker = reinterpret_cast<EpochMarkerLogType*>(buf);
   epoch_marker->populate(
     control_block_->marked_epoch_,
@@ -279,12 +288,12 @@ ErrorStack Logger::log_epoch_switch(Epoch new_epoch) {
     control_block_->current_ordinal_,
     current_file_->get_current_offset());
 
-  // Fill it up to 4kb and write. A bit wasteful, but happens only once per epoch
+  // Fill it up to 4kb. A bit wasteful, but happens only once per epoch.
+  // The caller writes it out along with the logs in the epoch.
   FillerLogType* filler_log = reinterpret_cast<FillerLogType*>(buf
     + sizeof(EpochMarkerLogType));
-  filler_log->populate(fill_buffer_.get_size() - sizeof(EpochMarkerLogType));
+  filler_log->populate(FillerLogType::kLogWriteUnitSize - sizeof(EpochMarkerLogType));
 
-  WRAP_ERROR_CODE(current_file_->write(fill_buffer_.get_size(), fill_buffer_));
   control_block_->marked_epoch_ = new_epoch;
   add_epoch_history(*epoch_marker);
 
@@ -302,6 +311,8 @@ ErrorStack Logger::switch_file_if_required() {
   LOG(INFO) << "Logger-" << id_ << " moving on to next file. " << *this;
 
   // Close the current one. Immediately call fsync on it AND the parent folder.
+  control_block_->durable_bytes_
+    += current_file_->get_current_offset() - control_block_->current_file_durable_offset_;
   current_file_->close();
   delete current_file_;
   current_file_ = nullptr;
@@ -365,7 +376,12 @@ ErrorStack Logger::write_one_epoch(Epoch write_epoch) {
         CHECK_ERROR(write_one_epoch_piece(buffer, write_epoch, 0, range.end_));
       }
     }
-    buffer.on_log_written(write_epoch);
+  }
+
+  // the pending writes refer to the threads' buffers. let them reuse it only after the write
+  WRAP_ERROR_CODE(flush_writes());
+  for (thread::Thread* the_thread : assigned_threads_) {
+    the_thread->get_thread_log_buffer().on_log_written(write_epoch);
   }
   CHECK_ERROR(update_durable_epoch(write_epoch, had_any_log));
   return kRetOk;
@@ -392,7 +408,8 @@ ErrorStack Logger::write_one_epoch_piece(
   // 1) First-4kb. Do we have to pad at the beginning?
   if (!is_log_aligned(from_offset)) {
     VLOG(1) << "padding at beginning needed. ";
-    char* buf = reinterpret_cast<char*>(fill_buffer_.get_block());
+    char* buf;
+    WRAP_ERROR_CODE(append_fill_block(&buf));
 
     // pad upto from_offset
     uint64_t begin_fill_size = from_offset - align_log_floor(from_offset);
@@ -424,7 +441,6 @@ ErrorStack Logger::write_one_epoch_piece(
       FillerLogType* end_filler_log = reinterpret_cast<FillerLogType*>(buf);
       end_filler_log->populate(end_fill_size);
     }
-    WRAP_ERROR_CODE(current_file_->write(FillerLogType::kLogWriteUnitSize, fill_buffer_));
     from_offset += copy_size;
   }
 
@@ -441,7 +457,7 @@ ErrorStack Logger::write_one_epoch_piece(
   if (middle_size > 0) {
     // debugging::StopWatch watch;
     VLOG(1) << "Writing middle regions: " << middle_size << " bytes from " << from_offset;
-    WRAP_ERROR_CODE(current_file_->write_raw(middle_size, raw_buffer + from_offset));
+    WRAP_ERROR_CODE(append_write(raw_buffer + from_offset, middle_size));
     // watch.stop();
     // mm, in fact too noisy... Maybe VLOG(0). but we need this information for the paper
     // LOG(INFO) << "Wrote middle regions of " << middle_size << " bytes in "
@@ -460,7 +476,8 @@ ErrorStack Logger::write_one_epoch_piece(
 
   // 3) the last 4kb
   VLOG(1) << "padding at end needed.";
-  char* buf = reinterpret_cast<char*>(fill_buffer_.get_block());
+  char* buf;
+  WRAP_ERROR_CODE(append_fill_block(&buf));
 
   uint64_t copy_size = upto_offset - from_offset;
   ASSERT_ND(copy_size < FillerLogType::kLogWriteUnitSize);
@@ -471,11 +488,44 @@ ErrorStack Logger::write_one_epoch_piece(
   const uint64_t fill_size = FillerLogType::kLogWriteUnitSize - copy_size;
   FillerLogType* filler_log = reinterpret_cast<FillerLogType*>(buf);
   filler_log->populate(fill_size);
-
-  WRAP_ERROR_CODE(current_file_->write(FillerLogType::kLogWriteUnitSize, fill_buffer_));
   return kRetOk;
 }
 
+ErrorCode Logger::append_fill_block(char** block) {
+  if (fill_blocks_used_ >= kFillBlocks) {
+    CHECK_ERROR_CODE(flush_writes());
+  }
+  ASSERT_ND(fill_blocks_used_ < kFillBlocks);
+  *block = reinterpret_cast<char*>(fill_buffer_.get_block())
+    + FillerLogType::kLogWriteUnitSize * fill_blocks_used_;
+  ++fill_blocks_used_;
+  return append_write(*block, FillerLogType::kLogWriteUnitSize);
+}
+
+ErrorCode Logger::append_write(const char* data, uint64_t bytes) {
+  ASSERT_ND(is_log_aligned(bytes));
+  if (write_vectors_.size() >= kMaxWriteVectors) {
+    // this doesn't release blocks in fill_buffer_, so the caller can still populate its block
+    CHECK_ERROR_CODE(current_file_->write_vectored(write_vectors_.size(), &write_vectors_[0]));
+    write_vectors_.clear();
+  }
+  struct iovec vector;
+  vector.iov_base = const_cast<char*>(data);
+  vector.iov_len = bytes;
+  write_vectors_.push_back(vector);
+  return kErrorCodeOk;
+}
+
+ErrorCode Logger::flush_writes() {
+  if (!write_vectors_.empty()) {
+    VLOG(1) << "Logger-" << id_ << " writes out " << write_vectors_.size() << " buffers";
+    CHECK_ERROR_CODE(current_file_->write_vectored(write_vectors_.size(), &write_vectors_[0]));
+    write_vectors_.clear();
+  }
+  fill_blocks_used_ = 0;
+  return kErrorCodeOk;
+}
+
 void Logger::assert_written_logs(Epoch write_epoch, const char* logs, uint64_t bytes) const {
   ASSERT_ND(write_epoch.is_valid());
   ASSERT_ND(logs);
@@ -42,6 +42,10 @@ Epoch LoggerRef::get_durable_epoch() const {
   return Epoch(control_block_->durable_epoch_);
 }
 
+uint64_t LoggerRef::get_durable_bytes() const {
+  return control_block_->durable_bytes_.load(std::memory_order_relaxed);
+}
+
 void LoggerRef::wakeup_for_durable_epoch(Epoch desired_durable_epoch) {
   assorted::memory_fence_acquire();
   if (get_durable_epoch() < desired_durable_epoch) {
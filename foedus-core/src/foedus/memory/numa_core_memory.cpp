@@ -75,6 +75,7 @@ uint64_t NumaCoreMemory::calculate_local_small_memory_size(const EngineOptions&
     * xct_opt.max_lock_free_read_set_size_;
   memory_size += sizeof(xct::LockFreeWriteXctAccess)
     * xct_opt.max_lock_free_write_set_size_;
+  memory_size += sizeof(xct::PageReadAccess) * xct_opt.max_page_read_set_size_;
   memory_size += sizeof(memory::PagePoolOffsetAndEpochChunk) * nodes;
 
   // In reality almost no chance we take as many locks as all read/write-sets,
@@ -124,6 +125,8 @@ ErrorStack NumaCoreMemory::initialize_once() {
   memory += sizeof(xct::LockFreeReadXctAccess) * xct_opt.max_lock_free_read_set_size_;
   small_thread_local_memory_pieces_.xct_lock_free_write_access_memory_ = memory;
   memory += sizeof(xct::LockFreeWriteXctAccess) * xct_opt.max_lock_free_write_set_size_;
+  small_thread_local_memory_pieces_.xct_page_read_access_memory_ = memory;
+  memory += sizeof(xct::PageReadAccess) * xct_opt.max_page_read_set_size_;
   retired_volatile_pool_chunks_ = reinterpret_cast<PagePoolOffsetAndEpochChunk*>(memory);
   memory += sizeof(memory::PagePoolOffsetAndEpochChunk) * nodes;
 
@@ -198,7 +201,11 @@ ErrorStack NumaCoreMemory::uninitialize_once() {
 
 PagePoolOffset NumaCoreMemory::grab_free_volatile_page() {
   if (UNLIKELY(free_volatile_pool_chunk_->empty())) {
-    if (grab_free_pages_from_node(free_volatile_pool_chunk_, volatile_pool_) != kErrorCodeOk) {
+    ErrorCode code = grab_free_pages_from_node(
+      free_volatile_pool_chunk_,
+      volatile_pool_,
+      core_local_ordinal_);
+    if (code != kErrorCodeOk) {
       return 0;
     }
   }
@@ -212,7 +219,7 @@ storage::VolatilePagePointer NumaCoreMemory::grab_free_volatile_page_pointer() {
 }
 void NumaCoreMemory::release_free_volatile_page(PagePoolOffset offset) {
   if (UNLIKELY(free_volatile_pool_chunk_->full())) {
-    release_free_pages_to_node(free_volatile_pool_chunk_, volatile_pool_);
+    release_free_pages_to_node(free_volatile_pool_chunk_, volatile_pool_, core_local_ordinal_);
   }
   ASSERT_ND(!free_volatile_pool_chunk_->full());
   free_volatile_pool_chunk_->push_back(offset);
@@ -220,7 +227,11 @@ void NumaCoreMemory::release_free_volatile_page(PagePoolOffset offset) {
 
 PagePoolOffset NumaCoreMemory::grab_free_snapshot_page() {
   if (UNLIKELY(free_snapshot_pool_chunk_->empty())) {
-    if (grab_free_pages_from_node(free_snapshot_pool_chunk_, snapshot_pool_) != kErrorCodeOk) {
+    ErrorCode code = grab_free_pages_from_node(
+      free_snapshot_pool_chunk_,
+      snapshot_pool_,
+      core_local_ordinal_);
+    if (code != kErrorCodeOk) {
       return 0;
     }
   }
@@ -229,7 +240,7 @@ PagePoolOffset NumaCoreMemory::grab_free_snapshot_page() {
 }
 void NumaCoreMemory::release_free_snapshot_page(PagePoolOffset offset) {
   if (UNLIKELY(free_snapshot_pool_chunk_->full())) {
-    release_free_pages_to_node(free_snapshot_pool_chunk_, snapshot_pool_);
+    release_free_pages_to_node(free_snapshot_pool_chunk_, snapshot_pool_, core_local_ordinal_);
   }
   ASSERT_ND(!free_snapshot_pool_chunk_->full());
   free_snapshot_pool_chunk_->push_back(offset);
@@ -237,17 +248,19 @@ void NumaCoreMemory::release_free_snapshot_page(PagePoolOffset offset) {
 
 ErrorCode NumaCoreMemory::grab_free_pages_from_node(
   PagePoolOffsetChunk* free_chunk,
-  memory::PagePool* pool) {
+  memory::PagePool* pool,
+  uint16_t home_shard) {
   uint32_t desired = (free_chunk->capacity() - free_chunk->size()) / 2;
   desired = std::min<uint32_t>(desired, pool->get_recommended_pages_per_grab());
-  return pool->grab(desired, free_chunk);
+  return pool->grab(desired, free_chunk, home_shard);
 }
 
 void NumaCoreMemory::release_free_pages_to_node(
   PagePoolOffsetChunk* free_chunk,
-  memory::PagePool *pool) {
+  memory::PagePool *pool,
+  uint16_t home_shard) {
   uint32_t desired = free_chunk->size() / 2;
-  pool->release(desired, free_chunk);
+  pool->release(desired, free_chunk, home_shard);
 }
 
 PagePoolOffsetAndEpochChunk* NumaCoreMemory::get_retired_volatile_pool_chunk(uint16_t node) {
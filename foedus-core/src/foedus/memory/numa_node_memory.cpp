@@ -240,7 +240,7 @@ NumaNodeMemoryRef::NumaNodeMemoryRef(Engine* engine, thread::ThreadGroupId numa_
     memory_repo->get_volatile_pool(numa_node),
     static_cast<uint64_t>(engine->get_options().memory_.page_pool_size_mb_per_node_) << 20,
     false,
-    false);
+    engine->get_options().memory_.rigorous_page_boundary_check_);
 }
 
 std::string NumaNodeMemoryRef::dump_free_memory_stat() const {
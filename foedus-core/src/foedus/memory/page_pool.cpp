@@ -122,26 +122,44 @@ std::string PagePool::get_debug_pool_name() const { return pimpl_->get_debug_poo
 void PagePool::set_debug_pool_name(const std::string& name) { pimpl_->set_debug_pool_name(name); }
 
 uint32_t PagePool::get_recommended_pages_per_grab() const {
-  return std::min<uint32_t>(1U << 12, pimpl_->free_pool_capacity_ / 8U);
+  return std::min<uint32_t>(1U << 12, pimpl_->get_free_pool_capacity() / 8U);
 }
 
 
+uint16_t PagePool::get_shard_count() const { return pimpl_->get_shard_count(); }
+
 ErrorCode   PagePool::grab(uint32_t desired_grab_count, PagePoolOffsetChunk* chunk) {
-  return pimpl_->grab(desired_grab_count, chunk);
+  return pimpl_->grab(desired_grab_count, chunk, pimpl_->get_current_shard());
+}
+ErrorCode   PagePool::grab(
+  uint32_t desired_grab_count,
+  PagePoolOffsetChunk* chunk,
+  uint16_t home_shard) {
+  return pimpl_->grab(desired_grab_count, chunk, home_shard);
+}
+ErrorCode   PagePool::grab_one(PagePoolOffset* offset) {
+  return pimpl_->grab_one(offset, pimpl_->get_current_shard());
 }
-ErrorCode   PagePool::grab_one(PagePoolOffset* offset) { return pimpl_->grab_one(offset); }
 
 void        PagePool::release(uint32_t desired_release_count, PagePoolOffsetChunk *chunk) {
-  pimpl_->release(desired_release_count, chunk);
+  pimpl_->release(desired_release_count, chunk, pimpl_->get_current_shard());
+}
+void        PagePool::release(
+  uint32_t desired_release_count,
+  PagePoolOffsetChunk* chunk,
+  uint16_t home_shard) {
+  pimpl_->release(desired_release_count, chunk, home_shard);
 }
 void        PagePool::release(uint32_t desired_release_count, PagePoolOffsetDynamicChunk* chunk) {
-  pimpl_->release(desired_release_count, chunk);
+  pimpl_->release(desired_release_count, chunk, pimpl_->get_current_shard());
 }
 void        PagePool::release(uint32_t desired_release_count, PagePoolOffsetAndEpochChunk* chunk) {
-  pimpl_->release(desired_release_count, chunk);
+  pimpl_->release(desired_release_count, chunk, pimpl_->get_current_shard());
 }
 
-void PagePool::release_one(PagePoolOffset offset) { pimpl_->release_one(offset); }
+void PagePool::release_one(PagePoolOffset offset) {
+  pimpl_->release_one(offset, pimpl_->get_current_shard());
+}
 
 const LocalPageResolver& PagePool::get_resolver() const { return pimpl_->get_resolver(); }
 
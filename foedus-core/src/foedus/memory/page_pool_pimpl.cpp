@@ -17,6 +17,7 @@
  */
 #include "foedus/memory/page_pool_pimpl.hpp"
 
+#include <sched.h>
 #include <glog/logging.h>
 
 #include <algorithm>
@@ -42,7 +43,8 @@ PagePoolPimpl::PagePoolPimpl()
     memory_(nullptr),
     memory_size_(0),
     owns_(false),
-    rigorous_page_boundary_check_(false) {}
+    rigorous_page_boundary_check_(false),
+    free_pool_capacity_(0) {}
 
 void PagePoolPimpl::attach(
   PagePoolControlBlock* control_block,
@@ -70,6 +72,7 @@ void PagePoolPimpl::attach(
     free_pool_capacity_ = free_pool_capacity_ / 2U;
   }
   resolver_ = LocalPageResolver(pool_base_, pages_for_free_pool_, pool_size_);
+  // The shard layout is decided by the owner in initialize_once(). Don't calculate it here.
 }
 
 ErrorStack PagePoolPimpl::initialize_once() {
@@ -78,6 +81,18 @@ ErrorStack PagePoolPimpl::initialize_once() {
       << " - total_pages=" << pool_size_ << ", pages_for_free_pool_=" << pages_for_free_pool_
       << ", boundary_check=" << rigorous_page_boundary_check_;
     control_block_->initialize();
+
+    // Engines attaching to this pool read the shard layout from the control block.
+    const uint64_t shard_count = std::max<uint64_t>(
+      1U,
+      std::min<uint64_t>(
+        PagePoolControlBlock::kMaxShards,
+        free_pool_capacity_ / PagePoolControlBlock::kMinPagesPerShard));
+    control_block_->free_pool_capacity_ = free_pool_capacity_;
+    control_block_->shard_count_ = shard_count;
+    control_block_->shard_capacity_ = assorted::int_div_ceil(free_pool_capacity_, shard_count);
+    ASSERT_ND(get_shard_begin(shard_count - 1U) < free_pool_capacity_ || free_pool_capacity_ == 0);
+
     LOG(INFO) << get_debug_pool_name() << " - Constructing circular free pool...";
     // all pages after pages_for_free_pool_-th page is in the free pool at first
     if (!rigorous_page_boundary_check_) {
@@ -140,10 +155,13 @@ ErrorStack PagePoolPimpl::initialize_once() {
     }
     */
 
-    control_block_->free_pool_head_ = 0;
-    control_block_->free_pool_count_ = free_pool_capacity_;
-    LOG(INFO) << get_debug_pool_name() << " - Constructed circular free pool.";
-    assert_free_pool();
+    for (uint16_t shard = 0; shard < get_shard_count(); ++shard) {
+      get_shard(shard).head_ = 0;
+      get_shard(shard).count_ = get_shard_capacity(shard);
+      assert_free_pool(shard);
+    }
+    LOG(INFO) << get_debug_pool_name() << " - Constructed circular free pool with "
+      << get_shard_count() << " shards.";
   }
 
   return kRetOk;
@@ -151,7 +169,9 @@ ErrorStack PagePoolPimpl::initialize_once() {
 
 ErrorStack PagePoolPimpl::uninitialize_once() {
   if (owns_) {
-    assert_free_pool();
+    for (uint16_t shard = 0; shard < get_shard_count(); ++shard) {
+      assert_free_pool(shard);
+    }
     if (rigorous_page_boundary_check_) {
       LOG(INFO) << get_debug_pool_name() << " - releasing mprotect() odd-numbered pages...";
       debugging::StopWatch watch;
@@ -188,155 +208,228 @@ ErrorStack PagePoolPimpl::uninitialize_once() {
   return kRetOk;
 }
 
-ErrorCode PagePoolPimpl::grab(uint32_t desired_grab_count, PagePoolOffsetChunk* chunk) {
-  ASSERT_ND(chunk->size() + desired_grab_count <= chunk->capacity());
-  VLOG(0) << get_debug_pool_name() << " - Grabbing " << desired_grab_count << " pages."
-    << " free_pool_count_=" << get_free_pool_count()
-    << "->"
-    << (get_free_pool_count() >= desired_grab_count
-      ? get_free_pool_count() - desired_grab_count
-      : 0);
-  soc::SharedMutexScope guard(&control_block_->lock_);
-  uint64_t free_count = get_free_pool_count();
-  if (UNLIKELY(free_count == 0)) {
-    LOG(WARNING) << get_debug_pool_name() << " - No more free pages left in the pool";
-    return kErrorCodeMemoryNoFreePages;
+uint16_t PagePoolPimpl::get_current_shard() const {
+  if (get_shard_count() == 1U) {
+    return 0;
   }
+  int cpu = ::sched_getcpu();
+  return cpu < 0 ? 0 : static_cast<uint16_t>(cpu % get_shard_count());
+}
 
-  // grab from the head
-  assert_free_pool();
-  uint64_t grab_count = std::min<uint64_t>(desired_grab_count, free_count);
-  PagePoolOffset* head = free_pool_ + free_pool_head();
-  if (free_pool_head() + grab_count > free_pool_capacity_) {
+uint64_t PagePoolPimpl::get_free_pool_count() const {
+  uint64_t total = 0;
+  for (uint16_t shard = 0; shard < get_shard_count(); ++shard) {
+    total += get_shard(shard).count_;
+  }
+  return total;
+}
+
+uint64_t PagePoolPimpl::grab_from_shard(
+  uint16_t shard,
+  uint64_t desired_grab_count,
+  PagePoolOffsetChunk* chunk) {
+  PagePoolShard& s = get_shard(shard);
+  const uint64_t capacity = get_shard_capacity(shard);
+  PagePoolOffset* const base = free_pool_ + get_shard_begin(shard);
+  assert_free_pool(shard);
+  const uint64_t grabbed = std::min<uint64_t>(desired_grab_count, s.count_);
+  uint64_t grab_count = grabbed;
+  if (s.head_ + grab_count > capacity) {
     // wrap around
-    uint64_t wrap_count = free_pool_capacity_ - free_pool_head();
-    chunk->push_back(head, head + wrap_count);
-    free_pool_head() = 0;
-    decrease_free_pool_count(wrap_count);
+    uint64_t wrap_count = capacity - s.head_;
+    chunk->push_back(base + s.head_, base + capacity);
+    s.head_ = 0;
+    s.count_ -= wrap_count;
     grab_count -= wrap_count;
-    head = free_pool_;
   }
 
   // no wrap around (or no more wrap around)
-  assert_free_pool();
-  ASSERT_ND(free_pool_head() + grab_count <= free_pool_capacity_);
-  chunk->push_back(head, head + grab_count);
-  free_pool_head() += grab_count;
-  decrease_free_pool_count(grab_count);
-  assert_free_pool();
+  ASSERT_ND(s.head_ + grab_count <= capacity);
+  chunk->push_back(base + s.head_, base + s.head_ + grab_count);
+  s.head_ += grab_count;
+  if (s.head_ == capacity) {
+    s.head_ = 0;
+  }
+  s.count_ -= grab_count;
+  assert_free_pool(shard);
+  return grabbed;
+}
+
+ErrorCode PagePoolPimpl::grab(
+  uint32_t desired_grab_count,
+  PagePoolOffsetChunk* chunk,
+  uint16_t home_shard) {
+  ASSERT_ND(chunk->size() + desired_grab_count <= chunk->capacity());
+  VLOG(0) << get_debug_pool_name() << " - Grabbing " << desired_grab_count << " pages."
+    << " free_pool_count_=" << get_free_pool_count();
+  // Start from the home shard. If it doesn't have enough free pages, steal from sibling shards.
+  uint64_t remaining = desired_grab_count;
+  for (uint16_t i = 0; i < get_shard_count() && remaining > 0; ++i) {
+    const uint16_t shard = (home_shard + i) % get_shard_count();
+    if (get_shard(shard).count_ == 0) {
+      continue;  // racy check, but it's just to skip obviously empty shards without locking
+    }
+    soc::SharedMutexScope guard(&get_shard(shard).lock_);
+    remaining -= grab_from_shard(shard, remaining, chunk);
+  }
+
+  if (UNLIKELY(remaining == desired_grab_count && desired_grab_count > 0)) {
+    LOG(WARNING) << get_debug_pool_name() << " - No more free pages left in the pool";
+    return kErrorCodeMemoryNoFreePages;
+  }
   return kErrorCodeOk;
 }
 
-ErrorCode PagePoolPimpl::grab_one(PagePoolOffset *offset) {
+ErrorCode PagePoolPimpl::grab_one(PagePoolOffset *offset, uint16_t home_shard) {
   VLOG(1) << get_debug_pool_name()
-    << " - Grabbing just one page. free_pool_count_=" << get_free_pool_count() << "->"
-    << (get_free_pool_count() - 1);
+    << " - Grabbing just one page. free_pool_count_=" << get_free_pool_count();
   *offset = 0;
-  soc::SharedMutexScope guard(&control_block_->lock_);
-  uint64_t free_count = get_free_pool_count();
-  if (UNLIKELY(free_count == 0)) {
-    LOG(WARNING) << get_debug_pool_name() << " - No more free pages left in the pool";
-    return kErrorCodeMemoryNoFreePages;
+  for (uint16_t i = 0; i < get_shard_count(); ++i) {
+    const uint16_t shard = (home_shard + i) % get_shard_count();
+    PagePoolShard& s = get_shard(shard);
+    if (s.count_ == 0) {
+      continue;
+    }
+    soc::SharedMutexScope guard(&s.lock_);
+    if (s.count_ == 0) {
+      continue;
+    }
+
+    // grab from the head
+    const uint64_t capacity = get_shard_capacity(shard);
+    ASSERT_ND(s.head_ < capacity);
+    *offset = free_pool_[get_shard_begin(shard) + s.head_];
+    ++s.head_;
+    if (s.head_ == capacity) {
+      // wrap around
+      s.head_ = 0;
+    }
+    --s.count_;
+    return kErrorCodeOk;
   }
 
-  // grab from the head
-  PagePoolOffset* head = free_pool_ + free_pool_head();
-  if (free_pool_head() == free_pool_capacity_) {
+  LOG(WARNING) << get_debug_pool_name() << " - No more free pages left in the pool";
+  return kErrorCodeMemoryNoFreePages;
+}
+
+template <typename CHUNK>
+uint64_t PagePoolPimpl::release_to_shard(
+  uint16_t shard,
+  uint64_t desired_release_count,
+  CHUNK* chunk) {
+  PagePoolShard& s = get_shard(shard);
+  const uint64_t capacity = get_shard_capacity(shard);
+  PagePoolOffset* const base = free_pool_ + get_shard_begin(shard);
+  assert_free_pool(shard);
+  const uint64_t released = std::min<uint64_t>(desired_release_count, capacity - s.count_);
+  uint64_t release_count = released;
+
+  // append to the tail
+  uint64_t tail = s.head_ + s.count_;
+  if (tail >= capacity) {
+    tail -= capacity;
+  }
+  if (tail + release_count > capacity) {
     // wrap around
-    free_pool_head() = 0;
-    head = free_pool_;
+    uint32_t wrap_count = capacity - tail;
+    chunk->move_to(base + tail, wrap_count);
+    s.count_ += wrap_count;
+    release_count -= wrap_count;
+    tail = 0;
   }
 
   // no wrap around (or no more wrap around)
-  ASSERT_ND(free_pool_head() + 1 <= free_pool_capacity_);
-  *offset = *head;
-  ++free_pool_head();
-  decrease_free_pool_count(1);
-  return kErrorCodeOk;
+  ASSERT_ND(tail + release_count <= capacity);
+  chunk->move_to(base + tail, release_count);
+  s.count_ += release_count;
+  assert_free_pool(shard);
+  return released;
 }
 
 template <typename CHUNK>
-void PagePoolPimpl::release_impl(uint32_t desired_release_count, CHUNK* chunk) {
+void PagePoolPimpl::release_impl(
+  uint32_t desired_release_count,
+  CHUNK* chunk,
+  uint16_t home_shard) {
   ASSERT_ND(chunk->size() >= desired_release_count);
   VLOG(0) << get_debug_pool_name() << " - Releasing " << desired_release_count << " pages."
-    << " free_pool_count_=" << get_free_pool_count() << "->"
-    << (get_free_pool_count() + desired_release_count);
-  soc::SharedMutexScope guard(&control_block_->lock_);
-  uint64_t free_count = get_free_pool_count();
-  if (free_count + desired_release_count > free_pool_capacity_) {
+    << " free_pool_count_=" << get_free_pool_count();
+  // Return to the home shard. If it is full, spill to sibling shards.
+  uint64_t remaining = std::min<uint64_t>(desired_release_count, chunk->size());
+  for (uint16_t i = 0; i < get_shard_count() && remaining > 0; ++i) {
+    const uint16_t shard = (home_shard + i) % get_shard_count();
+    if (get_shard(shard).count_ >= get_shard_capacity(shard)) {
+      continue;  // racy check, but it's just to skip obviously full shards without locking
+    }
+    soc::SharedMutexScope guard(&get_shard(shard).lock_);
+    remaining -= release_to_shard<CHUNK>(shard, remaining, chunk);
+  }
+
+  if (remaining > 0) {
     // this can't happen unless something is wrong! This is a critical issue from which
     // we can't recover because page pool is inconsistent!
     LOG(ERROR) << get_debug_pool_name()
       << " - PagePoolPimpl::release() More than full free-pool. inconsistent state!"
-        << " free_count/capacity/release_count=" << free_count << "/" << free_pool_capacity_
-          << "/" << desired_release_count;
+        << " free_count/capacity/release_count=" << get_free_pool_count() << "/"
+          << get_free_pool_capacity() << "/" << desired_release_count;
     // TASK(Hideaki) Do a duplicate-check here to identify the problemetic pages.
     // crash here only in debug mode. otherwise just log the error
     // ASSERT_ND(free_count + desired_release_count <= free_pool_capacity_);
     // TASK(Hideaki) need to figure out why we hit this.
-    return;
   }
-
-  // append to the tail
-  assert_free_pool();
-  uint64_t release_count = std::min<uint64_t>(desired_release_count, chunk->size());
-  uint64_t tail = free_pool_head() + free_count;
-  if (tail >= free_pool_capacity_) {
-    tail -= free_pool_capacity_;
-  }
-  if (tail + release_count > free_pool_capacity_) {
-    // wrap around
-    uint32_t wrap_count = free_pool_capacity_ - tail;
-    chunk->move_to(free_pool_ + tail, wrap_count);
-    increase_free_pool_count(wrap_count);
-    release_count -= wrap_count;
-    tail = 0;
-  }
-
-  // no wrap around (or no more wrap around)
-  ASSERT_ND(tail + release_count <= free_pool_capacity_);
-  chunk->move_to(free_pool_ + tail, release_count);
-  increase_free_pool_count(release_count);
-  assert_free_pool();
 }
-void PagePoolPimpl::release(uint32_t desired_release_count, PagePoolOffsetChunk* chunk) {
-  release_impl<PagePoolOffsetChunk>(desired_release_count, chunk);
+void PagePoolPimpl::release(
+  uint32_t desired_release_count,
+  PagePoolOffsetChunk* chunk,
+  uint16_t home_shard) {
+  release_impl<PagePoolOffsetChunk>(desired_release_count, chunk, home_shard);
 }
-void PagePoolPimpl::release(uint32_t desired_release_count, PagePoolOffsetDynamicChunk* chunk) {
-  release_impl<PagePoolOffsetDynamicChunk>(desired_release_count, chunk);
+void PagePoolPimpl::release(
+  uint32_t desired_release_count,
+  PagePoolOffsetDynamicChunk* chunk,
+  uint16_t home_shard) {
+  release_impl<PagePoolOffsetDynamicChunk>(desired_release_count, chunk, home_shard);
 }
-void PagePoolPimpl::release(uint32_t desired_release_count, PagePoolOffsetAndEpochChunk* chunk) {
-  release_impl<PagePoolOffsetAndEpochChunk>(desired_release_count, chunk);
+void PagePoolPimpl::release(
+  uint32_t desired_release_count,
+  PagePoolOffsetAndEpochChunk* chunk,
+  uint16_t home_shard) {
+  release_impl<PagePoolOffsetAndEpochChunk>(desired_release_count, chunk, home_shard);
 }
 
-void PagePoolPimpl::release_one(PagePoolOffset offset) {
+void PagePoolPimpl::release_one(PagePoolOffset offset, uint16_t home_shard) {
   ASSERT_ND(is_initialized() || !owns_);
   VLOG(1) << get_debug_pool_name() << " - Releasing just one page. free_pool_count_="
-    << get_free_pool_count() << "->" << (get_free_pool_count() + 1);
-  soc::SharedMutexScope guard(&control_block_->lock_);
-  uint64_t free_count = get_free_pool_count();
-  if (free_count >= free_pool_capacity_) {
-    // this can't happen unless something is wrong! This is a critical issue from which
-    // we can't recover because page pool is inconsistent!
-    LOG(ERROR) << get_debug_pool_name()
-      << " - PagePoolPimpl::release_one() More than full free-pool. inconsistent state!";
-    COERCE_ERROR(ERROR_STACK(kErrorCodeMemoryDuplicatePage));
-  }
+    << get_free_pool_count();
+  for (uint16_t i = 0; i < get_shard_count(); ++i) {
+    const uint16_t shard = (home_shard + i) % get_shard_count();
+    PagePoolShard& s = get_shard(shard);
+    const uint64_t capacity = get_shard_capacity(shard);
+    if (s.count_ >= capacity) {
+      continue;
+    }
+    soc::SharedMutexScope guard(&s.lock_);
+    if (s.count_ >= capacity) {
+      continue;
+    }
 
-  // append to the tail
-  uint64_t tail = free_pool_head() + free_count;
-  if (tail >= free_pool_capacity_) {
-    tail -= free_pool_capacity_;
-  }
-  if (tail == free_pool_capacity_) {
-    // wrap around
-    tail = 0;
+    // append to the tail
+    uint64_t tail = s.head_ + s.count_;
+    if (tail >= capacity) {
+      // wrap around
+      tail -= capacity;
+    }
+    ASSERT_ND(tail < capacity);
+    free_pool_[get_shard_begin(shard) + tail] = offset;
+    ++s.count_;
+    return;
   }
 
-  // no wrap around (or no more wrap around)
-  ASSERT_ND(tail + 1 <= free_pool_capacity_);
-  free_pool_[tail] = offset;
-  increase_free_pool_count(1);
+  // this can't happen unless something is wrong! This is a critical issue from which
+  // we can't recover because page pool is inconsistent!
+  LOG(ERROR) << get_debug_pool_name()
+    << " - PagePoolPimpl::release_one() More than full free-pool. inconsistent state!";
+  COERCE_ERROR(ERROR_STACK(kErrorCodeMemoryDuplicatePage));
 }
 
 
@@ -349,10 +442,17 @@ std::ostream& operator<<(std::ostream& o, const PagePoolPimpl& v) {
     << "<rigorous_page_boundary_check_>"
       << v.rigorous_page_boundary_check_ << "</rigorous_page_boundary_check_>"
     << "<pages_for_free_pool_>" << v.pages_for_free_pool_ << "</pages_for_free_pool_>"
-    << "<free_pool_capacity_>" << v.free_pool_capacity_ << "</free_pool_capacity_>"
-    << "<free_pool_head_>" << v.free_pool_head() << "</free_pool_head_>"
-    << "<free_pool_count_>" << v.get_free_pool_count() << "</free_pool_count_>"
-    << "</PagePool>";
+    << "<free_pool_capacity_>" << v.free_pool_capacity_ << "</free_pool_capacity_>";
+  if (v.control_block_) {
+    o << "<shard_count_>" << v.get_shard_count() << "</shard_count_>"
+      << "<shard_capacity_>" << v.control_block_->shard_capacity_ << "</shard_capacity_>"
+      << "<free_pool_count_>" << v.get_free_pool_count() << "</free_pool_count_>";
+    for (uint16_t shard = 0; shard < v.get_shard_count(); ++shard) {
+      o << "<Shard id=\"" << shard << "\" head=\"" << v.get_shard(shard).head_
+        << "\" count=\"" << v.get_shard(shard).count_ << "\" />";
+    }
+  }
+  o << "</PagePool>";
   return o;
 }
 
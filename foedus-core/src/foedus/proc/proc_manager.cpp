@@ -40,6 +40,13 @@ ErrorStack  ProcManager::uninitialize() { return pimpl_->uninitialize(); }
 ErrorStack  ProcManager::get_proc(const ProcName& name, Proc* out) {
   return pimpl_->get_proc(name, out);
 }
+void ProcManager::begin_invocation(thread::ThreadId thread_id) {
+  pimpl_->begin_invocation(thread_id);
+}
+void ProcManager::end_invocation(thread::ThreadId thread_id) {
+  pimpl_->end_invocation(thread_id);
+}
+uint64_t    ProcManager::get_generation() const { return pimpl_->get_generation(); }
 
 ErrorStack  ProcManager::pre_register(const ProcAndName& proc_and_name) {
   return pimpl_->pre_register(proc_and_name);
@@ -50,6 +57,9 @@ ErrorStack  ProcManager::local_register(const ProcAndName& proc_and_name) {
 ErrorStack  ProcManager::emulated_register(const ProcAndName& proc_and_name) {
   return pimpl_->emulated_register(proc_and_name);
 }
+ErrorStack  ProcManager::reload_shared_libraries() {
+  return pimpl_->reload_shared_libraries();
+}
 
 const std::vector< ProcAndName >& ProcManager::get_pre_registered_procedures() const {
   return pimpl_->pre_registered_procs_;
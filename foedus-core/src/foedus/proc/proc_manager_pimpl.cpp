@@ -17,10 +17,19 @@
  */
 #include "foedus/proc/proc_manager_pimpl.hpp"
 
+#include <dlfcn.h>
+#include <unistd.h>
 #include <glog/logging.h>
 
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <map>
+#include <mutex>
 #include <sstream>
 #include <string>
+#include <thread>
+#include <vector>
 
 #include "foedus/engine.hpp"
 #include "foedus/engine_options.hpp"
@@ -28,10 +37,32 @@
 #include "foedus/error_stack_batch.hpp"
 #include "foedus/assorted/atomic_fences.hpp"
 #include "foedus/assorted/dumb_spinlock.hpp"
+#include "foedus/fs/filesystem.hpp"
+#include "foedus/fs/path.hpp"
+#include "foedus/soc/shared_memory_repo.hpp"
 #include "foedus/soc/soc_manager.hpp"
+#include "foedus/thread/thread_id.hpp"
+#include "foedus/thread/thread_pimpl.hpp"
 
 namespace foedus {
 namespace proc {
+
+/**
+ * @brief Shared libraries of user procedures loaded in this process, for each NUMA node.
+ * @details
+ * A process has at most one SOC engine per NUMA node: one in each forked/spawned process,
+ * or all of them in the master's process for kChildEmulated SOCs. In the latter case,
+ * the master engine reloads the libraries on behalf of the SOC engines, so we keep them
+ * in a process-wide table rather than in each ProcManagerPimpl.
+ */
+static std::map< soc::SocId, std::vector< LoadedSharedLibrary > > static_node_libraries;
+
+/** Exclusive lock for static_node_libraries. This also serializes reloads in this process. */
+static std::mutex  static_node_libraries_lock;
+
+/** The in-invocation flag of this thread while it is running procedures, if any. */
+static thread_local const std::atomic<bool>* tls_invocation_flag = nullptr;
+
 ErrorStack ProcManagerPimpl::initialize_once() {
   // attach shared memories of all SOCs
   all_soc_procs_.clear();
@@ -51,13 +82,43 @@ ErrorStack ProcManagerPimpl::initialize_once() {
     get_local_data()->control_block_->initialize();
   }
 
-  // TODO(Hideaki) load shared libraries
+  // Each SOC loads shared libraries of its own node. Master has nothing to load.
+  if (!engine_->is_master()) {
+    std::lock_guard<std::mutex> guard(static_node_libraries_lock);
+    soc::SocId node = engine_->get_soc_id();
+    ASSERT_ND(static_node_libraries.find(node) == static_node_libraries.end());
+    std::vector< LoadedSharedLibrary > libraries;
+    CHECK_ERROR(open_shared_libraries(node, nullptr, &libraries));
+    uint32_t count = 0;
+    for (const LoadedSharedLibrary& library : libraries) {
+      for (const ProcAndName& proc_and_name : library.procs_) {
+        if (insert(proc_and_name, get_local_data()) == kLocalProcInvalid) {
+          LOG(ERROR) << "A procedure of this name is already registered in this engine: "
+            << proc_and_name.first;
+          close_shared_libraries(&libraries);
+          return ERROR_STACK_MSG(kErrorCodeProcProcAlreadyExists, proc_and_name.first.c_str());
+        }
+        ++count;
+      }
+    }
+    if (count > 0) {
+      LOG(INFO) << "Loaded " << count << " user procedures from shared libraries";
+    }
+    static_node_libraries[node] = libraries;
+  }
   return kRetOk;
 }
 
 ErrorStack ProcManagerPimpl::uninitialize_once() {
   ErrorStackBatch batch;
-  // TODO(Hideaki) unload shared libraries
+  if (!engine_->is_master()) {
+    std::lock_guard<std::mutex> guard(static_node_libraries_lock);
+    auto it = static_node_libraries.find(engine_->get_soc_id());
+    if (it != static_node_libraries.end()) {
+      close_shared_libraries(&it->second);
+      static_node_libraries.erase(it);
+    }
+  }
   if (!engine_->is_master()) {
     LOG(INFO) << "Uninitializing ProcManager(" << engine_->describe_short() << ")..";
     get_local_data()->control_block_->uninitialize();
@@ -139,10 +200,300 @@ ErrorStack  ProcManagerPimpl::emulated_register(const ProcAndName& proc_and_name
       << get_error_message(kErrorCodeProcRegisterUnsupportedSocType);
     return ERROR_STACK(kErrorCodeProcRegisterUnsupportedSocType);
   }
+  // All SOCs are in this process, so the function pointer is valid in all of them.
+  for (SharedData& data : all_soc_procs_) {
+    if (insert(proc_and_name, &data) == kLocalProcInvalid) {
+      LOG(ERROR) << "A procedure of this name is already registered in this engine: "
+        << proc_and_name.first;
+      return ERROR_STACK(kErrorCodeProcProcAlreadyExists);
+    }
+  }
   LOG(INFO) << "emulated-registered a user procedure: " << proc_and_name.first;
   return kRetOk;
 }
 
+ErrorStack ProcManagerPimpl::reload_shared_libraries() {
+  if (!is_initialized()) {
+    LOG(ERROR) << "Incorrect use of reload_shared_libraries(): "
+      << get_error_message(kErrorCodeProcRegisterTooEarly);
+    return ERROR_STACK(kErrorCodeProcRegisterTooEarly);
+  }
+
+  EngineType soc_type = engine_->get_options().soc_.soc_type_;
+  std::vector< soc::SocId > nodes;
+  if (engine_->is_master()) {
+    // emulated mode. reload libraries of all nodes and replace procedures in all SOCs.
+    if (soc_type != kChildEmulated) {
+      LOG(ERROR) << "Incorrect use of reload_shared_libraries(): "
+        << get_error_message(kErrorCodeProcRegisterUnsupportedSocType);
+      return ERROR_STACK(kErrorCodeProcRegisterUnsupportedSocType);
+    }
+    for (soc::SocId node = 0; node < all_soc_procs_.size(); ++node) {
+      nodes.push_back(node);
+    }
+  } else {
+    // local mode. reload libraries of this node and replace procedures in this SOC.
+    if (soc_type == kChildEmulated) {
+      // dlclose() would affect other SOCs in this process.
+      LOG(ERROR) << "Incorrect use of reload_shared_libraries(): "
+        << get_error_message(kErrorCodeProcRegisterMasterOnly);
+      return ERROR_STACK(kErrorCodeProcRegisterMasterOnly);
+    }
+    nodes.push_back(engine_->get_soc_id());
+  }
+
+  std::lock_guard<std::mutex> guard(static_node_libraries_lock);
+
+  // First, load the new images while the old ones are still there. If it fails, nothing changes.
+  std::map< soc::SocId, std::vector< LoadedSharedLibrary > > new_libraries;
+  std::map< std::string, std::string > copies;
+  ErrorStack result;
+  for (soc::SocId node : nodes) {
+    result = open_shared_libraries(node, &copies, &new_libraries[node]);
+    if (result.is_error()) {
+      break;
+    }
+  }
+  // The images are mapped, so we don't need the copied files any more.
+  for (const auto& copy : copies) {
+    fs::remove(fs::Path(copy.second));
+  }
+  if (result.is_error()) {
+    for (auto& libraries : new_libraries) {
+      close_shared_libraries(&libraries.second);
+    }
+    return result;
+  }
+
+  // Then, stop invocations in the SOCs and rebuild their procedures from scratch.
+  // Procedures of the old libraries are all dropped, so that none of them points to an old image.
+  for (soc::SocId node : nodes) {
+    quiesce(node);
+  }
+  for (soc::SocId node : nodes) {
+    all_soc_procs_[node].control_block_->lock_.lock();
+  }
+  std::vector< std::vector< ProcAndName > > new_procs(nodes.size());
+  for (uint32_t i = 0; i < nodes.size(); ++i) {
+    soc::SocId node = nodes[i];
+    result = build_procs(
+      all_soc_procs_[node],
+      static_node_libraries[node],
+      new_libraries[node],
+      &new_procs[i]);
+    if (result.is_error()) {
+      break;
+    }
+  }
+  if (!result.is_error()) {
+    for (uint32_t i = 0; i < nodes.size(); ++i) {
+      replace_procs(new_procs[i], &all_soc_procs_[nodes[i]]);
+    }
+  }
+  for (soc::SocId node : nodes) {
+    all_soc_procs_[node].control_block_->lock_.unlock();
+    resume(&all_soc_procs_[node]);
+  }
+
+  // Finally, unload the images nobody can reach any more.
+  for (uint32_t i = 0; i < nodes.size(); ++i) {
+    soc::SocId node = nodes[i];
+    if (result.is_error()) {
+      close_shared_libraries(&new_libraries[node]);
+    } else {
+      close_shared_libraries(&static_node_libraries[node]);
+      static_node_libraries[node] = new_libraries[node];
+      LOG(INFO) << "Reloaded shared libraries in SOC-" << node << ". It now has "
+        << new_procs[i].size() << " procedures";
+    }
+  }
+  return result;
+}
+
+std::atomic<bool>* ProcManagerPimpl::get_invocation_flag(thread::ThreadId thread_id) const {
+  soc::SharedMemoryRepo* memory_repo = engine_->get_soc_manager()->get_shared_memory_repo();
+  return &memory_repo->get_thread_memory_anchors(thread_id)->thread_memory_->in_proc_invocation_;
+}
+
+void ProcManagerPimpl::begin_invocation(thread::ThreadId thread_id) {
+  ASSERT_ND(thread::decompose_numa_node(thread_id) == engine_->get_soc_id());
+  const ProcManagerControlBlock* block = get_local_data()->control_block_;
+  std::atomic<bool>* flag = get_invocation_flag(thread_id);
+  ASSERT_ND(tls_invocation_flag == nullptr);
+  ASSERT_ND(!flag->load(std::memory_order_relaxed));
+  while (true) {
+    while (block->reloading_.load(std::memory_order_acquire)) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    // Dekker-style handshake with quiesce(). The flag must be visible before we check again,
+    // otherwise a reload that started just now would miss us. Only we write this cacheline.
+    flag->store(true, std::memory_order_seq_cst);
+    if (!block->reloading_.load(std::memory_order_seq_cst)) {
+      break;
+    }
+    flag->store(false, std::memory_order_release);
+  }
+  tls_invocation_flag = flag;
+}
+
+void ProcManagerPimpl::end_invocation(thread::ThreadId thread_id) {
+  std::atomic<bool>* flag = get_invocation_flag(thread_id);
+  ASSERT_ND(tls_invocation_flag == flag);
+  ASSERT_ND(flag->load(std::memory_order_relaxed));
+  tls_invocation_flag = nullptr;
+  flag->store(false, std::memory_order_release);
+}
+
+uint64_t ProcManagerPimpl::get_generation() const {
+  return get_local_data()->control_block_->generation_.load();
+}
+
+void ProcManagerPimpl::quiesce(soc::SocId node) const {
+  ProcManagerControlBlock* block = all_soc_procs_[node].control_block_;
+  ASSERT_ND(!block->reloading_.load());
+  block->reloading_.store(true, std::memory_order_seq_cst);
+  const uint16_t thread_count = engine_->get_options().thread_.thread_count_per_group_;
+  for (uint32_t rep = 1;; ++rep) {
+    uint16_t running = 0;
+    for (uint16_t ordinal = 0; ordinal < thread_count; ++ordinal) {
+      const std::atomic<bool>* flag = get_invocation_flag(thread::compose_thread_id(node, ordinal));
+      if (flag != tls_invocation_flag && flag->load(std::memory_order_seq_cst)) {
+        ++running;
+      }
+    }
+    if (running == 0) {
+      break;
+    }
+    if (rep % 1000U == 0) {
+      LOG(INFO) << "Still waiting for " << running << " workers in SOC-" << node
+        << " to finish running procedures before reloading shared libraries..";
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+}
+
+void ProcManagerPimpl::resume(SharedData* shared_data) {
+  ASSERT_ND(shared_data->control_block_->reloading_.load());
+  shared_data->control_block_->reloading_.store(false);
+}
+
+std::vector< std::string > ProcManagerPimpl::list_shared_libraries(soc::SocId node) const {
+  const ProcOptions& options = engine_->get_options().proc_;
+  std::vector< std::string > paths;
+  std::stringstream path_pattern(options.convert_shared_library_path_pattern(node));
+  std::string token;
+  while (std::getline(path_pattern, token, ';')) {
+    if (!token.empty()) {
+      paths.push_back(token);
+    }
+  }
+
+  std::stringstream dir_pattern(options.convert_shared_library_dir_pattern(node));
+  while (std::getline(dir_pattern, token, ';')) {
+    if (token.empty()) {
+      continue;
+    }
+    fs::Path dir(token);
+    std::vector< std::string > files;
+    for (const fs::Path& child : dir.child_paths()) {
+      const std::string& name = child.string();
+      if (name.size() > 3U && name.compare(name.size() - 3U, 3U, ".so") == 0
+        && fs::is_regular_file(child)) {
+        files.push_back(name);
+      }
+    }
+    // readdir() returns files in arbitrary order. Let's make it deterministic.
+    std::sort(files.begin(), files.end());
+    paths.insert(paths.end(), files.begin(), files.end());
+  }
+  return paths;
+}
+
+ErrorStack ProcManagerPimpl::open_shared_libraries(
+  soc::SocId node,
+  std::map< std::string, std::string >* copies,
+  std::vector< LoadedSharedLibrary >* out) {
+  ASSERT_ND(out->empty());
+  for (const std::string& path : list_shared_libraries(node)) {
+    std::string load_path = path;
+    if (copies) {
+      // dlopen() of the same path would just return the old image that is still loaded.
+      auto it = copies->find(path);
+      if (it == copies->end()) {
+        std::string copy_path;
+        ErrorStack copied = copy_shared_library(path, &copy_path);
+        if (copied.is_error()) {
+          close_shared_libraries(out);
+          return copied;
+        }
+        it = copies->insert(std::make_pair(path, copy_path)).first;
+      }
+      load_path = it->second;
+    }
+
+    LoadedSharedLibrary library;
+    ErrorStack opened = open_shared_library(path, load_path, &library);
+    if (opened.is_error()) {
+      close_shared_libraries(out);
+      return opened;
+    }
+    out->push_back(library);
+  }
+  return kRetOk;
+}
+
+ErrorStack ProcManagerPimpl::open_shared_library(
+  const std::string& path,
+  const std::string& load_path,
+  LoadedSharedLibrary* out) {
+  void* handle = ::dlopen(load_path.c_str(), RTLD_NOW | RTLD_LOCAL);
+  if (handle == nullptr) {
+    LOG(ERROR) << "Failed to load a shared library. dlerror=" << ::dlerror();
+    return ERROR_STACK_MSG(kErrorCodeProcLibraryLoadFailed, path.c_str());
+  }
+  ProcLibraryEntry entry = reinterpret_cast<ProcLibraryEntry>(
+    ::dlsym(handle, kProcLibraryEntryName));
+  if (entry == nullptr) {
+    LOG(ERROR) << "The shared library doesn't export " << kProcLibraryEntryName << ": " << path;
+    ::dlclose(handle);
+    return ERROR_STACK_MSG(kErrorCodeProcLibraryNoEntry, path.c_str());
+  }
+  out->path_ = path;
+  out->handle_ = handle;
+  out->procs_.clear();
+  entry(&out->procs_);
+  LOG(INFO) << "Loaded a shared library: " << path << " (" << load_path << ")";
+  return kRetOk;
+}
+
+ErrorStack ProcManagerPimpl::copy_shared_library(const std::string& path, std::string* copy_path) {
+  // Not ending with .so so that shared_library_dir_pattern_ never picks it up.
+  *copy_path = path + ".reload-" + fs::unique_name(::getpid());
+  std::ifstream in(path.c_str(), std::ios::binary);
+  std::ofstream copy(copy_path->c_str(), std::ios::binary | std::ios::trunc);
+  if (in && copy) {
+    copy << in.rdbuf();
+    copy.close();
+  }
+  if (!in || !copy) {
+    LOG(ERROR) << "Failed to copy a shared library to " << *copy_path;
+    fs::remove(fs::Path(*copy_path));
+    return ERROR_STACK_MSG(kErrorCodeProcLibraryLoadFailed, path.c_str());
+  }
+  return kRetOk;
+}
+
+void ProcManagerPimpl::close_shared_libraries(std::vector< LoadedSharedLibrary >* libraries) {
+  for (const LoadedSharedLibrary& library : *libraries) {
+    if (::dlclose(library.handle_) != 0) {
+      LOG(WARNING) << "dlclose() failed on " << library.path_ << ": " << ::dlerror();
+    } else {
+      LOG(INFO) << "Unloaded a shared library: " << library.path_;
+    }
+  }
+  libraries->clear();
+}
+
 LocalProcId ProcManagerPimpl::find_by_name(const ProcName& name, SharedData* shared_data) {
   // so far just a seqnetial search.
   LocalProcId count = shared_data->control_block_->count_;
@@ -169,6 +520,55 @@ LocalProcId ProcManagerPimpl::insert(const ProcAndName& proc_and_name, SharedDat
   return new_id;
 }
 
+ErrorStack ProcManagerPimpl::build_procs(
+  const SharedData& shared_data,
+  const std::vector< LoadedSharedLibrary >& old_libraries,
+  const std::vector< LoadedSharedLibrary >& new_libraries,
+  std::vector< ProcAndName >* out) {
+  out->clear();
+  for (LocalProcId i = 0; i < shared_data.control_block_->count_; ++i) {
+    const ProcAndName& proc_and_name = shared_data.procs_[i];
+    bool owned = false;
+    for (const LoadedSharedLibrary& library : old_libraries) {
+      for (const ProcAndName& library_proc : library.procs_) {
+        if (library_proc.first == proc_and_name.first) {
+          owned = true;
+          break;
+        }
+      }
+    }
+    if (!owned) {
+      out->push_back(proc_and_name);  // eg registered via pre_register()
+    }
+  }
+  for (const LoadedSharedLibrary& library : new_libraries) {
+    for (const ProcAndName& proc_and_name : library.procs_) {
+      for (const ProcAndName& existing : *out) {
+        if (existing.first == proc_and_name.first) {
+          LOG(ERROR) << "A procedure of this name is already registered in this engine: "
+            << proc_and_name.first << ", library=" << library.path_;
+          return ERROR_STACK_MSG(kErrorCodeProcProcAlreadyExists, proc_and_name.first.c_str());
+        }
+      }
+      out->push_back(proc_and_name);
+    }
+  }
+  return kRetOk;
+}
+
+void ProcManagerPimpl::replace_procs(
+  const std::vector< ProcAndName >& procs,
+  SharedData* shared_data) {
+  ASSERT_ND(shared_data->control_block_->reloading_.load());
+  ASSERT_ND(procs.size() < kLocalProcInvalid);
+  for (LocalProcId i = 0; i < procs.size(); ++i) {
+    shared_data->procs_[i] = procs[i];
+  }
+  shared_data->control_block_->count_ = procs.size();
+  assorted::memory_fence_release();
+  ++shared_data->control_block_->generation_;
+}
+
 std::string ProcManagerPimpl::describe_registered_procs() const {
   if (engine_->is_master()) {
     return "<Master engine has no proc>";
@@ -85,17 +85,30 @@ ErrorStack RestartManagerPimpl::recover() {
     }
   }
 
+  snapshot::SnapshotManagerPimpl* snapshot_pimpl = engine_->get_snapshot_manager()->get_pimpl();
   if (durable_epoch == snapshot_epoch) {
-    LOG(INFO) << "The snapshot is up-to-date. No need to recover.";
-    return kRetOk;
+    if (!snapshot_pimpl->has_deferred_storages()) {
+      LOG(INFO) << "The snapshot is up-to-date. No need to recover.";
+      return kRetOk;
+    }
+    // The latest snapshot deferred some storages (see snapshot::StorageSelection).
+    // The recovery snapshot includes them, but a new snapshot needs a newer durable epoch.
+    LOG(INFO) << "Some storages were deferred in the latest snapshot. Advancing epoch..";
+    xct::XctManager* xct_manager = engine_->get_xct_manager();
+    const Epoch target_epoch = snapshot_epoch.one_more();
+    while (xct_manager->get_current_global_epoch() <= target_epoch) {
+      xct_manager->advance_current_global_epoch();
+    }
+    WRAP_ERROR_CODE(xct_manager->wait_for_commit(target_epoch));
+    durable_epoch = engine_->get_log_manager()->get_durable_global_epoch();
+    ASSERT_ND(durable_epoch > snapshot_epoch);
   }
 
   LOG(INFO) << "There are logs that are durable but not yet snapshotted.";
   CHECK_ERROR(redo_meta_logs(durable_epoch, snapshot_epoch));
   LOG(INFO) << "Launching snapshot..";
-  snapshot::SnapshotManagerPimpl* snapshot_pimpl = engine_->get_snapshot_manager()->get_pimpl();
   snapshot::Snapshot the_snapshot;
-  CHECK_ERROR(snapshot_pimpl->handle_snapshot_triggered(&the_snapshot));
+  CHECK_ERROR(snapshot_pimpl->handle_snapshot_triggered(&the_snapshot, true));
   LOG(INFO) << "Finished initial snapshot during start-up.";
 
   // This fixes Bug #127.
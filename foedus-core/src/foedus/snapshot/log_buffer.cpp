@@ -17,12 +17,14 @@
  */
 #include "foedus/snapshot/log_buffer.hpp"
 
+#include <aio.h>
 #include <glog/logging.h>
 
 #include <algorithm>
 #include <cstring>
 #include <ostream>
 #include <string>
+#include <utility>
 
 #include "foedus/fs/direct_io_file.hpp"
 #include "foedus/fs/filesystem.hpp"
@@ -55,15 +57,29 @@ void InMemorySortedBuffer::describe(std::ostream* optr) const {
 
 
 DumpFileSortedBuffer::DumpFileSortedBuffer(
-  fs::DirectIoFile* file, memory::AlignedMemorySlice io_buffer)
+  fs::DirectIoFile* file,
+  memory::AlignedMemorySlice io_buffer,
+  memory::AlignedMemorySlice read_ahead_buffer)
   : SortedBuffer(
     reinterpret_cast<char*>(io_buffer.get_block()),
     io_buffer.get_size(),
     fs::file_size(file->get_path())),
     file_(file),
-    io_buffer_(io_buffer) {
+    io_buffer_(io_buffer),
+    read_ahead_buffer_(read_ahead_buffer),
+    read_ahead_active_(false),
+    read_ahead_offset_(0) {
   ASSERT_ND(buffer_size_ % kAlignment == 0);
   ASSERT_ND(total_size_ % kAlignment == 0);
+  ASSERT_ND(!read_ahead_buffer_.is_valid() || read_ahead_buffer_.get_size() == buffer_size_);
+  uint64_t overlap = std::max<uint64_t>(buffer_size_ / 16U, kMinReadAheadOverlap);
+  overlap = std::min<uint64_t>(overlap, buffer_size_ / 2U);
+  read_ahead_overlap_ = overlap / kAlignment * kAlignment;
+}
+
+DumpFileSortedBuffer::~DumpFileSortedBuffer() {
+  // the read must not outlive the buffer. we don't care its result here.
+  wait_read_ahead();
 }
 
 std::string DumpFileSortedBuffer::to_string() const {
@@ -76,9 +92,55 @@ void DumpFileSortedBuffer::describe(std::ostream* optr) const {
   describe_base_elements(optr);
   o << "<file_>" << file_ << "</file_>";
   o << "<io_buffer_>" << io_buffer_ << "</io_buffer_>";
+  o << "<read_ahead_buffer_>" << read_ahead_buffer_ << "</read_ahead_buffer_>";
+  o << "<read_ahead_overlap_>" << read_ahead_overlap_ << "</read_ahead_overlap_>";
+  o << "<read_ahead_active_>" << read_ahead_active_ << "</read_ahead_active_>";
+  o << "<read_ahead_offset_>" << read_ahead_offset_ << "</read_ahead_offset_>";
   o << "</DumpFileSortedBuffer>";
 }
 
+ErrorCode DumpFileSortedBuffer::read_first_window() {
+  ASSERT_ND(offset_ == 0);
+  ASSERT_ND(file_->get_current_offset() == 0);
+  uint64_t desired_reads = std::min(buffer_size_, total_size_);
+  CHECK_ERROR_CODE(file_->read(desired_reads, io_buffer_));
+  if (is_read_ahead_enabled()) {
+    CHECK_ERROR_CODE(start_read_ahead());
+  }
+  return kErrorCodeOk;
+}
+
+ErrorCode DumpFileSortedBuffer::start_read_ahead() {
+  ASSERT_ND(!read_ahead_active_);
+  if (offset_ + buffer_size_ >= total_size_) {
+    return kErrorCodeOk;  // this is the last window. nothing to read ahead
+  }
+  read_ahead_offset_ = offset_ + buffer_size_ - read_ahead_overlap_;
+  uint64_t desired_reads = std::min(buffer_size_, total_size_ - read_ahead_offset_);
+  CHECK_ERROR_CODE(file_->read_async(
+    read_ahead_offset_,
+    desired_reads,
+    read_ahead_buffer_.get_block(),
+    &read_ahead_control_));
+  read_ahead_active_ = true;
+  return kErrorCodeOk;
+}
+
+ErrorCode DumpFileSortedBuffer::wait_read_ahead() {
+  while (read_ahead_active_) {
+    bool completed = false;
+    ErrorCode result = file_->poll_async_read(&read_ahead_control_, &completed);
+    if (completed) {
+      read_ahead_active_ = false;
+      return result;
+    }
+    // Errors (EINTR etc) just mean we poll again.
+    const struct aiocb* controls[1] = { &read_ahead_control_ };
+    ::aio_suspend(controls, 1, nullptr);
+  }
+  return kErrorCodeOk;
+}
+
 ErrorCode DumpFileSortedBuffer::wind(uint64_t next_absolute_pos) {
   ASSERT_ND(offset_ % kAlignment == 0);
   assert_checks();
@@ -93,6 +155,29 @@ ErrorCode DumpFileSortedBuffer::wind(uint64_t next_absolute_pos) {
     return kErrorCodeInvalidParameter;
   }
 
+  if (is_read_ahead_enabled()) {
+    CHECK_ERROR_CODE(wait_read_ahead());
+    ASSERT_ND(read_ahead_offset_ == offset_ + buffer_size_ - read_ahead_overlap_);
+    if (next_absolute_pos >= read_ahead_offset_) {
+      // the usual case. the read-ahead buffer has the next window. just switch to it.
+      std::swap(io_buffer_, read_ahead_buffer_);
+      buffer_ = reinterpret_cast<char*>(io_buffer_.get_block());
+      offset_ = read_ahead_offset_;
+    } else {
+      // the caller retains more than the overlap. this should be rare. the read-ahead
+      // doesn't cover next_absolute_pos, so we read the window again from there.
+      LOG(INFO) << to_string() << " retained more than the read-ahead overlap. next_absolute_pos="
+        << next_absolute_pos << ", offset=" << offset_ << ", overlap=" << read_ahead_overlap_;
+      offset_ = next_absolute_pos / kAlignment * kAlignment;
+      CHECK_ERROR_CODE(file_->seek(offset_, fs::DirectIoFile::kDirectIoSeekSet));
+      CHECK_ERROR_CODE(file_->read(std::min(buffer_size_, total_size_ - offset_), io_buffer_));
+    }
+    CHECK_ERROR_CODE(start_read_ahead());
+    ASSERT_ND(next_absolute_pos >= offset_);
+    assert_checks();
+    return kErrorCodeOk;
+  }
+
   // suppose buf=64M and we have read second window(64M-128M) and now moving on to third window.
   // in the easiest case, current offset_=64M, next_absolute_pos=128M. we just read 64M.
   // but, probably next_absolute_pos=128M-alpha, further alpha might not be 4k-aligned.
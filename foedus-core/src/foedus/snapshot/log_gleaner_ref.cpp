@@ -53,6 +53,9 @@ uint16_t LogGleanerRef::increment_exit_count() {
   ASSERT_ND(control_block_->exit_count_ < control_block_->all_count_);
   return ++control_block_->exit_count_;
 }
+void LogGleanerRef::add_read_ahead_log_bytes(uint64_t bytes) {
+  control_block_->read_ahead_log_bytes_ += bytes;
+}
 
 bool LogGleanerRef::is_all_exitted() const {
   return control_block_->exit_count_ >= control_block_->all_count_;
@@ -67,6 +70,9 @@ bool LogGleanerRef::is_all_mappers_completed() const {
 uint16_t LogGleanerRef::get_mappers_count() const { return control_block_->mappers_count_; }
 uint16_t LogGleanerRef::get_reducers_count() const { return control_block_->reducers_count_; }
 uint16_t LogGleanerRef::get_all_count() const { return control_block_->all_count_; }
+uint64_t LogGleanerRef::get_read_ahead_log_bytes() const {
+  return control_block_->read_ahead_log_bytes_;
+}
 
 bool LogGleanerRef::is_error() const { return control_block_->is_error(); }
 void LogGleanerRef::wakeup() {
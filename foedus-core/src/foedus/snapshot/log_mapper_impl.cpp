@@ -20,8 +20,10 @@
 #include <glog/logging.h>
 
 #include <algorithm>
+#include <cstring>
 #include <ostream>
 #include <string>
+#include <vector>
 
 #include "foedus/assert_nd.hpp"
 #include "foedus/engine.hpp"
@@ -29,6 +31,7 @@
 #include "foedus/epoch.hpp"
 #include "foedus/error_stack_batch.hpp"
 #include "foedus/assorted/assorted_func.hpp"
+#include "foedus/assorted/raw_atomics.hpp"
 #include "foedus/debugging/stop_watch.hpp"
 #include "foedus/fs/direct_io_file.hpp"
 #include "foedus/fs/filesystem.hpp"
@@ -39,6 +42,10 @@
 #include "foedus/snapshot/log_gleaner_impl.hpp"
 #include "foedus/snapshot/log_reducer_impl.hpp"
 #include "foedus/snapshot/snapshot.hpp"
+#include "foedus/snapshot/storage_selection.hpp"
+#include "foedus/soc/shared_memory_repo.hpp"
+#include "foedus/soc/soc_id.hpp"
+#include "foedus/soc/soc_manager.hpp"
 #include "foedus/storage/partitioner.hpp"
 #include "foedus/storage/storage_manager.hpp"
 #include "foedus/storage/hash/hash_log_types.hpp"
@@ -57,7 +64,12 @@ uint16_t calculate_logger_id(Engine* engine, uint16_t local_ordinal) {
 
 LogMapper::LogMapper(Engine* engine, uint16_t local_ordinal)
   : MapReduceBase(engine, calculate_logger_id(engine, local_ordinal)),
-    processed_log_count_(0) {
+    processed_log_count_(0),
+    selective_(false),
+    selective_max_storage_id_(0),
+    storage_selections_(engine->get_soc_manager()->get_shared_memory_repo()->
+      get_global_memory_anchors()->storage_selection_memory_) {
+  std::memset(&read_ahead_, 0, sizeof(read_ahead_));
   clear_storage_buckets();
 }
 
@@ -119,6 +131,7 @@ ErrorStack LogMapper::initialize_once() {
   }
 
   processed_log_count_ = 0;
+  std::memset(&read_ahead_, 0, sizeof(read_ahead_));
   clear_storage_buckets();
 
   return kRetOk;
@@ -129,6 +142,7 @@ ErrorStack LogMapper::uninitialize_once() {
   io_buffer_.release_block();
   buckets_memory_.release_block();
   tmp_memory_.release_block();
+  std::memset(&read_ahead_, 0, sizeof(read_ahead_));
   clear_storage_buckets();
   return SUMMARIZE_ERROR_BATCH(batch);
 }
@@ -137,12 +151,88 @@ const uint64_t kIoAlignment = 0x1000;
 uint64_t align_io_floor(uint64_t offset) { return (offset / kIoAlignment) * kIoAlignment; }
 uint64_t align_io_ceil(uint64_t offset) { return align_io_floor(offset + kIoAlignment - 1U); }
 
+ErrorStack LogMapper::read_ahead_durable_logs(Epoch base_epoch) {
+  log::LoggerRef logger = engine_->get_log_manager()->get_logger(id_);
+  // We do nothing unless the logger made more bytes durable since the last call.
+  // Logs durable in the file but not yet in the global durable epoch are thus read here only when
+  // the logger writes more. Otherwise the mapper reads them in the snapshot as usual.
+  const uint64_t durable_bytes = logger.get_durable_bytes();
+  if (read_ahead_.base_epoch_ == base_epoch.value()
+    && read_ahead_.durable_bytes_ == durable_bytes) {
+    return kRetOk;  // nothing new. this is the usual case when the logger is idle.
+  }
+  const Epoch durable_epoch = engine_->get_log_manager()->get_durable_global_epoch();
+  if (!durable_epoch.is_valid() || (base_epoch.is_valid() && durable_epoch <= base_epoch)) {
+    return kRetOk;
+  }
+  read_ahead_.base_epoch_ = base_epoch.value();
+  read_ahead_.durable_bytes_ = durable_bytes;
+  const log::LogRange log_range = logger.get_log_range(base_epoch, durable_epoch);
+  if (log_range.is_empty()) {
+    return kRetOk;
+  }
+
+  // The beginning of the range is stable until the next snapshot changes base_epoch.
+  // If it moved, what we have read so far is useless.
+  const uint64_t buf_infile_aligned = align_io_floor(log_range.begin_offset);
+  if (read_ahead_.file_ordinal_ != log_range.begin_file_ordinal
+    || read_ahead_.buf_infile_aligned_ != buf_infile_aligned) {
+    read_ahead_.file_ordinal_ = log_range.begin_file_ordinal;
+    read_ahead_.buf_infile_aligned_ = buf_infile_aligned;
+    read_ahead_.size_inbuf_aligned_ = 0;
+  }
+
+  // We read only within the first file, only the 4kb-aligned durable part.
+  fs::Path path(engine_->get_options().log_.construct_suffixed_log_path(
+    numa_node_,
+    id_,
+    log_range.begin_file_ordinal));
+  uint64_t end_infile;
+  if (log_range.end_file_ordinal == log_range.begin_file_ordinal) {
+    end_infile = log_range.end_offset;
+  } else {
+    end_infile = fs::file_size(path);
+  }
+  end_infile = align_io_floor(end_infile);
+  ASSERT_ND(end_infile >= buf_infile_aligned);
+  const uint64_t end_inbuf_aligned = std::min<uint64_t>(
+    io_buffer_.get_size(),
+    end_infile - buf_infile_aligned);
+  if (end_inbuf_aligned <= read_ahead_.size_inbuf_aligned_) {
+    return kRetOk;
+  }
+
+  const uint64_t read_bytes = end_inbuf_aligned - read_ahead_.size_inbuf_aligned_;
+  fs::DirectIoFile file(path, engine_->get_options().snapshot_.emulation_);
+  WRAP_ERROR_CODE(file.open(true, false, false, false));
+  WRAP_ERROR_CODE(file.seek(
+    buf_infile_aligned + read_ahead_.size_inbuf_aligned_,
+    fs::DirectIoFile::kDirectIoSeekSet));
+  char* buffer = reinterpret_cast<char*>(io_buffer_.get_block());
+  WRAP_ERROR_CODE(file.read_raw(read_bytes, buffer + read_ahead_.size_inbuf_aligned_));
+  file.close();
+  DVLOG(1) << to_string() << " read ahead " << read_bytes << " bytes. now "
+    << end_inbuf_aligned << " bytes in buffer";
+  read_ahead_.size_inbuf_aligned_ = end_inbuf_aligned;
+  return kRetOk;
+}
+
 ErrorStack LogMapper::handle_process() {
   const Epoch base_epoch = parent_.get_base_epoch();
   const Epoch until_epoch = parent_.get_valid_until_epoch();
   log::LoggerRef logger = engine_->get_log_manager()->get_logger(id_);
   const log::LogRange log_range = logger.get_log_range(base_epoch, until_epoch);
   // uint64_t cur_offset = log_range.begin_offset;
+  // Logs read ahead before this snapshot are used at most once, only for the first read.
+  ReadAheadStatus read_ahead = read_ahead_;
+  std::memset(&read_ahead_, 0, sizeof(read_ahead_));
+  const Snapshot& cur_snapshot = parent_.get_cur_snapshot();
+  selective_ = cur_snapshot.selective_;
+  selective_max_storage_id_ = cur_snapshot.max_storage_id_;
+  deferred_log_counts_.clear();
+  if (selective_) {
+    deferred_log_counts_.resize(selective_max_storage_id_ + 1U, 0);
+  }
   if (log_range.is_empty()) {
     LOG(INFO) << to_string() << " has no logs to process";
     report_completion(0);
@@ -201,13 +291,27 @@ ErrorStack LogMapper::handle_process() {
     while (true) {
       WRAP_ERROR_CODE(check_cancelled());  // check per each read
       status.buf_infile_aligned_ = align_io_floor(status.next_infile_);
-      WRAP_ERROR_CODE(file.seek(status.buf_infile_aligned_, fs::DirectIoFile::kDirectIoSeekSet));
-      DVLOG(1) << to_string() << " seeked to: " << assorted::Hex(status.buf_infile_aligned_);
       status.end_inbuf_aligned_ = std::min(
         io_buffer_.get_size(),
         align_io_ceil(status.end_infile_ - status.buf_infile_aligned_));
       ASSERT_ND(status.end_inbuf_aligned_ % kIoAlignment == 0);
-      WRAP_ERROR_CODE(file.read(status.end_inbuf_aligned_, &io_buffer_));
+      if (read_ahead.size_inbuf_aligned_ > 0
+        && read_ahead.file_ordinal_ == status.cur_file_ordinal_
+        && read_ahead.buf_infile_aligned_ == status.buf_infile_aligned_) {
+        // The logs are already in io_buffer_. If they are shorter than this read,
+        // handle_process_buffer() tells us to read the rest just like a log spanning two reads.
+        status.end_inbuf_aligned_ = std::min(
+          status.end_inbuf_aligned_,
+          read_ahead.size_inbuf_aligned_);
+        LOG(INFO) << to_string() << " uses " << status.end_inbuf_aligned_
+          << " bytes of logs read ahead";
+        parent_.add_read_ahead_log_bytes(status.end_inbuf_aligned_);
+        read_ahead.size_inbuf_aligned_ = 0;
+      } else {
+        WRAP_ERROR_CODE(file.seek(status.buf_infile_aligned_, fs::DirectIoFile::kDirectIoSeekSet));
+        DVLOG(1) << to_string() << " seeked to: " << assorted::Hex(status.buf_infile_aligned_);
+        WRAP_ERROR_CODE(file.read(status.end_inbuf_aligned_, &io_buffer_));
+      }
 
       status.cur_inbuf_ = 0;
       if (status.next_infile_ != status.buf_infile_aligned_) {
@@ -237,6 +341,7 @@ ErrorStack LogMapper::handle_process() {
   watch.stop();
   LOG(INFO) << to_string() << " processed " << processed_log_count_ << " log entries in "
     << watch.elapsed_sec() << "s";
+  flush_deferred_log_counts();
   report_completion(watch.elapsed_sec());
   return kRetOk;
 }
@@ -307,6 +412,8 @@ ErrorStack LogMapper::handle_process_buffer(const fs::DirectIoFile &file, IoBufS
       }
     } else if (UNLIKELY(header->get_type() == log::kLogCodeFiller)) {
       // skip filler log
+    } else if (UNLIKELY(selective_) && !select_log(header)) {
+      // already in a snapshot, or carried forward to a later snapshot
     } else {
       bool bucketed = bucket_log(header->storage_id_, status->cur_inbuf_);
       if (UNLIKELY(!bucketed)) {
@@ -343,6 +450,34 @@ ErrorStack LogMapper::handle_process_buffer(const fs::DirectIoFile &file, IoBufS
   return kRetOk;
 }
 
+inline bool LogMapper::select_log(const log::LogHeader* header) {
+  ASSERT_ND(selective_);
+  const storage::StorageId storage_id = header->storage_id_;
+  if (storage_id > selective_max_storage_id_) {
+    return true;  // created during this snapshot. it can't be deferred yet
+  }
+  const StorageSelection& selection = storage_selections_[storage_id];
+  const Epoch epoch = header->xct_id_.get_epoch();
+  if (selection.get_from_epoch().is_valid() && epoch <= selection.get_from_epoch()) {
+    return false;
+  } else if (selection.is_deferred()) {
+    ++deferred_log_counts_[storage_id];
+    return false;
+  }
+  return true;
+}
+
+void LogMapper::flush_deferred_log_counts() {
+  for (storage::StorageId id = 1; id < deferred_log_counts_.size(); ++id) {
+    if (deferred_log_counts_[id] > 0) {
+      assorted::raw_atomic_fetch_add<uint64_t>(
+        &storage_selections_[id].pending_logs_,
+        deferred_log_counts_[id]);
+    }
+  }
+  deferred_log_counts_.clear();
+}
+
 inline bool LogMapper::bucket_log(storage::StorageId storage_id, uint64_t pos) {
   BucketHashList* hashlist = find_storage_hashlist(storage_id);
   if (UNLIKELY(hashlist == nullptr)) {
@@ -490,12 +625,27 @@ void LogMapper::flush_bucket(const BucketHashList& hashlist) {
           partition_array};
         partitioner.partition_batch(args);
 
-        // sort the log positions by the calculated partitions
-        std::memset(sort_array, 0, sizeof(PartitionSortEntry) * bucket->counts_);
+        // sort the log positions by the calculated partitions.
+        // There are only a few partitions, so we do a counting sort rather than std::sort.
+        // It's also stable, so logs in each partition keep the original order.
+        const uint16_t partitions = engine_->get_options().thread_.group_count_;
+        uint32_t partition_offsets[soc::kMaxSocs];
+        std::memset(partition_offsets, 0, sizeof(uint32_t) * partitions);
+        for (uint32_t i = 0; i < bucket->counts_; ++i) {
+          ASSERT_ND(partition_array[i] < partitions);
+          ++partition_offsets[partition_array[i]];
+        }
+        uint32_t total = 0;
+        for (uint16_t p = 0; p < partitions; ++p) {
+          const uint32_t count = partition_offsets[p];
+          partition_offsets[p] = total;
+          total += count;
+        }
+        ASSERT_ND(total == bucket->counts_);
         for (uint32_t i = 0; i < bucket->counts_; ++i) {
-          sort_array[i].set(partition_array[i], bucket->log_positions_[i]);
+          const storage::PartitionId partition = partition_array[i];
+          sort_array[partition_offsets[partition]++].set(partition, bucket->log_positions_[i]);
         }
-        std::sort(sort_array, sort_array + bucket->counts_);
 
         // let's reuse the current bucket as a temporary memory to hold sorted entries.
         // buckets are discarded after the flushing, so this doesn't cause any issue.
@@ -588,50 +738,75 @@ void LogMapper::send_bucket_partition_general(
   storage::StorageType storage_type,
   storage::PartitionId partition,
   const BufferPosition* positions) {
-  uint64_t written = 0;
-  uint32_t log_count = 0;
-  uint32_t shortest_key_length = 0xFFFF;
-  uint32_t longest_key_length = 0;
-  // stitch the log entries in send buffer
-  char* send_buffer = reinterpret_cast<char*>(tmp_send_buffer_slice_.get_block());
   const char* io_base = reinterpret_cast<const char*>(io_buffer_.get_block());
+  char* send_buffer = reinterpret_cast<char*>(tmp_send_buffer_slice_.get_block());
   ASSERT_ND(tmp_send_buffer_slice_.get_size() == kSendBufferSize);
 
-  for (uint32_t i = 0; i < bucket->counts_; ++i) {
-    uint64_t pos = from_buffer_position(positions[i]);
-    const log::LogHeader* header = reinterpret_cast<const log::LogHeader*>(io_base + pos);
-    ASSERT_ND(header->storage_id_ == bucket->storage_id_);
-    uint16_t log_length = header->log_length_;
-    ASSERT_ND(log_length > 0);
-    ASSERT_ND(log_length % 8 == 0);
-    if (written + log_length > kSendBufferSize) {
-      // buffer full. send out.
+  // If the reducer is on the same NUMA node, we stitch the log entries directly in its buffer.
+  // Otherwise, we stitch them in our send buffer, which is local memory, and then send it to
+  // the remote reducer in one large copy.
+  const bool zero_copy = partition == numa_node_;
+  LogReducerRef reducer(engine_, partition);
+  uint32_t from = 0;
+  while (from < bucket->counts_) {
+    // determine how many log entries fit in one block
+    uint64_t block_size = 0;
+    uint32_t to = from;
+    for (; to < bucket->counts_; ++to) {
+      uint64_t pos = from_buffer_position(positions[to]);
+      const log::LogHeader* header = reinterpret_cast<const log::LogHeader*>(io_base + pos);
+      if (block_size + header->log_length_ > kSendBufferSize) {
+        break;
+      }
+      block_size += header->log_length_;
+    }
+    ASSERT_ND(to > from);
+
+    uint32_t buffer_index = 0;
+    char* destination;
+    if (zero_copy) {
+      destination = reducer.reserve_log_chunk(block_size, &buffer_index);
+    } else {
+      destination = send_buffer;
+    }
+
+    uint64_t written = 0;
+    uint32_t shortest_key_length = 0xFFFF;
+    uint32_t longest_key_length = 0;
+    for (uint32_t i = from; i < to; ++i) {
+      uint64_t pos = from_buffer_position(positions[i]);
+      const log::LogHeader* header = reinterpret_cast<const log::LogHeader*>(io_base + pos);
+      ASSERT_ND(header->storage_id_ == bucket->storage_id_);
+      uint16_t log_length = header->log_length_;
+      ASSERT_ND(log_length > 0);
+      ASSERT_ND(log_length % 8 == 0);
+      std::memcpy(destination + written, header, log_length);
+      written += log_length;
+      update_key_lengthes(header, storage_type, &shortest_key_length, &longest_key_length);
+    }
+    ASSERT_ND(written == block_size);
+
+    if (zero_copy) {
+      reducer.commit_log_chunk(
+        bucket->storage_id_,
+        buffer_index,
+        destination,
+        to - from,
+        written,
+        shortest_key_length,
+        longest_key_length);
+    } else {
       send_bucket_partition_buffer(
         bucket,
         partition,
         send_buffer,
-        log_count,
+        to - from,
         written,
         shortest_key_length,
         longest_key_length);
-      log_count = 0;
-      written = 0;
-      shortest_key_length = 0xFFFF;
-      longest_key_length = 0;
     }
-    std::memcpy(send_buffer + written, header, header->log_length_);
-    written += header->log_length_;
-    ++log_count;
-    update_key_lengthes(header, storage_type, &shortest_key_length, &longest_key_length);
+    from = to;
   }
-  send_bucket_partition_buffer(
-    bucket,
-    partition,
-    send_buffer,
-    log_count,
-    written,
-    shortest_key_length,
-    longest_key_length);
 }
 
 void LogMapper::send_bucket_partition_presort(
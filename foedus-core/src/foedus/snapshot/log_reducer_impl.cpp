@@ -52,7 +52,8 @@ namespace snapshot {
 LogReducer::LogReducer(Engine* engine)
 : MapReduceBase(engine, engine->get_soc_id()),
   previous_snapshot_files_(engine_),
-  sorted_runs_(0) {
+  sorted_runs_(0),
+  in_memory_runs_bytes_(0) {
   soc::NodeMemoryAnchors* anchors = engine->get_soc_manager()->get_shared_memory_repo()->
     get_node_memory_anchors(numa_node_);
   control_block_ = anchors->log_reducer_memory_;
@@ -71,13 +72,7 @@ ErrorStack LogReducer::initialize_once() {
 
   const SnapshotOptions& option = engine_->get_options().snapshot_;
 
-  uint64_t dump_buffer_size = static_cast<uint64_t>(option.log_reducer_dump_io_buffer_mb_) << 20;
-  dump_io_buffer_.alloc(
-    dump_buffer_size,
-    memory::kHugepageSize,
-    memory::AlignedMemory::kNumaAllocOnnode,
-    get_numa_node());
-  ASSERT_ND(!dump_io_buffer_.is_null());
+  allocate_dump_io_buffer();
 
   // start from 1/16 of the main buffer. Should be big enough.
   sort_buffer_.alloc(
@@ -113,7 +108,7 @@ ErrorStack LogReducer::initialize_once() {
     memory::AlignedMemory::kNumaAllocOnnode,
     numa_node_),
 
-  sorted_runs_ = 0;
+  clear_sorted_runs();
 
   CHECK_ERROR(previous_snapshot_files_.initialize());
   return kRetOk;
@@ -122,6 +117,7 @@ ErrorStack LogReducer::initialize_once() {
 ErrorStack LogReducer::uninitialize_once() {
   ErrorStackBatch batch;
   batch.emprace_back(previous_snapshot_files_.uninitialize());
+  clear_sorted_runs();
   writer_intermediate_memory_.release_block();
   writer_pool_memory_.release_block();
   dump_io_buffer_.release_block();
@@ -131,7 +127,31 @@ ErrorStack LogReducer::uninitialize_once() {
   return SUMMARIZE_ERROR_BATCH(batch);
 }
 
+void LogReducer::allocate_dump_io_buffer() {
+  const SnapshotOptions& option = engine_->get_options().snapshot_;
+  uint64_t dump_buffer_size = static_cast<uint64_t>(option.log_reducer_dump_io_buffer_mb_) << 20;
+  dump_io_buffer_.alloc(
+    dump_buffer_size,
+    memory::kHugepageSize,
+    memory::AlignedMemory::kNumaAllocOnnode,
+    get_numa_node());
+  ASSERT_ND(!dump_io_buffer_.is_null());
+}
+
+void LogReducer::clear_sorted_runs() {
+  sorted_runs_ = 0;
+  in_memory_runs_.clear();
+  in_memory_runs_bytes_ = 0;
+}
+
 ErrorStack LogReducer::handle_process() {
+  // This object is reused for every snapshot. The gleaner has cleared the control block,
+  // so we also start over from zero sorted runs. merge_sort() of the previous snapshot
+  // might have released the dump buffer.
+  clear_sorted_runs();
+  if (dump_io_buffer_.is_null()) {
+    allocate_dump_io_buffer();
+  }
   while (true) {
     std::this_thread::sleep_for(std::chrono::milliseconds(10));
     WRAP_ERROR_CODE(check_cancelled());
@@ -160,7 +180,11 @@ ErrorStack LogReducer::handle_process() {
   LOG(INFO) << to_string() << " all mappers are done, this reducer starts the merge-sort phase.";
   ASSERT_ND(parent_.is_all_mappers_completed());
   WRAP_ERROR_CODE(check_cancelled());
-  CHECK_ERROR(merge_sort());
+  ErrorStack merge_result = merge_sort();
+  // Whether it succeeded or not, the sorted runs are no longer needed.
+  // Return the in-memory runs to the budget now rather than keeping them until next snapshot.
+  clear_sorted_runs();
+  CHECK_ERROR(merge_result);
 
   LOG(INFO) << to_string() << " all done.";
   return kRetOk;
@@ -187,6 +211,22 @@ ErrorStack LogReducer::dump_buffer() {
   std::map<storage::StorageId, std::vector<BufferPosition> > blocks;
   dump_buffer_scan_block_headers(base, final_status.components.tail_position_, &blocks);
 
+  const uint64_t in_memory_runs_budget
+    = static_cast<uint64_t>(engine_->get_options().snapshot_.log_reducer_in_memory_runs_mb_) << 20;
+  const uint64_t in_memory_run_bytes
+    = assorted::align<uint64_t, kInMemoryRunAlignment>(final_status.get_tail_bytes());
+  if (in_memory_runs_bytes_ + in_memory_run_bytes <= in_memory_runs_budget) {
+    CHECK_ERROR(dump_buffer_in_memory(base, final_status.get_tail_bytes(), blocks));
+    stop_watch.stop();
+    LOG(INFO) << to_string() << " Done sort " << final_status.get_tail_bytes() << " bytes in "
+      << stop_watch.elapsed_ms() << "ms. Kept it in memory. in_memory_runs_bytes_="
+      << in_memory_runs_bytes_;
+    ++sorted_runs_;
+    ++control_block_->in_memory_sorted_runs_;
+    control_block_->buffer_status_[buffer_index] = 0;
+    return kRetOk;
+  }
+
   // open a file
   fs::Path path = get_sorted_run_file_path(sorted_runs_);
   fs::DirectIoFile file(path);
@@ -224,6 +264,8 @@ ErrorStack LogReducer::dump_buffer() {
   // we don't need fsync here. if there is a failure during snapshotting,
   // we just start over. logs are already durable.
   file.close();
+  in_memory_runs_.emplace_back(nullptr);
+  ++control_block_->dumped_sorted_runs_;
 
   stop_watch.stop();
   LOG(INFO) << to_string() << " Done sort/dump " <<
@@ -239,6 +281,84 @@ ErrorStack LogReducer::dump_buffer() {
   return kRetOk;
 }
 
+ErrorStack LogReducer::dump_buffer_in_memory(
+  char* buffer_base,
+  uint64_t buffer_bytes,
+  const std::map<storage::StorageId, std::vector<BufferPosition> >& blocks) {
+  // the sorted run is never larger than the buffer. it has fewer block headers.
+  // we don't use hugepages here so that each run takes only what it needs out of the budget.
+  std::unique_ptr<InMemoryRun> run(new InMemoryRun());
+  run->memory_.alloc(
+    buffer_bytes,
+    kInMemoryRunAlignment,
+    memory::AlignedMemory::kNumaAllocOnnode,
+    get_numa_node());
+  if (run->memory_.is_null()) {
+    return ERROR_STACK(kErrorCodeOutofmemory);
+  }
+  char* const destination = reinterpret_cast<char*>(run->memory_.get_block());
+  run->bytes_ = 0;
+  for (const auto& kv : blocks) {
+    WRAP_ERROR_CODE(check_cancelled());
+    LogBuffer log_buffer(buffer_base);
+    storage::StorageId storage_id = kv.first;
+    uint32_t written_count;
+    uint32_t shortest_key_length;
+    uint32_t longest_key_length;
+    CHECK_ERROR(dump_buffer_sort_storage(
+      log_buffer,
+      storage_id,
+      kv.second,
+      &shortest_key_length,
+      &longest_key_length,
+      &written_count));
+    BufferPosition* outputs
+      = reinterpret_cast<BufferPosition*>(output_positions_slice_.get_block());
+    run->bytes_ += dump_buffer_sort_storage_copy(
+      log_buffer,
+      storage_id,
+      outputs,
+      shortest_key_length,
+      longest_key_length,
+      written_count,
+      destination + run->bytes_);
+    ASSERT_ND(run->bytes_ <= buffer_bytes);
+  }
+  in_memory_runs_bytes_ += run->memory_.get_size();
+  in_memory_runs_.emplace_back(std::move(run));
+  return kRetOk;
+}
+
+uint64_t LogReducer::dump_buffer_sort_storage_copy(
+  const LogBuffer &buffer,
+  storage::StorageId storage_id,
+  const BufferPosition* sorted_logs,
+  uint32_t shortest_key_length,
+  uint32_t longest_key_length,
+  uint32_t log_count,
+  char* destination) const {
+  uint64_t total_bytes = dump_block_header(
+    buffer,
+    storage_id,
+    sorted_logs,
+    shortest_key_length,
+    longest_key_length,
+    log_count,
+    destination);
+  uint64_t current_pos = sizeof(FullBlockHeader);
+  for (uint32_t i = 0; i < log_count; ++i) {
+    const log::RecordLogType* record = buffer.resolve(sorted_logs[i]);
+    ASSERT_ND(current_pos % 8 == 0);
+    ASSERT_ND(record->header_.storage_id_ == storage_id);
+    ASSERT_ND(record->header_.log_length_ > 0);
+    ASSERT_ND(record->header_.log_length_ % 8 == 0);
+    std::memcpy(destination + current_pos, record, record->header_.log_length_);
+    current_pos += record->header_.log_length_;
+  }
+  ASSERT_ND(total_bytes == current_pos);  // now we went over all logs again
+  return total_bytes;
+}
+
 ErrorStack LogReducer::dump_buffer_wait_for_writers(uint32_t buffer_index) const {
   debugging::StopWatch wait_watch;
   SPINLOCK_WHILE(control_block_->get_buffer_status_atomic(buffer_index).get_active_writers() > 0) {
@@ -525,9 +645,10 @@ fs::Path LogReducer::get_sorted_run_file_path(uint32_t sorted_run) const {
   return path;
 }
 
-LogReducer::MergeContext::MergeContext(uint32_t dumped_files_count)
-  : dumped_files_count_(dumped_files_count),
-  tmp_sorted_buffer_array_(new SortedBuffer*[dumped_files_count + 1]),
+LogReducer::MergeContext::MergeContext(uint32_t sorted_runs_count, uint32_t dumped_files_count)
+  : sorted_runs_count_(sorted_runs_count),
+  dumped_files_count_(dumped_files_count),
+  tmp_sorted_buffer_array_(new SortedBuffer*[sorted_runs_count + 1]),
   tmp_sorted_buffer_count_(0) {
 }
 
@@ -539,6 +660,7 @@ LogReducer::MergeContext::~MergeContext() {
   }
   sorted_files_auto_ptrs_.clear();
   io_buffers_.clear();
+  read_ahead_buffers_.clear();
   io_memory_.release_block();
   delete[] tmp_sorted_buffer_array_;
   tmp_sorted_buffer_array_ = nullptr;
@@ -591,8 +713,16 @@ ErrorStack LogReducer::merge_sort() {
   // thus, we release the reducer's dump IO buffer to reduce memory pressure.
   dump_io_buffer_.release_block();
 
-  MergeContext context(sorted_runs_);
-  LOG(INFO) << to_string() << " merge sorting " << sorted_runs_ << " sorted runs and the current"
+  uint32_t dumped_files_count = 0;
+  for (const auto& run : in_memory_runs_) {
+    if (!run) {
+      ++dumped_files_count;
+    }
+  }
+  ASSERT_ND(in_memory_runs_.size() == sorted_runs_);
+  MergeContext context(sorted_runs_, dumped_files_count);
+  LOG(INFO) << to_string() << " merge sorting " << sorted_runs_ << " sorted runs ("
+    << dumped_files_count << " of them in files) and the current"
     << " buffer which has "
     << 8ULL * control_block_->get_current_buffer_status().get_tail_position()
     << " bytes";
@@ -685,7 +815,8 @@ void LogReducer::merge_sort_allocate_io_buffers(LogReducer::MergeContext* contex
   debugging::StopWatch alloc_watch;
   uint64_t size_per_run =
     static_cast<uint64_t>(engine_->get_options().snapshot_.log_reducer_read_io_buffer_kb_) << 10;
-  uint64_t size_total = size_per_run * context->dumped_files_count_;
+  // each sorted run has a window and a read-ahead buffer of the same size.
+  uint64_t size_total = size_per_run * context->dumped_files_count_ * 2ULL;
   context->io_memory_.alloc(
     size_total,
     memory::kHugepageSize,
@@ -694,7 +825,11 @@ void LogReducer::merge_sort_allocate_io_buffers(LogReducer::MergeContext* contex
   for (uint32_t i = 0; i < context->dumped_files_count_; ++i) {
     context->io_buffers_.emplace_back(memory::AlignedMemorySlice(
       &context->io_memory_,
-      i * size_per_run,
+      i * size_per_run * 2ULL,
+      size_per_run));
+    context->read_ahead_buffers_.emplace_back(memory::AlignedMemorySlice(
+      &context->io_memory_,
+      i * size_per_run * 2ULL + size_per_run,
       size_per_run));
   }
   alloc_watch.stop();
@@ -731,7 +866,7 @@ ErrorStack LogReducer::merge_sort_dump_last_buffer() {
     BufferPosition* pos = reinterpret_cast<BufferPosition*>(output_positions_slice_.get_block());
 
     // The only difference is here. Output the sorted result to the other buffer, not to file.
-    uint64_t total_bytes = dump_block_header(
+    other_bytes += dump_buffer_sort_storage_copy(
       buffer,
       storage_id,
       pos,
@@ -739,18 +874,6 @@ ErrorStack LogReducer::merge_sort_dump_last_buffer() {
       longest_key_length,
       count,
       other + other_bytes);
-    uint64_t current_pos = sizeof(FullBlockHeader) + other_bytes;
-    for (uint32_t i = 0; i < count; ++i) {
-      const log::RecordLogType* record = buffer.resolve(pos[i]);
-      ASSERT_ND(current_pos % 8 == 0);
-      ASSERT_ND(record->header_.storage_id_ == storage_id);
-      ASSERT_ND(record->header_.log_length_ > 0);
-      ASSERT_ND(record->header_.log_length_ % 8 == 0);
-      std::memcpy(other + current_pos, record, record->header_.log_length_);
-      current_pos += record->header_.log_length_;
-    }
-    ASSERT_ND(total_bytes + other_bytes == current_pos);  // now we went over all logs again
-    other_bytes += total_bytes;
   }
 
   // We wrote out to the other buffer, switch the current.
@@ -775,9 +898,19 @@ ErrorStack LogReducer::merge_sort_open_sorted_runs(LogReducer::MergeContext* con
     reinterpret_cast<char*>(last_buffer),
     from_buffer_position(buffer_status.components.tail_position_)));
 
-  // sorted run files
-  ASSERT_ND(context->io_buffers_.size() == sorted_runs_);
-  for (uint32_t sorted_run = 0 ; sorted_run < context->dumped_files_count_; ++sorted_run) {
+  // sorted run files and sorted runs kept in memory
+  ASSERT_ND(context->io_buffers_.size() == context->dumped_files_count_);
+  ASSERT_ND(in_memory_runs_.size() == context->sorted_runs_count_);
+  uint32_t dumped_file = 0;
+  for (uint32_t sorted_run = 0 ; sorted_run < context->sorted_runs_count_; ++sorted_run) {
+    const InMemoryRun* run = in_memory_runs_[sorted_run].get();
+    if (run) {
+      context->sorted_buffers_.emplace_back(new InMemorySortedBuffer(
+        reinterpret_cast<char*>(run->memory_.get_block()),
+        run->bytes_));
+      continue;
+    }
+
     fs::Path path = get_sorted_run_file_path(sorted_run);
     if (!fs::exists(path)) {
       LOG(FATAL) << to_string() << " wtf. this sorted run file doesn't exist " << path;
@@ -794,12 +927,15 @@ ErrorStack LogReducer::merge_sort_open_sorted_runs(LogReducer::MergeContext* con
 
     context->sorted_buffers_.emplace_back(new DumpFileSortedBuffer(
       file_ptr.get(),
-      context->io_buffers_[sorted_run]));
+      context->io_buffers_[dumped_file],
+      context->read_ahead_buffers_[dumped_file]));
     context->sorted_files_auto_ptrs_.emplace_back(std::move(file_ptr));
+    ++dumped_file;
   }
 
-  ASSERT_ND(context->sorted_files_auto_ptrs_.size() == context->sorted_buffers_.size() - 1U);
-  ASSERT_ND(context->dumped_files_count_ == context->sorted_buffers_.size() - 1U);
+  ASSERT_ND(dumped_file == context->dumped_files_count_);
+  ASSERT_ND(context->sorted_files_auto_ptrs_.size() == context->dumped_files_count_);
+  ASSERT_ND(context->sorted_runs_count_ == context->sorted_buffers_.size() - 1U);
   return kRetOk;
 }
 
@@ -811,15 +947,15 @@ ErrorStack LogReducer::merge_sort_initialize_sort_buffers(LogReducer::MergeConte
       LOG(INFO) << to_string() << " buffer-" << index << " is empty";
       continue;
     }
-    if (index > 0) {
-      DumpFileSortedBuffer* casted = dynamic_cast<DumpFileSortedBuffer*>(buffer);
-      ASSERT_ND(casted);
+    DumpFileSortedBuffer* casted = dynamic_cast<DumpFileSortedBuffer*>(buffer);
+    if (casted) {
+      ASSERT_ND(index > 0);
       // the buffer hasn't loaded any data, so let's make the first read.
-      uint64_t desired_reads = std::min(casted->get_buffer_size(), casted->get_total_size());
-      WRAP_ERROR_CODE(casted->get_file()->read(desired_reads, casted->get_io_buffer()));
+      // this also starts reading ahead the next window in background.
+      WRAP_ERROR_CODE(casted->read_first_window());
     } else {
       ASSERT_ND(dynamic_cast<InMemorySortedBuffer*>(buffer));
-      // in-memory one has already loaded everything
+      // in-memory ones have already loaded everything
     }
 
     // See the first block header. As dummy block always follows a real block, this must be
@@ -918,6 +1054,7 @@ std::ostream& operator<<(std::ostream& o, const LogReducer& v) {
     << "<positions_buffers_>" << v.positions_buffers_ << "</positions_buffers_>"
     << "<current_buffer_>" << v.control_block_->current_buffer_ << "</current_buffer_>"
     << "<sorted_runs_>" << v.sorted_runs_ << "</sorted_runs_>"
+    << "<in_memory_runs_bytes_>" << v.in_memory_runs_bytes_ << "</in_memory_runs_bytes_>"
     << "</LogReducer>";
   return o;
 }
@@ -57,6 +57,12 @@ void LogReducerRef::clear() {
 uint32_t LogReducerRef::get_total_storage_count() const {
   return control_block_->total_storage_count_;
 }
+uint32_t LogReducerRef::get_in_memory_sorted_runs() const {
+  return control_block_->in_memory_sorted_runs_;
+}
+uint32_t LogReducerRef::get_dumped_sorted_runs() const {
+  return control_block_->dumped_sorted_runs_;
+}
 
 uint32_t    LogReducerRef::get_current_buffer_index_atomic() const {
   return control_block_->current_buffer_;
@@ -130,20 +136,44 @@ void        LogReducerRef::append_log_chunk(
   ASSERT_ND(verify_log_chunk(storage_id, send_buffer, log_count, send_buffer_size));
 
   debugging::RdtscWatch stop_watch;
+  uint32_t buffer_index;
+  char* destination = reserve_log_chunk(send_buffer_size, &buffer_index);
+
+  // now start copying. this might take a few tens of microseconds if it's 1MB and on another
+  // NUMA node.
+  debugging::RdtscWatch copy_watch;
+  std::memcpy(destination, send_buffer, send_buffer_size);
+  copy_watch.stop();
+  DVLOG(1) << "memcpy of " << send_buffer_size << " bytes took "
+    << copy_watch.elapsed() << " cycles";
 
+  commit_log_chunk(
+    storage_id,
+    buffer_index,
+    destination,
+    log_count,
+    send_buffer_size,
+    shortest_key_length,
+    longest_key_length);
+  stop_watch.stop();
+  DVLOG(1) << "Completed appending a block of " << send_buffer_size << " bytes to " << to_string()
+    << "'s buffer for storage-" << storage_id << " in " << stop_watch.elapsed() << " cycles";
+}
+
+char*       LogReducerRef::reserve_log_chunk(uint64_t send_buffer_size, uint32_t* buffer_index) {
   const uint64_t required_size = send_buffer_size + sizeof(FullBlockHeader);
-  uint32_t buffer_index = 0;
   uint64_t begin_position = 0;
   while (true) {
-    buffer_index = get_current_buffer_index_atomic();
-    std::atomic<uint64_t>* status_address = control_block_->get_buffer_status_address(buffer_index);
+    *buffer_index = get_current_buffer_index_atomic();
+    std::atomic<uint64_t>* status_address
+      = control_block_->get_buffer_status_address(*buffer_index);
 
     // If even the current buffer is marked as no more writers, the reducer is getting behind.
     // Mappers have to wait, potentially for a long time. So, let's just sleep.
-    ReducerBufferStatus cur_status = control_block_->get_buffer_status_atomic(buffer_index);
+    ReducerBufferStatus cur_status = control_block_->get_buffer_status_atomic(*buffer_index);
     if (cur_status.components.flags_ & kFlagNoMoreWriters) {
       VLOG(0) << "Both buffers full in" << to_string() << ". I'll sleep for a while..";
-      while (get_current_buffer_index_atomic() == buffer_index) {
+      while (get_current_buffer_index_atomic() == *buffer_index) {
         std::this_thread::sleep_for(std::chrono::milliseconds(1));
       }
       VLOG(0) << "Buffer switched in" << to_string() << " after sleep. Let's resume.";
@@ -185,13 +215,23 @@ void        LogReducerRef::append_log_chunk(
     break;
   }
 
-  // now start copying. this might take a few tens of microseconds if it's 1MB and on another
-  // NUMA node.
-  void* buffer = get_buffer(buffer_index);
-  debugging::RdtscWatch copy_watch;
-  char* destination = reinterpret_cast<char*>(buffer) + begin_position;
-  ASSERT_ND(begin_position + sizeof(FullBlockHeader) + send_buffer_size
+  ASSERT_ND(begin_position + required_size
     <= engine_->get_options().snapshot_.log_reducer_buffer_mb_ * (1ULL << 19));
+  char* block = reinterpret_cast<char*>(get_buffer(*buffer_index)) + begin_position;
+  return block + sizeof(FullBlockHeader);
+}
+
+void        LogReducerRef::commit_log_chunk(
+  storage::StorageId storage_id,
+  uint32_t buffer_index,
+  char* destination,
+  uint32_t log_count,
+  uint64_t send_buffer_size,
+  uint32_t shortest_key_length,
+  uint32_t longest_key_length) {
+  ASSERT_ND(verify_log_chunk(storage_id, destination, log_count, send_buffer_size));
+  const uint64_t required_size = send_buffer_size + sizeof(FullBlockHeader);
+  char* block = destination - sizeof(FullBlockHeader);
   FullBlockHeader header;
   header.storage_id_ = storage_id;
   header.log_count_ = log_count;
@@ -199,11 +239,7 @@ void        LogReducerRef::append_log_chunk(
   header.magic_word_ = BlockHeaderBase::kFullBlockHeaderMagicWord;
   header.shortest_key_length_ = shortest_key_length;
   header.longest_key_length_ = longest_key_length;
-  std::memcpy(destination, &header, sizeof(FullBlockHeader));
-  std::memcpy(destination + sizeof(FullBlockHeader), send_buffer, send_buffer_size);
-  copy_watch.stop();
-  DVLOG(1) << "memcpy of " << send_buffer_size << " bytes took "
-    << copy_watch.elapsed() << " cycles";
+  std::memcpy(block, &header, sizeof(FullBlockHeader));
 
   // done, let's decrement the active_writers_ to declare we are done.
   while (true) {
@@ -229,12 +265,9 @@ void        LogReducerRef::append_log_chunk(
     break;
   }
 
-  stop_watch.stop();
-  DVLOG(1) << "Completed appending a block of " << send_buffer_size << " bytes to " << to_string()
-    << "'s buffer for storage-" << storage_id << " in " << stop_watch.elapsed() << " cycles";
-  ASSERT_ND(reinterpret_cast<FullBlockHeader*>(destination)->is_full_block());
-  ASSERT_ND(reinterpret_cast<FullBlockHeader*>(destination)->storage_id_ == storage_id);
-  ASSERT_ND(reinterpret_cast<FullBlockHeader*>(destination)->block_length_
+  ASSERT_ND(reinterpret_cast<FullBlockHeader*>(block)->is_full_block());
+  ASSERT_ND(reinterpret_cast<FullBlockHeader*>(block)->storage_id_ == storage_id);
+  ASSERT_ND(reinterpret_cast<FullBlockHeader*>(block)->block_length_
     == to_buffer_position(required_size));
 }
 
@@ -24,6 +24,7 @@
 #include "foedus/epoch.hpp"
 #include "foedus/assorted/assorted_func.hpp"
 #include "foedus/assorted/cacheline.hpp"
+#include "foedus/assorted/radix_sort.hpp"
 #include "foedus/debugging/stop_watch.hpp"
 #include "foedus/memory/aligned_memory.hpp"
 #include "foedus/snapshot/log_buffer.hpp"
@@ -68,7 +69,8 @@ MergeSort::MergeSort(
   uint16_t inputs_count,
   uint16_t max_original_pages,
   memory::AlignedMemory* const work_memory,
-  uint16_t chunk_batch_size)
+  uint16_t chunk_batch_size,
+  uint16_t sort_threads)
   : DefaultInitializable(),
     id_(id),
     type_(type),
@@ -79,15 +81,19 @@ MergeSort::MergeSort(
     inputs_count_(inputs_count),
     max_original_pages_(max_original_pages),
     chunk_batch_size_(chunk_batch_size),
+    sort_threads_(sort_threads),
     work_memory_(work_memory) {
   ASSERT_ND(shortest_key_length_ <= longest_key_length_);
   ASSERT_ND(shortest_key_length_ > 0);
   ASSERT_ND(chunk_batch_size_ > 0);
+  ASSERT_ND(sort_threads_ > 0);
   current_count_ = 0;
   sort_entries_ = nullptr;
   position_entries_ = nullptr;
+  sort_buffer_ = nullptr;
   original_pages_ = nullptr;
   inputs_status_ = nullptr;
+  loser_tree_ = nullptr;
 }
 
 ErrorStack MergeSort::initialize_once() {
@@ -95,10 +101,11 @@ ErrorStack MergeSort::initialize_once() {
   // it (at most kLogChunk-1 such tuples). so, conservatively chunk_batch_size_ + inputs_count_.
   uint32_t buffer_capacity = kLogChunk * (chunk_batch_size_ + inputs_count_);
   buffer_capacity_ = assorted::align<uint32_t, 512U>(buffer_capacity);
-  uint64_t byte_size = buffer_capacity_ * (sizeof(SortEntry) + sizeof(PositionEntry));
+  uint64_t byte_size = buffer_capacity_ * (sizeof(SortEntry) * 2U + sizeof(PositionEntry));
   ASSERT_ND(byte_size % 4096U == 0);
   byte_size += storage::kPageSize * (max_original_pages_ + 1U);
   byte_size += sizeof(InputStatus) * inputs_count_;
+  byte_size += sizeof(InputIndex) * inputs_count_;
   WRAP_ERROR_CODE(work_memory_->assure_capacity(byte_size));
 
   // assign pointers
@@ -111,10 +118,14 @@ ErrorStack MergeSort::initialize_once() {
   offset += sizeof(SortEntry) * buffer_capacity;
   position_entries_ = reinterpret_cast<PositionEntry*>(block + offset);
   offset += sizeof(PositionEntry) * buffer_capacity;
+  sort_buffer_ = reinterpret_cast<SortEntry*>(block + offset);
+  offset += sizeof(SortEntry) * buffer_capacity;
   original_pages_ = reinterpret_cast<storage::Page*>(block + offset);
   offset += sizeof(storage::Page) * (max_original_pages_ + 1U);
   inputs_status_ = reinterpret_cast<InputStatus*>(block + offset);
   offset += sizeof(InputStatus) * inputs_count_;
+  loser_tree_ = reinterpret_cast<InputIndex*>(block + offset);
+  offset += sizeof(InputIndex) * inputs_count_;
   ASSERT_ND(offset == byte_size);
 
   // initialize inputs_status_
@@ -237,9 +248,10 @@ ErrorStack MergeSort::advance_window() {
 
       SortedBuffer* input = inputs_[i];
       WRAP_ERROR_CODE(input->wind(cur_abs_pos));
+      // the window memory might have changed, too (see DumpFileSortedBuffer)
+      status->window_ = input->get_buffer();
       status->window_offset_ = input->get_offset();
       ASSERT_ND(status->window_size_ == input->get_buffer_size());
-      ASSERT_ND(status->window_ == input->get_buffer());
 
       ASSERT_ND(cur_abs_pos >= status->window_offset_);
       status->cur_relative_pos_ = cur_abs_pos - status->window_offset_;
@@ -387,10 +399,62 @@ MergeSort::InputIndex MergeSort::determine_min_input() const {
   return min_input;
 }
 
+MergeSort::InputIndex MergeSort::get_min_input_candidate(InputIndex input) const {
+  const InputStatus* status = inputs_status_ + input;
+  status->assert_consistent();
+  if (status->is_ended() || status->is_last_chunk_overall()) {
+    return kInvalidInput;
+  }
+  return input;
+}
+
+bool MergeSort::precedes_as_min_input(InputIndex left, InputIndex right) const {
+  if (left == kInvalidInput) {
+    return false;
+  } else if (right == kInvalidInput) {
+    return true;
+  }
+  int cmp = compare_logs(
+    inputs_status_[left].get_chunk_log(),
+    inputs_status_[right].get_chunk_log());
+  return cmp < 0 || (cmp == 0 && left < right);
+}
+
+MergeSort::InputIndex MergeSort::build_loser_tree(uint32_t node) {
+  ASSERT_ND(node > 0);
+  if (node >= inputs_count_) {
+    return get_min_input_candidate(node - inputs_count_);
+  }
+  InputIndex left = build_loser_tree(node * 2U);
+  InputIndex right = build_loser_tree(node * 2U + 1U);
+  if (precedes_as_min_input(right, left)) {
+    loser_tree_[node] = left;
+    return right;
+  } else {
+    loser_tree_[node] = right;
+    return left;
+  }
+}
+
+void MergeSort::replay_loser_tree(InputIndex input) {
+  ASSERT_ND(loser_tree_[0] == input);
+  InputIndex winner = get_min_input_candidate(input);
+  for (uint32_t node = (inputs_count_ + input) / 2U; node > 0; node /= 2U) {
+    if (precedes_as_min_input(loser_tree_[node], winner)) {
+      std::swap(loser_tree_[node], winner);
+    }
+  }
+  loser_tree_[0] = winner;
+}
+
 MergeSort::InputIndex MergeSort::pick_chunks() {
+  // advance_window() and the previous batch moved all inputs, so we build the tree from scratch.
+  // After that, only the picked input moves in each iteration.
+  loser_tree_[0] = build_loser_tree(1U);
   uint32_t chunks;
   for (chunks = 0; chunks < chunk_batch_size_; ++chunks) {
-    InputIndex min_input = determine_min_input();
+    InputIndex min_input = loser_tree_[0];
+    ASSERT_ND(min_input == determine_min_input());
     if (min_input == kInvalidInput) {
       // now all inputs are in the last chunks, we can simply merge them all in one shot!
       return kInvalidInput;
@@ -403,20 +467,27 @@ MergeSort::InputIndex MergeSort::pick_chunks() {
     next_chunk(min_input);
 
     inputs_status_[min_input].assert_consistent();
+    replay_loser_tree(min_input);
   }
 
   VLOG(1) << "Now determining batch-threshold... chunks=" << chunks;
-  return determine_min_input();
+  ASSERT_ND(loser_tree_[0] == determine_min_input());
+  return loser_tree_[0];
 }
 
 void MergeSort::batch_sort(MergeSort::InputIndex min_input) {
   batch_sort_prepare(min_input);
   ASSERT_ND(current_count_ <= buffer_capacity_);
 
-  // First, sort it with std::sort, which is (*) smart enough to switch to heap sort for this case.
-  // (*) at least gcc's does.
+  // First, sort it with radix sort on the 128-bit integers.
+  // The position bits are the index of each entry at this point, thus already sorted.
   debugging::StopWatch sort_watch;
-  std::sort(&(sort_entries_->data_), &(sort_entries_[current_count_].data_));
+  assorted::radix_sort_uint128(
+    &(sort_entries_->data_),
+    &(sort_buffer_->data_),
+    current_count_,
+    kPositionBits,
+    sort_threads_);
   sort_watch.stop();
   VLOG(1) << "Storage-" << id_ << ", merge sort (main) of " << current_count_ << " logs in "
     << sort_watch.elapsed_ms() << "ms";
@@ -27,6 +27,7 @@ std::ostream& operator<<(std::ostream& o, const Snapshot& v) {
     << "<base_epoch_>" << v.base_epoch_ << "</base_epoch_>"
     << "<valid_until_epoch_>" << v.valid_until_epoch_ << "</valid_until_epoch_>"
     << "<max_storage_id_>" << v.max_storage_id_ << "</max_storage_id_>"
+    << "<selective_>" << v.selective_ << "</selective_>"
     << "</Snapshot>";
   return o;
 }
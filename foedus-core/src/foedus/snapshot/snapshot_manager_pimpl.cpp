@@ -44,10 +44,12 @@
 #include "foedus/snapshot/log_reducer_ref.hpp"
 #include "foedus/snapshot/snapshot_metadata.hpp"
 #include "foedus/snapshot/snapshot_options.hpp"
+#include "foedus/snapshot/storage_selection.hpp"
 #include "foedus/soc/soc_manager.hpp"
 #include "foedus/storage/composer.hpp"
 #include "foedus/storage/metadata.hpp"
 #include "foedus/storage/partitioner.hpp"
+#include "foedus/storage/storage.hpp"
 #include "foedus/storage/storage_manager.hpp"
 #include "foedus/thread/numa_thread_scope.hpp"
 #include "foedus/xct/xct_manager.hpp"
@@ -65,6 +67,7 @@ ErrorStack SnapshotManagerPimpl::initialize_once() {
   }
   soc::SharedMemoryRepo* repo = engine_->get_soc_manager()->get_shared_memory_repo();
   control_block_ = repo->get_global_memory_anchors()->snapshot_manager_memory_;
+  storage_selections_ = repo->get_global_memory_anchors()->storage_selection_memory_;
   if (engine_->is_master()) {
     control_block_->initialize();
     // get snapshot status from savepoint
@@ -93,6 +96,9 @@ ErrorStack SnapshotManagerPimpl::initialize_once() {
       meta->initialize();
       ASSERT_ND(meta->mutex_.is_initialized());
     }
+    for (storage::StorageId i = 0; i < max_storages; ++i) {
+      storage_selections_[i].initialize();
+    }
     // set the size of partitioner data
     repo->get_global_memory_anchors()->partitioner_metadata_[0].data_size_
       = engine_->get_options().storage_.partitioner_data_memory_mb_ * (1ULL << 20);
@@ -240,6 +246,7 @@ void SnapshotManagerPimpl::handle_snapshot_child() {
   LOG(INFO) << "Child snapshot daemon-" << engine_->get_soc_id() << " started";
   thread::NumaThreadScope scope(engine_->get_soc_id());
   SnapshotId previous_id = control_block_->gleaner_.cur_snapshot_.id_;
+  const bool read_ahead = get_option().log_mapper_read_ahead_;
   while (!is_stop_requested()) {
     {
       uint64_t demand = control_block_->snapshot_children_wakeup_.acquire_ticket();
@@ -249,7 +256,21 @@ void SnapshotManagerPimpl::handle_snapshot_child() {
     }
     if (is_stop_requested()) {
       break;
-    } else if (!is_gleaning() || previous_id == control_block_->gleaner_.cur_snapshot_.id_) {
+    } else if (!is_gleaning()) {
+      if (read_ahead) {
+        // mappers are not running now, so we can use their IO buffers.
+        const Epoch base_epoch = get_snapshot_epoch();
+        for (LogMapper* mapper : local_mappers_) {
+          ErrorStack result = mapper->read_ahead_durable_logs(base_epoch);
+          if (result.is_error()) {
+            // just an optimization. the mapper will read the logs again in the next snapshot.
+            LOG(WARNING) << "Child snapshot daemon-" << engine_->get_soc_id() << " couldn't read"
+              << " ahead logs for " << mapper->to_string() << ". error=" << result;
+          }
+        }
+      }
+      continue;
+    } else if (previous_id == control_block_->gleaner_.cur_snapshot_.id_) {
       continue;
     }
     SnapshotId current_id = control_block_->gleaner_.cur_snapshot_.id_;
@@ -313,7 +334,7 @@ void SnapshotManagerPimpl::trigger_snapshot_immediate(
   LOG(INFO) << "Observed the completion of snapshot! after=" << get_snapshot_epoch();
 }
 
-ErrorStack SnapshotManagerPimpl::handle_snapshot_triggered(Snapshot *new_snapshot) {
+ErrorStack SnapshotManagerPimpl::handle_snapshot_triggered(Snapshot *new_snapshot, bool recovery) {
   ASSERT_ND(engine_->is_master());
   ASSERT_ND(engine_->get_storage_manager()->is_initialized());  // snapshot relied on storage module
   Epoch durable_epoch = engine_->get_log_manager()->get_durable_global_epoch();
@@ -325,9 +346,11 @@ ErrorStack SnapshotManagerPimpl::handle_snapshot_triggered(Snapshot *new_snapsho
     (!previous_epoch.is_valid() || durable_epoch > previous_epoch));
   new_snapshot->base_epoch_ = previous_epoch;
   Epoch requested_epoch = control_block_->get_requested_snapshot_epoch();
-  if (requested_epoch.is_valid()) {
+  // requested_epoch stays after the request is satisfied. Honor it only if it's still new,
+  // otherwise this snapshot was triggered by the interval.
+  if (requested_epoch.is_valid()
+    && (!previous_epoch.is_valid() || requested_epoch > previous_epoch)) {
     ASSERT_ND(requested_epoch <= durable_epoch);
-    ASSERT_ND(!previous_epoch.is_valid() || requested_epoch > previous_epoch);
     new_snapshot->valid_until_epoch_ = requested_epoch;
   } else {
     new_snapshot->valid_until_epoch_ = durable_epoch;
@@ -336,6 +359,10 @@ ErrorStack SnapshotManagerPimpl::handle_snapshot_triggered(Snapshot *new_snapsho
   ASSERT_ND(new_snapshot->max_storage_id_
     >= control_block_->gleaner_.cur_snapshot_.max_storage_id_);
 
+  // storages below their snapshot thresholds carry their logs forward to later snapshots.
+  // the snapshot during restart can't leave anything behind.
+  select_storages(new_snapshot, recovery);
+
   // determine the snapshot ID
   SnapshotId snapshot_id;
   if (control_block_->previous_snapshot_id_ == kNullSnapshotId) {
@@ -358,6 +385,7 @@ ErrorStack SnapshotManagerPimpl::handle_snapshot_triggered(Snapshot *new_snapsho
   // This will create snapshot files at each partition and tell us the new root pages of
   // each storage.
   CHECK_ERROR(glean_logs(*new_snapshot, &new_root_page_pointers));
+  settle_storage_selection(*new_snapshot);
 
   // Write out the metadata file.
   CHECK_ERROR(snapshot_metadata(*new_snapshot, new_root_page_pointers));
@@ -372,6 +400,10 @@ ErrorStack SnapshotManagerPimpl::handle_snapshot_triggered(Snapshot *new_snapsho
   ASSERT_ND(new_snapshot_epoch.is_valid() &&
     (!get_snapshot_epoch().is_valid() || new_snapshot_epoch > get_snapshot_epoch()));
 
+  // transactions pinned to the new snapshot must find its roots before they see the new epoch.
+  engine_->get_storage_manager()->remember_snapshot_roots(new_snapshot_epoch);
+  assorted::memory_fence_release();
+
   // done. notify waiters if exist
   Epoch::EpochInteger epoch_after = new_snapshot_epoch.value();
   control_block_->previous_snapshot_id_ = snapshot_id;
@@ -383,6 +415,88 @@ ErrorStack SnapshotManagerPimpl::handle_snapshot_triggered(Snapshot *new_snapsho
   return kRetOk;
 }
 
+void SnapshotManagerPimpl::select_storages(Snapshot* new_snapshot, bool recovery) {
+  const Epoch previous_epoch = get_snapshot_epoch();
+  const Epoch until_epoch = new_snapshot->valid_until_epoch_;
+  new_snapshot->selective_ = false;
+  storage::StorageManager* storage_manager = engine_->get_storage_manager();
+  uint32_t deferred_count = 0;
+  for (storage::StorageId id = 1; id <= new_snapshot->max_storage_id_; ++id) {
+    StorageSelection* selection = storage_selections_ + id;
+    storage::StorageControlBlock* block = storage_manager->get_storage(id);
+    // logs up to previous snapshot are in the snapshot unless the storage was deferred
+    Epoch from_epoch = previous_epoch;
+    bool deferred = false;
+    if (previous_epoch.is_valid() && block->exists()) {
+      Epoch last_snapshot_epoch(block->meta_.last_snapshot_epoch_);
+      if (last_snapshot_epoch.is_valid() && last_snapshot_epoch < previous_epoch) {
+        from_epoch = last_snapshot_epoch;
+      }
+      // The first snapshot and the restart snapshot include everything. So do sequential
+      // storages because their cursors split snapshot/volatile records by the global epoch.
+      uint32_t threshold = block->meta_.snapshot_thresholds_.snapshot_trigger_threshold_;
+      if (!recovery
+        && threshold > 0
+        && block->meta_.type_ != storage::kSequentialStorage
+        && selection->pending_logs_ < threshold
+        && until_epoch.subtract(from_epoch) < StorageSelection::kMaxDeferredEpochs) {
+        deferred = true;
+        ++deferred_count;
+      }
+    }
+
+    if (from_epoch != previous_epoch || deferred) {
+      new_snapshot->selective_ = true;
+      if (from_epoch < new_snapshot->base_epoch_) {
+        new_snapshot->base_epoch_ = from_epoch;
+      }
+    }
+    selection->from_epoch_ = from_epoch.value();
+    selection->deferred_ = deferred ? 1U : 0U;
+    selection->pending_logs_ = 0;  // mappers count them again from from_epoch
+  }
+  assorted::memory_fence_release();
+  ASSERT_ND(!new_snapshot->base_epoch_.is_valid()
+    || until_epoch.subtract(new_snapshot->base_epoch_) < (1U << 16));
+  LOG(INFO) << "Deferred " << deferred_count << " storages in this snapshot. base_epoch="
+    << new_snapshot->base_epoch_ << ", selective=" << new_snapshot->selective_;
+}
+
+void SnapshotManagerPimpl::settle_storage_selection(const Snapshot& new_snapshot) {
+  assorted::memory_fence_acquire();  // mappers have added up pending_logs_
+  storage::StorageManager* storage_manager = engine_->get_storage_manager();
+  for (storage::StorageId id = 1; id <= new_snapshot.max_storage_id_; ++id) {
+    const StorageSelection* selection = storage_selections_ + id;
+    storage::StorageControlBlock* block = storage_manager->get_storage(id);
+    if (selection->is_deferred() && selection->pending_logs_ > 0) {
+      ASSERT_ND(selection->get_from_epoch().is_valid());
+      VLOG(0) << "Storage-" << id << " is deferred with " << selection->pending_logs_
+        << " pending logs since " << selection->get_from_epoch();
+      block->meta_.last_snapshot_epoch_ = selection->from_epoch_;
+    } else {
+      // deferred, but there was nothing to carry forward. it's as good as included.
+      block->meta_.last_snapshot_epoch_ = new_snapshot.valid_until_epoch_.value();
+    }
+  }
+}
+
+bool SnapshotManagerPimpl::has_deferred_storages() const {
+  const Epoch snapshot_epoch = get_snapshot_epoch();
+  if (!snapshot_epoch.is_valid()) {
+    return false;
+  }
+  storage::StorageManager* storage_manager = engine_->get_storage_manager();
+  const storage::StorageId max_storage_id = storage_manager->get_largest_storage_id();
+  for (storage::StorageId id = 1; id <= max_storage_id; ++id) {
+    storage::StorageControlBlock* block = storage_manager->get_storage(id);
+    Epoch last_snapshot_epoch(block->meta_.last_snapshot_epoch_);
+    if (block->exists() && last_snapshot_epoch.is_valid() && last_snapshot_epoch < snapshot_epoch) {
+      return true;
+    }
+  }
+  return false;
+}
+
 ErrorStack SnapshotManagerPimpl::glean_logs(
   const Snapshot& new_snapshot,
   std::map<storage::StorageId, storage::SnapshotPagePointer>* new_root_page_pointers) {
@@ -30,9 +30,12 @@ SnapshotOptions::SnapshotOptions() {
   log_mapper_bucket_kb_ = kDefaultLogMapperBucketKb;
   log_mapper_io_buffer_mb_ = kDefaultLogMapperIoBufferMb;
   log_mapper_sort_before_send_ = true;
+  log_mapper_read_ahead_ = false;
   log_reducer_buffer_mb_ = kDefaultLogReducerBufferMb;
   log_reducer_dump_io_buffer_mb_ = kDefaultLogReducerDumpIoBufferMb;
   log_reducer_read_io_buffer_kb_ = kDefaultLogReducerReadIoBufferKb;
+  log_reducer_sort_threads_ = kDefaultLogReducerSortThreads;
+  log_reducer_in_memory_runs_mb_ = kDefaultLogReducerInMemoryRunsMb;
   snapshot_writer_page_pool_size_mb_ = kDefaultSnapshotWriterPagePoolSizeMb;
   snapshot_writer_intermediate_pool_size_mb_ = kDefaultSnapshotWriterIntermediatePoolSizeMb;
 }
@@ -57,9 +60,12 @@ ErrorStack SnapshotOptions::load(tinyxml2::XMLElement* element) {
   EXTERNALIZE_LOAD_ELEMENT(element, log_mapper_bucket_kb_);
   EXTERNALIZE_LOAD_ELEMENT(element, log_mapper_io_buffer_mb_);
   EXTERNALIZE_LOAD_ELEMENT(element, log_mapper_sort_before_send_);
+  EXTERNALIZE_LOAD_ELEMENT(element, log_mapper_read_ahead_);
   EXTERNALIZE_LOAD_ELEMENT(element, log_reducer_buffer_mb_);
   EXTERNALIZE_LOAD_ELEMENT(element, log_reducer_dump_io_buffer_mb_);
   EXTERNALIZE_LOAD_ELEMENT(element, log_reducer_read_io_buffer_kb_);
+  EXTERNALIZE_LOAD_ELEMENT(element, log_reducer_sort_threads_);
+  EXTERNALIZE_LOAD_ELEMENT(element, log_reducer_in_memory_runs_mb_);
   EXTERNALIZE_LOAD_ELEMENT(element, snapshot_writer_page_pool_size_mb_);
   EXTERNALIZE_LOAD_ELEMENT(element, snapshot_writer_intermediate_pool_size_mb_);
   CHECK_ERROR(get_child_element(element, "SnapshotDeviceEmulationOptions", &emulation_))
@@ -88,13 +94,24 @@ ErrorStack SnapshotOptions::save(tinyxml2::XMLElement* element) const {
     " This buffer is also the unit of batch processing in mapper.");
   EXTERNALIZE_SAVE_ELEMENT(element, log_mapper_sort_before_send_,
     "Whether to sort logs in mapper side before sending it to reducer.");
+  EXTERNALIZE_SAVE_ELEMENT(element, log_mapper_read_ahead_,
+    "Whether mappers read durable logs into their IO buffer while the engine is not taking"
+    " a snapshot, so that the next snapshot does not have to read them again.");
   EXTERNALIZE_SAVE_ELEMENT(element, log_reducer_buffer_mb_,
     "The size in MB of a buffer to store log entries in reducer (partition).");
   EXTERNALIZE_SAVE_ELEMENT(element, log_reducer_dump_io_buffer_mb_,
     "The size in MB of a buffer to write out sorted log entries in reducer to a temporary file.");
   EXTERNALIZE_SAVE_ELEMENT(element, log_reducer_read_io_buffer_kb_,
-    "The size in KB of a buffer in reducer to read one temporary file. Note that the total"
-    " memory consumption is this number times the number of temporary files. It's a merge-sort.");
+    "The size in KB of a buffer in reducer to read one temporary file. Each file also has a"
+    " read-ahead buffer of the same size. Note that the total memory consumption is thus twice"
+    " this number times the number of temporary files. It's a merge-sort.");
+  EXTERNALIZE_SAVE_ELEMENT(element, log_reducer_sort_threads_,
+    "Number of threads, including the reducer itself, that sort a batch of log entries in"
+    " reducer. 1 means the reducer sorts alone.");
+  EXTERNALIZE_SAVE_ELEMENT(element, log_reducer_in_memory_runs_mb_,
+    "The total size in MB of sorted runs each reducer keeps in memory rather than writing them"
+    " to temporary files. The reducer spills sorted runs to files only after it exhausts this"
+    " budget. 0 means the reducer always dumps sorted runs to files.");
   EXTERNALIZE_SAVE_ELEMENT(element, snapshot_writer_page_pool_size_mb_,
     "The size in MB of one snapshot writer, which holds data pages modified in the snapshot"
     " and them sequentially dumps them to a file for each storage.");
@@ -28,8 +28,10 @@
 
 #include "foedus/assert_nd.hpp"
 #include "foedus/assorted/assorted_func.hpp"
+#include "foedus/snapshot/storage_selection.hpp"
 #include "foedus/storage/page.hpp"
 #include "foedus/storage/partitioner.hpp"
+#include "foedus/storage/snapshot_root_history.hpp"
 
 namespace foedus {
 namespace soc {
@@ -335,6 +337,16 @@ void SharedMemoryRepo::set_global_memory_anchors(
   total += align_4kb(sizeof(storage::StorageId) * options.storage_.max_storages_);
   put_global_memory_boundary(&total, "storage_name_sort_memory_boundary", reset_boundaries);
 
+  global_memory_anchors_.snapshot_root_history_memory_
+    = reinterpret_cast<storage::SnapshotRootHistory*>(base + total);
+  total += align_4kb(sizeof(storage::SnapshotRootHistory) * options.storage_.max_storages_);
+  put_global_memory_boundary(&total, "snapshot_root_history_memory_boundary", reset_boundaries);
+
+  global_memory_anchors_.storage_selection_memory_
+    = reinterpret_cast<snapshot::StorageSelection*>(base + total);
+  total += align_4kb(sizeof(snapshot::StorageSelection) * options.storage_.max_storages_);
+  put_global_memory_boundary(&total, "storage_selection_memory_boundary", reset_boundaries);
+
   global_memory_anchors_.storage_memories_
     = reinterpret_cast<storage::StorageControlBlock*>(base + total);
   total += static_cast<uint64_t>(GlobalMemoryAnchors::kStorageMemorySize)
@@ -385,6 +397,12 @@ uint64_t SharedMemoryRepo::calculate_global_memory_size(
   total +=
     align_4kb(sizeof(storage::StorageId) * options.storage_.max_storages_)
     + kBoundarySize;
+  total +=
+    align_4kb(sizeof(storage::SnapshotRootHistory) * options.storage_.max_storages_)
+    + kBoundarySize;
+  total +=
+    align_4kb(sizeof(snapshot::StorageSelection) * options.storage_.max_storages_)
+    + kBoundarySize;
   total +=
     static_cast<uint64_t>(GlobalMemoryAnchors::kStorageMemorySize) * options.storage_.max_storages_
     + kBoundarySize;
@@ -74,7 +74,9 @@ ErrorStack ArrayComposer::compose(const Composer::ComposeArguments& args) {
     args.log_streams_,
     args.log_streams_count_,
     kMaxLevels,
-    args.work_memory_);
+    args.work_memory_,
+    snapshot::MergeSort::kDefaultChunkBatch,
+    engine_->get_options().snapshot_.log_reducer_sort_threads_);
   CHECK_ERROR(merge_sort.initialize());
 
   ArrayComposeContext context(
@@ -334,6 +334,31 @@ ErrorStack ArrayStoragePimpl::load(const StorageControlBlock& snapshot_block) {
 }
 
 
+/**
+ * A read-only snapshot leaf page whose only record is zero-cleared up to the largest payload.
+ * A pinned-snapshot read on an array that had no snapshot page as of the pinned snapshot,
+ * which means no record was ever written by then, reads this record for every offset.
+ */
+struct EmptySnapshotLeaf {
+  EmptySnapshotLeaf() {
+    get_page()->initialize_snapshot_page(
+      Epoch(Epoch::kEpochInitialDurable),
+      0,
+      0,
+      kDataSize - kRecordOverhead,
+      0,
+      ArrayRange(0, 1));
+  }
+  ArrayPage* get_page() { return reinterpret_cast<ArrayPage*>(data_); }
+
+  alignas(kPageSize) char data_[kPageSize];
+};
+
+inline Record* get_empty_snapshot_record() {
+  static EmptySnapshotLeaf empty_leaf;
+  return empty_leaf.get_page()->get_leaf_record(0, kDataSize - kRecordOverhead);
+}
+
 inline ErrorCode ArrayStoragePimpl::locate_record_for_read(
   thread::Thread* context,
   ArrayOffset offset,
@@ -344,6 +369,10 @@ inline ErrorCode ArrayStoragePimpl::locate_record_for_read(
   uint16_t index = 0;
   ArrayPage* page = nullptr;
   CHECK_ERROR_CODE(lookup_for_read(context, offset, &page, &index, snapshot_record));
+  if (UNLIKELY(page == nullptr)) {
+    *out = get_empty_snapshot_record();  // empty as of the pinned snapshot
+    return kErrorCodeOk;
+  }
   ASSERT_ND(page);
   ASSERT_ND(page->is_leaf());
   ASSERT_ND(page->get_array_range().contains(offset));
@@ -544,6 +573,11 @@ inline ErrorCode ArrayStoragePimpl::lookup_for_read(
   ASSERT_ND(index);
   ArrayPage* current_page;
   CHECK_ERROR_CODE(get_root_page(context, false, &current_page));
+  if (UNLIKELY(current_page == nullptr)) {
+    *out = nullptr;  // empty as of the pinned snapshot
+    *snapshot_page = true;
+    return kErrorCodeOk;
+  }
   uint16_t levels = get_levels();
   ASSERT_ND(current_page->get_array_range().contains(offset));
   LookupRoute route = control_block_->route_finder_.find_route(offset);
@@ -782,7 +816,10 @@ inline ErrorCode ArrayStoragePimpl::locate_record_for_read_batch(
     snapshot_page_batch));
   const uint16_t payload_size = get_payload_size();
   for (uint8_t i = 0; i < batch_size; ++i) {
-    ASSERT_ND(page_batch[i]);
+    if (UNLIKELY(page_batch[i] == nullptr)) {
+      out_batch[i] = get_empty_snapshot_record();  // empty as of the pinned snapshot
+      continue;
+    }
     ASSERT_ND(page_batch[i]->is_leaf());
     ASSERT_ND(page_batch[i]->get_array_range().contains(offset_batch[i]));
     out_batch[i] = page_batch[i]->get_leaf_record(index_batch[i], payload_size);
@@ -802,6 +839,13 @@ inline ErrorCode ArrayStoragePimpl::lookup_for_read_batch(
   LookupRoute routes[kBatchMax];
   ArrayPage* root_page;
   CHECK_ERROR_CODE(get_root_page(context, false, &root_page));
+  if (UNLIKELY(root_page == nullptr)) {
+    for (uint8_t i = 0; i < batch_size; ++i) {
+      out_batch[i] = nullptr;  // empty as of the pinned snapshot
+      snapshot_page_batch[i] = true;
+    }
+    return kErrorCodeOk;
+  }
   uint16_t levels = get_levels();
   bool root_snapshot = root_page->header().snapshot_;
   const uint16_t payload_size = get_payload_size();
@@ -932,6 +976,9 @@ inline ErrorCode ArrayStoragePimpl::lookup_for_write_batch(
 ErrorStack ArrayStoragePimpl::verify_single_thread(thread::Thread* context) {
   ArrayPage* root;
   WRAP_ERROR_CODE(get_root_page(context, false, &root));
+  if (root == nullptr) {
+    return kRetOk;  // empty as of the pinned snapshot. nothing to verify
+  }
   return verify_single_thread(context, root);
 }
 ErrorStack ArrayStoragePimpl::verify_single_thread(thread::Thread* context, ArrayPage* page) {
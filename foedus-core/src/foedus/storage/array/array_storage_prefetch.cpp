@@ -39,6 +39,9 @@ ErrorCode ArrayStoragePimpl::prefetch_pages(
     << " prefetching " << get_meta().name_ << " from=" << from << ", to=" << to;
   ArrayPage* root_page;
   CHECK_ERROR_CODE(get_root_page(context, vol_on, &root_page));
+  if (root_page == nullptr) {
+    return kErrorCodeOk;  // empty as of the pinned snapshot. nothing to prefetch
+  }
   prefetch_page_l2(root_page);
   if (!root_page->is_leaf()) {
     CHECK_ERROR_CODE(prefetch_pages_recurse(context, vol_on, snp_on, from, to, root_page));
@@ -105,7 +105,9 @@ ErrorStack HashComposer::compose(const Composer::ComposeArguments& args) {
     args.log_streams_,
     args.log_streams_count_,
     kHashMaxLevels,
-    args.work_memory_);
+    args.work_memory_,
+    snapshot::MergeSort::kDefaultChunkBatch,
+    engine_->get_options().snapshot_.log_reducer_sort_threads_);
   CHECK_ERROR(merge_sort.initialize());
 
   HashComposeContext context(
@@ -563,6 +565,16 @@ ErrorCode HashComposeContext::apply_batch(uint64_t cur, uint64_t next) {
           log->get_payload(),
           log->payload_offset_,
           log->payload_count_));
+      } else if (log->header_.get_type() == log::kLogCodeHashAdd) {
+        const HashAddLogType* casted = reinterpret_cast<const HashAddLogType*>(log);
+        CHECK_ERROR_CODE(cur_bin_table_.add_record(
+          log->header_.xct_id_,
+          log->get_key(),
+          log->key_length_,
+          hash,
+          casted->get_value_type(),
+          log->get_payload(),
+          log->payload_offset_));
       } else if (log->header_.get_type() == log::kLogCodeHashInsert) {
         CHECK_ERROR_CODE(cur_bin_table_.insert_record(
           log->header_.xct_id_,
@@ -96,6 +96,19 @@ std::ostream& operator<<(std::ostream& o, const HashOverwriteLogType& v) {
   return o;
 }
 
+std::ostream& operator<<(std::ostream& o, const HashAddLogType& v) {
+  o << "<HashAddLog>"
+    << "<key_length_>" << v.key_length_ << "</key_length_>"
+    << "<key_>" << assorted::Top(v.get_key(), v.key_length_) << "</key_>"
+    << "<bin_bits_>" << static_cast<int>(v.bin_bits_) << "</bin_bits_>"
+    << "<hash_>" << assorted::Hex(v.hash_, 16) << "</hash_>"
+    << "<payload_offset_>" << v.payload_offset_ << "</payload_offset_>"
+    << "<value_type_>" << v.get_value_type() << "</value_type_>"
+    << "<addendum_>" << assorted::Top(v.get_payload(), v.payload_count_) << "</addendum_>"
+    << "</HashAddLog>";
+  return o;
+}
+
 }  // namespace hash
 }  // namespace storage
 }  // namespace foedus
@@ -26,6 +26,7 @@
 
 #include "foedus/engine.hpp"
 #include "foedus/engine_options.hpp"
+#include "foedus/assorted/radix_sort.hpp"
 #include "foedus/debugging/stop_watch.hpp"
 #include "foedus/log/common_log_types.hpp"
 #include "foedus/memory/engine_memory.hpp"
@@ -335,20 +336,25 @@ void HashPartitioner::sort_batch(const Partitioner::SortBatchArguments& args) co
   // we so far sort them in one path.
   // to save memory, we could do multi-path merge-sort.
   // however, in reality each log has many bytes, so log_count is not that big.
-  args.work_memory_->assure_capacity(sizeof(SortEntry) * args.logs_count_);
+  // The latter half is the scratch space of radix sort.
+  args.work_memory_->assure_capacity(sizeof(SortEntry) * args.logs_count_ * 2ULL);
 
   debugging::StopWatch stop_watch_entire;
 
   ASSERT_ND(sizeof(SortEntry) == 16U);
   SortEntry* entries = reinterpret_cast<SortEntry*>(args.work_memory_->get_block());
+  SortEntry* sort_buffer = entries + args.logs_count_;
   prepare_sort_entries(data_->bin_shifts_, args, entries);
 
   debugging::StopWatch stop_watch;
   // Gave up non-gcc support because of aarch64 support. yes, we can also assume __uint128_t.
-  // CPU profile of partition_hash_perf: ??% (introsort_loop) + ??% (other inlined).
-  std::sort(
+  // Same as array, radix sort skips the digits that are same in all entries.
+  assorted::radix_sort_uint128(
     reinterpret_cast<__uint128_t*>(entries),
-    reinterpret_cast<__uint128_t*>(entries + args.logs_count_));
+    reinterpret_cast<__uint128_t*>(sort_buffer),
+    args.logs_count_,
+    0,
+    engine_->get_options().snapshot_.log_reducer_sort_threads_);
   stop_watch.stop();
   VLOG(0) << "Sorted " << args.logs_count_ << " log entries in " << stop_watch.elapsed_ms() << "ms";
 
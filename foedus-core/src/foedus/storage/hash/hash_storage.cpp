@@ -244,6 +244,24 @@ ErrorCode HashStorage::increment_record(
     payload_offset);
 }
 
+template <typename PAYLOAD>
+ErrorCode HashStorage::add_record(
+  thread::Thread* context,
+  const void* key,
+  uint16_t key_length,
+  const HashCombo& combo,
+  PAYLOAD addendum,
+  uint16_t payload_offset) {
+  HashStoragePimpl pimpl(this);
+  return pimpl.add_record(
+    context,
+    key,
+    key_length,
+    combo,
+    addendum,
+    payload_offset);
+}
+
 std::ostream& operator<<(std::ostream& o, const HashStorage& v) {
   o << "<HashStorage>"
     << "<id>" << v.get_id() << "</id>"
@@ -314,6 +332,15 @@ INSTANTIATE_ALL_NUMERIC_TYPES(EXPIN_3);
     x* value, \
     uint16_t payload_offset)
 INSTANTIATE_ALL_NUMERIC_TYPES(EXPIN_5);
+
+#define EXPIN_6(x) template ErrorCode HashStorage::add_record< x > \
+  (thread::Thread* context, \
+    const void* key, \
+    uint16_t key_length, \
+    const HashCombo& combo, \
+    x addendum, \
+    uint16_t payload_offset)
+INSTANTIATE_ALL_NUMERIC_TYPES(EXPIN_6);
 // @endcond
 
 
@@ -604,16 +604,96 @@ ErrorCode HashStoragePimpl::increment_record(
   return register_record_write_log(context, location, log_entry);
 }
 
+template <typename PAYLOAD>
+ErrorCode HashStoragePimpl::add_record(
+  thread::Thread* context,
+  const void* key,
+  uint16_t key_length,
+  const HashCombo& combo,
+  PAYLOAD addendum,
+  uint16_t payload_offset) {
+  HashDataPage* bin_head;
+  CHECK_ERROR_CODE(locate_bin(context, true, combo, &bin_head));
+  ASSERT_ND(bin_head);
+  RecordLocation location;
+  // This is a blind write. We don't take read-set so that concurrent adds don't abort each other.
+  // Instead, precommit checks HashAddLogType::is_applicable() after locking the record.
+  CHECK_ERROR_CODE(locate_record_physical_only(
+    context,
+    true,
+    false,
+    0,
+    key,
+    key_length,
+    combo,
+    bin_head,
+    &location));
+
+  if (UNLIKELY(!location.is_found()
+    || location.observed_.is_deleted()
+    || location.cur_payload_length_ < payload_offset + sizeof(PAYLOAD))) {
+    // We can't return an error based on a physical-only observation. Do it again logically.
+    CHECK_ERROR_CODE(locate_record_logical(
+      context,
+      true,
+      false,
+      0,
+      key,
+      key_length,
+      combo,
+      bin_head,
+      &location));
+    if (!location.is_found()) {
+      return kErrorCodeStrKeyNotFound;  // protected by page version set, so we are done
+    } else if (location.observed_.is_deleted()) {
+      return kErrorCodeStrKeyNotFound;  // protected by the read set
+    } else if (location.cur_payload_length_ < payload_offset + sizeof(PAYLOAD)) {
+      LOG(WARNING) << "short record " << combo;  // probably this is a rare error. so warn.
+      return kErrorCodeStrTooShortPayload;  // protected by the read set
+    }
+  }
+
+  uint16_t log_length
+    = HashAddLogType::calculate_log_length(key_length, sizeof(PAYLOAD));
+  HashAddLogType* log_entry = reinterpret_cast<HashAddLogType*>(
+    context->get_thread_log_buffer().reserve_new_log(log_length));
+  log_entry->populate<PAYLOAD>(
+    get_id(),
+    key,
+    key_length,
+    get_bin_bits(),
+    combo.hash_,
+    addendum,
+    payload_offset);
+
+  return register_record_write_log(context, location, log_entry);
+}
+
 ErrorCode HashStoragePimpl::get_root_page(
   thread::Thread* context,
   bool for_write,
   HashIntermediatePage** root) {
+  DualPagePointer* root_pointer = &control_block_->root_page_pointer_;
+  DualPagePointer pinned_root;
+  if (UNLIKELY(context->get_current_xct().is_pinned_to_snapshot())) {
+    CHECK_ERROR_CODE(engine_->get_storage_manager()->get_pinned_root_pointer(
+      context,
+      get_id(),
+      for_write,
+      &pinned_root));
+    if (pinned_root.snapshot_pointer_ == 0) {
+      // the storage was empty or did not exist as of the pinned snapshot
+      *root = nullptr;
+      return kErrorCodeOk;
+    }
+    root_pointer = &pinned_root;
+  }
   CHECK_ERROR_CODE(context->follow_page_pointer(
     nullptr,  // guaranteed to be non-null
     false,    // guaranteed to be non-null
     for_write,
     false,    // guaranteed to be non-null
-    &control_block_->root_page_pointer_,
+    root_pointer,
     reinterpret_cast<Page**>(root),
     nullptr,  // no parent. it's root.
     0));
@@ -846,8 +926,11 @@ ErrorCode HashStoragePimpl::locate_bin(
   HashDataPage** bin_head) {
   HashIntermediatePage* root;
   CHECK_ERROR_CODE(get_root_page(context, for_write, &root));
-  ASSERT_ND(root);
   *bin_head = nullptr;
+  if (UNLIKELY(root == nullptr)) {
+    ASSERT_ND(!for_write);
+    return kErrorCodeOk;  // empty as of the pinned snapshot. not found
+  }
   xct::Xct& current_xct = context->get_current_xct();
 
   HashIntermediatePage* parent = root;
@@ -1197,6 +1280,15 @@ xct::TrackMovedRecordResult HashStoragePimpl::track_moved_record_search(
   x* value, \
   uint16_t payload_offset)
 INSTANTIATE_ALL_NUMERIC_TYPES(EXPIN_5I);
+
+#define EXPIN_6I(x) template ErrorCode HashStoragePimpl::add_record< x > \
+  (thread::Thread* context, \
+  const void* key, \
+  uint16_t key_length, \
+  const HashCombo& combo, \
+  x addendum, \
+  uint16_t payload_offset)
+INSTANTIATE_ALL_NUMERIC_TYPES(EXPIN_6I);
 // @endcond
 
 }  // namespace hash
@@ -26,6 +26,7 @@
 #include <vector>
 
 #include "foedus/engine.hpp"
+#include "foedus/engine_options.hpp"
 #include "foedus/cache/snapshot_file_set.hpp"
 #include "foedus/debugging/stop_watch.hpp"
 #include "foedus/fs/direct_io_file.hpp"
@@ -35,6 +36,7 @@
 #include "foedus/snapshot/snapshot_writer_impl.hpp"
 #include "foedus/storage/metadata.hpp"
 #include "foedus/storage/storage_manager.hpp"
+#include "foedus/storage/value_type.hpp"
 #include "foedus/storage/masstree/masstree_id.hpp"
 #include "foedus/storage/masstree/masstree_log_types.hpp"
 #include "foedus/storage/masstree/masstree_page_impl.hpp"
@@ -86,7 +88,9 @@ ErrorStack MasstreeComposer::compose(const Composer::ComposeArguments& args) {
     args.log_streams_,
     args.log_streams_count_,
     MasstreeComposeContext::kMaxLevels,
-    args.work_memory_);
+    args.work_memory_,
+    snapshot::MergeSort::kDefaultChunkBatch,
+    engine_->get_options().snapshot_.log_reducer_sort_threads_);
   CHECK_ERROR(merge_sort.initialize());
 
   MasstreeComposeContext context(engine_, &merge_sort, args);
@@ -427,7 +431,9 @@ ErrorStack MasstreeComposeContext::execute() {
         } else if (log_type == log::kLogCodeMasstreeUpdate) {
           CHECK_ERROR(execute_update_group(cur, cur + group.count_));
         } else {
-          ASSERT_ND(log_type == log::kLogCodeMasstreeOverwrite);
+          // Adds modify the payload in-place just like overwrites.
+          ASSERT_ND(log_type == log::kLogCodeMasstreeOverwrite
+            || log_type == log::kLogCodeMasstreeAdd);
           CHECK_ERROR(execute_overwrite_group(cur, cur + group.count_));
         }
       }
@@ -455,7 +461,7 @@ ErrorStack MasstreeComposeContext::execute_same_key_group(uint32_t from, uint32_
   }
   // As these logs are on the same key, we check which logs can be nullified.
 
-  // Let's say I:Insert, U:Update, D:Delete, O:Overwrite
+  // Let's say I:Insert, U:Update, D:Delete, O:Overwrite (or Add. we don't distinguish them here)
   // overwrite: this is the easiest one that is nullified by following delete/update.
   // insert: if there is following delete, everything in-between disappear, including insert/delete.
   // update: nullified by following delete/update
@@ -521,7 +527,8 @@ ErrorStack MasstreeComposeContext::execute_same_key_group(uint32_t from, uint32_
           break;
         default:
           ASSERT_ND(log_type_j == log::kLogCodeMasstreeUpdate
-            || log_type_j == log::kLogCodeMasstreeOverwrite);
+            || log_type_j == log::kLogCodeMasstreeOverwrite
+            || log_type_j == log::kLogCodeMasstreeAdd);
           ASSERT_ND((!starts_with_insert && insert_count == delete_count)
             || (starts_with_insert && insert_count == delete_count + 1U));
           break;
@@ -589,6 +596,10 @@ ErrorStack MasstreeComposeContext::execute_same_key_group(uint32_t from, uint32_
       next_to_check = next + 1U;
       last_active_delete = to;
     }
+  } else if (starts_with_insert) {
+    // I,,, without any delete. The first insert stays active.
+    last_active_insert = from;
+    next_to_check = from + 1U;
   }
 
   // From now on, we are sure there is no more delete or insert.
@@ -613,9 +624,10 @@ ErrorStack MasstreeComposeContext::execute_same_key_group(uint32_t from, uint32_
         is_last_active_update_merged = false;
       }
     } else {
-      // Overwrites are just skipped.
-      ASSERT_ND(log_type == log::kLogCodeMasstreeOverwrite);
-      ASSERT_ND(starts_with_insert || last_active_insert != to);
+      // Overwrites/adds are just skipped.
+      ASSERT_ND(log_type == log::kLogCodeMasstreeOverwrite
+        || log_type == log::kLogCodeMasstreeAdd);
+      ASSERT_ND(!starts_with_insert || last_active_insert != to);
     }
   }
 
@@ -659,8 +671,9 @@ ErrorStack MasstreeComposeContext::execute_same_key_group(uint32_t from, uint32_
 
     // Process the I/U as usual. This also makes sure that the tail-record is the key.
   } else {
-    ASSERT_ND(log::kLogCodeMasstreeOverwrite == merge_sort_->get_log_type_from_sort_position(cur));
-    // All logs are overwrites.
+    ASSERT_ND(log::kLogCodeMasstreeOverwrite == merge_sort_->get_log_type_from_sort_position(cur)
+      || log::kLogCodeMasstreeAdd == merge_sort_->get_log_type_from_sort_position(cur));
+    // All logs are overwrites/adds.
     // Even in this case, we must process the first log as usual so that
     // the tail-record in the tail page points to the record.
   }
@@ -671,8 +684,8 @@ ErrorStack MasstreeComposeContext::execute_same_key_group(uint32_t from, uint32_
     return kRetOk;
   }
 
-  // All the followings are overwrites.
-  // Process the remaining overwrites in a tight loop.
+  // All the followings are overwrites/adds.
+  // Process the remaining overwrites/adds in a tight loop.
   // We made sure sure the tail-record in the tail page points to the record.
   PathLevel* last = get_last_level();
   ASSERT_ND(get_page(last->tail_)->is_border());
@@ -684,15 +697,18 @@ ErrorStack MasstreeComposeContext::execute_same_key_group(uint32_t from, uint32_
   char* record = page->get_record(index);
 
   for (uint32_t i = cur; i < to; ++i) {
-    const MasstreeOverwriteLogType* casted =
-      reinterpret_cast<const MasstreeOverwriteLogType*>(merge_sort_->resolve_sort_position(i));
-    ASSERT_ND(casted->header_.get_type() == log::kLogCodeMasstreeOverwrite);
+    const MasstreeCommonLogType* casted =
+      reinterpret_cast<const MasstreeCommonLogType*>(merge_sort_->resolve_sort_position(i));
+    ASSERT_ND(casted->header_.get_type() == log::kLogCodeMasstreeOverwrite
+      || casted->header_.get_type() == log::kLogCodeMasstreeAdd);
     ASSERT_ND(page->equal_key(index, casted->get_key(), casted->key_length_));
 
     // Also, we look for a chance to ignore redundant overwrites.
     // If next overwrite log covers the same or more data range, we can skip the log.
+    // An add log depends on the preceding value, so it never makes the previous log redundant.
     // Ideally, we should have removed such logs back in mappers.
-    if (i < to) {
+    if (i + 1U < to
+      && merge_sort_->get_log_type_from_sort_position(i + 1U) == log::kLogCodeMasstreeOverwrite) {
       const MasstreeOverwriteLogType* next =
         reinterpret_cast<const MasstreeOverwriteLogType*>(
           merge_sort_->resolve_sort_position(i + 1U));
@@ -704,7 +720,21 @@ ErrorStack MasstreeComposeContext::execute_same_key_group(uint32_t from, uint32_
       }
     }
 
-    casted->apply_record(nullptr, id_, page->get_owner_id(index), record);
+    if (casted->header_.get_type() == log::kLogCodeMasstreeOverwrite) {
+      reinterpret_cast<const MasstreeOverwriteLogType*>(casted)->apply_record(
+        nullptr,
+        id_,
+        page->get_owner_id(index),
+        record);
+    } else {
+      // As execute_a_log() does, we don't use apply_record(), which assumes a locked record.
+      const MasstreeAddLogType* add = reinterpret_cast<const MasstreeAddLogType*>(casted);
+      ASSERT_ND(page->get_payload_length(index) >= add->payload_offset_ + add->payload_count_);
+      add_value(
+        add->get_value_type(),
+        page->get_record_payload(index) + add->payload_offset_,
+        add->get_payload());
+    }
   }
   return kRetOk;
 }
@@ -1096,10 +1126,26 @@ inline ErrorStack MasstreeComposeContext::execute_a_log(uint32_t cur) {
     SlotIndex index = key_count - 1;
     ASSERT_ND(!page->does_point_to_layer(index));
     ASSERT_ND(page->equal_key(index, key, key_length));
-    char* record = page->get_record(index);
+    // log.apply_record() assumes a locked record in a volatile page. This page is private to us,
+    // so we just copy the payload.
     const MasstreeOverwriteLogType* casted
       = reinterpret_cast<const MasstreeOverwriteLogType*>(entry);
-    casted->apply_record(nullptr, id_, page->get_owner_id(index), record);
+    ASSERT_ND(page->get_payload_length(index) >= casted->payload_offset_ + casted->payload_count_);
+    std::memcpy(
+      page->get_record_payload(index) + casted->payload_offset_,
+      casted->get_payload(),
+      casted->payload_count_);
+  } else if (entry->header_.get_type() == log::kLogCodeMasstreeAdd) {
+    // [Add] same as above except we add the addendum to the current value
+    SlotIndex index = key_count - 1;
+    ASSERT_ND(!page->does_point_to_layer(index));
+    ASSERT_ND(page->equal_key(index, key, key_length));
+    const MasstreeAddLogType* casted = reinterpret_cast<const MasstreeAddLogType*>(entry);
+    ASSERT_ND(page->get_payload_length(index) >= casted->payload_offset_ + casted->payload_count_);
+    add_value(
+      casted->get_value_type(),
+      page->get_record_payload(index) + casted->payload_offset_,
+      casted->get_payload());
   } else {
     // DELETE/INSERT/UPDATE
     ASSERT_ND(
@@ -1114,12 +1160,12 @@ inline ErrorStack MasstreeComposeContext::execute_a_log(uint32_t cur) {
       ASSERT_ND(!page->does_point_to_layer(index));
       ASSERT_ND(page->equal_key(index, key, key_length));
       page->set_key_count(index);
+      key_count = index;
     }
     // Notice that this is "if", not "else if". UPDATE = DELETE + INSERT.
     if (entry->header_.get_type() == log::kLogCodeMasstreeInsert
       || entry->header_.get_type() == log::kLogCodeMasstreeUpdate) {
       // [Insert/Update] next-layer is already handled above, so just append it.
-      ASSERT_ND(entry->header_.get_type() == log::kLogCodeMasstreeInsert);
       ASSERT_ND(key_count == 0 || !page->equal_key(key_count - 1, key, key_length));  // no dup
       KeyLength skip = last->layer_ * kSliceLen;
       append_border(
@@ -1307,8 +1353,9 @@ ErrorStack MasstreeComposeContext::open_next_level(
 
     MasstreeBorderPage* target_casted = as_border(target);
     ASSERT_ND(copy_count <= key_count);
+    // the records after copy_count will be appended again as we consume the original page.
     target_casted->set_key_count(copy_count);
-    level->next_original_ = copy_count + 1U;
+    level->next_original_ = copy_count;
     if (level->next_original_ >= key_count) {
       level->set_no_more_next_original();
     } else {
@@ -1353,9 +1400,10 @@ ErrorStack MasstreeComposeContext::open_next_level(
     MasstreeIntermediatePage* target_casted = as_intermdiate(target);
     target_casted->set_key_count(index);
     target_casted->get_minipage(index).key_count_ = index_mini;
+    // the next separator must come from the original. target's is now its high fence
     KeySlice this_fence;
     KeySlice next_fence;
-    target_casted->extract_separators_snapshot(index, index_mini, &this_fence, &next_fence);
+    casted->extract_separators_snapshot(index, index_mini, &this_fence, &next_fence);
     level->next_original_ = index;
     level->next_original_mini_ = index_mini + 1U;
     level->next_original_slice_ = next_fence;
@@ -1460,8 +1508,6 @@ inline bool MasstreeComposeContext::does_need_to_adjust_path(
   } else if (!cur_path_[0].contains_key(key, key_length)) {
     // first slice does not match
     return true;
-  } else if (get_last_level()->layer_ == 0) {
-    return false;  // first slice check already done.
   }
 
   // Does the slices of the next_key match the current path? if not we have to close them
@@ -1541,7 +1587,7 @@ ErrorStack MasstreeComposeContext::adjust_path(const char* key, KeyLength key_le
     ASSERT_ND(casted->get_minipage(casted->get_key_count()).find_pointer(next_slice)
       == casted->get_minipage(casted->get_key_count()).key_count_);
     if (last->has_next_original() && last->next_original_slice_ <= next_slice) {
-      ASSERT_ND(last->next_original_slice_ != next_slice);
+      // this includes the pointer whose low fence is exactly the slice
       CHECK_ERROR(consume_original_upto_intermediate(next_slice, last));
     }
     ASSERT_ND(casted->find_minipage(next_slice) == casted->get_key_count());
@@ -1764,10 +1810,10 @@ ErrorStack MasstreeComposeContext::consume_original_upto_intermediate(
   KeySlice slice,
   PathLevel* level) {
   ASSERT_ND(level->has_next_original());
-  ASSERT_ND(level->next_original_slice_ < slice);
+  ASSERT_ND(level->next_original_slice_ <= slice);
   uint16_t level_index = level - cur_path_;
   MasstreeIntermediatePage* original = as_intermdiate(get_original(level_index));
-  while (level->has_next_original() && level->next_original_slice_ < slice) {
+  while (level->has_next_original() && level->next_original_slice_ <= slice) {
     MasstreeIntermediatePointerIterator it(original);
     it.index_ = level->next_original_;
     it.index_mini_ = level->next_original_mini_;
@@ -1939,8 +1985,14 @@ ErrorStack MasstreeComposeContext::pushup_non_root() {
         parent_page->extract_separators_snapshot(index, index_mini, &check_low, &check_high);
         ASSERT_ND(check_low == low_fence);
         // high-fence should be same as tail's high if this level has split. let's check it, too.
+        // The parent is a truncated copy of its original page, so its separator after this
+        // pointer is now the page's high fence. The original separator is the next original
+        // pointer the parent will consume, or the parent's high fence if there is none.
+        KeySlice original_high = parent->has_next_original()
+          ? parent->next_original_slice_
+          : parent->high_fence_;
         MasstreePage* tail = get_page(last->tail_);
-        ASSERT_ND(check_high == tail->get_high_fence());
+        ASSERT_ND(original_high == tail->get_high_fence());
 #endif  // NDEBUG
       }
     }
@@ -43,6 +43,8 @@ MasstreeCursor::MasstreeCursor(MasstreeStorage storage, thread::Thread* context)
     storage_(storage.get_engine(), storage.get_control_block()),
     context_(context),
     current_xct_(&context->get_current_xct()) {
+  filter_ = nullptr;
+  page_level_read_set_ = false;
   for_writes_ = false;
   forward_cursor_ = true;
   reached_end_ = false;
@@ -172,6 +174,22 @@ MasstreePage* MasstreeCursor::resolve_volatile(VolatilePagePointer ptr) const {
 /////////////////////////////////////////////////////////////////////////////////////////
 
 ErrorCode MasstreeCursor::next() {
+  CHECK_ERROR_CODE(next_unfiltered());
+  return skip_filtered_records();
+}
+
+inline ErrorCode MasstreeCursor::skip_filtered_records() {
+  if (filter_ == nullptr || !filter_->has_predicate()) {
+    return kErrorCodeOk;
+  }
+  // next_unfiltered() checks the end key for each record, so this never goes beyond it.
+  while (is_valid_record() && !filter_->evaluate(cur_payload_, cur_payload_length_)) {
+    CHECK_ERROR_CODE(next_unfiltered());
+  }
+  return kErrorCodeOk;
+}
+
+ErrorCode MasstreeCursor::next_unfiltered() {
   ASSERT_ND(!should_skip_cur_route_);
   if (!is_valid_record()) {
     return kErrorCodeOk;
@@ -363,7 +381,12 @@ ErrorCode MasstreeCursor::proceed_route_intermediate() {
       DualPagePointer& pointer = minipage.pointers_[route->index_mini_];
       ASSERT_ND(!pointer.is_both_null());
       CHECK_ERROR_CODE(
-        MasstreeStoragePimpl(&storage_).follow_page(context_, for_writes_, &pointer, &next));
+        MasstreeStoragePimpl(&storage_).follow_page(
+          context_,
+          for_writes_,
+          &pointer,
+          &next,
+          page));
 
       if (forward_cursor_) {
         if (UNLIKELY(next->get_low_fence() != route->latest_separator_)) {
@@ -506,7 +529,12 @@ inline ErrorCode MasstreeCursor::proceed_deeper_intermediate() {
     DualPagePointer& pointer = minipage.pointers_[route->index_mini_];
     ASSERT_ND(!pointer.is_both_null());
     CHECK_ERROR_CODE(
-      MasstreeStoragePimpl(&storage_).follow_page(context_, for_writes_, &pointer, &next));
+      MasstreeStoragePimpl(&storage_).follow_page(
+        context_,
+        for_writes_,
+        &pointer,
+        &next,
+        page));
     if (UNLIKELY(next->get_low_fence() != separator_low ||
         next->get_high_fence() != separator_high)) {
       VLOG(0) << "Interesting4. first sep doesn't match. concurrent adoption. local retry.";
@@ -544,11 +572,16 @@ ErrorCode MasstreeCursor::fetch_cur_record_logical(MasstreeBorderPage* page, Slo
   Layer layer = page->get_layer();
   cur_key_length_ = layer * sizeof(KeySlice) + remainder;
 
-  CHECK_ERROR_CODE(cur_key_location_.populate_logical(
-    current_xct_,
-    page,
-    record,
-    for_writes_));
+  if (cur_route()->page_read_protected_) {
+    ASSERT_ND(cur_route()->page_ == page);
+    cur_key_location_.populate_protected(page, record);
+  } else {
+    CHECK_ERROR_CODE(cur_key_location_.populate_logical(
+      current_xct_,
+      page,
+      record,
+      for_writes_));
+  }
   if (!cur_key_location_.observed_.is_next_layer()) {
     cur_key_suffix_ = page->get_record(record);
     cur_payload_length_ = page->get_payload_length(record);
@@ -626,6 +659,7 @@ ErrorCode MasstreeCursor::push_route(MasstreePage* page) {
     route.index_mini_ = kMaxRecords;  // must be set shortly after this method
     route.snapshot_ = page->header().snapshot_;
     route.layer_ = page->get_layer();
+    route.page_read_protected_ = false;
     if (is_border && !route.was_stably_moved()) {
       route.setup_order();
       assorted::memory_fence_acquire();
@@ -648,6 +682,21 @@ ErrorCode MasstreeCursor::push_route(MasstreePage* page) {
   if (!is_border || page->header().snapshot_ || route.was_stably_moved()) {
     return kErrorCodeOk;
   }
+  if (page_level_read_set_ && !for_writes_ && route.key_count_ > 0) {
+    // The page read-set also verifies the page version, so it replaces the page version set.
+    MasstreeBorderPage* border = reinterpret_cast<MasstreeBorderPage*>(page);
+    CHECK_ERROR_CODE(current_xct_->add_to_page_read_set(
+      &page->header().page_version_,
+      route.stable_,
+      &page->header().key_count_,
+      border->get_owner_id(0),
+      -static_cast<int32_t>(sizeof(MasstreeBorderPage::Slot)),
+      route.key_count_,
+      &route.page_read_protected_));
+    if (route.page_read_protected_) {
+      return kErrorCodeOk;
+    }
+  }
   return current_xct_->add_to_page_version_set(&page->header().page_version_, route.stable_);
 }
 
@@ -970,6 +1019,11 @@ ErrorCode MasstreeCursor::open(
   MasstreeIntermediatePage* root;
   MasstreeStoragePimpl pimpl(&storage_);
   CHECK_ERROR_CODE(pimpl.get_first_root(context_, for_writes, &root));
+  if (UNLIKELY(root == nullptr)) {
+    // empty as of the pinned snapshot. route_count_ == 0 means no more records.
+    ASSERT_ND(!is_valid_record());
+    return kErrorCodeOk;
+  }
   CHECK_ERROR_CODE(push_route(root));
   CHECK_ERROR_CODE(locate_layer(0));
   ASSERT_ND(route_count_ != 0);
@@ -1000,7 +1054,7 @@ ErrorCode MasstreeCursor::open(
   if (is_valid_record()) {
     assert_route();
   }
-  return kErrorCodeOk;
+  return skip_filtered_records();
 }
 
 inline ErrorCode MasstreeCursor::locate_layer(uint8_t layer) {
@@ -1237,7 +1291,12 @@ ErrorCode MasstreeCursor::locate_descend(KeySlice slice) {
     ASSERT_ND(!pointer.is_both_null());
     MasstreePage* next;
     CHECK_ERROR_CODE(
-      MasstreeStoragePimpl(&storage_).follow_page(context_, for_writes_, &pointer, &next));
+      MasstreeStoragePimpl(&storage_).follow_page(
+        context_,
+        for_writes_,
+        &pointer,
+        &next,
+        cur));
 
     // Master-tree invariant
     // verify that the followed page covers the key range we want.
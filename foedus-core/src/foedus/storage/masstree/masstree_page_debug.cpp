@@ -81,6 +81,8 @@ std::ostream& operator<<(std::ostream& o, const MasstreeBorderPage& v) {
   o << "<MasstreeBorderPage>";
   describe_masstree_page_common(&o, v);
   o << "<consecutive_inserts_>" << v.consecutive_inserts_ << "</consecutive_inserts_>";
+  o << "<sequential_splits_>" << static_cast<int>(v.sequential_splits_)
+    << "</sequential_splits_>";
   o << std::endl << "<records>";
   for (uint16_t i = 0; i < v.get_key_count(); ++i) {
     o << std::endl << "  <record index=\"" << i
@@ -140,6 +140,7 @@ void MasstreeBorderPage::initialize_volatile_page(
     low_fence,
     high_fence);
   consecutive_inserts_ = true;  // initially key_count = 0, so of course sorted
+  sequential_splits_ = 0;
   next_offset_ = 0;  // well, already implicitly zero-ed, but to be clear
 }
 
@@ -158,6 +159,7 @@ void MasstreeBorderPage::initialize_snapshot_page(
     low_fence,
     high_fence);
   consecutive_inserts_ = true;  // snapshot pages are always completely sorted
+  sequential_splits_ = 0;
   next_offset_ = 0;  // well, already implicitly zero-ed, but to be clear
 }
 
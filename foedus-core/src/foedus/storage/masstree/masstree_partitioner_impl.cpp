@@ -103,8 +103,9 @@ ErrorStack MasstreePartitioner::design_partition(
     if (snapshot_page_id == 0) {
       CHECK_ERROR(design_partition_first(vol));
     } else {
-      // So far same assignment as previous snapshot.
-      // TODO(Hideaki) check current volatile pages to change the assignments.
+      // Partition keys must be the separators in the previous snapshot's root page because
+      // composers in all reducers update children of the same root page. We start from the
+      // previous assignment, then move partitions to other nodes based on current volatile pages.
       for (MasstreeIntermediatePointerIterator it(snp); it.is_valid(); it.next()) {
         data_->low_keys_[data_->partition_count_] = it.get_low_key();
         SnapshotPagePointer pointer = it.get_pointer().snapshot_pointer_;
@@ -112,6 +113,7 @@ ErrorStack MasstreePartitioner::design_partition(
         data_->partitions_[data_->partition_count_] = assignment;
         ++data_->partition_count_;
       }
+      CHECK_ERROR(design_partition_rebalance(vol));
     }
   }
 
@@ -121,7 +123,11 @@ ErrorStack MasstreePartitioner::design_partition(
 }
 
 
-void design_partition_first_parallel_recurse(
+/**
+ * @return estimated number of volatile pages in the subtree. Each sampled child stands for
+ * as many children as the inverse of the probability to pick it (Knuth's estimator).
+ */
+uint64_t design_partition_first_parallel_recurse(
   const memory::GlobalVolatilePageResolver& resolver,
   const MasstreePage* page,
   uint32_t subtree_id,
@@ -129,27 +135,34 @@ void design_partition_first_parallel_recurse(
   assorted::UniformRandom* unirand) {
   uint32_t node = page->header().stat_last_updater_node_;
   result->increment(node, subtree_id);
+  uint64_t estimated_pages = 1;
   // we don't care foster twins. this is just for sampling.
   if (!page->is_border()) {
     const auto* casted = reinterpret_cast<const MasstreeIntermediatePage*>(page);
     const uint32_t kSamplingWidth = 3;  // follow this many pointers per page.
+    uint64_t sampled_pages = 0;
     for (uint32_t rep = 0; rep < kSamplingWidth; ++rep) {
       uint32_t index = unirand->next_uint32() % (casted->get_key_count() + 1U);
       const MasstreeIntermediatePage::MiniPage& minipage = casted->get_minipage(index);
       uint32_t index_mini = unirand->next_uint32() % (minipage.key_count_ + 1U);
       VolatilePagePointer pointer = minipage.pointers_[index_mini].volatile_pointer_;
       if (pointer.is_null()) {
-        // because now this page might be changing, this is possible
+        // because now this page might be changing, this is possible.
+        // also, the subtree might have been dropped after the previous snapshot.
         continue;
       }
       MasstreePage* child = reinterpret_cast<MasstreePage*>(resolver.resolve_offset(pointer));
-      design_partition_first_parallel_recurse(resolver, child, subtree_id, result, unirand);
+      uint64_t child_pages
+        = design_partition_first_parallel_recurse(resolver, child, subtree_id, result, unirand);
+      sampled_pages += child_pages * (casted->get_key_count() + 1U) * (minipage.key_count_ + 1U);
     }
+    estimated_pages += sampled_pages / kSamplingWidth;
   } else {
     // so far do not bother going down to next layer. the border page's owner probably
     // represents it well. it might not, but a worst case always exists (such as just 1 page
     // in the first layer.. in that case anyway no luck).
   }
+  return estimated_pages;
 }
 
 void design_partition_first_parallel(
@@ -163,7 +176,9 @@ void design_partition_first_parallel(
   debugging::StopWatch watch;
   MasstreePage* page = reinterpret_cast<MasstreePage*>(resolver.resolve_offset(subtree));
   assorted::UniformRandom unirand(subtree_id);
-  design_partition_first_parallel_recurse(resolver, page, subtree_id, result, &unirand);
+  uint64_t estimated_pages
+    = design_partition_first_parallel_recurse(resolver, page, subtree_id, result, &unirand);
+  result->set_load(subtree_id, estimated_pages);
   watch.stop();
   VLOG(0) << "Subtree-" << subtree_id << " done in " << watch.elapsed_us() << "us";
 }
@@ -206,13 +221,127 @@ ErrorStack MasstreePartitioner::design_partition_first(const MasstreeIntermediat
 
   samples.assign_owners();
   LOG(INFO) << "Joined. Results:" << samples;
+  std::vector<uint64_t> loads(data_->partition_count_);
   for (uint32_t subtree_id = 0; subtree_id < data_->partition_count_; ++subtree_id) {
     data_->partitions_[subtree_id] = samples.get_assignment(subtree_id);
+    loads[subtree_id] = samples.get_load(subtree_id);
   }
 
+  balance_assignments(loads);
   return kRetOk;
 }
 
+ErrorStack MasstreePartitioner::design_partition_rebalance(const MasstreeIntermediatePage* root) {
+  LOG(INFO) << "Checking current volatile pages to rebalance partitions of Masstree-" << id_;
+  // Each pointer in the current volatile root is within one partition because volatile pages
+  // only split after the previous snapshot. A null pointer means the subtree was dropped
+  // and has not been modified since then.
+  std::vector<VolatilePagePointer> pointers;
+  std::vector<uint16_t> partition_of_pointers;
+  pointers.reserve(kMaxIntermediatePointers);
+  partition_of_pointers.reserve(kMaxIntermediatePointers);
+  for (MasstreeIntermediatePointerIterator it(root); it.is_valid(); it.next()) {
+    const DualPagePointer& pointer = it.get_pointer();
+    if (pointer.volatile_pointer_.is_null()) {
+      continue;
+    }
+    const KeySlice* begin = data_->low_keys_;
+    const KeySlice* end = begin + data_->partition_count_;
+    const KeySlice* found = std::upper_bound(begin, end, it.get_low_key());
+    ASSERT_ND(found != begin);
+    pointers.push_back(pointer.volatile_pointer_);
+    partition_of_pointers.push_back(found - begin - 1);
+  }
+  if (pointers.empty()) {
+    LOG(INFO) << "No volatile pages in Masstree-" << id_ << ". Keeping previous assignments";
+    return kRetOk;
+  }
+
+  const uint32_t subtrees = pointers.size();
+  OwnerSamples samples(engine_->get_soc_count(), subtrees);
+  std::vector< std::thread > threads;
+  threads.reserve(subtrees);
+  for (uint32_t subtree_id = 0; subtree_id < subtrees; ++subtree_id) {
+    threads.emplace_back(
+      design_partition_first_parallel,
+      engine_,
+      pointers[subtree_id],
+      subtree_id,
+      &samples);
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+
+  std::vector<uint64_t> loads(data_->partition_count_, 0);
+  for (uint32_t subtree_id = 0; subtree_id < subtrees; ++subtree_id) {
+    loads[partition_of_pointers[subtree_id]] += samples.get_load(subtree_id);
+  }
+  balance_assignments(loads);
+  return kRetOk;
+}
+
+void MasstreePartitioner::balance_assignments(const std::vector<uint64_t>& loads) {
+  ASSERT_ND(loads.size() == data_->partition_count_);
+  const uint16_t nodes = engine_->get_soc_count();
+  std::vector<uint64_t> node_loads(nodes, 0);
+  uint64_t total = 0;
+  for (uint16_t i = 0; i < data_->partition_count_; ++i) {
+    ASSERT_ND(data_->partitions_[i] < nodes);
+    node_loads[data_->partitions_[i]] += loads[i];
+    total += loads[i];
+  }
+
+  // Each move strictly reduces the sum of squared node loads, so this terminates.
+  // We limit the number of moves anyway, and don't bother with small imbalance because
+  // moving a partition away from the node that wrote its pages loses locality.
+  uint32_t moves = 0;
+  for (; moves < data_->partition_count_; ++moves) {
+    uint16_t max_node = 0;
+    uint16_t min_node = 0;
+    for (uint16_t node = 1; node < nodes; ++node) {
+      if (node_loads[node] > node_loads[max_node]) {
+        max_node = node;
+      }
+      if (node_loads[node] < node_loads[min_node]) {
+        min_node = node;
+      }
+    }
+    const uint64_t gap = node_loads[max_node] - node_loads[min_node];
+    if (gap <= total / kRebalanceToleranceInverse) {
+      break;
+    }
+
+    // the partition whose load is closest to half of the gap evens out the two nodes
+    uint16_t best = data_->partition_count_;
+    uint64_t best_distance = gap;
+    for (uint16_t i = 0; i < data_->partition_count_; ++i) {
+      if (data_->partitions_[i] != max_node || loads[i] == 0 || loads[i] >= gap) {
+        continue;
+      }
+      uint64_t distance = loads[i] * 2U > gap ? loads[i] * 2U - gap : gap - loads[i] * 2U;
+      if (distance < best_distance) {
+        best = i;
+        best_distance = distance;
+      }
+    }
+    if (best == data_->partition_count_) {
+      break;
+    }
+    data_->partitions_[best] = min_node;
+    node_loads[max_node] -= loads[best];
+    node_loads[min_node] += loads[best];
+  }
+
+  if (moves > 0) {
+    LOG(INFO) << "Moved " << moves << " partitions of Masstree-" << id_ << " to balance "
+      << total << " estimated volatile pages among " << nodes << " nodes";
+  }
+  for (uint16_t node = 0; node < nodes; ++node) {
+    VLOG(0) << "Masstree-" << id_ << " Node-" << node << " load=" << node_loads[node];
+  }
+}
+
 void OwnerSamples::assign_owners() {
   // so far simply the node that has majority. but we might want to balance out
   for (uint32_t subtree_id = 0; subtree_id < subtrees_; ++subtree_id) {
@@ -242,7 +371,7 @@ std::ostream& operator<<(std::ostream& o, const OwnerSamples& v) {
     for (uint32_t node = 0; node < v.nodes_; ++node) {
       o << assorted::Hex(v.at(node, subtree_id), 6) << " ";
     }
-    o << "</subtree>" << std::endl;
+    o << "load=" << v.get_load(subtree_id) << "</subtree>" << std::endl;
   }
   o << std::endl << "</OwnerSamples>";
   return o;
@@ -450,7 +579,8 @@ void prepare_sort_entries(const Partitioner::SortBatchArguments& args, SortEntry
     ASSERT_ND(log_entry->header_.log_type_code_ == log::kLogCodeMasstreeInsert
       || log_entry->header_.log_type_code_ == log::kLogCodeMasstreeDelete
       || log_entry->header_.log_type_code_ == log::kLogCodeMasstreeUpdate
-      || log_entry->header_.log_type_code_ == log::kLogCodeMasstreeOverwrite);
+      || log_entry->header_.log_type_code_ == log::kLogCodeMasstreeOverwrite
+      || log_entry->header_.log_type_code_ == log::kLogCodeMasstreeAdd);
     ASSERT_ND(log_entry->key_length_ == sizeof(KeySlice));
     Epoch epoch = log_entry->header_.xct_id_.get_epoch();
     ASSERT_ND(epoch.subtract(base_epoch) < (1U << 16));
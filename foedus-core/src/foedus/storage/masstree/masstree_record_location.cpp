@@ -17,6 +17,7 @@
  */
 #include "foedus/storage/masstree/masstree_record_location.hpp"
 
+#include "foedus/assorted/atomic_fences.hpp"
 #include "foedus/storage/masstree/masstree_page_impl.hpp"
 #include "foedus/xct/xct.hpp"
 
@@ -54,6 +55,15 @@ ErrorCode RecordLocation::populate_logical(
   return kErrorCodeOk;
 }
 
+void RecordLocation::populate_protected(MasstreeBorderPage* page, SlotIndex index) {
+  page_ = page;
+  index_ = index;
+  readset_ = nullptr;
+  observed_ = page->get_owner_id(index)->xct_id_.spin_while_being_written();
+  assorted::memory_fence_acquire();  // following reads must happen *after* observing xid
+  ASSERT_ND(!observed_.is_being_written());
+}
+
 }  // namespace masstree
 }  // namespace storage
 }  // namespace foedus
@@ -157,6 +157,11 @@ ErrorCode ReserveRecords::run(xct::SysxctWorkspace* sysxct_workspace) {
     DVLOG(0) << "Ouch. need to split for allocating a space for next-layer";
   } else {
     ASSERT_ND(match.match_type_ == MasstreeBorderPage::kNotFound);
+    if (target_->should_split_early(key_count, slice_, early_split_threshold_)) {
+      DVLOG(1) << "Early split for sequential inserts. key_count=" << static_cast<int>(key_count);
+      out_split_needed_ = true;
+      return kErrorCodeOk;
+    }
     if (should_aggresively_create_next_layer_ &&
       target_->can_accomodate(key_count, sizeof(KeySlice), sizeof(DualPagePointer))) {
       DVLOG(1) << "Aggressively creating a next-layer.";
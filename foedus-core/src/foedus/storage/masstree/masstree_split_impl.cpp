@@ -22,8 +22,10 @@
 #include <algorithm>
 
 #include "foedus/assert_nd.hpp"
+#include "foedus/engine.hpp"
 #include "foedus/assorted/uniform_random.hpp"
 #include "foedus/debugging/rdtsc_watch.hpp"
+#include "foedus/snapshot/snapshot_manager.hpp"
 #include "foedus/storage/masstree/masstree_page_impl.hpp"
 #include "foedus/thread/thread.hpp"
 
@@ -31,6 +33,21 @@ namespace foedus {
 namespace storage {
 namespace masstree {
 
+/**
+ * Whether the record can be dropped when we compact the page.
+ * A record with ordinal 0 is a placeholder of an uncommitted insert (see ReserveRecords), which
+ * might be in the write-set of an in-flight transaction. We keep them.
+ * Next-layer pointers are never reclaimed, either.
+ * Deletions newer than reclaimable_until are kept, too. See SplitBorder for why.
+ */
+inline bool is_reclaimable_record(const xct::XctId& id, Epoch reclaimable_until) {
+  return id.is_deleted()
+    && !id.is_next_layer()
+    && id.get_ordinal() != 0
+    && reclaimable_until.is_valid()
+    && id.get_epoch() <= reclaimable_until;
+}
+
 /////////////////////////////////////////////////////////////////////////////////////
 ///
 ///                      Border node's Split
@@ -86,7 +103,18 @@ ErrorCode SplitBorder::run(xct::SysxctWorkspace* sysxct_workspace) {
   // lock all records
   CHECK_ERROR_CODE(lock_existing_records(sysxct_workspace));
 
-  if (strategy.no_record_split_) {
+  if (strategy.compact_records_) {
+    // foster-minor is empty-range, foster-major receives all surviving records.
+    ASSERT_ND(strategy.mid_slice_ == target_->get_low_fence());
+    twin[0]->set_key_count(0);
+    twin[0]->next_offset_ = 0;
+    migrate_records(
+      strategy.smallest_slice_,
+      strategy.largest_slice_,
+      strategy.reclaimable_until_,
+      twin[1]);
+    twin[1]->sequential_splits_ = target_->get_sequential_splits();
+  } else if (strategy.no_record_split_) {
     ASSERT_ND(!disable_no_record_split_);
     // in this case, we can move all records in one memcpy.
     // well, actually two : one for slices and another for data.
@@ -103,15 +131,25 @@ ErrorCode SplitBorder::run(xct::SysxctWorkspace* sysxct_workspace) {
       ASSERT_ND(owner_id->is_keylocked());
       owner_id->get_key_lock()->reset();  // no race
     }
+    // The new page is likely to receive the next NRS, too. Remember it for early splits.
+    const uint8_t sequential_splits = target_->get_sequential_splits();
+    twin[0]->sequential_splits_ = sequential_splits;
+    twin[1]->sequential_splits_
+      = sequential_splits < kMaxSequentialSplits ? sequential_splits + 1U : kMaxSequentialSplits;
   } else {
     migrate_records(
       strategy.smallest_slice_,
       strategy.mid_slice_ - 1,  // to make it inclusive
+      Epoch(),  // a usual split keeps all records
       twin[0]);
     migrate_records(
       strategy.mid_slice_,
       strategy.largest_slice_,  // this is inclusive (to avoid supremum hassles)
+      Epoch(),  // a usual split keeps all records
       twin[1]);
+    // A usual split means the inserts are not purely sequential. Gradually forget.
+    twin[0]->sequential_splits_ = target_->get_sequential_splits() >> 1;
+    twin[1]->sequential_splits_ = target_->get_sequential_splits() >> 1;
   }
 
   // Now we will install the new pages. **From now on no error-return allowed**
@@ -136,7 +174,8 @@ ErrorCode SplitBorder::run(xct::SysxctWorkspace* sysxct_workspace) {
   assorted::memory_fence_release();
 
   watch.stop();
-  DVLOG(1) << "Costed " << watch.elapsed() << " cycles to split a page. original page physical"
+  DVLOG(1) << "Costed " << watch.elapsed() << " cycles to "
+    << (strategy.compact_records_ ? "compact" : "split") << " a page. original page physical"
     << " record count: " << static_cast<int>(key_count)
     << "->" << static_cast<int>(twin[0]->get_key_count())
     << " + " << static_cast<int>(twin[1]->get_key_count());
@@ -149,9 +188,21 @@ void SplitBorder::decide_strategy(SplitBorder::SplitStrategy* out) const {
   ASSERT_ND(key_count > 0);
   out->original_key_count_ = key_count;
   out->no_record_split_ = false;
+  out->compact_records_ = false;
+  out->reclaimable_until_ = context_->get_engine()->get_snapshot_manager()->get_snapshot_epoch();
   out->smallest_slice_ = target_->get_slice(0);
   out->largest_slice_ = target_->get_slice(0);
 
+  // if many records are deleted (or the page is fragmented), we don't need a new separator.
+  if (should_compact(out->reclaimable_until_)) {
+    DVLOG(1) << "Compacting a page instead of splitting. key_count=" << static_cast<int>(key_count);
+    out->compact_records_ = true;
+    out->smallest_slice_ = kInfimumSlice;
+    out->largest_slice_ = kSupremumSlice;
+    out->mid_slice_ = target_->get_low_fence();
+    return;
+  }
+
   // if consecutive_inserts_, we are already sure about the key distributions, so easy.
   if (target_->is_consecutive_inserts()) {
     out->largest_slice_ = target_->get_slice(key_count - 1);
@@ -178,6 +229,19 @@ void SplitBorder::decide_strategy(SplitBorder::SplitStrategy* out) const {
 
   ASSERT_ND(key_count >= 2U);  // because it's not consecutive, there must be at least 2 records.
 
+  // Not sorted, but this page came from a series of NRS and we are again appending at the end.
+  // The inserts are mostly sequential (eg a few threads appending in slightly different orders),
+  // so we should again leave a fresh page for them rather than two half-full pages.
+  if (!disable_no_record_split_
+    && trigger_ > out->largest_slice_
+    && target_->get_sequential_splits() > 0) {
+    out->no_record_split_ = true;
+    DVLOG(1) << "No record split on a mostly sequential page. key_count="
+      << static_cast<int>(key_count);
+    out->mid_slice_ = out->largest_slice_ + 1;
+    return;
+  }
+
   {
     // even if not, there is another easy case where two "tides" mix in this page;
     // one tide from left sequentially inserts keys while another tide from right also sequentially
@@ -301,6 +365,34 @@ void SplitBorder::decide_strategy(SplitBorder::SplitStrategy* out) const {
   }
 }
 
+bool SplitBorder::should_compact(Epoch reclaimable_until) const {
+  const SlotIndex key_count = target_->get_key_count();
+  SlotIndex kept_count = 0;
+  uint32_t kept_space = 0;
+  for (SlotIndex i = 0; i < key_count; ++i) {
+    const xct::XctId id = target_->get_owner_id(i)->xct_id_;
+    if (is_reclaimable_record(id, reclaimable_until)) {
+      continue;
+    }
+    ++kept_count;
+    // same as migrate_records(). next-layer records don't need suffixes.
+    const KeyLength remainder
+      = id.is_next_layer() ? kInitiallyNextLayer : target_->get_remainder_length(i);
+    kept_space += MasstreeBorderPage::required_data_space(
+      remainder,
+      target_->get_payload_length(i));
+  }
+
+  // The compacted page must have enough room, otherwise we will soon split it anyways.
+  if (kept_count * 2U > kBorderPageMaxSlots || kept_space * 2U > kBorderPageDataPartSize) {
+    return false;
+  }
+
+  // And compaction must reclaim a lot, otherwise it is just an expensive no-op.
+  const uint32_t used_space = target_->get_next_offset() + key_count * kBorderPageSlotSize;
+  return kept_count * 2U <= key_count || kept_space * 2U <= used_space;
+}
+
 ErrorCode SplitBorder::lock_existing_records(xct::SysxctWorkspace* sysxct_workspace) {
   debugging::RdtscWatch watch;  // check how expensive this is
   ASSERT_ND(target_->is_locked());
@@ -345,6 +437,7 @@ ErrorCode SplitBorder::lock_existing_records(xct::SysxctWorkspace* sysxct_worksp
 void SplitBorder::migrate_records(
   KeySlice inclusive_from,
   KeySlice inclusive_to,
+  Epoch reclaimable_until,
   MasstreeBorderPage* dest) const {
   ASSERT_ND(target_->is_locked());
   const auto& copy_from = *target_;
@@ -364,6 +457,10 @@ void SplitBorder::migrate_records(
   for (SlotIndex i = 0; i < key_count; ++i) {
     const KeySlice from_slice = copy_from.get_slice(i);
     if (from_slice >= inclusive_from && from_slice <= inclusive_to) {
+      // We have locked all records, so this is the final decision.
+      if (is_reclaimable_record(copy_from.get_owner_id(i)->xct_id_, reclaimable_until)) {
+        continue;
+      }
       // move this record.
       auto* to_slot = dest->get_new_slot(migrated_count);
       const auto* from_slot = copy_from.get_slot(i);
@@ -572,6 +572,61 @@ ErrorCode MasstreeStorage::increment_record_normalized(
     payload_offset);
 }
 
+template <typename PAYLOAD>
+ErrorCode MasstreeStorage::add_record(
+  thread::Thread* context,
+  const void* key,
+  KeyLength key_length,
+  PAYLOAD addendum,
+  PayloadLength payload_offset) {
+  // Automatically switch to faster implementation for 8-byte keys
+  if (key_length == sizeof(KeySlice)) {
+    KeySlice slice = normalize_be_bytes_full(key);
+    return add_record_normalized<PAYLOAD>(context, slice, addendum, payload_offset);
+  }
+
+  MasstreeStoragePimpl pimpl(this);
+  RecordLocation location;
+  CHECK_ERROR_CODE(pimpl.locate_record(
+    context,
+    key,
+    key_length,
+    true,
+    &location,
+    true));
+  return pimpl.add_general<PAYLOAD>(
+    context,
+    location,
+    key,
+    key_length,
+    addendum,
+    payload_offset);
+}
+
+template <typename PAYLOAD>
+ErrorCode MasstreeStorage::add_record_normalized(
+  thread::Thread* context,
+  KeySlice key,
+  PAYLOAD addendum,
+  PayloadLength payload_offset) {
+  MasstreeStoragePimpl pimpl(this);
+  RecordLocation location;
+  CHECK_ERROR_CODE(pimpl.locate_record_normalized(
+    context,
+    key,
+    true,
+    &location,
+    true));
+  uint64_t be_key = assorted::htobe<uint64_t>(key);
+  return pimpl.add_general<PAYLOAD>(
+    context,
+    location,
+    &be_key,
+    sizeof(be_key),
+    addendum,
+    payload_offset);
+}
+
 ErrorStack MasstreeStorage::verify_single_thread(thread::Thread* context) {
   return MasstreeStoragePimpl(this).verify_single_thread(context);
 }
@@ -654,6 +709,15 @@ INSTANTIATE_ALL_NUMERIC_TYPES(EXPIN_5);
 #define EXPIN_6(x) template ErrorCode MasstreeStorage::increment_record_normalized< x > \
   (thread::Thread* context, KeySlice key, x* value, PayloadLength payload_offset)
 INSTANTIATE_ALL_NUMERIC_TYPES(EXPIN_6);
+
+#define EXPIN_7(x) template ErrorCode MasstreeStorage::add_record< x > \
+  (thread::Thread* context, const void* key, KeyLength key_length, x addendum, \
+  PayloadLength payload_offset)
+INSTANTIATE_ALL_NUMERIC_TYPES(EXPIN_7);
+
+#define EXPIN_8(x) template ErrorCode MasstreeStorage::add_record_normalized< x > \
+  (thread::Thread* context, KeySlice key, x addendum, PayloadLength payload_offset)
+INSTANTIATE_ALL_NUMERIC_TYPES(EXPIN_8);
 // @endcond
 
 }  // namespace masstree
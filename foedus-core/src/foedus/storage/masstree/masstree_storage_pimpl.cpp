@@ -60,6 +60,20 @@ ErrorCode MasstreeStoragePimpl::get_first_root(
   bool for_write,
   MasstreeIntermediatePage** root) {
   DualPagePointer* root_pointer = get_first_root_pointer_address();
+  DualPagePointer pinned_root;
+  if (UNLIKELY(context->get_current_xct().is_pinned_to_snapshot())) {
+    CHECK_ERROR_CODE(engine_->get_storage_manager()->get_pinned_root_pointer(
+      context,
+      get_id(),
+      for_write,
+      &pinned_root));
+    if (pinned_root.snapshot_pointer_ == 0) {
+      // the storage was empty or did not exist as of the pinned snapshot
+      *root = nullptr;
+      return kErrorCodeOk;
+    }
+    root_pointer = &pinned_root;
+  }
   MasstreeIntermediatePage* page = nullptr;
   CHECK_ERROR_CODE(context->follow_page_pointer(
     nullptr,
@@ -252,7 +266,7 @@ inline ErrorCode MasstreeStoragePimpl::find_border_physical(
       uint8_t pointer_index = minipage.find_pointer(slice);
       DualPagePointer& pointer = minipage.pointers_[pointer_index];
       MasstreePage* next;
-      CHECK_ERROR_CODE(follow_page(context, for_writes, &pointer, &next));
+      CHECK_ERROR_CODE(follow_page(context, for_writes, &pointer, &next, page));
       next->prefetch_general();
       if (LIKELY(next->within_fences(slice))) {
         if (next->has_foster_child() && !cur->is_moved()) {
@@ -285,7 +299,8 @@ ErrorCode MasstreeStoragePimpl::locate_record(
   const void* key,
   KeyLength key_length,
   bool for_writes,
-  RecordLocation* result) {
+  RecordLocation* result,
+  bool physical_only) {
   ASSERT_ND(result);
   ASSERT_ND(key_length <= kMaxKeyLength);
   result->clear();
@@ -295,6 +310,9 @@ ErrorCode MasstreeStoragePimpl::locate_record(
     context,
     for_writes,
     reinterpret_cast<MasstreeIntermediatePage**>(&layer_root)));
+  if (UNLIKELY(layer_root == nullptr)) {
+    return kErrorCodeStrKeyNotFound;  // empty as of the pinned snapshot
+  }
   for (uint16_t current_layer = 0;; ++current_layer) {
     KeyLength remainder_length = key_length - current_layer * 8;
     KeySlice slice = slice_layer(key, key_length, current_layer);
@@ -326,6 +344,9 @@ ErrorCode MasstreeStoragePimpl::locate_record(
     if (border->does_point_to_layer(index)) {
       CHECK_ERROR_CODE(follow_layer(context, for_writes, border, index, &layer_root));
       continue;
+    } else if (physical_only) {
+      result->populate_protected(border, index);
+      return kErrorCodeOk;
     } else {
       CHECK_ERROR_CODE(result->populate_logical(cur_xct, border, index, for_writes));
       return kErrorCodeOk;
@@ -337,13 +358,17 @@ ErrorCode MasstreeStoragePimpl::locate_record_normalized(
   thread::Thread* context,
   KeySlice key,
   bool for_writes,
-  RecordLocation* result) {
+  RecordLocation* result,
+  bool physical_only) {
   ASSERT_ND(result);
   result->clear();
   xct::Xct* cur_xct = &context->get_current_xct();
   MasstreeBorderPage* border;
   MasstreeIntermediatePage* layer_root;
   CHECK_ERROR_CODE(get_first_root(context, for_writes, &layer_root));
+  if (UNLIKELY(layer_root == nullptr)) {
+    return kErrorCodeStrKeyNotFound;  // empty as of the pinned snapshot
+  }
   CHECK_ERROR_CODE(find_border_physical(context, layer_root, 0, for_writes, key, &border));
   SlotIndex index = border->find_key_normalized(0, border->get_key_count(), key);
   PageVersionStatus border_version = border->get_version().status_;
@@ -360,7 +385,11 @@ ErrorCode MasstreeStoragePimpl::locate_record_normalized(
   }
   // because this is just one slice, we never go to second layer
   ASSERT_ND(!border->does_point_to_layer(index));
-  CHECK_ERROR_CODE(result->populate_logical(cur_xct, border, index, for_writes));
+  if (physical_only) {
+    result->populate_protected(border, index);
+  } else {
+    CHECK_ERROR_CODE(result->populate_logical(cur_xct, border, index, for_writes));
+  }
   return kErrorCodeOk;
 }
 
@@ -368,7 +397,8 @@ ErrorCode MasstreeStoragePimpl::follow_page(
   thread::Thread* context,
   bool for_writes,
   storage::DualPagePointer* pointer,
-  MasstreePage** page) {
+  MasstreePage** page,
+  const MasstreeIntermediatePage* parent) {
   ASSERT_ND(!pointer->is_both_null());
   return context->follow_page_pointer(
     nullptr,  // masstree doesn't create a new page except splits.
@@ -377,8 +407,8 @@ ErrorCode MasstreeStoragePimpl::follow_page(
     true,
     pointer,
     reinterpret_cast<Page**>(page),
-    nullptr,  // only used for new page creation, so nothing to pass
-    -1);  // same as above
+    reinterpret_cast<const Page*>(parent),  // only to decide the snapshot read extent
+    -1);  // only used for new page creation, so nothing to pass
 }
 
 inline ErrorCode MasstreeStoragePimpl::follow_layer(
@@ -489,7 +519,8 @@ ErrorCode MasstreeStoragePimpl::reserve_record(
         suffix,
         physical_payload_hint,  // let's allocate conservatively
         get_meta().should_aggresively_create_next_layer(layer, remainder),
-        match.match_type_ == MasstreeBorderPage::kNotFound ? count : match.index_);
+        match.match_type_ == MasstreeBorderPage::kNotFound ? count : match.index_,
+        get_meta().border_early_split_threshold_);
       CHECK_ERROR_CODE(context->run_nested_sysxct(&reserve, 2U));
 
       // We might need to split the page
@@ -567,7 +598,8 @@ ErrorCode MasstreeStoragePimpl::reserve_record_normalized(
       nullptr,
       physical_payload_hint,
       false,
-      index == kBorderPageMaxSlots ? count : index);
+      index == kBorderPageMaxSlots ? count : index,
+      get_meta().border_early_split_threshold_);
     CHECK_ERROR_CODE(context->run_nested_sysxct(&reserve, 2U));
 
     if (reserve.out_split_needed_) {
@@ -838,6 +870,52 @@ ErrorCode MasstreeStoragePimpl::increment_general(
   return register_record_write_log(context, location, log_entry);
 }
 
+template <typename PAYLOAD>
+ErrorCode MasstreeStoragePimpl::add_general(
+  thread::Thread* context,
+  const RecordLocation& location,
+  const void* be_key,
+  KeyLength key_length,
+  PAYLOAD addendum,
+  PayloadLength payload_offset) {
+  // locate_record() didn't take read-set, so we can't return an error based on what we saw.
+  // In that case, observe it again with read-set, which protects the error.
+  RecordLocation logical;
+  const RecordLocation* target = &location;
+  if (UNLIKELY(location.observed_.is_deleted()
+    || location.page_->get_payload_length(location.index_) < payload_offset + sizeof(PAYLOAD))) {
+    CHECK_ERROR_CODE(logical.populate_logical(
+      &context->get_current_xct(),
+      location.page_,
+      location.index_,
+      true));
+    if (logical.observed_.is_deleted()) {
+      return kErrorCodeStrKeyNotFound;
+    }
+    target = &logical;
+  }
+  CHECK_ERROR_CODE(check_next_layer_bit(target->observed_));
+  MasstreeBorderPage* border = target->page_;
+  if (border->get_payload_length(target->index_) < payload_offset + sizeof(PAYLOAD)) {
+    LOG(WARNING) << "short record ";  // probably this is a rare error. so warn.
+    return kErrorCodeStrTooShortPayload;
+  }
+
+  // Unlike increment_general(), we don't read the current value. This is a blind write, and
+  // precommit checks MasstreeAddLogType::is_applicable() instead of verifying a read-set.
+  uint16_t log_length = MasstreeAddLogType::calculate_log_length(key_length, sizeof(PAYLOAD));
+  MasstreeAddLogType* log_entry = reinterpret_cast<MasstreeAddLogType*>(
+    context->get_thread_log_buffer().reserve_new_log(log_length));
+  log_entry->populate<PAYLOAD>(
+    get_id(),
+    be_key,
+    key_length,
+    addendum,
+    payload_offset);
+  border->header().stat_last_updater_node_ = context->get_numa_node();
+  return register_record_write_log(context, *target, log_entry);
+}
+
 // Defines MasstreeStorage methods so that we can inline implementation calls
 xct::TrackMovedRecordResult MasstreeStorage::track_moved_record(
   xct::RwLockableXctId* old_address,
@@ -862,6 +940,11 @@ inline xct::TrackMovedRecordResult MasstreeStoragePimpl::track_moved_record(
   (thread::Thread* context, const RecordLocation& location, \
   const void* be_key, KeyLength key_length, x* value, PayloadLength payload_offset)
 INSTANTIATE_ALL_NUMERIC_TYPES(EXPIN_5);
+
+#define EXPIN_7(x) template ErrorCode MasstreeStoragePimpl::add_general< x > \
+  (thread::Thread* context, const RecordLocation& location, \
+  const void* be_key, KeyLength key_length, x addendum, PayloadLength payload_offset)
+INSTANTIATE_ALL_NUMERIC_TYPES(EXPIN_7);
 // @endcond
 
 }  // namespace masstree
@@ -39,6 +39,9 @@ ErrorCode MasstreeStoragePimpl::prefetch_pages_normalized(
 
   MasstreeIntermediatePage* root_page;
   CHECK_ERROR_CODE(get_first_root(context, false, &root_page));
+  if (root_page == nullptr) {
+    return kErrorCodeOk;  // empty as of the pinned snapshot. nothing to prefetch
+  }
   prefetch_page_l2(root_page);
   CHECK_ERROR_CODE(prefetch_pages_normalized_recurse(context, vol_on, snp_on, from, to, root_page));
 
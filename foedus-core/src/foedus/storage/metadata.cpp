@@ -60,6 +60,18 @@ ErrorStack MetadataSerializer::load_base(tinyxml2::XMLElement* element) {
     element,
     "snapshot_keep_threshold_",
     &data_->snapshot_thresholds_.snapshot_keep_threshold_));
+  CHECK_ERROR(get_element(
+    element,
+    "snapshot_read_extent_",
+    &data_->snapshot_thresholds_.snapshot_read_extent_,
+    true,
+    0U));
+  CHECK_ERROR(get_element(
+    element,
+    "last_snapshot_epoch_",
+    &data_->last_snapshot_epoch_,
+    true,
+    static_cast<Epoch::EpochInteger>(Epoch::kEpochInvalid)));
   return kRetOk;
 }
 
@@ -78,6 +90,12 @@ ErrorStack MetadataSerializer::save_base(tinyxml2::XMLElement* element) const {
     "snapshot_keep_threshold_",
     "",
     data_->snapshot_thresholds_.snapshot_keep_threshold_));
+  CHECK_ERROR(add_element(
+    element,
+    "snapshot_read_extent_",
+    "",
+    data_->snapshot_thresholds_.snapshot_read_extent_));
+  CHECK_ERROR(add_element(element, "last_snapshot_epoch_", "", data_->last_snapshot_epoch_));
   return kRetOk;
 }
 
@@ -93,6 +93,7 @@ struct StreamStatus {
   }
   ErrorCode wind_stream() {
     CHECK_ERROR_CODE(stream_->wind(cur_absolute_pos_));
+    buffer_ = stream_->get_buffer();
     cur_relative_pos_ = stream_->to_relative_pos(cur_absolute_pos_);
     return kErrorCodeOk;
   }
@@ -21,11 +21,14 @@
 
 #include <algorithm>
 #include <ostream>
+#include <vector>
 
 #include "foedus/assert_nd.hpp"
 #include "foedus/engine.hpp"
+#include "foedus/assorted/assorted_func.hpp"
 #include "foedus/savepoint/savepoint_manager.hpp"
 #include "foedus/snapshot/snapshot_manager.hpp"
+#include "foedus/storage/storage_manager.hpp"
 #include "foedus/storage/sequential/sequential_page_impl.hpp"
 #include "foedus/storage/sequential/sequential_storage_pimpl.hpp"
 #include "foedus/thread/thread.hpp"
@@ -47,6 +50,39 @@ Epoch max_from_epoch_snapshot_epoch(Epoch from_epoch, Epoch latest_snapshot_epoc
   }
 }
 
+/** Root snapshot page of the storage in the snapshot the transaction reads, or 0 if none */
+ErrorCode read_root_snapshot_page_id(
+  thread::Thread* context,
+  const SequentialStorage& storage,
+  SnapshotPagePointer* out) {
+  *out = storage.get_metadata()->root_snapshot_page_id_;
+  if (context->get_current_xct().is_pinned_to_snapshot()) {
+    // the metadata might already point to a newer snapshot
+    DualPagePointer pinned_root;
+    CHECK_ERROR_CODE(context->get_engine()->get_storage_manager()->get_pinned_root_pointer(
+      context,
+      storage.get_id(),
+      false,
+      &pinned_root));
+    *out = pinned_root.snapshot_pointer_;
+  }
+  return kErrorCodeOk;
+}
+
+SequentialScanPartition whole_scan_partition(int32_t node_filter) {
+  SequentialScanPartition partition;
+  partition.node_ = node_filter >= 0 ? node_filter : 0;
+  partition.volatile_thread_begin_ = 0;
+  partition.volatile_thread_end_ = 0xFFFFU;
+  partition.designed_ = 0;
+  partition.snapshot_epoch_ = Epoch::kEpochInvalid;
+  partition.truncate_epoch_ = Epoch::kEpochInvalid;
+  partition.root_snapshot_page_id_ = 0;
+  partition.snapshot_page_begin_ = 0;
+  partition.snapshot_page_end_ = kSequentialScanAllPages;
+  return partition;
+}
+
 SequentialCursor::SequentialCursor(
   thread::Thread* context,
   const SequentialStorage& storage,
@@ -56,6 +92,48 @@ SequentialCursor::SequentialCursor(
   Epoch from_epoch,
   Epoch to_epoch,
   int32_t node_filter)
+  : SequentialCursor(
+      context,
+      storage,
+      buffer,
+      buffer_size,
+      order_mode,
+      from_epoch,
+      to_epoch,
+      node_filter,
+      whole_scan_partition(node_filter)) {
+}
+
+SequentialCursor::SequentialCursor(
+  thread::Thread* context,
+  const SequentialStorage& storage,
+  void* buffer,
+  uint64_t buffer_size,
+  const SequentialScanPartition& partition,
+  Epoch from_epoch,
+  Epoch to_epoch)
+  : SequentialCursor(
+      context,
+      storage,
+      buffer,
+      buffer_size,
+      kNodeFirstMode,
+      from_epoch,
+      to_epoch,
+      partition.node_,
+      partition) {
+}
+
+SequentialCursor::SequentialCursor(
+  thread::Thread* context,
+  const SequentialStorage& storage,
+  void* buffer,
+  uint64_t buffer_size,
+  OrderMode order_mode,
+  Epoch from_epoch,
+  Epoch to_epoch,
+  int32_t node_filter,
+  const SequentialScanPartition& partition)
   : context_(context),
     xct_(&context->get_current_xct()),
     engine_(context->get_engine()),
@@ -65,9 +143,14 @@ SequentialCursor::SequentialCursor(
       from_epoch.is_valid() ? from_epoch : engine_->get_savepoint_manager()->get_earliest_epoch()),
     to_epoch_(
       to_epoch.is_valid() ? to_epoch : engine_->get_xct_manager()->get_current_grace_epoch()),
-    latest_snapshot_epoch_(engine_->get_snapshot_manager()->get_snapshot_epoch()),
+    latest_snapshot_epoch_(
+      xct_->is_pinned_to_snapshot()
+        ? xct_->get_pinned_snapshot_epoch()
+        : engine_->get_snapshot_manager()->get_snapshot_epoch()),
     from_epoch_volatile_(max_from_epoch_snapshot_epoch(from_epoch_, latest_snapshot_epoch_)),
+    filter_(nullptr),
     node_filter_(node_filter),
+    partition_(partition),
     node_count_(engine_->get_soc_count()),
     order_mode_(order_mode),
     buffer_(reinterpret_cast<SequentialRecordBatch*>(buffer)),
@@ -86,6 +169,7 @@ SequentialCursor::SequentialCursor(
   ASSERT_ND(from_epoch_ <= to_epoch_);
 
   if (xct_->get_isolation_level() == xct::kSnapshot
+    || xct_->is_pinned_to_snapshot()
     || (latest_snapshot_epoch_.is_valid() && to_epoch_ <= latest_snapshot_epoch_)) {
     snapshot_only_ = true;
     safe_epoch_only_ = true;
@@ -115,6 +199,69 @@ SequentialCursor::~SequentialCursor() {
   states_.clear();
 }
 
+ErrorCode SequentialCursor::design_scan_partitions(
+  thread::Thread* context,
+  const SequentialStorage& storage,
+  uint16_t partitions_per_node,
+  std::vector<SequentialScanPartition>* out) {
+  ASSERT_ND(partitions_per_node > 0);
+  out->clear();
+  Engine* engine = context->get_engine();
+  const uint16_t node_count = engine->get_soc_count();
+  const uint16_t thread_per_node = engine->get_options().thread_.thread_count_per_group_;
+
+  // the storage image the partitions are designed for. see SequentialScanPartition
+  const xct::Xct& current_xct = context->get_current_xct();
+  const Epoch snapshot_epoch
+    = current_xct.is_pinned_to_snapshot()
+      ? current_xct.get_pinned_snapshot_epoch()
+      : engine->get_snapshot_manager()->get_snapshot_epoch();
+  const Epoch truncate_epoch = storage.get_truncate_epoch();
+  SnapshotPagePointer root_snapshot_page_id = 0;
+
+  // count snapshot pages in each node. we don't care epochs here. cursors filter them later.
+  std::vector<uint64_t> node_pages(node_count, 0);
+  if (snapshot_epoch.is_valid()) {
+    CHECK_ERROR_CODE(read_root_snapshot_page_id(context, storage, &root_snapshot_page_id));
+    for (SnapshotPagePointer next_page_id = root_snapshot_page_id; next_page_id != 0;) {
+      SequentialRootPage* page;
+      CHECK_ERROR_CODE(context->find_or_read_a_snapshot_page(
+        next_page_id,
+        reinterpret_cast<Page**>(&page)));
+      for (uint16_t i = 0; i < page->get_pointer_count(); ++i) {
+        const HeadPagePointer& pointer = page->get_pointers()[i];
+        uint16_t node_id = extract_numa_node_from_snapshot_pointer(pointer.page_id_);
+        ASSERT_ND(node_id < node_count);
+        node_pages[node_id] += pointer.page_count_;
+      }
+      next_page_id = page->get_next_page();
+    }
+  }
+
+  for (uint16_t node_id = 0; node_id < node_count; ++node_id) {
+    for (uint16_t i = 0; i < partitions_per_node; ++i) {
+      SequentialScanPartition partition;
+      partition.node_ = node_id;
+      partition.volatile_thread_begin_ = thread_per_node * i / partitions_per_node;
+      partition.volatile_thread_end_ = thread_per_node * (i + 1U) / partitions_per_node;
+      partition.designed_ = 1;
+      partition.snapshot_epoch_ = snapshot_epoch.value();
+      partition.truncate_epoch_ = truncate_epoch.value();
+      partition.root_snapshot_page_id_ = root_snapshot_page_id;
+      partition.snapshot_page_begin_ = node_pages[node_id] * i / partitions_per_node;
+      if (i + 1U == partitions_per_node) {
+        partition.snapshot_page_end_ = kSequentialScanAllPages;
+      } else {
+        partition.snapshot_page_end_ = node_pages[node_id] * (i + 1U) / partitions_per_node;
+      }
+      out->push_back(partition);
+    }
+    DVLOG(0) << "Designed " << partitions_per_node << " scan partitions for node-" << node_id
+      << ". snapshot_pages=" << node_pages[node_id];
+  }
+  return kErrorCodeOk;
+}
+
 SequentialCursor::NodeState::NodeState(uint16_t node_id) : node_id_(node_id) {
   volatile_cur_core_ = 0;
   snapshot_cur_head_ = 0;
@@ -126,6 +273,7 @@ SequentialCursor::NodeState::~NodeState() {}
 
 SequentialRecordIterator::SequentialRecordIterator()
   : batch_(nullptr),
+    filter_(nullptr),
     from_epoch_(INVALID_EPOCH),
     to_epoch_(INVALID_EPOCH),
     record_count_(0) {
@@ -134,13 +282,16 @@ SequentialRecordIterator::SequentialRecordIterator()
   cur_offset_ = 0;
   cur_record_epoch_ = INVALID_EPOCH;
   stat_skipped_records_ = 0;
+  stat_filtered_records_ = 0;
 }
 
 SequentialRecordIterator::SequentialRecordIterator(
   const SequentialRecordBatch* batch,
   Epoch from_epoch,
-  Epoch to_epoch)
+  Epoch to_epoch,
+  const RecordFilter* filter)
   : batch_(batch),
+    filter_(filter),
     from_epoch_(from_epoch),
     to_epoch_(to_epoch),
     record_count_(batch->get_record_count()) {
@@ -150,9 +301,13 @@ SequentialRecordIterator::SequentialRecordIterator(
   cur_record_epoch_ = batch->get_epoch_from_offset(0);
   ASSERT_ND(cur_record_epoch_.is_valid());
   stat_skipped_records_ = 0;
+  stat_filtered_records_ = 0;
   if (!in_epoch_range(cur_record_epoch_)) {
     ++stat_skipped_records_;
     next();
+  } else if (filter_ && !filter_->evaluate(get_cur_record_raw(), cur_record_length_)) {
+    ++stat_filtered_records_;
+    next();
   }
 }
 
@@ -202,6 +357,24 @@ ErrorCode SequentialCursor::next_batch(SequentialRecordIterator* out) {
   return kErrorCodeOk;
 }
 
+ErrorCode SequentialCursor::check_partition(SnapshotPagePointer root_snapshot_page_id) const {
+  if (!partition_.designed_) {
+    return kErrorCodeOk;
+  }
+  if (partition_.root_snapshot_page_id_ != root_snapshot_page_id
+    || partition_.snapshot_epoch_ != latest_snapshot_epoch_.value()
+    || partition_.truncate_epoch_ != truncate_epoch_.value()) {
+    LOG(INFO) << "The scan partition is stale. Designed for snapshot_epoch="
+      << Epoch(partition_.snapshot_epoch_) << ", truncate_epoch="
+      << Epoch(partition_.truncate_epoch_) << ", root_snapshot_page_id="
+      << assorted::Hex(partition_.root_snapshot_page_id_) << ". Now snapshot_epoch="
+      << latest_snapshot_epoch_ << ", truncate_epoch=" << truncate_epoch_
+      << ", root_snapshot_page_id=" << assorted::Hex(root_snapshot_page_id);
+    return kErrorCodeStrSequentialScanPartitionStale;
+  }
+  return kErrorCodeOk;
+}
+
 ErrorCode SequentialCursor::init_states() {
   DVLOG(0) << "Initializing states...";
   DVLOG(1) << *this;
@@ -220,17 +393,25 @@ ErrorCode SequentialCursor::init_states() {
     from_epoch_ = truncate_epoch_;
   }
 
+  SnapshotPagePointer root_snapshot_page_id = 0;
+  if (latest_snapshot_epoch_.is_valid()) {
+    CHECK_ERROR_CODE(read_root_snapshot_page_id(context_, storage_, &root_snapshot_page_id));
+  }
+  CHECK_ERROR_CODE(check_partition(root_snapshot_page_id));
+
   // initialize snapshot page status
   if (!finished_snapshots_) {
     ASSERT_ND(latest_snapshot_epoch_.is_valid());
-    SnapshotPagePointer root_snapshot_page_id = storage_.get_metadata()->root_snapshot_page_id_;
 
     // read all entries from all root pages
     uint64_t too_old_pointers = 0;
     uint64_t too_new_pointers = 0;
     uint64_t node_filtered_pointers = 0;
+    uint64_t partition_filtered_pointers = 0;
     uint64_t added_pointers = 0;
     uint32_t page_count = 0;
+    // ordinals of snapshot pages in each node. see SequentialScanPartition
+    std::vector<uint64_t> node_page_ordinals(node_count_, 0);
     for (SnapshotPagePointer next_page_id = root_snapshot_page_id; next_page_id != 0;) {
       ASSERT_ND(next_page_id != 0);
       ++page_count;
@@ -243,6 +424,10 @@ ErrorCode SequentialCursor::init_states() {
         ASSERT_ND(pointer.from_epoch_.is_valid());
         ASSERT_ND(pointer.to_epoch_.is_valid());
         uint16_t numa_node = extract_numa_node_from_snapshot_pointer(pointer.page_id_);
+        ASSERT_ND(numa_node < node_count_);
+        const uint64_t ordinal_begin = node_page_ordinals[numa_node];
+        const uint64_t ordinal_end = ordinal_begin + pointer.page_count_;
+        node_page_ordinals[numa_node] = ordinal_end;
         if (pointer.from_epoch_ >= to_epoch_) {
           ++too_new_pointers;
           continue;
@@ -252,11 +437,23 @@ ErrorCode SequentialCursor::init_states() {
         } else if (node_filter_ >= 0 && numa_node != static_cast<uint32_t>(node_filter_)) {
           ++node_filtered_pointers;
           continue;
+        } else if (ordinal_end <= partition_.snapshot_page_begin_
+          || ordinal_begin >= partition_.snapshot_page_end_) {
+          ++partition_filtered_pointers;
+          continue;
         } else {
           ++added_pointers;
-          uint16_t node_id = extract_numa_node_from_snapshot_pointer(pointer.page_id_);
-          ASSERT_ND(node_id < node_count_);
-          states_[node_id].snapshot_heads_.push_back(pointer);
+          // the partition might cover only a part of the contiguous pages
+          HeadPagePointer trimmed = pointer;
+          uint64_t skipped = 0;
+          if (ordinal_begin < partition_.snapshot_page_begin_) {
+            skipped = partition_.snapshot_page_begin_ - ordinal_begin;
+          }
+          uint64_t end = std::min<uint64_t>(ordinal_end, partition_.snapshot_page_end_);
+          trimmed.page_id_ += skipped;
+          trimmed.page_count_ = end - ordinal_begin - skipped;
+          ASSERT_ND(trimmed.page_count_ > 0);
+          states_[numa_node].snapshot_heads_.push_back(trimmed);
         }
       }
       next_page_id = page->get_next_page();
@@ -264,7 +461,8 @@ ErrorCode SequentialCursor::init_states() {
 
     DVLOG(0) << "Read " << page_count << " root snapshot pages. added_pointers=" << added_pointers
       << ", too_old_pointers=" << too_old_pointers << ", too_new_pointers=" << too_new_pointers
-      << ", node_filtered_pointers=" << node_filtered_pointers;
+      << ", node_filtered_pointers=" << node_filtered_pointers
+      << ", partition_filtered_pointers=" << partition_filtered_pointers;
     if (added_pointers == 0) {
       finished_snapshots_ = true;
     }
@@ -284,6 +482,12 @@ ErrorCode SequentialCursor::init_states() {
       }
       NodeState& state = states_[node_id];
       for (uint16_t thread_ordinal = 0; thread_ordinal < thread_per_node; ++thread_ordinal) {
+        if (thread_ordinal < partition_.volatile_thread_begin_
+          || thread_ordinal >= partition_.volatile_thread_end_) {
+          ++empty_threads;
+          state.volatile_cur_pages_.push_back(nullptr);
+          continue;
+        }
         thread::ThreadId thread_id = thread::compose_thread_id(node_id, thread_ordinal);
         memory::PagePoolOffset offset = *pimpl.get_head_pointer(thread_id);
         if (offset == 0) {
@@ -339,7 +543,11 @@ ErrorCode SequentialCursor::next_batch_snapshot(
 
     // okay, we have a page to return
     ASSERT_ND(state.snapshot_cur_buffer_ < state.snapshot_buffered_pages_);
-    *out = SequentialRecordIterator(buffer_ + state.snapshot_cur_buffer_, from_epoch_, to_epoch_);
+    *out = SequentialRecordIterator(
+      buffer_ + state.snapshot_cur_buffer_,
+      from_epoch_,
+      to_epoch_,
+      filter_);
     *found = true;
     ++state.snapshot_cur_buffer_;
     return kErrorCodeOk;
@@ -407,8 +615,13 @@ ErrorCode SequentialCursor::buffer_snapshot_pages(uint16_t node) {
     ASSERT_ND(p->header_.get_page_type() == kSequentialPageType);
     ASSERT_ND(p->next_page_.volatile_pointer_.is_null());
     // Q: "Why +1?". A: For ex., think about the case where page_count_ == 1.
-    if (i + state.snapshot_buffer_begin_ + 1U == head.page_count_) {
+    if (i + state.snapshot_buffer_begin_ + 1U == head.page_count_
+      && partition_.snapshot_page_end_ == kSequentialScanAllPages) {
       ASSERT_ND(p->next_page_.snapshot_pointer_ == 0);
+    } else if (i + state.snapshot_buffer_begin_ + 1U == head.page_count_) {
+      // the head might be trimmed by the partition
+      ASSERT_ND(p->next_page_.snapshot_pointer_ == 0
+        || p->next_page_.snapshot_pointer_ == page_id_begin + i + 1U);
     } else {
       ASSERT_ND(p->next_page_.snapshot_pointer_ == page_id_begin + i + 1U);
     }
@@ -501,7 +714,8 @@ ErrorCode SequentialCursor::next_batch_safe_volatiles(
           *out = SequentialRecordIterator(
             reinterpret_cast<SequentialRecordBatch*>(page),
             from_epoch_volatile_,
-            to_epoch_);
+            to_epoch_,
+            filter_);
           *found = true;
           return kErrorCodeOk;
         }
@@ -622,7 +836,8 @@ ErrorCode SequentialCursor::next_batch_unsafe_volatiles(
         *out = SequentialRecordIterator(
           reinterpret_cast<SequentialRecordBatch*>(page),
           from_epoch_volatile_,
-          to_epoch_);
+          to_epoch_,
+          filter_);
         *found = true;
         return kErrorCodeOk;
       }
@@ -656,6 +871,11 @@ std::ostream& operator<<(std::ostream& o, const SequentialCursor& v) {
   o << "  <to_epoch>" << v.get_to_epoch() << "</to_epoch>" << std::endl;
   o << "  <order_mode>" << v.order_mode_ << "</order_mode>" << std::endl;
   o << "  <node_filter>" << v.node_filter_ << "</node_filter>" << std::endl;
+  o << "  <partition volatile_thread_begin_=\"" << v.partition_.volatile_thread_begin_
+    << "\" volatile_thread_end_=\"" << v.partition_.volatile_thread_end_
+    << "\" snapshot_page_begin_=\"" << v.partition_.snapshot_page_begin_
+    << "\" snapshot_page_end_=\"" << v.partition_.snapshot_page_end_
+    << "\" />" << std::endl;
   o << "  <snapshot_only_>" << v.snapshot_only_ << "</snapshot_only_>" << std::endl;
   o << "  <safe_epoch_only_>" << v.safe_epoch_only_ << "</safe_epoch_only_>" << std::endl;
   o << "  <buffer_>" << v.buffer_ << "</buffer_>" << std::endl;
@@ -73,6 +73,39 @@ ErrorCode SequentialStorage::append_record(
   return context->get_current_xct().add_to_lock_free_write_set(get_id(), log_entry);
 }
 
+ErrorCode SequentialStorage::append_records(
+  thread::Thread* context,
+  const void* const* payloads,
+  const uint16_t* payload_counts,
+  uint32_t record_count) {
+  xct::Xct& cur_xct = context->get_current_xct();
+  if (!cur_xct.is_active()) {
+    return kErrorCodeXctNoXct;
+  }
+  // Check everything first so that we don't leave a partial batch in the write-set.
+  for (uint32_t i = 0; i < record_count; ++i) {
+    if (payload_counts[i] == 0 || payloads[i] == nullptr) {
+      return kErrorCodeInvalidParameter;
+    } else if (payload_counts[i] >= kMaxPayload) {
+      return kErrorCodeStrTooLongPayload;
+    }
+  }
+  if (UNLIKELY(cur_xct.get_lock_free_write_set_size() + record_count
+      > cur_xct.get_max_lock_free_write_set_size())) {
+    return kErrorCodeXctWriteSetOverflow;
+  }
+
+  log::ThreadLogBuffer& log_buffer = context->get_thread_log_buffer();
+  for (uint32_t i = 0; i < record_count; ++i) {
+    uint16_t log_length = SequentialAppendLogType::calculate_log_length(payload_counts[i]);
+    SequentialAppendLogType* log_entry = reinterpret_cast<SequentialAppendLogType*>(
+      log_buffer.reserve_new_log(log_length));
+    log_entry->populate(get_id(), payloads[i], payload_counts[i]);
+    CHECK_ERROR_CODE(cur_xct.add_to_lock_free_write_set(get_id(), log_entry));
+  }
+  return kErrorCodeOk;
+}
+
 void SequentialStorage::apply_append_record(
   thread::Thread* context,
   const SequentialAppendLogType* log_entry) {
@@ -186,6 +219,7 @@ ErrorStack SequentialStoragePimpl::load(const StorageControlBlock& snapshot_bloc
   return kRetOk;
 }
 ErrorStack SequentialStoragePimpl::initialize_head_tail_pages() {
+  control_block_->truncate_lock_.reset();
   std::memset(control_block_->head_pointer_pages_, 0, sizeof(control_block_->head_pointer_pages_));
   std::memset(control_block_->tail_pointer_pages_, 0, sizeof(control_block_->tail_pointer_pages_));
   // we pre-allocate pointer pages for all required nodes.
@@ -259,8 +293,7 @@ ErrorStack SequentialStoragePimpl::truncate(Epoch new_truncate_epoch, Epoch* com
 
   // We lock it first so that there are no concurrent truncate.
   {
-    // TODO(Hideaki) Ownerless-lock here
-    // xct::McsOwnerlessLockScope scope(&control_block_->cur_truncate_epoch_tid_);
+    xct::McsOwnerlessLockScope scope(&control_block_->truncate_lock_);
 
     if (Epoch(control_block_->cur_truncate_epoch_) >= new_truncate_epoch) {
       LOG(INFO) << "Already truncated up to " << Epoch(control_block_->cur_truncate_epoch_)
@@ -326,7 +359,6 @@ void SequentialStoragePimpl::append_record(
   const void* payload,
   uint16_t payload_count) {
   thread::ThreadId thread_id = context->get_thread_id();
-  thread::ThreadGroupId node = context->get_numa_node();
 
   // the list is local to this core, so no race possible EXCEPT scanning thread
   // and snapshot thread, but they are read-only or only dropping pages.
@@ -342,31 +374,7 @@ void SequentialStoragePimpl::append_record(
       // note: we make sure no volatile page has records from two epochs.
       // this makes us easy to drop volatile pages after snapshotting.
       (tail->get_record_count() > 0 && tail->get_first_record_epoch() != owner_id.get_epoch())) {
-    memory::PagePoolOffset new_page_offset
-      = context->get_thread_memory()->grab_free_volatile_page();
-    if (UNLIKELY(new_page_offset == 0)) {
-      LOG(FATAL) << " Unexpected error. we ran out of free page while inserting to sequential"
-        " storage after commit.";
-    }
-    VolatilePagePointer new_page_pointer;
-    new_page_pointer.set(node, new_page_offset);
-    SequentialPage* new_page = reinterpret_cast<SequentialPage*>(
-      context->get_local_volatile_page_resolver().resolve_offset_newpage(new_page_offset));
-    new_page->initialize_volatile_page(get_id(), new_page_pointer);
-
-    if (tail == nullptr) {
-      // this is the first access to this head pointer. Let's install the first page.
-      ASSERT_ND(*tail_pointer == 0);
-      memory::PagePoolOffset* head_pointer = get_head_pointer(thread_id);
-      ASSERT_ND(*head_pointer == 0);
-      *head_pointer = new_page_offset;
-      *tail_pointer = new_page_offset;
-    } else {
-      ASSERT_ND(*get_head_pointer(thread_id) != 0);
-      *tail_pointer = new_page_offset;
-      tail->next_page().volatile_pointer_ = new_page_pointer;
-    }
-    tail = new_page;
+    tail = install_new_tail_page(context, tail, tail_pointer);
   }
 
   ASSERT_ND(tail &&
@@ -375,6 +383,41 @@ void SequentialStoragePimpl::append_record(
   tail->append_record_nosync(owner_id, payload_count, payload);
 }
 
+SequentialPage* SequentialStoragePimpl::install_new_tail_page(
+  thread::Thread* context,
+  SequentialPage* cur_tail,
+  memory::PagePoolOffset* tail_pointer) {
+  thread::ThreadId thread_id = context->get_thread_id();
+  thread::ThreadGroupId node = context->get_numa_node();
+  memory::PagePoolOffset new_page_offset
+    = context->get_thread_memory()->grab_free_volatile_page();
+  if (UNLIKELY(new_page_offset == 0)) {
+    LOG(FATAL) << " Unexpected error. we ran out of free page while inserting to sequential"
+      " storage after commit.";
+  }
+  VolatilePagePointer new_page_pointer;
+  new_page_pointer.set(node, new_page_offset);
+  SequentialPage* new_page = reinterpret_cast<SequentialPage*>(
+    context->get_local_volatile_page_resolver().resolve_offset_newpage(new_page_offset));
+  new_page->initialize_volatile_page(get_id(), new_page_pointer);
+
+  // The page must be fully initialized before scanners can reach it.
+  assorted::memory_fence_release();
+  if (cur_tail == nullptr) {
+    // this is the first access to this head pointer. Let's install the first page.
+    ASSERT_ND(*tail_pointer == 0);
+    memory::PagePoolOffset* head_pointer = get_head_pointer(thread_id);
+    ASSERT_ND(*head_pointer == 0);
+    *head_pointer = new_page_offset;
+    *tail_pointer = new_page_offset;
+  } else {
+    ASSERT_ND(*get_head_pointer(thread_id) != 0);
+    *tail_pointer = new_page_offset;
+    cur_tail->next_page().volatile_pointer_.word = new_page_pointer.word;
+  }
+  return new_page;
+}
+
 memory::PagePoolOffset* SequentialStoragePimpl::get_head_pointer(thread::ThreadId thread_id) const {
   ASSERT_ND(thread::decompose_numa_node(thread_id) < engine_->get_options().thread_.group_count_);
   ASSERT_ND(thread::decompose_numa_local_ordinal(thread_id)
@@ -56,6 +56,17 @@ StorageId StorageManager::get_largest_storage_id() {
   return pimpl_->control_block_->largest_storage_id_;
 }
 
+void StorageManager::remember_snapshot_roots(Epoch snapshot_epoch) {
+  pimpl_->remember_snapshot_roots(snapshot_epoch);
+}
+ErrorCode StorageManager::get_pinned_root_pointer(
+  thread::Thread* context,
+  StorageId id,
+  bool for_write,
+  DualPagePointer* out) {
+  return pimpl_->get_pinned_root_pointer(context, id, for_write, out);
+}
+
 const StorageName kEmptyString;
 const StorageName& StorageManager::get_name(StorageId id) {
   StorageControlBlock* block = get_storage(id);
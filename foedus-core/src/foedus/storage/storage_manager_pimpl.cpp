@@ -41,6 +41,7 @@
 #include "foedus/soc/soc_manager.hpp"
 #include "foedus/storage/metadata.hpp"
 #include "foedus/storage/partitioner.hpp"
+#include "foedus/storage/snapshot_root_history.hpp"
 #include "foedus/storage/storage.hpp"
 #include "foedus/storage/storage_log_types.hpp"
 #include "foedus/storage/storage_options.hpp"
@@ -56,7 +57,9 @@
 #include "foedus/storage/sequential/sequential_log_types.hpp"
 #include "foedus/storage/sequential/sequential_metadata.hpp"
 #include "foedus/storage/sequential/sequential_storage.hpp"
+#include "foedus/thread/thread.hpp"
 #include "foedus/thread/thread_pool.hpp"
+#include "foedus/xct/xct.hpp"
 #include "foedus/xct/xct_manager.hpp"
 
 namespace foedus {
@@ -73,17 +76,28 @@ ErrorStack StorageManagerPimpl::initialize_once() {
     return ERROR_STACK(kErrorCodeDepedentModuleUnavailableInit);
   }
 
+  const uint16_t history_size = engine_->get_options().storage_.snapshot_root_history_size_;
+  if (history_size == 0 || history_size > SnapshotRootHistory::kMaxSlots) {
+    LOG(ERROR) << "StorageOptions::snapshot_root_history_size_ must be 1 to "
+      << SnapshotRootHistory::kMaxSlots << ": " << history_size;
+    return ERROR_STACK(kErrorCodeConfValueOutofrange);
+  }
+
   // attach shared memories
   soc::GlobalMemoryAnchors* anchors
     = engine_->get_soc_manager()->get_shared_memory_repo()->get_global_memory_anchors();
   control_block_ = anchors->storage_manager_memory_;
   storages_ = anchors->storage_memories_;
   storage_name_sort_ = anchors->storage_name_sort_memory_;
+  snapshot_root_histories_ = anchors->snapshot_root_history_memory_;
 
   if (engine_->is_master()) {
     // initialize the shared memory. only on master engine
     control_block_->initialize();
     control_block_->largest_storage_id_ = 0;
+    for (uint32_t id = 0; id < get_max_storages(); ++id) {
+      snapshot_root_histories_[id].initialize(history_size);
+    }
 
     // Then, initialize storages with latest snapshot
     CHECK_ERROR(initialize_read_latest_snapshot());
@@ -145,6 +159,7 @@ ErrorStack StorageManagerPimpl::initialize_read_latest_snapshot() {
       ++active_storages;
     }
   }
+  remember_snapshot_roots(engine_->get_savepoint_manager()->get_latest_snapshot_epoch());
   stop_watch.stop();
   LOG(INFO) << "Found " << active_storages
     << " active storages  in " << stop_watch.elapsed_ms() << " milliseconds";
@@ -232,6 +247,58 @@ ErrorStack StorageManagerPimpl::uninitialize_once() {
   return SUMMARIZE_ERROR_BATCH(batch);
 }
 
+void StorageManagerPimpl::remember_snapshot_roots(Epoch snapshot_epoch) {
+  ASSERT_ND(engine_->is_master());
+  ASSERT_ND(snapshot_epoch.is_valid());
+  // StorageId 0 is never used, so its history remembers which snapshots we remember.
+  // Install it first so that it never remembers a snapshot some storage has forgotten.
+  snapshot_root_histories_[0].install(snapshot_epoch, 0, snapshot_epoch);
+  const StorageId largest_storage_id = control_block_->largest_storage_id_;
+  for (StorageId id = 1; id <= largest_storage_id; ++id) {
+    const StorageControlBlock* block = storages_ + id;
+    if (block->exists()) {
+      snapshot_root_histories_[id].install(
+        snapshot_epoch,
+        block->root_page_pointer_.snapshot_pointer_,
+        Epoch(block->meta_.last_snapshot_epoch_));
+    }
+  }
+}
+
+ErrorCode StorageManagerPimpl::get_pinned_root_pointer(
+  thread::Thread* context,
+  StorageId id,
+  bool for_write,
+  DualPagePointer* out) {
+  const xct::Xct& current_xct = context->get_current_xct();
+  ASSERT_ND(current_xct.is_pinned_to_snapshot());
+  if (UNLIKELY(for_write)) {
+    return kErrorCodeXctPinnedSnapshotReadOnly;
+  }
+  ASSERT_ND(id > 0 && id < get_max_storages());
+  out->volatile_pointer_.clear();
+  const Epoch pinned_epoch = current_xct.get_pinned_snapshot_epoch();
+  Epoch root_epoch;
+  if (!snapshot_root_histories_[id].find(pinned_epoch, &out->snapshot_pointer_, &root_epoch)) {
+    // Either the pinned snapshot is too old, or the storage did not exist as of the snapshot.
+    // The history of StorageId 0 forgets a snapshot before any storage does, so if it still
+    // remembers the snapshot, the storage did not exist in it. Not an error, just empty.
+    SnapshotPagePointer dummy_root;
+    if (!snapshot_root_histories_[0].find(pinned_epoch, &dummy_root, &root_epoch)) {
+      return kErrorCodeXctPinnedSnapshotExpired;
+    }
+    out->snapshot_pointer_ = 0;
+    return kErrorCodeOk;
+  }
+  if (root_epoch.is_valid() && root_epoch < pinned_epoch) {
+    // The snapshot deferred this storage. Its root misses some logs up to the pinned epoch,
+    // so reading it would mix an older image of this storage with other storages.
+    out->snapshot_pointer_ = 0;
+    return kErrorCodeXctPinnedSnapshotDeferred;
+  }
+  return kErrorCodeOk;
+}
+
 StorageId StorageManagerPimpl::issue_next_storage_id() {
   soc::SharedMutexScope guard(&control_block_->mod_lock_);  // implies fence too
   ++control_block_->largest_storage_id_;
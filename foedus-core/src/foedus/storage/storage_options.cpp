@@ -22,11 +22,13 @@ StorageOptions::StorageOptions() {
   max_storages_ = kDefaultMaxStorages;
   partitioner_data_memory_mb_ = kDefaultPartitionerDataMemoryMb;
   hot_threshold_ = kDefaultHotThreshold;
+  snapshot_root_history_size_ = kDefaultSnapshotRootHistorySize;
 }
 ErrorStack StorageOptions::load(tinyxml2::XMLElement* element) {
   EXTERNALIZE_LOAD_ELEMENT(element, max_storages_);
   EXTERNALIZE_LOAD_ELEMENT(element, partitioner_data_memory_mb_);
   EXTERNALIZE_LOAD_ELEMENT(element, hot_threshold_);
+  EXTERNALIZE_LOAD_ELEMENT(element, snapshot_root_history_size_);
   return kRetOk;
 }
 ErrorStack StorageOptions::save(tinyxml2::XMLElement* element) const {
@@ -39,6 +41,10 @@ ErrorStack StorageOptions::save(tinyxml2::XMLElement* element) const {
     " information (eg. long keys).");
   EXTERNALIZE_SAVE_ELEMENT(element, hot_threshold_,
     "Hot record threshold; for HCC only.");
+  EXTERNALIZE_SAVE_ELEMENT(element, snapshot_root_history_size_,
+    "Number of recent snapshots whose root pages the engine remembers for each storage."
+    " A pinned-snapshot transaction can keep reading while fewer than this number of"
+    " new snapshots are taken.");
   return kRetOk;
 }
 }  // namespace storage
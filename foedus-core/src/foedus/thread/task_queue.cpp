@@ -0,0 +1,136 @@
+/*
+ * Copyright (c) 2014-2015, Hewlett-Packard Development Company, LP.
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details. You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * HP designates this particular file as subject to the "Classpath" exception
+ * as provided by HP in the LICENSE.txt file that accompanied this code.
+ */
+#include "foedus/thread/task_queue.hpp"
+
+#include <atomic>
+#include <cstring>
+#include <ostream>
+
+#include "foedus/assert_nd.hpp"
+#include "foedus/soc/shared_memory_repo.hpp"
+#include "foedus/thread/thread_pimpl.hpp"
+#include "foedus/thread/thread_ref.hpp"
+
+namespace foedus {
+namespace thread {
+
+ErrorCode TaskQueue::push(
+  const proc::ProcName& proc_name,
+  const void* input,
+  uint32_t input_size) {
+  if (!is_open()) {
+    return kErrorCodeSessionExpired;
+  } else if (input_size > TaskQueueRequest::kMaxInputSize) {
+    return kErrorCodeInvalidParameter;
+  } else if (get_pending_count() >= kSlots) {
+    return kErrorCodeThrTaskQueueFull;
+  }
+
+  TaskQueueRequest* requests
+    = reinterpret_cast<TaskQueueRequest*>(session_.thread_->get_task_input_memory());
+  TaskQueueRequest* request = requests + (pushed_ % kSlots);
+  request->proc_name_ = proc_name;
+  request->input_len_ = input_size;
+  if (input_size > 0) {
+    std::memcpy(request->input_, input, input_size);
+  }
+  ++pushed_;
+
+  // Publishing the request doesn't need mutex. The thread is the only reader of the slot.
+  // We wake up the thread only if it might be sleeping. While it is serving requests, it
+  // will see this one without the signal. Both sides store and then load with seq_cst, so
+  // either we see the thread sleeping or the thread sees this request before it sleeps.
+  ThreadControlBlock* block = session_.thread_->get_control_block();
+  block->task_queue_pushed_.store(pushed_, std::memory_order_seq_cst);
+  if (block->task_queue_sleeping_.load(std::memory_order_seq_cst)) {
+    block->wakeup_cond_.signal();
+  }
+  return kErrorCodeOk;
+}
+
+ErrorCode TaskQueue::pop(ErrorCode* result, void* output, uint32_t* output_size) {
+  if (!is_open()) {
+    return kErrorCodeSessionExpired;
+  } else if (get_pending_count() == 0) {
+    return kErrorCodeInvalidParameter;
+  }
+
+  // We check the shared counter only when we have popped all results we knew of.
+  ThreadControlBlock* block = session_.thread_->get_control_block();
+  while (completed_ == popped_) {
+    uint64_t demand = block->task_complete_cond_.acquire_ticket();
+    completed_ = block->task_queue_completed_.load(std::memory_order_acquire);
+    if (completed_ != popped_) {
+      break;
+    } else if (!session_.is_running()) {
+      // the thread quit serving, most likely because the engine is shutting down.
+      return kErrorCodeSessionExpired;
+    }
+    block->task_complete_cond_.timedwait(demand, 100000ULL);
+  }
+  ASSERT_ND(completed_ - popped_ <= get_pending_count());
+
+  const TaskQueueResult* results
+    = reinterpret_cast<const TaskQueueResult*>(session_.thread_->get_task_output_memory());
+  const TaskQueueResult& slot = results[popped_ % kSlots];
+  *result = slot.result_;
+  if (output_size) {
+    *output_size = slot.output_len_;
+  }
+  if (output && slot.output_len_ > 0) {
+    std::memcpy(output, slot.output_, slot.output_len_);
+  }
+  ++popped_;
+  return kErrorCodeOk;
+}
+
+ErrorStack TaskQueue::close() {
+  if (!is_open()) {
+    return kRetOk;
+  }
+  ThreadControlBlock* block = session_.thread_->get_control_block();
+  block->task_queue_closed_.store(true, std::memory_order_release);
+  block->wakeup_cond_.signal();
+  ErrorStack result = session_.get_result();
+  session_.release();
+  pushed_ = 0;
+  popped_ = 0;
+  completed_ = 0;
+  return result;
+}
+
+std::ostream& operator<<(std::ostream& o, const TaskQueue& v) {
+  o << "TaskQueue: open=" << v.is_open();
+  if (v.is_open()) {
+    o << ", thread_id=" << v.session_.thread_->get_thread_id()
+      << ", pushed=" << v.pushed_ << ", popped=" << v.popped_ << ", completed=" << v.completed_;
+  }
+  return o;
+}
+
+static_assert(sizeof(TaskQueueRequest) == TaskQueueRequest::kSize, "Check TaskQueueRequest");
+static_assert(sizeof(TaskQueueResult) == TaskQueueResult::kSize, "Check TaskQueueResult");
+static_assert(
+  sizeof(TaskQueueRequest) * TaskQueue::kSlots <= soc::ThreadMemoryAnchors::kTaskInputMemorySize,
+  "TaskQueue doesn't fit in the task input memory.");
+static_assert(
+  sizeof(TaskQueueResult) * TaskQueue::kSlots <= soc::ThreadMemoryAnchors::kTaskOutputMemorySize,
+  "TaskQueue doesn't fit in the task output memory.");
+
+}  // namespace thread
+}  // namespace foedus
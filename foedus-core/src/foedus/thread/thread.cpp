@@ -72,6 +72,22 @@ void Thread::reset_snapshot_cache_counts() const {
   pimpl_->control_block_->stat_snapshot_cache_misses_ = 0;
 }
 
+uint64_t Thread::get_htm_elided_commits() const {
+  return pimpl_->control_block_->stat_htm_elided_commits_;
+}
+
+void Thread::increment_htm_elided_commits() {
+  ++pimpl_->control_block_->stat_htm_elided_commits_;
+}
+
+const xct::McsWwLockStat* Thread::get_mcs_ww_lock_stats() const {
+  return pimpl_->control_block_->mcs_ww_lock_stats_;
+}
+
+void Thread::reset_mcs_ww_lock_stats() const {
+  pimpl_->control_block_->reset_mcs_ww_lock_stats();
+}
+
 xct::Xct&   Thread::get_current_xct()   { return pimpl_->current_xct_; }
 bool        Thread::is_running_xct()    const { return pimpl_->current_xct_.is_active(); }
 
@@ -95,13 +111,13 @@ ErrorCode Thread::read_snapshot_pages(
 ErrorCode Thread::find_or_read_a_snapshot_page(
   storage::SnapshotPagePointer page_id,
   storage::Page** out) {
-  return pimpl_->find_or_read_a_snapshot_page(page_id, out);
+  return pimpl_->find_or_read_a_snapshot_page(page_id, 1U, out);
 }
 ErrorCode Thread::find_or_read_snapshot_pages_batch(
   uint16_t batch_size,
   const storage::SnapshotPagePointer* page_ids,
   storage::Page** out) {
-  return pimpl_->find_or_read_snapshot_pages_batch(batch_size, page_ids, out);
+  return pimpl_->find_or_read_snapshot_pages_batch(batch_size, page_ids, nullptr, out);
 }
 
 ErrorCode Thread::install_a_volatile_page(
@@ -21,7 +21,10 @@
 #include <sched.h>
 #include <glog/logging.h>
 
+#include <algorithm>
 #include <atomic>
+#include <cstring>
+#include <deque>
 #include <future>
 #include <mutex>
 #include <thread>
@@ -40,7 +43,14 @@
 #include "foedus/proc/proc_manager.hpp"
 #include "foedus/soc/shared_memory_repo.hpp"
 #include "foedus/soc/soc_manager.hpp"
+#include "foedus/storage/metadata.hpp"
+#include "foedus/storage/page.hpp"
+#include "foedus/storage/storage.hpp"
+#include "foedus/storage/storage_manager.hpp"
+#include "foedus/storage/array/array_page_impl.hpp"
+#include "foedus/storage/masstree/masstree_page_impl.hpp"
 #include "foedus/thread/numa_thread_scope.hpp"
+#include "foedus/thread/task_queue.hpp"
 #include "foedus/thread/thread.hpp"
 #include "foedus/thread/thread_pool.hpp"
 #include "foedus/thread/thread_pool_pimpl.hpp"
@@ -69,6 +79,9 @@ ThreadPimpl::ThreadPimpl(
     log_buffer_(engine, id),
     current_xct_(engine, holder, id),
     snapshot_file_set_(engine),
+    defer_snapshot_cache_miss_(false),
+    pending_snapshot_read_count_(0),
+    deferred_page_id_(0),
     control_block_(nullptr),
     task_input_memory_(nullptr),
     task_output_memory_(nullptr),
@@ -96,6 +109,8 @@ ErrorStack ThreadPimpl::initialize_once() {
   ASSERT_ND(mcs_type == xct::XctOptions::kMcsImplementationTypeSimple
     || mcs_type == xct::XctOptions::kMcsImplementationTypeExtended);
   simple_mcs_rw_ = mcs_type == xct::XctOptions::kMcsImplementationTypeSimple;
+  mcs_ww_numa_handover_limit_ = engine_->get_options().xct_.mcs_ww_numa_handover_limit_;
+  mcs_ww_lock_stats_enabled_ = engine_->get_options().xct_.enable_mcs_ww_lock_stats_;
   node_memory_ = engine_->get_memory_manager()->get_local_memory();
   core_memory_ = node_memory_->get_core_memory(id_);
   if (engine_->get_options().cache_.snapshot_cache_enabled_) {
@@ -109,6 +124,10 @@ ErrorStack ThreadPimpl::initialize_once() {
     &control_block_->mcs_block_current_,
     &control_block_->mcs_rw_async_mapping_current_);
   CHECK_ERROR(snapshot_file_set_.initialize());
+  defer_snapshot_cache_miss_ = false;
+  pending_snapshot_read_count_ = 0;
+  deferred_page_id_ = 0;
+  std::memset(pending_snapshot_reads_, 0, sizeof(pending_snapshot_reads_));
   CHECK_ERROR(log_buffer_.initialize());
   global_volatile_page_resolver_
     = engine_->get_memory_manager()->get_global_volatile_page_resolver();
@@ -147,6 +166,7 @@ ErrorStack ThreadPimpl::uninitialize_once() {
     }
   }
   batch.emprace_back(snapshot_file_set_.uninitialize());
+  snapshot_read_extent_buffer_.release_block();
   batch.emprace_back(log_buffer_.uninitialize());
   core_memory_ = nullptr;
   node_memory_ = nullptr;
@@ -196,34 +216,47 @@ void ThreadPimpl::handle_tasks() {
       current_xct_.set_default_rll_threshold_for_this_xct(
         engine_->get_options().xct_.hot_threshold_for_retrospective_lock_list_);
 
-      const proc::ProcName& proc_name = control_block_->proc_name_;
-      VLOG(0) << "Thread-" << id_ << " retrieved a task: " << proc_name;
-      proc::Proc proc = nullptr;
-      ErrorStack result = engine_->get_proc_manager()->get_proc(proc_name, &proc);
-      if (result.is_error()) {
-        // control_block_->proc_result_
-        LOG(ERROR) << "Thread-" << id_ << " couldn't find procedure: " << proc_name;
+      ErrorStack result;
+      proc::ProcManager* proc_manager = engine_->get_proc_manager();
+      const bool task_queue_mode = control_block_->task_queue_mode_;
+      if (task_queue_mode) {
+        result = handle_task_queue();
       } else {
-        uint32_t output_used = 0;
-        proc::ProcArguments args = {
-          engine_,
-          holder_,
-          task_input_memory_,
-          control_block_->input_len_,
-          task_output_memory_,
-          soc::ThreadMemoryAnchors::kTaskOutputMemorySize,
-          &output_used,
-        };
-        result = proc(args);
-        VLOG(0) << "Thread-" << id_ << " run(task) returned. result =" << result
-          << ", output_used=" << output_used;
-        control_block_->output_len_ = output_used;
+        const proc::ProcName& proc_name = control_block_->proc_name_;
+        VLOG(0) << "Thread-" << id_ << " retrieved a task: " << proc_name;
+        proc::Proc proc = nullptr;
+        // Shared libraries of procedures are not reloaded while we look up and run it
+        proc_manager->begin_invocation(id_);
+        result = proc_manager->get_proc(proc_name, &proc);
+        if (result.is_error()) {
+          // control_block_->proc_result_
+          LOG(ERROR) << "Thread-" << id_ << " couldn't find procedure: " << proc_name;
+        } else {
+          uint32_t output_used = 0;
+          proc::ProcArguments args = {
+            engine_,
+            holder_,
+            task_input_memory_,
+            control_block_->input_len_,
+            task_output_memory_,
+            soc::ThreadMemoryAnchors::kTaskOutputMemorySize,
+            &output_used,
+          };
+          result = proc(args);
+          VLOG(0) << "Thread-" << id_ << " run(task) returned. result =" << result
+            << ", output_used=" << output_used;
+          control_block_->output_len_ = output_used;
+        }
       }
       if (result.is_error()) {
         control_block_->proc_result_.from_error_stack(result);
       } else {
         control_block_->proc_result_.clear();
       }
+      if (!task_queue_mode) {
+        // The result might point to strings in the procedure's library until we copy it above.
+        proc_manager->end_invocation(id_);
+      }
       control_block_->status_ = kWaitingForClientRelease;
       {
         // Wakeup the client if it's waiting.
@@ -236,6 +269,241 @@ void ThreadPimpl::handle_tasks() {
   control_block_->status_ = kTerminated;
   LOG(INFO) << "Thread-" << id_ << " exits";
 }
+ErrorStack ThreadPimpl::handle_task_queue() {
+  VLOG(0) << "Thread-" << id_ << " starts serving a task queue";
+  // Suspending requests on cache misses makes sense only when we have the snapshot cache.
+  const bool interleaved = control_block_->task_queue_interleaved_ && snapshot_cache_hashtable_;
+  proc::ProcManager* proc_manager = engine_->get_proc_manager();
+  proc::ProcName cached_name;
+  proc::Proc cached_proc = nullptr;
+  uint64_t cached_generation = 0;
+  uint32_t completed = 0;  // all requests before this are completed
+  uint32_t served = 0;  // all requests before this have run at least once
+  uint64_t batches = 0;
+  uint64_t suspensions = 0;
+  /** A request waiting for a snapshot page read. Ordered by index_ in suspended. */
+  struct SuspendedRequest {
+    uint32_t                      index_;
+    uint32_t                      suspended_count_;
+    storage::SnapshotPagePointer  page_id_;
+  };
+  // Beyond this, the request reads the page synchronously so that it surely makes progress.
+  const uint32_t kMaxSuspensionsPerRequest = 8;
+  std::deque<SuspendedRequest> suspended;
+  while (!is_stop_requested()) {
+    uint32_t pushed = control_block_->task_queue_pushed_.load(std::memory_order_acquire);
+    if (pushed == served && suspended.empty()) {
+      // The queue is empty. Check closed_ only after we saw the empty queue, so that we never
+      // miss requests pushed before close.
+      uint64_t demand = control_block_->wakeup_cond_.acquire_ticket();
+      // Tell push() to signal us before we check the queue for the last time. See push().
+      control_block_->task_queue_sleeping_.store(true, std::memory_order_seq_cst);
+      if (control_block_->task_queue_closed_.load(std::memory_order_acquire)) {
+        if (control_block_->task_queue_pushed_.load(std::memory_order_seq_cst) == served) {
+          control_block_->task_queue_sleeping_.store(false, std::memory_order_relaxed);
+          break;
+        }
+      } else if (control_block_->task_queue_pushed_.load(std::memory_order_seq_cst) == served) {
+        control_block_->wakeup_cond_.timedwait(demand, 100000ULL, 1U << 16, 1U << 13);
+      }
+      control_block_->task_queue_sleeping_.store(false, std::memory_order_relaxed);
+      continue;
+    }
+
+    // Serve all requests published so far, then notify the client just once.
+    // Shared libraries of procedures are not reloaded while we serve a batch.
+    proc_manager->begin_invocation(id_);
+    for (; served != pushed; ++served) {
+      SuspendedRequest request = {served, 1U, 0};
+      if (!run_task_queue_request(
+        served,
+        interleaved,
+        &cached_name,
+        &cached_proc,
+        &cached_generation,
+        &request.page_id_)) {
+        suspended.push_back(request);
+        ++suspensions;
+        ++control_block_->stat_task_queue_suspensions_;
+      }
+    }
+
+    // Then retry the suspended requests whose pages have arrived.
+    // We wait for the reads only when there is nothing else to do.
+    if (!suspended.empty()) {
+      const bool idle
+        = control_block_->task_queue_pushed_.load(std::memory_order_acquire) == served;
+      ErrorCode read_result = complete_snapshot_reads(idle);
+      if (read_result != kErrorCodeOk) {
+        proc_manager->end_invocation(id_);
+        return ERROR_STACK(read_result);
+      }
+      for (auto it = suspended.begin(); it != suspended.end();) {
+        if (is_snapshot_read_pending(it->page_id_)) {
+          ++it;
+        } else if (run_task_queue_request(
+          it->index_,
+          it->suspended_count_ < kMaxSuspensionsPerRequest,
+          &cached_name,
+          &cached_proc,
+          &cached_generation,
+          &it->page_id_)) {
+          it = suspended.erase(it);
+        } else {
+          ++it->suspended_count_;
+          ++suspensions;
+          ++control_block_->stat_task_queue_suspensions_;
+          ++it;
+        }
+      }
+    }
+
+    proc_manager->end_invocation(id_);
+
+    // Results are popped in order, so we publish only up to the oldest suspended request.
+    const uint32_t new_completed = suspended.empty() ? served : suspended.front().index_;
+    if (new_completed != completed) {
+      completed = new_completed;
+      control_block_->task_queue_completed_.store(completed, std::memory_order_release);
+      control_block_->task_complete_cond_.signal();
+      ++batches;
+    }
+  }
+
+  // We might be quitting due to stop requests. Don't leave reads into our pages in flight.
+  while (pending_snapshot_read_count_ > 0) {
+    ErrorCode drain_result = complete_snapshot_reads(true);
+    if (drain_result != kErrorCodeOk) {
+      LOG(WARNING) << "Thread-" << id_ << " failed to install a snapshot page while draining"
+        << " pending reads: " << get_error_name(drain_result);
+    }
+  }
+  VLOG(0) << "Thread-" << id_ << " finished serving a task queue. " << completed
+    << " requests in " << batches << " batches, " << suspensions << " suspensions";
+  return kRetOk;
+}
+
+bool ThreadPimpl::run_task_queue_request(
+  uint32_t index,
+  bool defer_cache_miss,
+  proc::ProcName* cached_name,
+  proc::Proc* cached_proc,
+  uint64_t* cached_generation,
+  storage::SnapshotPagePointer* missed_page) {
+  const TaskQueueRequest* requests = reinterpret_cast<TaskQueueRequest*>(task_input_memory_);
+  TaskQueueResult* results = reinterpret_cast<TaskQueueResult*>(task_output_memory_);
+  const TaskQueueRequest& request = requests[index % TaskQueue::kSlots];
+  TaskQueueResult* result = results + (index % TaskQueue::kSlots);
+  proc::ProcManager* proc_manager = engine_->get_proc_manager();
+  // The cached function pointer is invalid if its shared library has been reloaded since then.
+  // The caller is in an invocation, so no reload happens until we return.
+  const uint64_t generation = proc_manager->get_generation();
+  if (*cached_proc == nullptr
+    || *cached_name != request.proc_name_
+    || *cached_generation != generation) {
+    *cached_name = request.proc_name_;
+    *cached_generation = generation;
+    ErrorStack lookup = proc_manager->get_proc(*cached_name, cached_proc);
+    if (lookup.is_error()) {
+      LOG(ERROR) << "Thread-" << id_ << " couldn't find procedure: " << *cached_name;
+      *cached_proc = nullptr;
+      result->result_ = lookup.get_error_code();
+      result->output_len_ = 0;
+      return true;
+    }
+  }
+  uint32_t output_used = 0;
+  proc::ProcArguments args = {
+    engine_,
+    holder_,
+    request.input_,
+    request.input_len_,
+    result->output_,
+    TaskQueueResult::kMaxOutputSize,
+    &output_used,
+  };
+  defer_snapshot_cache_miss_ = defer_cache_miss;
+  deferred_page_id_ = 0;
+  ErrorCode code = (*cached_proc)(args).get_error_code();
+  defer_snapshot_cache_miss_ = false;
+  if (code == kErrorCodeCacheMissPending && deferred_page_id_ != 0) {
+    // The procedure gave up the transaction on our request. Abort it on its behalf, and
+    // run it again from the beginning after the read.
+    if (current_xct_.is_active()) {
+      engine_->get_xct_manager()->abort_xct(holder_);
+    }
+    *missed_page = deferred_page_id_;
+    return false;
+  }
+  result->result_ = code;
+  result->output_len_ = output_used;
+  return true;
+}
+
+ErrorCode ThreadPimpl::complete_snapshot_reads(bool wait) {
+  if (pending_snapshot_read_count_ == 0) {
+    return kErrorCodeOk;
+  }
+  if (wait) {
+    const struct aiocb* controls[kMaxPendingSnapshotReads];
+    uint16_t count = 0;
+    for (uint16_t i = 0; i < kMaxPendingSnapshotReads; ++i) {
+      if (pending_snapshot_reads_[i].active_) {
+        controls[count] = &pending_snapshot_reads_[i].control_;
+        ++count;
+      }
+    }
+    ASSERT_ND(count == pending_snapshot_read_count_);
+    // Timeout to check stop requests. Errors (EINTR etc) just mean we poll again.
+    struct timespec timeout = {0, 100000000L};
+    ::aio_suspend(controls, count, &timeout);
+  }
+
+  ErrorCode ret = kErrorCodeOk;
+  for (uint16_t i = 0; i < kMaxPendingSnapshotReads; ++i) {
+    PendingSnapshotRead* read = pending_snapshot_reads_ + i;
+    if (!read->active_) {
+      continue;
+    }
+    bool read_completed = false;
+    ErrorCode read_result
+      = snapshot_file_set_.poll_page_read(read->page_id_, &read->control_, &read_completed);
+    if (!read_completed && read_result == kErrorCodeOk) {
+      continue;
+    }
+    read->active_ = false;
+    --pending_snapshot_read_count_;
+    storage::Page* page = snapshot_page_pool_->get_base() + read->offset_;
+    if (read_result != kErrorCodeOk || page->get_header().page_id_ != read->page_id_) {
+      // The retried request will read it synchronously and report the error, if any.
+      LOG(WARNING) << "Asynchronous snapshot page read failed. thread=" << *holder_
+        << ", page_id=" << assorted::Hex(read->page_id_);
+      core_memory_->release_free_snapshot_page(read->offset_);
+      continue;
+    }
+    ErrorCode install_result = snapshot_cache_hashtable_->install(read->page_id_, read->offset_);
+    if (install_result != kErrorCodeOk) {
+      core_memory_->release_free_snapshot_page(read->offset_);
+      ret = install_result;
+      continue;
+    }
+    ++control_block_->stat_snapshot_cache_misses_;
+  }
+  return ret;
+}
+
+bool ThreadPimpl::is_snapshot_read_pending(storage::SnapshotPagePointer page_id) const {
+  if (pending_snapshot_read_count_ == 0) {
+    return false;
+  }
+  for (uint16_t i = 0; i < kMaxPendingSnapshotReads; ++i) {
+    if (pending_snapshot_reads_[i].active_ && pending_snapshot_reads_[i].page_id_ == page_id) {
+      return true;
+    }
+  }
+  return false;
+}
+
 void ThreadPimpl::set_thread_schedule() {
   // this code totally assumes pthread. maybe ifdef to handle Windows.. later!
   SPINLOCK_WHILE(raw_thread_set_ == false) {
@@ -296,7 +564,7 @@ ErrorCode ThreadPimpl::install_a_volatile_page(
 
   // copy from snapshot version
   storage::Page* snapshot_page;
-  CHECK_ERROR_CODE(find_or_read_a_snapshot_page(pointer->snapshot_pointer_, &snapshot_page));
+  CHECK_ERROR_CODE(find_or_read_a_snapshot_page(pointer->snapshot_pointer_, 1U, &snapshot_page));
   storage::VolatilePagePointer volatile_pointer = core_memory_->grab_free_volatile_page_pointer();
   const auto offset = volatile_pointer.get_offset();
   if (UNLIKELY(volatile_pointer.is_null())) {
@@ -466,7 +734,10 @@ ErrorCode ThreadPimpl::follow_page_pointer(
       CHECK_ERROR_CODE(install_a_volatile_page(pointer, page));
     } else {
       // otherwise just use snapshot
-      CHECK_ERROR_CODE(find_or_read_a_snapshot_page(pointer->snapshot_pointer_, page));
+      CHECK_ERROR_CODE(find_or_read_a_snapshot_page(
+        pointer->snapshot_pointer_,
+        get_snapshot_read_extent(parent),
+        page));
       followed_snapshot = true;
     }
   }
@@ -513,8 +784,10 @@ ErrorCode ThreadPimpl::follow_page_pointers_for_read_batch(
 
   // collect snapshot page IDs.
   storage::SnapshotPagePointer snapshot_page_ids[Thread::kMaxFindPagesBatch];
+  uint32_t read_extents[Thread::kMaxFindPagesBatch];
   for (uint16_t b = 0; b < batch_size; ++b) {
     snapshot_page_ids[b] = 0;
+    read_extents[b] = 1U;
     storage::DualPagePointer* pointer = pointers[b];
     if (pointer == nullptr) {
       continue;
@@ -525,12 +798,17 @@ ErrorCode ThreadPimpl::follow_page_pointers_for_read_batch(
     if (pointer->snapshot_pointer_ != 0 && pointer->volatile_pointer_.is_null()) {
       has_some_snapshot = true;
       snapshot_page_ids[b] = pointer->snapshot_pointer_;
+      read_extents[b] = get_snapshot_read_extent(parents[b]);
     }
   }
 
   // follow them in a batch. output to tmp_out.
   if (has_some_snapshot) {
-    CHECK_ERROR_CODE(find_or_read_snapshot_pages_batch(batch_size, snapshot_page_ids, tmp_out));
+    CHECK_ERROR_CODE(find_or_read_snapshot_pages_batch(
+      batch_size,
+      snapshot_page_ids,
+      read_extents,
+      tmp_out));
   }
 
   // handle cases we have to volatile pages. also we might have to create a new page.
@@ -646,6 +924,7 @@ ErrorCode ThreadPimpl::follow_page_pointers_for_write_batch(
 
 ErrorCode ThreadPimpl::find_or_read_a_snapshot_page(
   storage::SnapshotPagePointer page_id,
+  uint32_t read_extent,
   storage::Page** out) {
   if (snapshot_cache_hashtable_) {
     ASSERT_ND(engine_->get_options().cache_.snapshot_cache_enabled_);
@@ -657,7 +936,7 @@ ErrorCode ThreadPimpl::find_or_read_a_snapshot_page(
       if (offset != 0) {
         DVLOG(0) << "Interesting, this race is rare, but possible. offset=" << offset;
       }
-      CHECK_ERROR_CODE(on_snapshot_cache_miss(page_id, &offset));
+      CHECK_ERROR_CODE(on_snapshot_cache_miss(page_id, read_extent, &offset));
       ASSERT_ND(offset != 0);
       CHECK_ERROR_CODE(snapshot_cache_hashtable_->install(page_id, offset));
       ++control_block_->stat_snapshot_cache_misses_;
@@ -687,6 +966,7 @@ static_assert(
 ErrorCode ThreadPimpl::find_or_read_snapshot_pages_batch(
   uint16_t batch_size,
   const storage::SnapshotPagePointer* page_ids,
+  const uint32_t* read_extents,
   storage::Page** out) {
   ASSERT_ND(batch_size <= Thread::kMaxFindPagesBatch);
   if (batch_size == 0) {
@@ -699,6 +979,7 @@ ErrorCode ThreadPimpl::find_or_read_snapshot_pages_batch(
     ASSERT_ND(engine_->get_options().cache_.snapshot_cache_enabled_);
     memory::PagePoolOffset offsets[Thread::kMaxFindPagesBatch];
     CHECK_ERROR_CODE(snapshot_cache_hashtable_->find_batch(batch_size, page_ids, offsets));
+    bool read_ahead = false;
     for (uint16_t b = 0; b < batch_size; ++b) {
       memory::PagePoolOffset offset = offsets[b];
       storage::SnapshotPagePointer page_id = page_ids[b];
@@ -710,11 +991,17 @@ ErrorCode ThreadPimpl::find_or_read_snapshot_pages_batch(
         out[b] = out[b - 1];
         continue;
       }
+      if (read_ahead && offset == 0) {
+        // an earlier miss in this batch might have read this page as a part of its extent
+        offset = snapshot_cache_hashtable_->find(page_id);
+      }
       if (offset == 0 || snapshot_page_pool_->get_base()[offset].get_header().page_id_ != page_id) {
         if (offset != 0) {
           DVLOG(0) << "Interesting, this race is rare, but possible. offset=" << offset;
         }
-        CHECK_ERROR_CODE(on_snapshot_cache_miss(page_id, &offset));
+        const uint32_t read_extent = read_extents ? read_extents[b] : 1U;
+        CHECK_ERROR_CODE(on_snapshot_cache_miss(page_id, read_extent, &offset));
+        read_ahead = read_ahead || read_extent > 1U;
         ASSERT_ND(offset != 0);
         CHECK_ERROR_CODE(snapshot_cache_hashtable_->install(page_id, offset));
         ++control_block_->stat_snapshot_cache_misses_;
@@ -740,7 +1027,42 @@ ErrorCode ThreadPimpl::find_or_read_snapshot_pages_batch(
 
 ErrorCode ThreadPimpl::on_snapshot_cache_miss(
   storage::SnapshotPagePointer page_id,
+  uint32_t read_extent,
   memory::PagePoolOffset* pool_offset) {
+  if (defer_snapshot_cache_miss_ && current_xct_.is_active()) {
+    // Someone in this thread might be already reading the page.
+    if (is_snapshot_read_pending(page_id)) {
+      deferred_page_id_ = page_id;
+      return kErrorCodeCacheMissPending;
+    }
+    // Otherwise issue an asynchronous read if we have a room. If not, just read it now.
+    for (uint16_t i = 0; i < kMaxPendingSnapshotReads; ++i) {
+      PendingSnapshotRead* read = pending_snapshot_reads_ + i;
+      if (read->active_) {
+        continue;
+      }
+      memory::PagePoolOffset offset = core_memory_->grab_free_snapshot_page();
+      if (offset == 0) {
+        LOG(ERROR) << "Could not grab free snapshot page while cache miss. thread=" << *holder_
+          << ", page_id=" << assorted::Hex(page_id);
+        return kErrorCodeCacheNoFreePages;
+      }
+      storage::Page* new_page = snapshot_page_pool_->get_base() + offset;
+      ErrorCode issue_result
+        = snapshot_file_set_.read_page_async(page_id, new_page, &read->control_);
+      if (issue_result != kErrorCodeOk) {
+        core_memory_->release_free_snapshot_page(offset);
+        return issue_result;
+      }
+      read->active_ = true;
+      read->page_id_ = page_id;
+      read->offset_ = offset;
+      ++pending_snapshot_read_count_;
+      deferred_page_id_ = page_id;
+      return kErrorCodeCacheMissPending;
+    }
+  }
+
   // grab a buffer page to read into.
   memory::PagePoolOffset offset = core_memory_->grab_free_snapshot_page();
   if (offset == 0) {
@@ -752,7 +1074,15 @@ ErrorCode ThreadPimpl::on_snapshot_cache_miss(
   }
 
   storage::Page* new_page = snapshot_page_pool_->get_base() + offset;
-  ErrorCode read_result = read_a_snapshot_page(page_id, new_page);
+  const uint32_t extent = std::min<uint32_t>(
+    read_extent,
+    storage::Metadata::SnapshotThresholds::kMaxSnapshotReadExtent);
+  ErrorCode read_result;
+  if (extent <= 1U) {
+    read_result = read_a_snapshot_page(page_id, new_page);
+  } else {
+    read_result = read_a_snapshot_extent(page_id, extent, new_page);
+  }
   if (read_result != kErrorCodeOk) {
     LOG(ERROR) << "Failed to read a snapshot page. thread=" << *holder_
       << ", page_id=" << assorted::Hex(page_id);
@@ -764,6 +1094,112 @@ ErrorCode ThreadPimpl::on_snapshot_cache_miss(
   return kErrorCodeOk;
 }
 
+/** Pages the composers write next to each other in a snapshot file */
+inline bool is_snapshot_leaf_page(const storage::Page* page) {
+  switch (page->get_header().get_page_type()) {
+  case storage::kArrayPageType:
+    return reinterpret_cast<const storage::array::ArrayPage*>(page)->is_leaf();
+  case storage::kMasstreeBorderPageType:
+    return true;
+  default:
+    return false;
+  }
+}
+
+uint32_t ThreadPimpl::get_snapshot_read_extent(const storage::Page* parent) const {
+  if (parent == nullptr) {
+    return 1U;
+  }
+  bool leaf_parent;
+  switch (parent->get_header().get_page_type()) {
+  case storage::kArrayPageType:
+    leaf_parent = reinterpret_cast<const storage::array::ArrayPage*>(parent)->get_level() == 1U;
+    break;
+  case storage::kMasstreeIntermediatePageType:
+    leaf_parent = reinterpret_cast<const storage::masstree::MasstreeIntermediatePage*>(
+      parent)->get_btree_level() == 1U;
+    break;
+  default:
+    leaf_parent = false;
+    break;
+  }
+  if (!leaf_parent) {
+    return 1U;
+  }
+  const storage::StorageControlBlock* block
+    = engine_->get_storage_manager()->get_storage(parent->get_header().storage_id_);
+  return std::max<uint32_t>(block->meta_.snapshot_thresholds_.snapshot_read_extent_, 1U);
+}
+
+ErrorCode ThreadPimpl::read_a_snapshot_extent(
+  storage::SnapshotPagePointer page_id,
+  uint32_t extent,
+  storage::Page* page) {
+  if (snapshot_read_extent_buffer_.is_null()) {
+    snapshot_read_extent_buffer_.alloc_onnode(
+      storage::kPageSize * storage::Metadata::SnapshotThresholds::kMaxSnapshotReadExtent,
+      storage::kPageSize,
+      holder_->get_numa_node());
+    if (snapshot_read_extent_buffer_.is_null()) {
+      LOG(WARNING) << "Could not allocate the snapshot read extent buffer. thread=" << *holder_
+        << ". Reading only the missed page";
+      return read_a_snapshot_page(page_id, page);
+    }
+  }
+  storage::Page* buffer = reinterpret_cast<storage::Page*>(
+    snapshot_read_extent_buffer_.get_block());
+  uint32_t read_count;
+  CHECK_ERROR_CODE(snapshot_file_set_.read_pages_upto(page_id, extent, buffer, &read_count));
+  if (read_count == 0) {
+    return kErrorCodeFsTooShortRead;
+  }
+  ASSERT_ND(buffer->get_header().page_id_ == page_id);
+  std::memcpy(reinterpret_cast<void*>(page), buffer, storage::kPageSize);
+  install_read_ahead_snapshot_pages(page_id, page, buffer + 1, read_count - 1U);
+  return kErrorCodeOk;
+}
+
+void ThreadPimpl::install_read_ahead_snapshot_pages(
+  storage::SnapshotPagePointer page_id,
+  const storage::Page* page,
+  const storage::Page* following_pages,
+  uint32_t following_count) {
+  ASSERT_ND(snapshot_cache_hashtable_);
+  if (!is_snapshot_leaf_page(page)) {
+    return;
+  }
+  const storage::StorageId storage_id = page->get_header().storage_id_;
+  storage::Page* pool_base = snapshot_page_pool_->get_base();
+  for (uint32_t i = 0; i < following_count; ++i) {
+    const storage::Page* read_page = following_pages + i;
+    const storage::SnapshotPagePointer read_page_id = page_id + 1U + i;
+    ASSERT_ND(read_page->get_header().page_id_ == read_page_id);
+    if (read_page->get_header().storage_id_ != storage_id) {
+      break;  // pages of another storage follow
+    } else if (!is_snapshot_leaf_page(read_page)) {
+      continue;
+    }
+    memory::PagePoolOffset cached = snapshot_cache_hashtable_->find(read_page_id);
+    if (cached != 0 && pool_base[cached].get_header().page_id_ == read_page_id) {
+      continue;
+    }
+    memory::PagePoolOffset offset = core_memory_->grab_free_snapshot_page();
+    if (offset == 0) {
+      break;  // this is just a read-ahead. the cleaner will make room later
+    }
+    std::memcpy(reinterpret_cast<void*>(pool_base + offset), read_page, storage::kPageSize);
+    ErrorCode install_result = snapshot_cache_hashtable_->install(read_page_id, offset);
+    if (install_result != kErrorCodeOk) {
+      // Again, just a read-ahead. The transaction doesn't need this page.
+      LOG(WARNING) << "Failed to install a read-ahead snapshot page. thread=" << *holder_
+        << ", page_id=" << assorted::Hex(read_page_id)
+        << ", err=" << get_error_name(install_result);
+      core_memory_->release_free_snapshot_page(offset);
+      break;
+    }
+  }
+}
+
 ThreadRef ThreadPimpl::get_thread_ref(ThreadId id) {
   auto* pool_pimpl = engine_->get_thread_pool()->get_pimpl();
   return pool_pimpl->get_thread_ref(id);
@@ -63,6 +63,10 @@ bool ThreadPool::impersonate_on_numa_core(
   return pimpl_->impersonate_on_numa_core(core, proc_name, task_input, task_input_size, session);
 }
 
+bool ThreadPool::impersonate_task_queue_on_numa_node(ThreadGroupId node, TaskQueue* queue) {
+  return pimpl_->impersonate_task_queue_on_numa_node(node, queue);
+}
+
 ThreadGroupRef* ThreadPool::get_group_ref(ThreadGroupId numa_node) {
   return pimpl_->get_group(numa_node);
 }
@@ -118,6 +118,18 @@ bool ThreadPoolPimpl::impersonate_on_numa_core(
   return thread->try_impersonate(proc_name, task_input, task_input_size, session);
 }
 
+bool ThreadPoolPimpl::impersonate_task_queue_on_numa_node(ThreadGroupId node, TaskQueue* queue) {
+  uint16_t thread_per_group = engine_->get_options().thread_.thread_count_per_group_;
+  ThreadGroupRef& group = groups_[node];
+  for (size_t j = 0; j < thread_per_group; ++j) {
+    ThreadRef* thread = group.get_thread(j);
+    if (thread->try_impersonate_task_queue(queue)) {
+      return true;
+    }
+  }
+  return false;
+}
+
 std::ostream& operator<<(std::ostream& o, const ThreadPoolPimpl& v) {
   o << "<ThreadPool>";
   o << "<groups>";
@@ -27,6 +27,7 @@
 #include "foedus/soc/shared_memory_repo.hpp"
 #include "foedus/soc/soc_manager.hpp"
 #include "foedus/thread/impersonate_session.hpp"
+#include "foedus/thread/task_queue.hpp"
 #include "foedus/thread/thread_id.hpp"
 #include "foedus/thread/thread_pimpl.hpp"
 
@@ -61,6 +62,29 @@ bool ThreadRef::try_impersonate(
   const void* task_input,
   uint64_t task_input_size,
   ImpersonateSession *session) {
+  return try_impersonate_impl(proc_name, task_input, task_input_size, nullptr, session);
+}
+
+bool ThreadRef::try_impersonate_task_queue(TaskQueue* queue) {
+  if (queue->is_open()) {
+    LOG(WARNING) << "This queue is already attached to some thread. Closing the current one..";
+    queue->close();
+  }
+  if (!try_impersonate_impl(proc::ProcName(), nullptr, 0, queue, &queue->session_)) {
+    return false;
+  }
+  queue->pushed_ = 0;
+  queue->popped_ = 0;
+  queue->completed_ = 0;
+  return true;
+}
+
+bool ThreadRef::try_impersonate_impl(
+  const proc::ProcName& proc_name,
+  const void* task_input,
+  uint64_t task_input_size,
+  const TaskQueue* task_queue,
+  ImpersonateSession *session) {
   if (session->is_valid()) {
     LOG(WARNING) << "This session is already attached to some thread. Releasing the current one..";
     session->release();
@@ -88,6 +112,13 @@ bool ThreadRef::try_impersonate(
     session->thread_ = this;
     session->ticket_ = ++control_block_->current_ticket_;
     control_block_->proc_name_ = proc_name;
+    control_block_->task_queue_mode_ = (task_queue != nullptr);
+    if (task_queue) {
+      control_block_->task_queue_interleaved_ = task_queue->is_interleave_cache_misses();
+      control_block_->task_queue_closed_.store(false);
+      control_block_->task_queue_pushed_.store(0);
+      control_block_->task_queue_completed_.store(0);
+    }
     control_block_->status_ = kWaitingForExecution;
     control_block_->input_len_ = task_input_size;
     if (task_input_size > 0) {
@@ -124,11 +155,23 @@ uint64_t ThreadRef::get_snapshot_cache_misses() const {
   return control_block_->stat_snapshot_cache_misses_;
 }
 
+uint64_t ThreadRef::get_task_queue_suspensions() const {
+  return control_block_->stat_task_queue_suspensions_;
+}
+
+uint64_t ThreadRef::get_htm_elided_commits() const {
+  return control_block_->stat_htm_elided_commits_;
+}
+
 void ThreadRef::reset_snapshot_cache_counts() const {
   control_block_->stat_snapshot_cache_hits_ = 0;
   control_block_->stat_snapshot_cache_misses_ = 0;
 }
 
+const xct::McsWwLockStat* ThreadRef::get_mcs_ww_lock_stats() const {
+  return control_block_->mcs_ww_lock_stats_;
+}
+
 Epoch ThreadGroupRef::get_min_in_commit_epoch() const {
   assorted::memory_fence_acquire();
   Epoch ret = INVALID_EPOCH;
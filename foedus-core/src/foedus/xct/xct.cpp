@@ -66,7 +66,11 @@ Xct::Xct(Engine* engine, thread::Thread* context, thread::ThreadId thread_id)
   max_lock_free_write_set_size_ = 0;
   pointer_set_size_ = 0;
   page_version_set_size_ = 0;
+  page_read_set_ = nullptr;
+  page_read_set_size_ = 0;
+  max_page_read_set_size_ = 0;
   isolation_level_ = kSerializable;
+  pinned_snapshot_epoch_ = INVALID_EPOCH;
   mcs_block_current_ = nullptr;
   mcs_rw_async_mapping_current_ = nullptr;
   local_work_memory_ = nullptr;
@@ -112,6 +116,9 @@ void Xct::initialize(
   pointer_set_size_ = 0;
   page_version_set_ = reinterpret_cast<PageVersionAccess*>(pieces.xct_page_version_memory_);
   page_version_set_size_ = 0;
+  page_read_set_ = reinterpret_cast<PageReadAccess*>(pieces.xct_page_read_access_memory_);
+  page_read_set_size_ = 0;
+  max_page_read_set_size_ = xct_opt.max_page_read_set_size_;
   mcs_block_current_ = mcs_block_current;
   *mcs_block_current_ = 0;
   mcs_rw_async_mapping_current_ = mcs_rw_async_mapping_current;
@@ -184,6 +191,7 @@ std::ostream& operator<<(std::ostream& o, const Xct& v) {
       << "<write_set_size>" << v.get_write_set_size() << "</write_set_size>"
       << "<pointer_set_size>" << v.get_pointer_set_size() << "</pointer_set_size>"
       << "<page_version_set_size>" << v.get_page_version_set_size() << "</page_version_set_size>"
+      << "<page_read_set_size>" << v.get_page_read_set_size() << "</page_read_set_size>"
       << "<lock_free_read_set_size>" << v.get_lock_free_read_set_size()
         << "</lock_free_read_set_size>"
       << "<lock_free_write_set_size>" << v.get_lock_free_write_set_size()
@@ -255,6 +263,66 @@ ErrorCode Xct::add_to_page_version_set(
   return kErrorCodeOk;
 }
 
+ErrorCode Xct::add_to_page_read_set(
+  const storage::PageVersion* version_address,
+  storage::PageVersionStatus observed,
+  const uint16_t* key_count_address,
+  const RwLockableXctId* first_owner_id_address,
+  int32_t owner_id_stride,
+  uint16_t record_count,
+  bool* added) {
+  ASSERT_ND(version_address);
+  ASSERT_ND(key_count_address);
+  ASSERT_ND(first_owner_id_address);
+  if (isolation_level_ != kSerializable) {
+    *added = true;  // no read-set needed anyways
+    return kErrorCodeOk;
+  }
+  *added = false;
+  if (UNLIKELY(page_read_set_size_ >= max_page_read_set_size_)) {
+    DVLOG(1) << "Page read set is full. falls back to per-record read sets";
+    return kErrorCodeOk;
+  }
+
+  // We must observe the current epoch BEFORE the XctIds. If a record is modified after this,
+  // the modifying transaction commits in threshold or later. See PageReadAccess.
+  const Epoch threshold = engine_->get_xct_manager()->get_current_global_epoch().one_less();
+  assorted::memory_fence_acquire();
+
+  PageReadAccess& access = page_read_set_[page_read_set_size_];
+  access.address_ = version_address;
+  access.observed_ = observed;
+  access.record_count_ = record_count;
+  access.next_layer_count_ = 0;
+  access.owner_id_stride_ = owner_id_stride;
+  access.first_owner_id_address_ = first_owner_id_address;
+  access.key_count_address_ = key_count_address;
+  access.threshold_epoch_ = threshold;
+  access.max_observed_ = XctId();
+  for (uint16_t i = 0; i < record_count; ++i) {
+    XctId xid = access.get_owner_id_address(i)->xct_id_;
+    if (xid.is_being_written()
+      || !xid.is_valid()
+      || !xid.get_epoch().before(threshold)) {
+      // A recently modified record. We can't tell whether it will be modified again
+      // after we read it. Just use per-record read-set for this page.
+      return kErrorCodeOk;
+    }
+    if (xid.is_next_layer()) {
+      ++access.next_layer_count_;
+    }
+    if (i == 0) {
+      access.max_observed_ = xid;  // store_max() needs a valid XctId in this side
+    } else {
+      access.max_observed_.store_max(xid);
+    }
+  }
+
+  ++page_read_set_size_;
+  *added = true;
+  return kErrorCodeOk;
+}
+
 ErrorCode Xct::on_record_read(
   bool intended_for_write,
   RwLockableXctId* tid_address,
@@ -280,7 +348,9 @@ ErrorCode Xct::on_record_read(
     // Also no point to conservatively take write-locks recommended by RLL
     // because we don't take any read locks in these modes, so the
     // original SILO's write-lock protocol is enough and abort-free.
-    ASSERT_ND(isolation_level_ == kDirtyRead || isolation_level_ == kSnapshot);
+    ASSERT_ND(isolation_level_ == kDirtyRead
+      || isolation_level_ == kSnapshot
+      || isolation_level_ == kPinnedSnapshot);
     *observed_xid = tid_address->xct_id_.spin_while_being_written();
     ASSERT_ND(!observed_xid->is_being_written());
     return kErrorCodeOk;
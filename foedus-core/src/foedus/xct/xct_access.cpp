@@ -41,6 +41,17 @@ std::ostream& operator<<(std::ostream& o, const PageVersionAccess& v) {
   return o;
 }
 
+std::ostream& operator<<(std::ostream& o, const PageReadAccess& v) {
+  o << "<PageReadAccess><address>" << v.address_ << "</address>"
+    << "<observed>" << v.observed_ << "</observed>"
+    << "<record_count>" << v.record_count_ << "</record_count>"
+    << "<key_count_address>" << v.key_count_address_ << "</key_count_address>"
+    << "<next_layer_count>" << v.next_layer_count_ << "</next_layer_count>"
+    << "<threshold_epoch>" << v.threshold_epoch_ << "</threshold_epoch>"
+    << "<max_observed>" << v.max_observed_ << "</max_observed></PageReadAccess>";
+  return o;
+}
+
 std::ostream& operator<<(std::ostream& o, const ReadXctAccess& v) {
   o << "<ReadXctAccess><storage>" << v.storage_id_ << "</storage>"
 //    << "<current_lock_position_>" << v.current_lock_position_ << "</current_lock_position_>"
@@ -175,6 +175,18 @@ std::ostream& operator<<(std::ostream& o, const McsWwLock& v) {
   return o;
 }
 
+std::ostream& operator<<(std::ostream& o, const McsWwLockStat& v) {
+  o << "<McsWwLockStat lock=\"" << assorted::Hex(v.lock_address_)
+    << "\" acquires=\"" << v.acquires_
+    << "\" contended=\"" << v.contended_acquires_
+    << "\" wait_cycles=\"" << v.wait_cycles_
+    << "\" local_handovers=\"" << v.local_handovers_
+    << "\" remote_handovers=\"" << v.remote_handovers_
+    << "\" bypassed_handovers=\"" << v.bypassed_handovers_
+    << "\" />";
+  return o;
+}
+
 std::ostream& operator<<(std::ostream& o, const XctId& v) {
   o << "<XctId epoch=\"" << v.get_epoch()
     << "\" ordinal=\"" << v.get_ordinal()
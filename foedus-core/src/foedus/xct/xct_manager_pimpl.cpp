@@ -30,6 +30,7 @@
 #include "foedus/error_stack_batch.hpp"
 #include "foedus/assorted/atomic_fences.hpp"
 #include "foedus/assorted/cacheline.hpp"
+#include "foedus/assorted/hardware_transaction.hpp"
 #include "foedus/cache/cache_manager.hpp"
 #include "foedus/debugging/stop_watch.hpp"
 #include "foedus/log/log_manager.hpp"
@@ -37,10 +38,14 @@
 #include "foedus/log/thread_log_buffer.hpp"
 #include "foedus/savepoint/savepoint.hpp"
 #include "foedus/savepoint/savepoint_manager.hpp"
+#include "foedus/snapshot/snapshot_manager.hpp"
 #include "foedus/soc/soc_manager.hpp"
 #include "foedus/storage/record.hpp"
 #include "foedus/storage/storage_manager.hpp"
+#include "foedus/storage/hash/hash_log_types.hpp"
+#include "foedus/storage/masstree/masstree_log_types.hpp"
 #include "foedus/thread/thread.hpp"
+#include "foedus/thread/thread_pimpl.hpp"
 #include "foedus/thread/thread_pool.hpp"
 #include "foedus/thread/thread_ref.hpp"
 #include "foedus/xct/in_commit_epoch_guard.hpp"
@@ -89,6 +94,17 @@ ErrorStack XctManagerPimpl::initialize_once() {
   soc::SharedMemoryRepo* memory_repo = engine_->get_soc_manager()->get_shared_memory_repo();
   control_block_ = memory_repo->get_global_memory_anchors()->xct_manager_memory_;
 
+  htm_precommit_enabled_ = false;
+  if (engine_->get_options().xct_.htm_precommit_max_write_set_size_ > 0) {
+    if (assorted::is_rtm_supported()) {
+      LOG(INFO) << "This CPU supports RTM. precommit tries to elide locks of small write-sets";
+      htm_precommit_enabled_ = true;
+    } else {
+      LOG(INFO) << "htm_precommit_max_write_set_size_ is set, but this CPU does not support RTM."
+        << " precommit always takes locks";
+    }
+  }
+
   if (engine_->is_master()) {
     control_block_->initialize();
     control_block_->current_global_epoch_
@@ -139,21 +155,41 @@ void XctManagerPimpl::handle_epoch_chime() {
   SPINLOCK_WHILE(!is_stop_requested() && !is_initialized()) {
     assorted::memory_fence_acquire();
   }
-  uint64_t interval_microsec = engine_->get_options().xct_.epoch_advance_interval_ms_ * 1000ULL;
-  LOG(INFO) << "epoch_chime_thread now starts processing. interval_microsec=" << interval_microsec;
+  const XctOptions& options = engine_->get_options().xct_;
+  const bool adaptive = options.epoch_advance_target_latency_us_ > 0;
+  EpochChimeTuner tuner(options);
+  uint64_t interval_microsec = options.epoch_advance_interval_ms_ * 1000ULL;
+  if (adaptive) {
+    interval_microsec = tuner.get_interval_us();
+    control_block_->epoch_advance_interval_us_ = interval_microsec;
+  }
+  LOG(INFO) << "epoch_chime_thread now starts processing. interval_microsec=" << interval_microsec
+    << ", adaptive=" << adaptive;
+  uint32_t epochs_since_observation = 0;
+  uint64_t durable_bytes_at_observation = engine_->get_log_manager()->get_durable_bytes();
+  std::chrono::steady_clock::time_point epoch_began = std::chrono::steady_clock::now();
   while (!is_stop_requested()) {
     {
       uint64_t demand = control_block_->epoch_chime_wakeup_.acquire_ticket();
       if (is_stop_requested()) {
         break;
       }
-      if (get_requested_global_epoch() <= get_current_global_epoch())  {  // otherwise no sleep
-        bool signaled = control_block_->epoch_chime_wakeup_.timedwait(
-          demand,
-          interval_microsec,
-          soc::kDefaultPollingSpins,
-          interval_microsec);
-        VLOG(1) << "epoch_chime_thread. wokeup with " << (signaled ? "signal" : "timeout");
+      // Under heavy load, the adaptive chime doesn't cut an epoch short for waiting transactions
+      const bool honor_request = !adaptive || tuner.is_light_load();
+      if (!honor_request || get_requested_global_epoch() <= get_current_global_epoch())  {
+        uint64_t elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+          std::chrono::steady_clock::now() - epoch_began).count();
+        if (elapsed < interval_microsec) {
+          bool signaled = control_block_->epoch_chime_wakeup_.timedwait(
+            demand,
+            interval_microsec - elapsed,
+            soc::kDefaultPollingSpins,
+            interval_microsec);
+          VLOG(1) << "epoch_chime_thread. wokeup with " << (signaled ? "signal" : "timeout");
+          if (signaled && !honor_request) {
+            continue;  // sleep for the rest of the interval, unless it's for termination
+          }
+        }
       }
     }
     if (is_stop_requested()) {
@@ -178,11 +214,89 @@ void XctManagerPimpl::handle_epoch_chime() {
       assorted::memory_fence_release();
       control_block_->current_global_epoch_advanced_.signal();
     }
+    epoch_began = std::chrono::steady_clock::now();
     engine_->get_log_manager()->wakeup_loggers();
+
+    if (adaptive && ++epochs_since_observation >= EpochChimeTuner::kEpochsPerObservation) {
+      uint32_t histogram[XctManagerControlBlock::kCommitLatencyBuckets];
+      for (uint16_t i = 0; i < XctManagerControlBlock::kCommitLatencyBuckets; ++i) {
+        histogram[i] = control_block_->commit_latency_histogram_[i].exchange(0);
+      }
+      uint64_t durable_bytes = engine_->get_log_manager()->get_durable_bytes();
+      tuner.observe(
+        durable_bytes - durable_bytes_at_observation,
+        epochs_since_observation,
+        engine_->get_options().log_.loggers_per_node_ * engine_->get_soc_count(),
+        histogram);
+      durable_bytes_at_observation = durable_bytes;
+      epochs_since_observation = 0;
+      if (interval_microsec != tuner.get_interval_us()) {
+        VLOG(0) << "epoch_chime_thread. interval_microsec " << interval_microsec << " -> "
+          << tuner.get_interval_us() << ", light_load=" << tuner.is_light_load();
+      }
+      interval_microsec = tuner.get_interval_us();
+      control_block_->epoch_advance_interval_us_ = interval_microsec;
+    }
   }
   LOG(INFO) << "epoch_chime_thread ended.";
 }
 
+EpochChimeTuner::EpochChimeTuner(const XctOptions& options) {
+  target_latency_us_ = options.epoch_advance_target_latency_us_;
+  max_interval_us_ = std::max<uint32_t>(target_latency_us_ / 2U, 1U);
+  min_interval_us_ = std::min<uint32_t>(options.epoch_advance_min_interval_us_, max_interval_us_);
+  min_interval_us_ = std::max<uint32_t>(min_interval_us_, 1U);
+  uint64_t base = options.epoch_advance_interval_ms_ * 1000ULL;
+  base = std::min<uint64_t>(base, max_interval_us_);
+  base_interval_us_ = std::max<uint64_t>(base, min_interval_us_);
+  interval_us_ = base_interval_us_;
+  light_load_ = true;
+}
+
+void EpochChimeTuner::observe(
+  uint64_t durable_bytes,
+  uint32_t epochs,
+  uint16_t loggers,
+  const uint32_t* histogram) {
+  uint64_t bytes_per_epoch = durable_bytes / std::max<uint32_t>(epochs, 1U);
+  bytes_per_epoch /= std::max<uint16_t>(loggers, 1U);
+  light_load_ = bytes_per_epoch < kLightLoadBytesPerEpoch;
+
+  uint64_t latency = get_percentile_us(histogram, 99);
+  if (latency > target_latency_us_) {
+    interval_us_ = std::max<uint32_t>(interval_us_ / 2U, min_interval_us_);
+  } else if (!light_load_) {
+    if (latency * 4U <= target_latency_us_ * 3ULL) {
+      interval_us_ = std::min<uint32_t>(interval_us_ + interval_us_ / 4U + 1U, max_interval_us_);
+    }
+  } else if (interval_us_ < base_interval_us_) {
+    interval_us_ += (base_interval_us_ - interval_us_ + 1U) / 2U;
+  } else {
+    interval_us_ -= (interval_us_ - base_interval_us_ + 1U) / 2U;
+  }
+  ASSERT_ND(interval_us_ >= min_interval_us_);
+  ASSERT_ND(interval_us_ <= max_interval_us_);
+}
+
+uint64_t EpochChimeTuner::get_percentile_us(const uint32_t* histogram, uint16_t percentile) {
+  uint64_t total = 0;
+  for (uint16_t i = 0; i < XctManagerControlBlock::kCommitLatencyBuckets; ++i) {
+    total += histogram[i];
+  }
+  if (total == 0) {
+    return 0;
+  }
+  const uint64_t threshold = (total * percentile + 99U) / 100U;
+  uint64_t cumulative = 0;
+  for (uint16_t i = 0; i < XctManagerControlBlock::kCommitLatencyBuckets; ++i) {
+    cumulative += histogram[i];
+    if (cumulative >= threshold) {
+      return 1ULL << (i + 1U);
+    }
+  }
+  return 1ULL << XctManagerControlBlock::kCommitLatencyBuckets;
+}
+
 void XctManagerPimpl::handle_epoch_chime_wait_grace_period(Epoch grace_epoch) {
   ASSERT_ND(engine_->is_master());
   ASSERT_ND(grace_epoch.one_more() == get_current_global_epoch());
@@ -296,7 +410,25 @@ ErrorCode XctManagerPimpl::wait_for_commit(Epoch commit_epoch, int64_t wait_micr
     wakeup_epoch_chime_thread();
   }
 
-  return engine_->get_log_manager()->wait_until_durable(commit_epoch, wait_microseconds);
+  if (engine_->get_options().xct_.epoch_advance_target_latency_us_ == 0) {
+    return engine_->get_log_manager()->wait_until_durable(commit_epoch, wait_microseconds);
+  }
+
+  // measure the latency for the adaptive epoch chime
+  debugging::StopWatch watch;
+  ErrorCode ret = engine_->get_log_manager()->wait_until_durable(commit_epoch, wait_microseconds);
+  watch.stop();
+  if (ret == kErrorCodeOk) {
+    uint64_t latency_us = static_cast<uint64_t>(watch.elapsed_us());
+    uint16_t bucket = 0;
+    if (latency_us > 1U) {
+      bucket = std::min<uint16_t>(
+        63 - __builtin_clzll(latency_us),
+        XctManagerControlBlock::kCommitLatencyBuckets - 1U);
+    }
+    control_block_->commit_latency_histogram_[bucket].fetch_add(1U, std::memory_order_relaxed);
+  }
+  return ret;
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////
@@ -312,9 +444,19 @@ ErrorCode XctManagerPimpl::begin_xct(thread::Thread* context, IsolationLevel iso
   if (UNLIKELY(control_block_->new_transaction_paused_.load())) {
     wait_until_resume_accepting_xct(context);
   }
+  Epoch pinned_snapshot_epoch;
+  if (isolation_level == kPinnedSnapshot) {
+    // The snapshot manager publishes snapshot_epoch after it remembers the new roots,
+    // so all storages in this snapshot are guaranteed to be in SnapshotRootHistory.
+    pinned_snapshot_epoch = engine_->get_snapshot_manager()->get_snapshot_epoch();
+    if (!pinned_snapshot_epoch.is_valid()) {
+      return kErrorCodeXctNoSnapshotToPin;
+    }
+  }
   DVLOG(1) << *context << " Began new transaction."
     << " RLL size=" << current_xct.get_retrospective_lock_list()->get_last_active_entry();
   current_xct.activate(isolation_level);
+  current_xct.set_pinned_snapshot_epoch(pinned_snapshot_epoch);
   ASSERT_ND(current_xct.get_mcs_block_current() == 0);
   ASSERT_ND(context->get_thread_log_buffer().get_offset_tail()
     == context->get_thread_log_buffer().get_offset_committed());
@@ -349,7 +491,10 @@ ErrorCode XctManagerPimpl::precommit_xct(thread::Thread* context, Epoch *commit_
 
   ErrorCode result;
   bool read_only = context->get_current_xct().is_read_only();
-  if (read_only) {
+  if (UNLIKELY(!read_only && current_xct.is_pinned_to_snapshot())) {
+    // storages reject writes in the first place. this is just a safety net.
+    result = kErrorCodeXctPinnedSnapshotReadOnly;
+  } else if (read_only) {
     result = precommit_xct_readonly(context, commit_epoch);
   } else {
     result = precommit_xct_readwrite(context, commit_epoch);
@@ -366,6 +511,7 @@ ErrorCode XctManagerPimpl::precommit_xct(thread::Thread* context, Epoch *commit_
     current_xct.deactivate();
   }
   ASSERT_ND(current_xct.get_current_lock_list()->is_empty());
+  context->get_pimpl()->on_xct_end();
   return result;
 }
 ErrorCode XctManagerPimpl::precommit_xct_readonly(thread::Thread* context, Epoch *commit_epoch) {
@@ -383,6 +529,14 @@ ErrorCode XctManagerPimpl::precommit_xct_readonly(thread::Thread* context, Epoch
 
 ErrorCode XctManagerPimpl::precommit_xct_readwrite(thread::Thread* context, Epoch *commit_epoch) {
   DVLOG(1) << *context << " Committing read-write";
+  if (htm_precommit_enabled_) {
+    ErrorCode elided_ret;
+    if (precommit_xct_elided(context, commit_epoch, &elided_ret)) {
+      return elided_ret;
+    }
+    DVLOG(1) << *context << " Could not elide locks. Falling back to the usual precommit";
+  }
+
   XctId max_xct_id;
   max_xct_id.set(Epoch::kEpochInitialDurable, 1);  // TODO(Hideaki) not quite..
   ErrorCode lock_ret = precommit_xct_lock(context, &max_xct_id);  // Phase 1
@@ -428,6 +582,118 @@ ErrorCode XctManagerPimpl::precommit_xct_readwrite(thread::Thread* context, Epoc
   return kErrorCodeXctRaceAbort;
 }
 
+/**
+ * Some writes (eg MasstreeAddLogType) depend on the record state without a related read-set,
+ * which we check here after locking the record instead of verifying the read-set.
+ */
+inline bool is_blind_write_applicable(const WriteXctAccess& write) {
+  switch (write.log_entry_->header_.get_type()) {
+  case log::kLogCodeMasstreeAdd:
+    return reinterpret_cast<const storage::masstree::MasstreeAddLogType*>(
+      write.log_entry_)->is_applicable(write.owner_id_address_);
+  case log::kLogCodeHashAdd:
+    return reinterpret_cast<const storage::hash::HashAddLogType*>(
+      write.log_entry_)->is_applicable(write.owner_id_address_);
+  default:
+    return true;
+  }
+}
+
+/** Code we give to rtm_abort() when a record is locked by someone or moved. We fall back. */
+const uint8_t kHtmAbortLocked = 1;
+/** Code we give to rtm_abort() when verification failed. The transaction must abort. */
+const uint8_t kHtmAbortVerify = 2;
+/** Number of hardware transactions precommit_xct_elided() tries on transient aborts. */
+const uint16_t kHtmPrecommitMaxAttempts = 3;
+
+bool XctManagerPimpl::precommit_xct_elided(
+  thread::Thread* context,
+  Epoch* commit_epoch,
+  ErrorCode* result) {
+  ASSERT_ND(htm_precommit_enabled_);
+  Xct& current_xct = context->get_current_xct();
+  WriteXctAccess* write_set = current_xct.get_write_set();
+  const uint32_t  write_set_size = current_xct.get_write_set_size();
+  if (write_set_size == 0
+    || write_set_size > engine_->get_options().xct_.htm_precommit_max_write_set_size_
+    || !current_xct.get_current_lock_list()->is_empty()) {
+    // Locks we took before precommit (eg RLL) must be handled by the usual protocol.
+    return false;
+  }
+
+  // Same preparation as precommit_xct_lock(). Both are idempotent, so the fallback redoes them.
+  *result = precommit_xct_lock_batch_track_moved(context);
+  if (*result != kErrorCodeOk) {
+    return true;
+  }
+  precommit_xct_sort_access(context);
+
+  // Same as precommit_xct_readwrite(). See InCommitEpochGuard.
+  Epoch conservative_epoch = get_current_global_epoch_weak();
+  InCommitEpochGuard guard(context->get_in_commit_epoch_address(), conservative_epoch);
+  assorted::memory_fence_acq_rel();
+
+  for (uint16_t attempt = 0; attempt < kHtmPrecommitMaxAttempts; ++attempt) {
+    XctId max_xct_id;
+    max_xct_id.set(Epoch::kEpochInitialDurable, 1);
+    const uint32_t status = assorted::rtm_begin();
+    if (status == assorted::kRtmStarted) {
+      // Phase 1 without locks. Reading the lock words puts them in the read-set of the
+      // hardware transaction, so anyone who locks them until rtm_end() aborts us.
+      // We also mark them as locked so that apply sees the same record state as with locks
+      // (eg log apply methods assert is_keylocked()). Nobody can observe the mark because
+      // we clear it before rtm_end(). This doesn't cost an additional cacheline write
+      // because apply writes xct_id_ next to the lock word anyway.
+      for (uint32_t i = 0; i < write_set_size; ++i) {
+        RwLockableXctId* owner = write_set[i].owner_id_address_;
+        if (i == 0 || owner != write_set[i - 1].owner_id_address_) {
+          if (owner->is_keylocked() || owner->needs_track_moved()) {
+            assorted::rtm_abort<kHtmAbortLocked>();
+          }
+          max_xct_id.store_max(owner->xct_id_);
+          owner->lock_.tail_ |= 0xFFFFU;
+        }
+        if (write_set[i].related_read_
+          && owner->xct_id_ != write_set[i].related_read_->observed_owner_id_) {
+          assorted::rtm_abort<kHtmAbortVerify>();
+        } else if (!write_set[i].related_read_ && !is_blind_write_applicable(write_set[i])) {
+          assorted::rtm_abort<kHtmAbortVerify>();
+        }
+      }
+
+      *commit_epoch = get_current_global_epoch_weak();  // serialization point!
+      if (!precommit_xct_verify_readwrite(context, &max_xct_id)) {  // phase 2
+        assorted::rtm_abort<kHtmAbortVerify>();
+      }
+      precommit_xct_apply(context, max_xct_id, commit_epoch);  // phase 3
+      for (uint32_t i = 0; i < write_set_size; ++i) {
+        write_set[i].owner_id_address_->lock_.tail_ &= ~0xFFFFU;
+      }
+      assorted::rtm_end();
+
+      // announce log AFTER apply, same as precommit_xct_readwrite().
+      assorted::memory_fence_release();
+      if (engine_->get_options().log_.emulation_.null_device_) {
+        context->get_thread_log_buffer().discard_current_xct_log();
+      } else {
+        context->get_thread_log_buffer().publish_committed_log(*commit_epoch);
+      }
+      context->increment_htm_elided_commits();
+      *result = kErrorCodeOk;
+      return true;
+    }
+
+    if ((status & assorted::kRtmAbortExplicit)
+      && assorted::rtm_abort_code(status) == kHtmAbortVerify) {
+      DVLOG(1) << *context << " Verification failed in hardware transaction. will abort";
+      *result = kErrorCodeXctRaceAbort;
+      return true;
+    } else if ((status & assorted::kRtmAbortRetry) == 0) {
+      break;  // locked records, capacity, system calls, etc. Retrying wouldn't help.
+    }
+  }
+  return false;
+}
 
 bool XctManagerPimpl::precommit_xct_lock_track_write(
   thread::Thread* context, WriteXctAccess* entry) {
@@ -630,6 +896,9 @@ moved_retry:
         if (r->owner_id_address_->xct_id_ != r->related_read_->observed_owner_id_) {
           return kErrorCodeXctRaceAbort;
         }
+      } else if (UNLIKELY(!is_blind_write_applicable(*r))) {
+        DVLOG(1) << *context << " The record of a blind add got deleted or shrunk";
+        return kErrorCodeXctRaceAbort;
       }
     }
   }
@@ -645,68 +914,150 @@ moved_retry:
 
 const uint16_t kReadsetPrefetchBatch = 16;
 
+/** Prefetches owner_id of read-set entries in [from, to). */
+template <typename ACCESS>
+inline void prefetch_read_set_block(const ACCESS* read_set, uint32_t from, uint32_t to) {
+  for (uint32_t i = from; i < to; ++i) {
+    assorted::prefetch_cacheline(read_set[i].owner_id_address_);
+  }
+}
+
+/**
+ * @brief Verifies read-set entries in [from, to) without branching on each entry.
+ * @return whether all of them are surely fine, in which case the highest observed XctId among
+ * them is stored to max_observed. When this returns false, the caller must check the entries
+ * one by one, which tells what exactly happened (it might be a moved record, not an abort).
+ * @details
+ * The entries point to scattered records, so the bottleneck is the cache misses rather than
+ * the comparisons. The caller prefetches the next block while we check this block, and we
+ * merely OR up all bits that need attention: different XctId, observed being_written,
+ * and moved/next-layer records, which are rare. Hence, the common case has no
+ * data-dependent branches and the loads on the entries are independent of each other.
+ */
+template <typename ACCESS>
+inline bool verify_read_set_block_fast(
+  const ACCESS* read_set,
+  uint32_t from,
+  uint32_t to,
+  XctId* max_observed) {
+  uint64_t anomaly = 0;
+  for (uint32_t i = from; i < to; ++i) {
+    const uint64_t observed = read_set[i].observed_owner_id_.data_;
+    const uint64_t now = read_set[i].owner_id_address_->xct_id_.data_;
+    anomaly |= (observed ^ now)
+      | (observed & kXctIdBeingWrittenBit)
+      | (now & (kXctIdMovedBit | kXctIdNextLayerBit));
+  }
+  if (UNLIKELY(anomaly != 0)) {
+    return false;
+  }
+  // XctId::store_max() needs a valid epoch in this side, so start from the first one
+  ASSERT_ND(from < to);
+  *max_observed = read_set[from].observed_owner_id_;
+  for (uint32_t i = from + 1U; i < to; ++i) {
+    max_observed->store_max(read_set[i].observed_owner_id_);
+  }
+  return true;
+}
+
 bool XctManagerPimpl::precommit_xct_verify_readonly(thread::Thread* context, Epoch *commit_epoch) {
   Xct& current_xct = context->get_current_xct();
   ReadXctAccess*    read_set = current_xct.get_read_set();
   const uint32_t    read_set_size = current_xct.get_read_set_size();
   storage::StorageManager* st = engine_->get_storage_manager();
-  for (uint32_t i = 0; i < read_set_size; ++i) {
-    ASSERT_ND(read_set[i].related_write_ == nullptr);
-    // let's prefetch owner_id in parallel
-    if (i % kReadsetPrefetchBatch == 0) {
-      for (uint32_t j = i; j < i + kReadsetPrefetchBatch && j < read_set_size; ++j) {
-        assorted::prefetch_cacheline(read_set[j].owner_id_address_);
-      }
-    }
-
-    ReadXctAccess& access = read_set[i];
-    DVLOG(2) << *context << "Verifying " << st->get_name(access.storage_id_)
-      << ":" << access.owner_id_address_ << ". observed_xid=" << access.observed_owner_id_
-        << ", now_xid=" << access.owner_id_address_->xct_id_;
-    if (UNLIKELY(access.observed_owner_id_.is_being_written())) {
-      // safety net. observing this case.
-      // hm, this should be checked and retried during transaction.
-      // probably there still is some code to forget that.
-      // At least safe to abort here, so keep it this way for now.
-      DLOG(WARNING) << *context << "?? this should have been checked. being_written! will abort";
-      return false;
+  // We verify kReadsetPrefetchBatch entries at a time while prefetching the next block.
+  prefetch_read_set_block(read_set, 0, std::min<uint32_t>(kReadsetPrefetchBatch, read_set_size));
+  for (uint32_t from = 0; from < read_set_size; from += kReadsetPrefetchBatch) {
+    const uint32_t to = std::min<uint32_t>(from + kReadsetPrefetchBatch, read_set_size);
+    prefetch_read_set_block(
+      read_set,
+      to,
+      std::min<uint32_t>(to + kReadsetPrefetchBatch, read_set_size));
+    XctId block_max;
+    if (LIKELY(verify_read_set_block_fast(read_set, from, to, &block_max))) {
+      // Remembers the highest epoch observed.
+      commit_epoch->store_max(block_max.get_epoch());
+      continue;
     }
 
-    // Implementation Note: we do verify the versions whether we took a lock on this record or not.
-    // In a sentence, this is the simplest and most reliable while wasted cost is not that much.
+    // Something needs attention in this block. Check them one by one.
+    for (uint32_t i = from; i < to; ++i) {
+      ReadXctAccess& access = read_set[i];
+      ASSERT_ND(access.related_write_ == nullptr);
+      DVLOG(2) << *context << "Verifying " << st->get_name(access.storage_id_)
+        << ":" << access.owner_id_address_ << ". observed_xid=" << access.observed_owner_id_
+          << ", now_xid=" << access.owner_id_address_->xct_id_;
+      if (UNLIKELY(access.observed_owner_id_.is_being_written())) {
+        // safety net. observing this case.
+        // hm, this should be checked and retried during transaction.
+        // probably there still is some code to forget that.
+        // At least safe to abort here, so keep it this way for now.
+        DLOG(WARNING) << *context << "?? this should have been checked. being_written! will abort";
+        return false;
+      }
 
-    // In a paragraph.. We could check whether it's locked, and in \e some case skip verification,
-    // but think of case 1) read A without read-lock, later take a write-lock on A due to RLL.
-    // also case 2) read A without read-lock, then read A again but this time with read-lock.
-    // Yes, we could rule these cases out by checking something for each read/write,
-    // but that's fragile. too much complexity for little. we just verify always. period.
-    if (UNLIKELY(access.owner_id_address_->needs_track_moved())) {
-      if (!precommit_xct_verify_track_read(context, &access)) {
+      // Implementation Note: we do verify the versions whether we took a lock on this record or
+      // not. In a sentence, this is the simplest and most reliable while wasted cost is not that
+      // much.
+
+      // In a paragraph.. We could check whether it's locked, and in \e some case skip
+      // verification, but think of case 1) read A without read-lock, later take a write-lock on A
+      // due to RLL. also case 2) read A without read-lock, then read A again but this time with
+      // read-lock. Yes, we could rule these cases out by checking something for each read/write,
+      // but that's fragile. too much complexity for little. we just verify always. period.
+      if (UNLIKELY(access.owner_id_address_->needs_track_moved())) {
+        if (!precommit_xct_verify_track_read(context, &access)) {
+          return false;
+        }
+      }
+      if (access.observed_owner_id_ != access.owner_id_address_->xct_id_) {
+        DLOG(WARNING) << *context << " read set changed by other transaction. will abort";
+        // read clobbered
         return false;
       }
-    }
-    if (access.observed_owner_id_ != access.owner_id_address_->xct_id_) {
-      DLOG(WARNING) << *context << " read set changed by other transaction. will abort";
-      // read clobbered
-      return false;
-    }
 
-    // Remembers the highest epoch observed.
-    commit_epoch->store_max(access.observed_owner_id_.get_epoch());
+      // Remembers the highest epoch observed.
+      commit_epoch->store_max(access.observed_owner_id_.get_epoch());
+    }
   }
 
   // Check lock-free read-set, which is a bit simpler.
   LockFreeReadXctAccess* lock_free_read_set = current_xct.get_lock_free_read_set();
   const uint32_t    lock_free_read_set_size = current_xct.get_lock_free_read_set_size();
-  for (uint32_t i = 0; i < lock_free_read_set_size; ++i) {
-    const LockFreeReadXctAccess& access = lock_free_read_set[i];
-    ASSERT_ND(!access.owner_id_address_->needs_track_moved());
-    if (access.observed_owner_id_ != access.owner_id_address_->xct_id_) {
-      DLOG(WARNING) << *context << " lock free read set changed by other transaction. will abort";
-      return false;
+  prefetch_read_set_block(
+    lock_free_read_set,
+    0,
+    std::min<uint32_t>(kReadsetPrefetchBatch, lock_free_read_set_size));
+  for (uint32_t from = 0; from < lock_free_read_set_size; from += kReadsetPrefetchBatch) {
+    const uint32_t to = std::min<uint32_t>(from + kReadsetPrefetchBatch, lock_free_read_set_size);
+    prefetch_read_set_block(
+      lock_free_read_set,
+      to,
+      std::min<uint32_t>(to + kReadsetPrefetchBatch, lock_free_read_set_size));
+    XctId block_max;
+    if (LIKELY(verify_read_set_block_fast(lock_free_read_set, from, to, &block_max))) {
+      commit_epoch->store_max(block_max.get_epoch());
+      continue;
+    }
+    for (uint32_t i = from; i < to; ++i) {
+      const LockFreeReadXctAccess& access = lock_free_read_set[i];
+      ASSERT_ND(!access.owner_id_address_->needs_track_moved());
+      if (access.observed_owner_id_ != access.owner_id_address_->xct_id_) {
+        DLOG(WARNING) << *context
+          << " lock free read set changed by other transaction. will abort";
+        return false;
+      }
+
+      commit_epoch->store_max(access.observed_owner_id_.get_epoch());
     }
+  }
 
-    commit_epoch->store_max(access.observed_owner_id_.get_epoch());
+  XctId page_read_max;
+  if (!precommit_xct_verify_page_read_set(context, &page_read_max)) {
+    return false;
+  }
+  if (page_read_max.is_valid()) {
+    commit_epoch->store_max(page_read_max.get_epoch());
   }
 
   DVLOG(1) << *context << "Read-only higest epoch observed: " << *commit_epoch;
@@ -732,90 +1083,120 @@ bool XctManagerPimpl::precommit_xct_verify_readwrite(thread::Thread* context, Xc
   Xct& current_xct = context->get_current_xct();
   ReadXctAccess*          read_set = current_xct.get_read_set();
   const uint32_t          read_set_size = current_xct.get_read_set_size();
-  for (uint32_t i = 0; i < read_set_size; ++i) {
-    // let's prefetch owner_id in parallel
-    if (i % kReadsetPrefetchBatch == 0) {
-      for (uint32_t j = i; j < i + kReadsetPrefetchBatch && j < read_set_size; ++j) {
-        if (read_set[j].related_write_ == nullptr) {
-          assorted::prefetch_cacheline(read_set[j].owner_id_address_);
-        }
-      }
-    }
-    // The owning transaction has changed.
-    // We don't check ordinal here because there is no change we are racing with ourselves.
-    ReadXctAccess& access = read_set[i];
-    if (UNLIKELY(access.observed_owner_id_.is_being_written())) {
-      // same as above.
-      DLOG(WARNING) << *context << "?? this should have been checked. being_written! will abort";
-      return false;
-    }
-    storage::StorageManager* st = engine_->get_storage_manager();
-    if (access.related_write_) {
-      // we already checked this in lock()
-      DVLOG(3) << *context << " skipped read-sets that are already checked";
-      ASSERT_ND(access.observed_owner_id_ == access.owner_id_address_->xct_id_);
+  storage::StorageManager* st = engine_->get_storage_manager();
+  // Same as precommit_xct_verify_readonly. Entries with related_write_ were checked in lock(),
+  // but they are still unchanged now, so we don't bother excluding them from the fast path.
+  // Their XctIds are already in max_xct_id, too.
+  prefetch_read_set_block(read_set, 0, std::min<uint32_t>(kReadsetPrefetchBatch, read_set_size));
+  for (uint32_t from = 0; from < read_set_size; from += kReadsetPrefetchBatch) {
+    const uint32_t to = std::min<uint32_t>(from + kReadsetPrefetchBatch, read_set_size);
+    prefetch_read_set_block(
+      read_set,
+      to,
+      std::min<uint32_t>(to + kReadsetPrefetchBatch, read_set_size));
+    XctId block_max;
+    if (LIKELY(verify_read_set_block_fast(read_set, from, to, &block_max))) {
+      max_xct_id->store_max(block_max);
       continue;
     }
-    DVLOG(2) << *context << " Verifying " << st->get_name(access.storage_id_)
-      << ":" << access.owner_id_address_ << ". observed_xid=" << access.observed_owner_id_
-        << ", now_xid=" << access.owner_id_address_->xct_id_;
-    // As noted in precommit_xct_verify_readonly, we verify read-set whether it's locked or not.
 
-    // read-set has to also track moved records.
-    // however, unlike write-set locks, we don't have to do retry-loop.
-    // if the rare event (yet another concurrent split) happens, we just abort the transaction.
-    if (UNLIKELY(access.owner_id_address_->needs_track_moved())) {
-      if (!precommit_xct_verify_track_read(context, &access)) {
+    for (uint32_t i = from; i < to; ++i) {
+      // The owning transaction has changed.
+      // We don't check ordinal here because there is no change we are racing with ourselves.
+      ReadXctAccess& access = read_set[i];
+      if (UNLIKELY(access.observed_owner_id_.is_being_written())) {
+        // same as above.
+        DLOG(WARNING) << *context << "?? this should have been checked. being_written! will abort";
         return false;
       }
-    }
-
-    if (access.observed_owner_id_ != access.owner_id_address_->xct_id_) {
-      DVLOG(1) << *context << " read set changed by other transaction. will abort";
-      // same as read_only
-      return false;
-    }
+      if (access.related_write_) {
+        // we already checked this in lock()
+        DVLOG(3) << *context << " skipped read-sets that are already checked";
+        ASSERT_ND(access.observed_owner_id_ == access.owner_id_address_->xct_id_);
+        continue;
+      }
+      DVLOG(2) << *context << " Verifying " << st->get_name(access.storage_id_)
+        << ":" << access.owner_id_address_ << ". observed_xid=" << access.observed_owner_id_
+          << ", now_xid=" << access.owner_id_address_->xct_id_;
+      // As noted in precommit_xct_verify_readonly, we verify read-set whether it's locked or not.
+
+      // read-set has to also track moved records.
+      // however, unlike write-set locks, we don't have to do retry-loop.
+      // if the rare event (yet another concurrent split) happens, we just abort the transaction.
+      if (UNLIKELY(access.owner_id_address_->needs_track_moved())) {
+        if (!precommit_xct_verify_track_read(context, &access)) {
+          return false;
+        }
+      }
 
-    /*
-    // Hideaki[2016Feb] I think I remember why I kept this here. When we didn't have the
-    // "being_written" flag, we did need it even after splitting XID/TID.
-    // But, now that we have it in XID, it's surely safe without this.
-    // Still.. in case I miss something, I leave it here commented out.
-
-    // Hideaki: Umm, after several changes, I'm now not sure if we still need this check.
-    // As far as XID hasn't changed, do we care whether others locked it or not?
-    // Thanks to the separation of XID and Lock-word, I think this is now unnecessary.
-    // If it's our own lock, we haven't applied our changes yet, so safe. If it's other's lock,
-    // why do we care as far as XID hasn'nt changed? Everyone updates XID -> unlocks in this order.
-    // Anyways, we are in the course of a bigger change, so revisit it later.
-    if (access.owner_id_address_->is_keylocked()) {
-      DVLOG(2) << *context
-        << " read set contained a locked record. was it myself who locked it?";
-      LockListPosition my_lock_pos = cll->binary_search(access.owner_id_address_);
-      if (my_lock_pos != kLockListPositionInvalid && cll->get_array()[my_lock_pos].is_locked()) {
-        DVLOG(2) << *context << " okay, myself. go on.";
-      } else {
-        DVLOG(1) << *context << " no, not me. will abort";
+      if (access.observed_owner_id_ != access.owner_id_address_->xct_id_) {
+        DVLOG(1) << *context << " read set changed by other transaction. will abort";
+        // same as read_only
         return false;
       }
+
+      /*
+      // Hideaki[2016Feb] I think I remember why I kept this here. When we didn't have the
+      // "being_written" flag, we did need it even after splitting XID/TID.
+      // But, now that we have it in XID, it's surely safe without this.
+      // Still.. in case I miss something, I leave it here commented out.
+
+      // Hideaki: Umm, after several changes, I'm now not sure if we still need this check.
+      // As far as XID hasn't changed, do we care whether others locked it or not?
+      // Thanks to the separation of XID and Lock-word, I think this is now unnecessary.
+      // If it's our own lock, we haven't applied our changes yet, so safe. If it's other's
+      // lock, why do we care as far as XID hasn'nt changed? Everyone updates XID -> unlocks in
+      // this order.
+      // Anyways, we are in the course of a bigger change, so revisit it later.
+      if (access.owner_id_address_->is_keylocked()) {
+        DVLOG(2) << *context
+          << " read set contained a locked record. was it myself who locked it?";
+        LockListPosition my_lock_pos = cll->binary_search(access.owner_id_address_);
+        if (my_lock_pos != kLockListPositionInvalid && cll->get_array()[my_lock_pos].is_locked()) {
+          DVLOG(2) << *context << " okay, myself. go on.";
+        } else {
+          DVLOG(1) << *context << " no, not me. will abort";
+          return false;
+        }
+      }
+      */
+      max_xct_id->store_max(access.observed_owner_id_);
     }
-    */
-    max_xct_id->store_max(access.observed_owner_id_);
   }
 
   // Check Page Pointer/Version
   // Check lock-free read-set, which is a bit simpler.
   LockFreeReadXctAccess* lock_free_read_set = current_xct.get_lock_free_read_set();
   const uint32_t    lock_free_read_set_size = current_xct.get_lock_free_read_set_size();
-  for (uint32_t i = 0; i < lock_free_read_set_size; ++i) {
-    const LockFreeReadXctAccess& access = lock_free_read_set[i];
-    ASSERT_ND(!access.owner_id_address_->needs_track_moved());
-    if (access.observed_owner_id_ != access.owner_id_address_->xct_id_) {
-      DLOG(WARNING) << *context << " lock free read set changed by other transaction. will abort";
-      return false;
+  prefetch_read_set_block(
+    lock_free_read_set,
+    0,
+    std::min<uint32_t>(kReadsetPrefetchBatch, lock_free_read_set_size));
+  for (uint32_t from = 0; from < lock_free_read_set_size; from += kReadsetPrefetchBatch) {
+    const uint32_t to = std::min<uint32_t>(from + kReadsetPrefetchBatch, lock_free_read_set_size);
+    prefetch_read_set_block(
+      lock_free_read_set,
+      to,
+      std::min<uint32_t>(to + kReadsetPrefetchBatch, lock_free_read_set_size));
+    XctId block_max;  // not used. lock-free reads don't affect the XctId of this transaction
+    if (LIKELY(verify_read_set_block_fast(lock_free_read_set, from, to, &block_max))) {
+      continue;
+    }
+    for (uint32_t i = from; i < to; ++i) {
+      const LockFreeReadXctAccess& access = lock_free_read_set[i];
+      ASSERT_ND(!access.owner_id_address_->needs_track_moved());
+      if (access.observed_owner_id_ != access.owner_id_address_->xct_id_) {
+        DLOG(WARNING) << *context
+          << " lock free read set changed by other transaction. will abort";
+        return false;
+      }
     }
   }
 
+  if (!precommit_xct_verify_page_read_set(context, max_xct_id)) {
+    return false;
+  }
+
   if (!precommit_xct_verify_pointer_set(context)) {
     return false;
   } else if (!precommit_xct_verify_page_version_set(context)) {
@@ -865,6 +1246,53 @@ bool XctManagerPimpl::precommit_xct_verify_page_version_set(thread::Thread* cont
   return true;
 }
 
+bool XctManagerPimpl::precommit_xct_verify_page_read_set(
+  thread::Thread* context,
+  XctId* max_observed) {
+  const Xct& current_xct = context->get_current_xct();
+  const PageReadAccess* page_read_set = current_xct.get_page_read_set();
+  const uint32_t        page_read_set_size = current_xct.get_page_read_set_size();
+  for (uint32_t i = 0; i < page_read_set_size; ++i) {
+    const PageReadAccess& access = page_read_set[i];
+    if (access.address_->status_ != access.observed_) {
+      DLOG(WARNING) << *context << " page version of page read set is changed. will abort"
+        " observed=" << access.observed_ << ", now=" << access.address_->status_;
+      return false;
+    }
+    // Inserts don't change the page version. See PageReadAccess.
+    if (UNLIKELY(*access.key_count_address_ != access.record_count_)) {
+      DVLOG(1) << *context << " a record was inserted to a page in page read set. will abort"
+        " observed=" << access.record_count_ << ", now=" << *access.key_count_address_;
+      return false;
+    }
+    // See PageReadAccess. Each record must be still older than threshold_epoch_.
+    // The records are in one page, so no prefetching needed.
+    uint16_t next_layer_count = 0;
+    for (uint16_t j = 0; j < access.record_count_; ++j) {
+      XctId now = access.get_owner_id_address(j)->xct_id_;
+      if (UNLIKELY(now.is_being_written()
+        || !now.is_valid()
+        || !now.get_epoch().before(access.threshold_epoch_))) {
+        DVLOG(1) << *context << " a record in page read set might be changed. will abort";
+        return false;
+      }
+      if (now.is_next_layer()) {
+        ++next_layer_count;
+      }
+    }
+    if (UNLIKELY(next_layer_count != access.next_layer_count_)) {
+      DVLOG(1) << *context << " a record in page read set became next layer. will abort";
+      return false;
+    }
+    if (max_observed->is_valid()) {
+      max_observed->store_max(access.max_observed_);
+    } else {
+      *max_observed = access.max_observed_;
+    }
+  }
+  return true;
+}
+
 void XctManagerPimpl::precommit_xct_apply(
   thread::Thread* context,
   XctId max_xct_id,
@@ -991,6 +1419,7 @@ ErrorCode XctManagerPimpl::abort_xct(thread::Thread* context) {
   release_and_clear_all_current_locks(context);
   current_xct.deactivate();
   context->get_thread_log_buffer().discard_current_xct_log();
+  context->get_pimpl()->on_xct_end();
   return kErrorCodeOk;
 }
 
@@ -24,6 +24,8 @@
 #include "foedus/assert_nd.hpp"
 #include "foedus/assorted/atomic_fences.hpp"
 #include "foedus/assorted/spin_until_impl.hpp"
+#include "foedus/debugging/rdtsc.hpp"
+#include "foedus/thread/thread_id.hpp"
 #include "foedus/thread/thread_pimpl.hpp"  // just for explicit instantiation at the end
 #include "foedus/xct/xct_id.hpp"
 #include "foedus/xct/xct_mcs_adapter_impl.hpp"
@@ -31,6 +33,12 @@
 namespace foedus {
 namespace xct {
 
+/**
+ * How many waiters after the direct successor a NUMA-aware handover looks at.
+ * Each of them is a remote cache miss, so we don't go far.
+ */
+const uint32_t kMcsWwNumaHandoverScanLength = 4;
+
 inline void assert_mcs_aligned(const void* address) {
   ASSERT_ND(address);
   ASSERT_ND(reinterpret_cast<uintptr_t>(address) % 8 == 0);
@@ -69,6 +77,7 @@ McsBlockIndex McsWwImpl<ADAPTOR>::acquire_unconditional(McsWwLock* mcs_lock) {
   const thread::ThreadId id = adaptor_.get_my_id();
   McsWwBlockData desired(id, block_index);  // purely local copy. okay to be always relaxed.
   McsWwBlockData group_tail = desired;      // purely local copy. okay to be always relaxed.
+  McsWwLockStat* stat = adaptor_.get_ww_lock_stat(mcs_lock);
   auto* address = &(mcs_lock->tail_);     // be careful on this one!
   assert_mcs_aligned(address);
 
@@ -95,6 +104,9 @@ McsBlockIndex McsWwImpl<ADAPTOR>::acquire_unconditional(McsWwLock* mcs_lock) {
       DVLOG(2) << "Okay, got a lock uncontended. me=" << id;
       me_waiting->store(false, std::memory_order_release);
       ASSERT_ND(address->is_valid_atomic());
+      if (UNLIKELY(stat)) {
+        ++stat->acquires_;
+      }
       return block_index;
     } else if (UNLIKELY(pred.is_guest_relaxed())) {
       // ouch, I don't want to keep the guest ID! return it back.
@@ -120,12 +132,18 @@ McsBlockIndex McsWwImpl<ADAPTOR>::acquire_unconditional(McsWwLock* mcs_lock) {
   McsWwBlock* pred_block = adaptor_.get_ww_other_block(predecessor_id, predecessor_block);
   ASSERT_ND(!pred_block->has_successor_atomic());
 
+  const uint64_t wait_start = UNLIKELY(stat) ? debugging::get_rdtsc() : 0;
   pred_block->set_successor_release(id, block_index);
 
   ASSERT_ND(address->is_valid_atomic());
   ASSERT_ND(!address->is_guest_atomic());
   spin_until([me_waiting]{ return !me_waiting->load(std::memory_order_acquire); });
   DVLOG(1) << "Okay, now I hold the lock. me=" << id << ", ex-pred=" << predecessor_id;
+  if (UNLIKELY(stat)) {
+    ++stat->acquires_;
+    ++stat->contended_acquires_;
+    stat->wait_cycles_ += debugging::get_rdtsc() - wait_start;
+  }
   ASSERT_ND(!me_waiting->load());
   ASSERT_ND(mcs_lock->is_locked());
   ASSERT_ND(address->is_valid_atomic());
@@ -167,6 +185,10 @@ McsBlockIndex McsWwImpl<ADAPTOR>::acquire_try(McsWwLock* mcs_lock) {
     ASSERT_ND(!address->is_guest_atomic());
     ASSERT_ND(!pred.is_valid_relaxed());
     ASSERT_ND(!adaptor_.me_waiting()->load());
+    McsWwLockStat* stat = adaptor_.get_ww_lock_stat(mcs_lock);
+    if (UNLIKELY(stat)) {
+      ++stat->acquires_;
+    }
     return block_index;  // we got it!
   }
 
@@ -253,7 +275,8 @@ void McsWwImpl<ADAPTOR>::release(McsWwLock* mcs_lock, McsBlockIndex block_index)
   }
   // Relax: In either case above, we confirmed that block->has_successor with fences.
   // We thus can just read in relaxed mode here.
-  thread::ThreadId successor_id = block->get_successor_thread_id_relaxed();
+  const McsWwBlockData successor = block->successor_.copy_once();
+  thread::ThreadId successor_id = successor.get_thread_id_relaxed();
   DVLOG(1) << "Okay, I have a successor. me=" << id << ", succ=" << successor_id;
   ASSERT_ND(successor_id != id);
   ASSERT_ND(address->copy_atomic() != myself);
@@ -261,11 +284,74 @@ void McsWwImpl<ADAPTOR>::release(McsWwLock* mcs_lock, McsBlockIndex block_index)
   ASSERT_ND(adaptor_.other_waiting(successor_id)->load());
   ASSERT_ND(mcs_lock->is_locked());
 
+  McsWwLockStat* stat = adaptor_.get_ww_lock_stat(mcs_lock);
+  if (thread::decompose_numa_node(successor_id) != adaptor_.get_my_numa_node()) {
+    // The limit is 0 unless NUMA-aware handover is enabled, so this is just one compare.
+    if (successor.get_bypass_count_relaxed() < adaptor_.get_ww_numa_handover_limit()
+      && handover_to_local_waiter(successor)) {
+      if (UNLIKELY(stat)) {
+        ++stat->local_handovers_;
+        ++stat->bypassed_handovers_;
+      }
+      return;
+    }
+    if (UNLIKELY(stat)) {
+      ++stat->remote_handovers_;
+    }
+  } else if (UNLIKELY(stat)) {
+    ++stat->local_handovers_;
+  }
+
   ASSERT_ND(address->copy_atomic() != myself);
   adaptor_.other_waiting(successor_id)->store(false, std::memory_order_release);
   ASSERT_ND(address->copy_atomic() != myself);
 }
 
+template <typename ADAPTOR>
+bool McsWwImpl<ADAPTOR>::handover_to_local_waiter(McsWwBlockData successor) {
+  // We are still the lock owner. We relink only waiters whose successor_ is already set.
+  // No one else writes to such successor_ any more, and a waiter doesn't read its successor_
+  // until it gets the lock, which happens after our release-stores below.
+  // We never relink the tail waiter because a new waiter might be linking itself to it.
+  // We thus don't need any atomic operation here.
+  const thread::ThreadGroupId my_node = adaptor_.get_my_numa_node();
+  const uint32_t successor_id = successor.get_thread_id_relaxed();
+  const McsBlockIndex successor_block = successor.get_block_relaxed();
+  const uint16_t bypass_count = successor.get_bypass_count_relaxed();
+  McsWwBlock* prev_block = adaptor_.get_ww_other_block(successor_id, successor_block);
+  for (uint32_t i = 0; i < kMcsWwNumaHandoverScanLength; ++i) {
+    const McsWwBlockData cur = prev_block->successor_.copy_acquire();
+    if (!cur.is_valid_relaxed()) {
+      return false;  // prev is the tail, or its successor is still linking itself
+    }
+    const thread::ThreadId cur_id = cur.get_thread_id_relaxed();
+    McsWwBlock* cur_block = adaptor_.get_ww_other_block(cur_id, cur.get_block_relaxed());
+    if (thread::decompose_numa_node(cur_id) != my_node) {
+      prev_block = cur_block;
+      continue;
+    }
+
+    const McsWwBlockData next = cur_block->successor_.copy_acquire();
+    if (!next.is_valid_relaxed()) {
+      return false;  // cur might be the tail. Then we can't unlink it without the lock word
+    }
+    ASSERT_ND(adaptor_.other_waiting(cur_id)->load());
+    // Unlink cur, then put it in front of the bypassed waiters.
+    // The bypass count goes with the link to the first bypassed waiter.
+    prev_block->successor_.set_release(next.get_thread_id_relaxed(), next.get_block_relaxed());
+    cur_block->successor_.set_combined_release(
+      McsWwBlockData::combine(
+        successor_id,
+        successor_block,
+        static_cast<uint16_t>(bypass_count + 1U)));
+    DVLOG(1) << "NUMA-aware handover. me=" << adaptor_.get_my_id() << ", succ=" << cur_id
+      << ", bypassed=" << successor_id << ", bypass_count=" << bypass_count + 1U;
+    adaptor_.other_waiting(cur_id)->store(false, std::memory_order_release);
+    return true;
+  }
+  return false;
+}
+
 //////////////////////////////////////////////////////////////
 ///  Ownerless interface for WW-lock implementations
 //////////////////////////////////////////////////////////////
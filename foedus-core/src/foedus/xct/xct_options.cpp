@@ -24,12 +24,18 @@ XctOptions::XctOptions() {
   max_write_set_size_ = kDefaultMaxWriteSetSize;
   max_lock_free_read_set_size_ = kDefaultMaxLockFreeReadSetSize;
   max_lock_free_write_set_size_ = kDefaultMaxLockFreeWriteSetSize;
+  max_page_read_set_size_ = kDefaultMaxPageReadSetSize;
   local_work_memory_size_mb_ = kDefaultLocalWorkMemorySizeMb;
   epoch_advance_interval_ms_ = kDefaultEpochAdvanceIntervalMs;
+  epoch_advance_target_latency_us_ = kDefaultEpochAdvanceTargetLatencyUs;
+  epoch_advance_min_interval_us_ = kDefaultEpochAdvanceMinIntervalUs;
   enable_retrospective_lock_list_ = false;  // TODO(Hideaki) tentative!
   hot_threshold_for_retrospective_lock_list_ = kDefaultHotThreshold;
   force_canonical_xlocks_in_precommit_ = true;  // TODO(Hideaki) tentative!
   mcs_implementation_type_ = kMcsImplementationTypeSimple;
+  mcs_ww_numa_handover_limit_ = 0;
+  enable_mcs_ww_lock_stats_ = false;
+  htm_precommit_max_write_set_size_ = 0;
 }
 
 ErrorStack XctOptions::load(tinyxml2::XMLElement* element) {
@@ -37,12 +43,18 @@ ErrorStack XctOptions::load(tinyxml2::XMLElement* element) {
   EXTERNALIZE_LOAD_ELEMENT(element, max_write_set_size_);
   EXTERNALIZE_LOAD_ELEMENT(element, max_lock_free_read_set_size_);
   EXTERNALIZE_LOAD_ELEMENT(element, max_lock_free_write_set_size_);
+  EXTERNALIZE_LOAD_ELEMENT(element, max_page_read_set_size_);
   EXTERNALIZE_LOAD_ELEMENT(element, local_work_memory_size_mb_);
   EXTERNALIZE_LOAD_ELEMENT(element, epoch_advance_interval_ms_);
+  EXTERNALIZE_LOAD_ELEMENT(element, epoch_advance_target_latency_us_);
+  EXTERNALIZE_LOAD_ELEMENT(element, epoch_advance_min_interval_us_);
   EXTERNALIZE_LOAD_ELEMENT(element, enable_retrospective_lock_list_);
   EXTERNALIZE_LOAD_ELEMENT(element, hot_threshold_for_retrospective_lock_list_);
   EXTERNALIZE_LOAD_ELEMENT(element, force_canonical_xlocks_in_precommit_);
   EXTERNALIZE_LOAD_ELEMENT(element, mcs_implementation_type_);
+  EXTERNALIZE_LOAD_ELEMENT(element, mcs_ww_numa_handover_limit_);
+  EXTERNALIZE_LOAD_ELEMENT(element, enable_mcs_ww_lock_stats_);
+  EXTERNALIZE_LOAD_ELEMENT(element, htm_precommit_max_write_set_size_);
   return kRetOk;
 }
 
@@ -62,6 +74,10 @@ ErrorStack XctOptions::save(tinyxml2::XMLElement* element) const {
   EXTERNALIZE_SAVE_ELEMENT(element, max_lock_free_write_set_size_,
     "The maximum number of lock-free write-set one transaction can have. Default is 8K records.\n"
     " We pre-allocate this much memory for each NumaCoreMemory. So, don't make it too large.");
+  EXTERNALIZE_SAVE_ELEMENT(element, max_page_read_set_size_,
+    "The maximum number of page-level read-set one transaction can have. Default is 4K pages.\n"
+    " When this is full, scans fall back to per-record read-set.\n"
+    " We pre-allocate this much memory for each NumaCoreMemory. So, don't make it too large.");
   EXTERNALIZE_SAVE_ELEMENT(element, local_work_memory_size_mb_,
     "Local work memory is used for various purposes during a transaction."
     " We avoid allocating such temporary memory for each transaction and pre-allocate this"
@@ -72,6 +88,13 @@ ErrorStack XctOptions::save(tinyxml2::XMLElement* element) const {
     " out savepoint file for each non-empty epoch. However, too infrequent epoch advancement\n"
     " would increase the latency of queries because transactions are not deemed as commit"
     " until the epoch advances.");
+  EXTERNALIZE_SAVE_ELEMENT(element, epoch_advance_target_latency_us_,
+    "Target 99th-percentile latency of wait_for_commit() in microseconds. Non-zero value\n"
+    " enables adaptive intervals between epoch advancements based on the commit latency and\n"
+    " the write load. Default is 0, which means fixed intervals of epoch_advance_interval_ms_.");
+  EXTERNALIZE_SAVE_ELEMENT(element, epoch_advance_min_interval_us_,
+    "The shortest interval in microseconds between epoch advancements the adaptive epoch\n"
+    " chime might choose. Used only when epoch_advance_target_latency_us_ is set.");
   EXTERNALIZE_SAVE_ELEMENT(element, enable_retrospective_lock_list_,
     "When enabled, we remember read/write-sets on abort and use it as RLL on next run.");
   EXTERNALIZE_SAVE_ELEMENT(element, hot_threshold_for_retrospective_lock_list_,
@@ -83,6 +106,17 @@ ErrorStack XctOptions::save(tinyxml2::XMLElement* element) const {
   EXTERNALIZE_SAVE_ELEMENT(element, mcs_implementation_type_,
     "Defines which implementation of MCS locks to use for RW locks."
     " So far we allow kMcsImplementationTypeSimple and kMcsImplementationTypeExtended.");
+  EXTERNALIZE_SAVE_ELEMENT(element, mcs_ww_numa_handover_limit_,
+    "How many times a WW lock can be handed over to a waiter in the releaser's NUMA node\n"
+    " ahead of a waiter in another node. Default is 0, which means strict FIFO handover.\n"
+    " Only WW locks (page locks) are affected. Record locks are RW locks and always FIFO.");
+  EXTERNALIZE_SAVE_ELEMENT(element, enable_mcs_ww_lock_stats_,
+    "Whether to collect per-lock handover and wait-time statistics of WW locks.\n"
+    " Only WW locks (page locks) are counted, not record locks.");
+  EXTERNALIZE_SAVE_ELEMENT(element, htm_precommit_max_write_set_size_,
+    "Largest write-set for which precommit tries to elide record locks with hardware\n"
+    " transactional memory (RTM), falling back to locks on abort. Default is 0 (disabled).\n"
+    " Ignored on CPUs without RTM.");
   return kRetOk;
 }
 
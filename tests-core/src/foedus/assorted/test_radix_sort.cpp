@@ -0,0 +1,67 @@
+/*
+ * Copyright (c) 2014-2015, Hewlett-Packard Development Company, LP.
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details. You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * HP designates this particular file as subject to the "Classpath" exception
+ * as provided by HP in the LICENSE.txt file that accompanied this code.
+ */
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "foedus/test_common.hpp"
+#include "foedus/assorted/radix_sort.hpp"
+#include "foedus/assorted/uniform_random.hpp"
+
+namespace foedus {
+namespace assorted {
+
+DEFINE_TEST_CASE_PACKAGE(RadixSortTest, foedus.assorted);
+
+/**
+ * Sorts random entries whose lowest index_bits bits hold the original index, and compares
+ * the result with std::sort. high_mask limits the upper 64 bits so that some digits are same.
+ */
+void test_sort(uint32_t count, uint16_t index_bits, uint64_t high_mask, uint16_t threads) {
+  UniformRandom rnd(count + index_bits + threads);
+  std::vector<__uint128_t> data(count);
+  std::vector<__uint128_t> buffer(count);
+  for (uint32_t i = 0; i < count; ++i) {
+    __uint128_t value = static_cast<__uint128_t>(rnd.next_uint64() & high_mask) << 64;
+    value |= static_cast<__uint128_t>(rnd.next_uint64()) << index_bits;
+    if (index_bits > 0) {
+      value |= i;
+    }
+    data[i] = value;
+  }
+  std::vector<__uint128_t> expected(data);
+  std::sort(expected.begin(), expected.end());
+
+  radix_sort_uint128(data.data(), buffer.data(), count, index_bits, threads);
+  for (uint32_t i = 0; i < count; ++i) {
+    EXPECT_TRUE(expected[i] == data[i]) << i;
+  }
+}
+
+TEST(RadixSortTest, Small) { test_sort(100, 0, ~0ULL, 1); }
+TEST(RadixSortTest, Random) { test_sort(10000, 0, ~0ULL, 1); }
+TEST(RadixSortTest, FewDigits) { test_sort(10000, 0, 0xFFULL, 1); }
+TEST(RadixSortTest, Presorted) { test_sort(10000, 23, 0xFFFFULL, 1); }
+TEST(RadixSortTest, Parallel) { test_sort(1U << 18, 0, ~0ULL, 4); }
+TEST(RadixSortTest, ParallelPresorted) { test_sort(1U << 18, 23, 0xFFFFFFULL, 4); }
+
+}  // namespace assorted
+}  // namespace foedus
+
+TEST_MAIN_CAPTURE_SIGNALS(RadixSortTest, foedus.assorted);
@@ -16,6 +16,7 @@
  * as provided by HP in the LICENSE.txt file that accompanied this code.
  */
 #include <gtest/gtest.h>
+#include <sys/uio.h>
 
 #include <cstring>
 #include <string>
@@ -92,6 +93,40 @@ TEST(DirectIoFileTest, CreateWrite) {
   EXPECT_EQ(3 << 14, file_size(file.get_path()));
 }
 
+TEST(DirectIoFileTest, WriteVectored) {
+  DirectIoFile file(Path(std::string("testfile_") + get_random_name()));
+  memory::AlignedMemory memory(1 << 16, 1 << 12, memory::AlignedMemory::kNumaAllocOnnode, 0);
+  char* block = reinterpret_cast<char*>(memory.get_block());
+  for (int i = 0; i < 16; ++i) {
+    std::memset(block + (i << 12), i, 1 << 12);
+  }
+  // write blocks 3, 8-9, 1 in this order
+  struct iovec vectors[3];
+  vectors[0].iov_base = block + (3 << 12);
+  vectors[0].iov_len = 1 << 12;
+  vectors[1].iov_base = block + (8 << 12);
+  vectors[1].iov_len = 2 << 12;
+  vectors[2].iov_base = block + (1 << 12);
+  vectors[2].iov_len = 1 << 12;
+  COERCE_ERROR_CODE(file.open(true, true, false, true));
+  COERCE_ERROR_CODE(file.write_vectored(3, vectors));
+  EXPECT_EQ(4 << 12, file.get_current_offset());
+  file.close();
+  EXPECT_EQ(4 << 12, file_size(file.get_path()));
+
+  memory::AlignedMemory read_memory(1 << 14, 1 << 12, memory::AlignedMemory::kNumaAllocOnnode, 0);
+  DirectIoFile read_file(file.get_path());
+  COERCE_ERROR_CODE(read_file.open(true, false, false, false));
+  COERCE_ERROR_CODE(read_file.read(1 << 14, &read_memory));
+  read_file.close();
+  const char* read_block = reinterpret_cast<const char*>(read_memory.get_block());
+  const int kExpected[4] = {3, 8, 9, 1};
+  for (int i = 0; i < 4; ++i) {
+    EXPECT_EQ(kExpected[i], read_block[i << 12]) << i;
+    EXPECT_EQ(kExpected[i], read_block[((i + 1) << 12) - 1]) << i;
+  }
+}
+
 TEST(DirectIoFileTest, WriteWithLogBuffer) {
   EngineOptions options = get_tiny_options();
   Engine engine(options);
@@ -18,6 +18,8 @@
 #include <gtest/gtest.h>
 
 #include <string>
+#include <thread>
+#include <vector>
 
 #include "foedus/test_common.hpp"
 #include "foedus/memory/aligned_memory.hpp"
@@ -172,6 +174,89 @@ void test_grab_release_with_epoch(bool with_mprotect) {
   COERCE_ERROR(pool.uninitialize());
 }
 
+void test_sharded_grab_release(uint16_t shards) {
+  // free pages in the pool are enough for the given number of shards, not more
+  const uint64_t kPoolPages
+    = shards * static_cast<uint64_t>(PagePoolControlBlock::kMinPagesPerShard) + 64U;
+  const uint64_t kPoolSize = kPoolPages * kPageSize;
+  AlignedMemory block_memory;
+  block_memory.alloc(kPageSize, kAlignment, AlignedMemory::kNumaAllocOnnode, 0);
+  PagePoolControlBlock* block = reinterpret_cast<PagePoolControlBlock*>(block_memory.get_block());
+  AlignedMemory pool_memory;
+  pool_memory.alloc(kPoolSize, kAlignment, AlignedMemory::kNumaAllocOnnode, 0);
+
+  // A reference from another engine might attach before the owner initializes, and with
+  // a different page-boundary-check option. It still must see the owner's shard layout.
+  PagePool pool_ref;
+  pool_ref.attach(block, pool_memory.get_block(), kPoolSize, false, true);
+
+  PagePool pool;
+  pool.attach(block, pool_memory.get_block(), kPoolSize, true, false);
+  COERCE_ERROR(pool.initialize());
+  EXPECT_EQ(shards, pool.get_shard_count());
+  const uint64_t capacity = pool.get_free_pool_capacity();
+
+  COERCE_ERROR(pool_ref.initialize());
+  EXPECT_EQ(shards, pool_ref.get_shard_count());
+  EXPECT_EQ(capacity, pool_ref.get_free_pool_capacity());
+
+  // Drain the pool from one home shard. Other shards are stolen from.
+  std::vector<PagePoolOffsetChunk> chunks;
+  while (true) {
+    chunks.emplace_back();
+    ErrorCode code = pool.grab(PagePoolOffsetChunk::kMaxSize, &chunks.back(), 1U);
+    if (code == kErrorCodeMemoryNoFreePages) {
+      EXPECT_EQ(0, chunks.back().size());
+      chunks.pop_back();
+      break;
+    }
+    EXPECT_EQ(kErrorCodeOk, code);
+  }
+  std::vector<bool> grabbed(kPoolPages, false);
+  uint64_t total = 0;
+  for (const PagePoolOffsetChunk& chunk : chunks) {
+    PagePoolOffsetChunk copied(chunk);
+    while (!copied.empty()) {
+      PagePoolOffset offset = copied.pop_back();
+      EXPECT_GE(offset, pool.get_resolver().begin_);
+      EXPECT_LT(offset, kPoolPages);
+      EXPECT_FALSE(grabbed[offset]) << offset;
+      grabbed[offset] = true;
+    }
+    total += chunk.size();
+  }
+  EXPECT_EQ(capacity, total);
+  EXPECT_EQ(capacity, pool.get_stat().allocated_pages_);
+
+  // Return them all to the same home shard. It overflows to the siblings.
+  for (PagePoolOffsetChunk& chunk : chunks) {
+    pool.release(chunk.size(), &chunk, 2U);
+    EXPECT_EQ(0, chunk.size());
+  }
+  EXPECT_EQ(0, pool.get_stat().allocated_pages_);
+
+  // Concurrent grabs/releases from different home shards
+  std::vector<std::thread> threads;
+  for (uint16_t t = 0; t < shards * 2U; ++t) {
+    threads.emplace_back([&pool, t](){
+      PagePoolOffsetChunk chunk;
+      for (uint32_t rep = 0; rep < 200U; ++rep) {
+        EXPECT_EQ(kErrorCodeOk, pool.grab(1000U, &chunk, t));
+        pool.release(chunk.size(), &chunk, t + 1U);
+      }
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  EXPECT_EQ(0, pool.get_stat().allocated_pages_);
+
+  COERCE_ERROR(pool_ref.uninitialize());
+  COERCE_ERROR(pool.uninitialize());
+}
+
+TEST(PagePoolTest, ShardedGrabRelease)   { test_sharded_grab_release(4); }
+
 TEST(PagePoolTest, Construct)         { test_construct(false); }
 TEST(PagePoolTest, ConstructMprotect) { test_construct(true); }
 
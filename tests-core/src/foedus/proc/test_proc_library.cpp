@@ -0,0 +1,84 @@
+/*
+ * Copyright (c) 2014-2015, Hewlett-Packard Development Company, LP.
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details. You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * HP designates this particular file as subject to the "Classpath" exception
+ * as provided by HP in the LICENSE.txt file that accompanied this code.
+ */
+#include <atomic>
+#include <vector>
+
+#include "foedus/error_stack.hpp"
+#include "foedus/proc/proc_id.hpp"
+
+/**
+ * @file test_proc_library.cpp
+ * A shared library of user procedures loaded by test_proc_manager via dlopen().
+ * This is not a testcase by itself.
+ * We build it twice. The second version (TEST_PROC_LIBRARY_VERSION=2) replaces the first one
+ * in the reload testcases. It returns a different value from library_task and
+ * does not have library_dropped_task.
+ */
+#ifndef TEST_PROC_LIBRARY_VERSION
+#define TEST_PROC_LIBRARY_VERSION 1
+#endif  // TEST_PROC_LIBRARY_VERSION
+
+namespace foedus {
+namespace proc {
+
+/** Outputs 42 in the first version, 43 in the second. */
+ErrorStack library_task(const ProcArguments& args) {
+  if (args.output_buffer_size_ >= sizeof(uint32_t)) {
+    *reinterpret_cast<uint32_t*>(args.output_buffer_) = 41 + TEST_PROC_LIBRARY_VERSION;
+    *args.output_used_ = sizeof(uint32_t);
+  }
+  return kRetOk;
+}
+
+/**
+ * Sets the first of the two std::atomic<bool> whose addresses are given as the input,
+ * waits until the second becomes true, then outputs the version of this library.
+ * Only for emulated SOCs, which share the addresses.
+ */
+ErrorStack library_wait_task(const ProcArguments& args) {
+  typedef std::atomic<bool>* Flag;
+  if (args.input_len_ != sizeof(Flag) * 2U) {
+    return ERROR_STACK(kErrorCodeInvalidParameter);
+  }
+  const Flag* flags = reinterpret_cast<const Flag*>(args.input_buffer_);
+  flags[0]->store(true);
+  while (!flags[1]->load()) {
+    continue;
+  }
+  *reinterpret_cast<uint32_t*>(args.output_buffer_) = TEST_PROC_LIBRARY_VERSION;
+  *args.output_used_ = sizeof(uint32_t);
+  return kRetOk;
+}
+
+#if TEST_PROC_LIBRARY_VERSION == 1
+ErrorStack library_dropped_task(const ProcArguments& /*args*/) {
+  return kRetOk;
+}
+#endif  // TEST_PROC_LIBRARY_VERSION == 1
+
+}  // namespace proc
+}  // namespace foedus
+
+extern "C" void foedus_list_procs(std::vector<foedus::proc::ProcAndName>* out) {
+  out->push_back(foedus::proc::ProcAndName("library_task", &foedus::proc::library_task));
+  out->push_back(foedus::proc::ProcAndName("library_wait_task", &foedus::proc::library_wait_task));
+#if TEST_PROC_LIBRARY_VERSION == 1
+  out->push_back(
+    foedus::proc::ProcAndName("library_dropped_task", &foedus::proc::library_dropped_task));
+#endif  // TEST_PROC_LIBRARY_VERSION == 1
+}
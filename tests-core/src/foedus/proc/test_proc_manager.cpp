@@ -0,0 +1,350 @@
+/*
+ * Copyright (c) 2014-2015, Hewlett-Packard Development Company, LP.
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details. You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * HP designates this particular file as subject to the "Classpath" exception
+ * as provided by HP in the LICENSE.txt file that accompanied this code.
+ */
+#include <stdint.h>
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <string>
+#include <thread>
+
+#include "foedus/engine.hpp"
+#include "foedus/engine_options.hpp"
+#include "foedus/test_common.hpp"
+#include "foedus/fs/filesystem.hpp"
+#include "foedus/fs/path.hpp"
+#include "foedus/proc/proc_id.hpp"
+#include "foedus/proc/proc_manager.hpp"
+#include "foedus/thread/impersonate_session.hpp"
+#include "foedus/thread/thread_pool.hpp"
+
+#define X_QUOTE(str) #str
+#define X_EXPAND_AND_QUOTE(str) X_QUOTE(str)
+
+namespace foedus {
+namespace proc {
+DEFINE_TEST_CASE_PACKAGE(ProcManagerTest, foedus.proc);
+
+// -DTEST_PROC_LIBRARY_DIR is given just for this testcase
+const char* kLibraryDir = X_EXPAND_AND_QUOTE(TEST_PROC_LIBRARY_DIR);
+
+ErrorStack emulated_task(const ProcArguments& /*args*/) {
+  return kRetOk;
+}
+
+/** Runs library_task in test_proc_library and checks its output. */
+void run_library_task(Engine* engine) {
+  Proc proc;
+  COERCE_ERROR(engine->get_proc_manager()->get_proc("library_task", &proc));
+  EXPECT_TRUE(proc != nullptr);
+
+  thread::ImpersonateSession session;
+  EXPECT_TRUE(engine->get_thread_pool()->impersonate("library_task", nullptr, 0, &session));
+  COERCE_ERROR(session.get_result());
+  uint32_t output = 0;
+  EXPECT_EQ(sizeof(output), session.get_output_size());
+  session.get_output(&output);
+  EXPECT_EQ(42U, output);
+  session.release();
+}
+
+/**
+ * Runs the procedure in the given node and returns its result.
+ * @param[out] output output of the procedure if it is 4 bytes, otherwise 0.
+ */
+ErrorCode run_on_node(
+  Engine* engine,
+  uint16_t node,
+  const char* name,
+  const void* input,
+  uint32_t input_len,
+  uint32_t* output) {
+  thread::ImpersonateSession session;
+  EXPECT_TRUE(engine->get_thread_pool()->impersonate_on_numa_node(
+    node,
+    name,
+    input,
+    input_len,
+    &session));
+  ErrorCode code = session.get_result().get_error_code();
+  *output = 0;
+  if (session.get_output_size() == sizeof(*output)) {
+    session.get_output(output);
+  }
+  session.release();
+  return code;
+}
+
+/** Runs library_task in all nodes and checks its output. */
+void run_library_task_all_nodes(Engine* engine, uint32_t expected) {
+  for (uint16_t node = 0; node < engine->get_options().thread_.group_count_; ++node) {
+    uint32_t output;
+    EXPECT_EQ(kErrorCodeOk, run_on_node(engine, node, "library_task", nullptr, 0, &output));
+    EXPECT_EQ(expected, output) << node;
+  }
+}
+
+/** Runs library_dropped_task in all nodes and checks its result. */
+void run_dropped_task_all_nodes(Engine* engine, ErrorCode expected) {
+  for (uint16_t node = 0; node < engine->get_options().thread_.group_count_; ++node) {
+    uint32_t output;
+    EXPECT_EQ(expected, run_on_node(engine, node, "library_dropped_task", nullptr, 0, &output))
+      << node;
+  }
+}
+
+/** A folder where reload testcases deploy test_proc_library. */
+struct LibraryFolder {
+  LibraryFolder() : folder_(get_random_tmp_file_path("proc_library")) {
+    fs::create_directories(folder_);
+    path_ = folder_;
+    path_ /= "libtest_reload.so";
+  }
+  ~LibraryFolder() {
+    fs::remove_all(folder_);
+  }
+
+  /** Places the given content at path_ by renaming a new file, like install(1) does. */
+  void deploy(const std::string& from) {
+    fs::Path tmp(path_.string() + ".tmp");
+    {
+      std::ifstream in(from.c_str(), std::ios::binary);
+      std::ofstream out(tmp.c_str(), std::ios::binary | std::ios::trunc);
+      ASSERT_TRUE(in.good()) << from;
+      out << in.rdbuf();
+    }
+    ASSERT_TRUE(fs::rename(tmp, path_));
+  }
+  /** Places the given version of test_proc_library at path_. */
+  void deploy_version(int version) {
+    if (version == 1) {
+      deploy(std::string(kLibraryDir) + "/libtest_proc_library.so");
+    } else {
+      deploy(std::string(kLibraryDir) + "/v2/libtest_proc_library_v2.so");
+    }
+  }
+
+  fs::Path folder_;
+  fs::Path path_;
+};
+
+TEST(ProcManagerTest, EmulatedRegister) {
+  EngineOptions options = get_tiny_options();
+  options.thread_.group_count_ = 2;
+  Engine engine(options);
+  COERCE_ERROR(engine.initialize());
+  {
+    UninitializeGuard guard(&engine);
+    COERCE_ERROR(engine.get_proc_manager()->emulated_register(
+      ProcAndName("emulated_task", &emulated_task)));
+    EXPECT_TRUE(engine.get_proc_manager()->emulated_register(
+      ProcAndName("emulated_task", &emulated_task)).is_error());
+    for (uint16_t node = 0; node < options.thread_.group_count_; ++node) {
+      thread::ImpersonateSession session;
+      EXPECT_TRUE(engine.get_thread_pool()->impersonate_on_numa_node(
+        node,
+        "emulated_task",
+        nullptr,
+        0,
+        &session));
+      COERCE_ERROR(session.get_result());
+      session.release();
+    }
+    COERCE_ERROR(engine.uninitialize());
+  }
+  cleanup_test(options);
+}
+
+TEST(ProcManagerTest, LoadLibrary) {
+  EngineOptions options = get_tiny_options();
+  std::string path = std::string(kLibraryDir) + "/libtest_proc_library.so";
+  options.proc_.shared_library_path_pattern_ = path.c_str();
+  Engine engine(options);
+  COERCE_ERROR(engine.initialize());
+  {
+    UninitializeGuard guard(&engine);
+    run_library_task(&engine);
+    COERCE_ERROR(engine.uninitialize());
+  }
+  cleanup_test(options);
+}
+
+TEST(ProcManagerTest, LoadLibraryDir) {
+  EngineOptions options = get_tiny_options();
+  options.proc_.shared_library_dir_pattern_ = kLibraryDir;
+  Engine engine(options);
+  COERCE_ERROR(engine.initialize());
+  {
+    UninitializeGuard guard(&engine);
+    run_library_task(&engine);
+    COERCE_ERROR(engine.uninitialize());
+  }
+  cleanup_test(options);
+}
+
+TEST(ProcManagerTest, ReloadLibrary) {
+  EngineOptions options = get_tiny_options();
+  options.thread_.group_count_ = 2;
+  std::string path = std::string(kLibraryDir) + "/libtest_proc_library.so";
+  options.proc_.shared_library_path_pattern_ = path.c_str();
+  Engine engine(options);
+  COERCE_ERROR(engine.initialize());
+  {
+    UninitializeGuard guard(&engine);
+    run_library_task(&engine);
+    for (int rep = 0; rep < 3; ++rep) {
+      COERCE_ERROR(engine.get_proc_manager()->reload_shared_libraries());
+      run_library_task(&engine);
+    }
+    COERCE_ERROR(engine.uninitialize());
+  }
+  cleanup_test(options);
+}
+
+TEST(ProcManagerTest, ReloadChangedLibrary) {
+  // The second version changes library_task and drops library_dropped_task
+  LibraryFolder library;
+  library.deploy_version(1);
+  EngineOptions options = get_tiny_options();
+  options.thread_.group_count_ = 2;
+  options.proc_.shared_library_path_pattern_ = library.path_.c_str();
+  Engine engine(options);
+  COERCE_ERROR(engine.initialize());
+  {
+    UninitializeGuard guard(&engine);
+    COERCE_ERROR(engine.get_proc_manager()->emulated_register(
+      ProcAndName("emulated_task", &emulated_task)));
+    run_library_task_all_nodes(&engine, 42U);
+    run_dropped_task_all_nodes(&engine, kErrorCodeOk);
+
+    library.deploy_version(2);
+    COERCE_ERROR(engine.get_proc_manager()->reload_shared_libraries());
+    run_library_task_all_nodes(&engine, 43U);
+    run_dropped_task_all_nodes(&engine, kErrorCodeProcNotFound);
+    Proc proc;
+    EXPECT_TRUE(engine.get_proc_manager()->get_proc("library_dropped_task", &proc).is_error());
+
+    // procedures not from the libraries are kept
+    for (uint16_t node = 0; node < options.thread_.group_count_; ++node) {
+      uint32_t output;
+      EXPECT_EQ(kErrorCodeOk, run_on_node(&engine, node, "emulated_task", nullptr, 0, &output));
+    }
+
+    library.deploy_version(1);
+    COERCE_ERROR(engine.get_proc_manager()->reload_shared_libraries());
+    run_library_task_all_nodes(&engine, 42U);
+    run_dropped_task_all_nodes(&engine, kErrorCodeOk);
+    COERCE_ERROR(engine.uninitialize());
+  }
+  cleanup_test(options);
+}
+
+TEST(ProcManagerTest, ReloadBrokenLibrary) {
+  LibraryFolder library;
+  library.deploy_version(1);
+  EngineOptions options = get_tiny_options();
+  options.thread_.group_count_ = 2;
+  options.proc_.shared_library_path_pattern_ = library.path_.c_str();
+  Engine engine(options);
+  COERCE_ERROR(engine.initialize());
+  {
+    UninitializeGuard guard(&engine);
+    run_library_task_all_nodes(&engine, 42U);
+
+    // Not a shared library. The reload fails, and the old procedures stay intact.
+    std::string broken = library.folder_.string() + "/broken.txt";
+    {
+      std::ofstream out(broken.c_str());
+      out << "not a shared library";
+    }
+    library.deploy(broken);
+    EXPECT_EQ(
+      kErrorCodeProcLibraryLoadFailed,
+      engine.get_proc_manager()->reload_shared_libraries().get_error_code());
+    run_library_task_all_nodes(&engine, 42U);
+    run_dropped_task_all_nodes(&engine, kErrorCodeOk);
+
+    library.deploy_version(2);
+    COERCE_ERROR(engine.get_proc_manager()->reload_shared_libraries());
+    run_library_task_all_nodes(&engine, 43U);
+
+    // The private copies we dlopen()-ed are already removed
+    for (const fs::Path& child : library.folder_.child_paths()) {
+      EXPECT_EQ(std::string::npos, child.string().find(".reload-")) << child;
+    }
+    COERCE_ERROR(engine.uninitialize());
+  }
+  cleanup_test(options);
+}
+
+TEST(ProcManagerTest, ReloadWaitsForRunningProc) {
+  LibraryFolder library;
+  library.deploy_version(1);
+  EngineOptions options = get_tiny_options();
+  options.proc_.shared_library_path_pattern_ = library.path_.c_str();
+  Engine engine(options);
+  COERCE_ERROR(engine.initialize());
+  {
+    UninitializeGuard guard(&engine);
+    std::atomic<bool> started(false);
+    std::atomic<bool> go(false);
+    std::atomic<bool>* flags[2] = {&started, &go};
+    thread::ImpersonateSession session;
+    EXPECT_TRUE(engine.get_thread_pool()->impersonate(
+      "library_wait_task",
+      flags,
+      sizeof(flags),
+      &session));
+    while (!started.load()) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    library.deploy_version(2);
+    std::atomic<bool> reloaded(false);
+    std::thread reloader([&engine, &reloaded]() {
+      COERCE_ERROR(engine.get_proc_manager()->reload_shared_libraries());
+      reloaded.store(true);
+    });
+    // The old version keeps running until it returns. The reload waits for it.
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    EXPECT_FALSE(reloaded.load());
+    go.store(true);
+    COERCE_ERROR(session.get_result());
+    uint32_t output = 0;
+    EXPECT_EQ(sizeof(output), session.get_output_size());
+    session.get_output(&output);
+    EXPECT_EQ(1U, output);
+    session.release();
+    reloader.join();
+    EXPECT_TRUE(reloaded.load());
+
+    run_library_task_all_nodes(&engine, 43U);
+    EXPECT_EQ(
+      kErrorCodeOk,
+      run_on_node(&engine, 0, "library_wait_task", flags, sizeof(flags), &output));
+    EXPECT_EQ(2U, output);
+    COERCE_ERROR(engine.uninitialize());
+  }
+  cleanup_test(options);
+}
+
+}  // namespace proc
+}  // namespace foedus
+
+TEST_MAIN_CAPTURE_SIGNALS(ProcManagerTest, foedus.proc);
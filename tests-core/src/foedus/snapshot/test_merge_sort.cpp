@@ -27,6 +27,7 @@
 #include <vector>
 
 #include "foedus/test_common.hpp"
+#include "foedus/assorted/assorted_func.hpp"
 #include "foedus/fs/direct_io_file.hpp"
 #include "foedus/fs/filesystem.hpp"
 #include "foedus/memory/aligned_memory.hpp"
@@ -390,12 +391,15 @@ struct MultiInputsTest : public TestBase {
     EXPECT_TRUE(file_.close());
     COERCE_ERROR_CODE(file_.open(true, false, false, false));
 
-    // smaller buffer size on purpose. causes window move
-    io_window_.alloc(capacity_ / 6U, 1U << 12, memory::AlignedMemory::kNumaAllocOnnode, 0);
-    memory::AlignedMemorySlice slice(&io_window_);
-    COERCE_ERROR_CODE(file_.read(slice.get_size(), slice));
+    // smaller buffer size on purpose. causes window move.
+    // the latter half is the read-ahead buffer, so window moves also go through read-ahead.
+    const uint64_t window_size = assorted::align<uint64_t, 4096U>(capacity_ / 6U);
+    io_window_.alloc(window_size * 2U, 1U << 12, memory::AlignedMemory::kNumaAllocOnnode, 0);
+    memory::AlignedMemorySlice slice(&io_window_, 0, window_size);
+    memory::AlignedMemorySlice read_ahead_slice(&io_window_, window_size, window_size);
 
-    io_buffer_ = new DumpFileSortedBuffer(&file_, slice);
+    io_buffer_ = new DumpFileSortedBuffer(&file_, slice, read_ahead_slice);
+    COERCE_ERROR_CODE(io_buffer_->read_first_window());
     io_buffer_->set_current_block(
       kStorageId,
       kLogsPerInput,
@@ -859,6 +863,80 @@ TEST(MergeSortTest, MultiInputsDuplicatesMasstreeVarlen) {
   test_multi_inputs_masstree_varlen(kDuplicates);
 }
 
+///////////////////////////////////////////////////
+/// DumpFileSortedBuffer read-ahead
+///////////////////////////////////////////////////
+/** Each 8 bytes of the file contains its own byte position. */
+void verify_dump_window(const DumpFileSortedBuffer& buffer) {
+  const uint64_t* words = reinterpret_cast<const uint64_t*>(buffer.get_buffer());
+  uint64_t valid_bytes
+    = std::min(buffer.get_buffer_size(), buffer.get_total_size() - buffer.get_offset());
+  for (uint64_t i = 0; i < valid_bytes / sizeof(uint64_t); ++i) {
+    if (words[i] != buffer.get_offset() + i * sizeof(uint64_t)) {
+      EXPECT_EQ(buffer.get_offset() + i * sizeof(uint64_t), words[i]) << i;
+      return;
+    }
+  }
+}
+
+TEST(MergeSortTest, DumpFileReadAhead) {
+  const uint64_t kWindow = 1U << 18;
+  const uint64_t kFileSize = kWindow * 8U;
+  fs::Path path(get_random_tmp_file_path("DumpFileReadAhead"));
+  memory::AlignedMemory file_memory;
+  file_memory.alloc(kFileSize, 1U << 12, memory::AlignedMemory::kNumaAllocOnnode, 0);
+  uint64_t* words = reinterpret_cast<uint64_t*>(file_memory.get_block());
+  for (uint64_t i = 0; i < kFileSize / sizeof(uint64_t); ++i) {
+    words[i] = i * sizeof(uint64_t);
+  }
+
+  fs::DirectIoFile file(path);
+  EXPECT_TRUE(fs::create_directories(path.parent_path()));
+  COERCE_ERROR_CODE(file.open(true, true, true, true));
+  COERCE_ERROR_CODE(file.write(kFileSize, file_memory));
+  COERCE_ERROR_CODE(file.sync());
+  EXPECT_TRUE(file.close());
+  COERCE_ERROR_CODE(file.open(true, false, false, false));
+
+  memory::AlignedMemory window_memory;
+  window_memory.alloc(kWindow * 2U, 1U << 12, memory::AlignedMemory::kNumaAllocOnnode, 0);
+  memory::AlignedMemorySlice window(&window_memory, 0, kWindow);
+  memory::AlignedMemorySlice read_ahead(&window_memory, kWindow, kWindow);
+  {
+    DumpFileSortedBuffer buffer(&file, window, read_ahead);
+    const uint64_t overlap = buffer.get_read_ahead_overlap();
+    EXPECT_EQ(1U << 16, overlap);
+    COERCE_ERROR_CODE(buffer.read_first_window());
+    EXPECT_EQ(0, buffer.get_offset());
+    verify_dump_window(buffer);
+
+    // retains less than the overlap. the read-ahead buffer becomes the window.
+    COERCE_ERROR_CODE(buffer.wind(kWindow - 1000U));
+    EXPECT_EQ(kWindow - overlap, buffer.get_offset());
+    EXPECT_EQ(read_ahead.get_block(), buffer.get_buffer());
+    verify_dump_window(buffer);
+
+    // retains more than the overlap. the window is read again without swapping.
+    uint64_t pos = buffer.get_offset() + kWindow - overlap - 10000U;
+    COERCE_ERROR_CODE(buffer.wind(pos));
+    EXPECT_EQ(pos / 4096U * 4096U, buffer.get_offset());
+    EXPECT_EQ(read_ahead.get_block(), buffer.get_buffer());
+    verify_dump_window(buffer);
+
+    // then the read-ahead goes on from the re-read window
+    while (buffer.get_offset() + kWindow < kFileSize) {
+      const void* previous = buffer.get_buffer();
+      uint64_t expected_offset = buffer.get_offset() + kWindow - overlap;
+      COERCE_ERROR_CODE(buffer.wind(buffer.get_offset() + kWindow - 100U));
+      EXPECT_EQ(expected_offset, buffer.get_offset());
+      EXPECT_NE(previous, buffer.get_buffer());
+      verify_dump_window(buffer);
+    }
+  }
+  EXPECT_TRUE(file.close());
+  fs::remove_all(path.parent_path());
+}
+
 }  // namespace snapshot
 }  // namespace foedus
 
@@ -17,19 +17,29 @@
  */
 #include <gtest/gtest.h>
 
+#include <chrono>
+#include <cstring>
 #include <string>
+#include <thread>
 
 #include "foedus/engine.hpp"
 #include "foedus/engine_options.hpp"
 #include "foedus/test_common.hpp"
+#include "foedus/assorted/assorted_func.hpp"
 #include "foedus/log/log_manager.hpp"
 #include "foedus/proc/proc_manager.hpp"
+#include "foedus/snapshot/log_gleaner_ref.hpp"
+#include "foedus/snapshot/log_reducer_ref.hpp"
 #include "foedus/snapshot/snapshot_id.hpp"
 #include "foedus/snapshot/snapshot_manager.hpp"
 #include "foedus/snapshot/snapshot_manager_pimpl.hpp"
+#include "foedus/storage/storage.hpp"
 #include "foedus/storage/storage_manager.hpp"
 #include "foedus/storage/array/array_metadata.hpp"
+#include "foedus/storage/array/array_route.hpp"
 #include "foedus/storage/array/array_storage.hpp"
+#include "foedus/thread/impersonate_session.hpp"
+#include "foedus/thread/thread.hpp"
 #include "foedus/thread/thread_pool.hpp"
 #include "foedus/xct/xct_manager.hpp"
 
@@ -135,6 +145,39 @@ ErrorStack increments_twice_task(const proc::ProcArguments& args) {
   return kRetOk;
 }
 
+/** Same results as increments_task, but with blind adds in a few transactions. */
+ErrorStack adds_task(const proc::ProcArguments& args) {
+  EXPECT_EQ(kInput, args.input_len_);
+  const TaskInput* input = reinterpret_cast<const TaskInput*>(args.input_buffer_);
+  const uint32_t records = input->records;
+  uint32_t id = input->id;
+  EXPECT_NE(id, 2U);
+
+  thread::Thread* context = args.context_;
+  storage::array::ArrayStorage array(args.engine_, kName);
+  ASSERT_ND(array.exists());
+  xct::XctManager* xct_manager = args.engine_->get_xct_manager();
+  Epoch commit_epoch;
+  const uint64_t kOne = 1U;
+  for (uint32_t r = 0; r < 3U; ++r) {
+    WRAP_ERROR_CODE(xct_manager->begin_xct(context, xct::kSerializable));
+    for (uint32_t i = 0; i < records / 2U; ++i) {
+      storage::array::ArrayOffset rec = id * records / 2U + i;
+      if (r == 0) {
+        WRAP_ERROR_CODE(array.add_record<uint64_t>(context, rec, rec / 2ULL, 0));
+      } else if (r == 1U) {
+        WRAP_ERROR_CODE(array.add_record<uint64_t>(context, rec, kOne, 0));
+      } else {
+        // unsigned arithmetic wraps around, so this gives rec even for rec=0
+        WRAP_ERROR_CODE(array.add_record<uint64_t>(context, rec, rec - (rec / 2ULL) - kOne, 0));
+      }
+    }
+    WRAP_ERROR_CODE(xct_manager->precommit_xct(context, &commit_epoch));
+  }
+  WRAP_ERROR_CODE(xct_manager->wait_for_commit(commit_epoch));
+  return kRetOk;
+}
+
 ErrorStack two_arrays_task(const proc::ProcArguments& args) {
   EXPECT_EQ(kInput, args.input_len_);
   const TaskInput* input = reinterpret_cast<const TaskInput*>(args.input_buffer_);
@@ -246,6 +289,7 @@ ErrorStack verify_holes_task(const proc::ProcArguments& args) {
 const proc::ProcName kOv("overwrites_task");
 const proc::ProcName kInc("increments_task");
 const proc::ProcName kInc2("increments_twice_task");
+const proc::ProcName kAdd("adds_task");
 const proc::ProcName kTwo("two_arrays_task");
 const proc::ProcName kHoles("overwrites_holes_task");
 
@@ -280,6 +324,7 @@ void test_run(
     engine.get_proc_manager()->pre_register("overwrites_task", overwrites_task);
     engine.get_proc_manager()->pre_register("increments_task", increments_task);
     engine.get_proc_manager()->pre_register("increments_twice_task", increments_twice_task);
+    engine.get_proc_manager()->pre_register("adds_task", adds_task);
     engine.get_proc_manager()->pre_register("two_arrays_task", two_arrays_task);
     engine.get_proc_manager()->pre_register("overwrites_holes_task", overwrites_holes_task);
     engine.get_proc_manager()->pre_register("verify", verify_proc);
@@ -335,6 +380,454 @@ void test_run(
   cleanup_test(options);
 }
 
+ErrorStack selective_increments_task(const proc::ProcArguments& args) {
+  EXPECT_EQ(kInput, args.input_len_);
+  const TaskInput* input = reinterpret_cast<const TaskInput*>(args.input_buffer_);
+  const uint32_t records = input->records;
+
+  thread::Thread* context = args.context_;
+  storage::array::ArrayStorage array(args.engine_, kName);
+  storage::array::ArrayStorage another(args.engine_, kNameAnother);
+  xct::XctManager* xct_manager = args.engine_->get_xct_manager();
+  WRAP_ERROR_CODE(xct_manager->begin_xct(context, xct::kSerializable));
+  for (uint32_t i = 0; i < records; ++i) {
+    WRAP_ERROR_CODE(array.increment_record_oneshot<uint64_t>(context, i, 1U, 0));
+    WRAP_ERROR_CODE(another.increment_record_oneshot<uint64_t>(context, i, 1U, 0));
+  }
+  Epoch commit_epoch;
+  WRAP_ERROR_CODE(xct_manager->precommit_xct(context, &commit_epoch));
+  WRAP_ERROR_CODE(xct_manager->wait_for_commit(commit_epoch));
+  return kRetOk;
+}
+
+/** id is the expected value of all records in both arrays */
+ErrorStack selective_verify_task(const proc::ProcArguments& args) {
+  EXPECT_EQ(kInput, args.input_len_);
+  const TaskInput* input = reinterpret_cast<const TaskInput*>(args.input_buffer_);
+  const uint32_t records = input->records;
+
+  thread::Thread* context = args.context_;
+  storage::array::ArrayStorage array(args.engine_, kName);
+  storage::array::ArrayStorage another(args.engine_, kNameAnother);
+  xct::XctManager* xct_manager = args.engine_->get_xct_manager();
+  WRAP_ERROR_CODE(xct_manager->begin_xct(context, xct::kSerializable));
+  for (uint32_t i = 0; i < records; ++i) {
+    uint64_t data = 0;
+    WRAP_ERROR_CODE(array.get_record_primitive<uint64_t>(context, i, &data, 0));
+    EXPECT_EQ(input->id, data) << i;
+    WRAP_ERROR_CODE(another.get_record_primitive<uint64_t>(context, i, &data, 0));
+    EXPECT_EQ(input->id, data) << i;
+  }
+  Epoch commit_epoch;
+  WRAP_ERROR_CODE(xct_manager->precommit_xct(context, &commit_epoch));
+  return kRetOk;
+}
+
+// The second array has a snapshot trigger threshold, so it is deferred in a few snapshots
+// while the first array is snapshotted every time.
+/** Reads a record of kName (input->id == 0) or kNameAnother in a pinned xct. Outputs ErrorCode */
+ErrorStack pinned_read_task(const proc::ProcArguments& args) {
+  EXPECT_EQ(kInput, args.input_len_);
+  const TaskInput* input = reinterpret_cast<const TaskInput*>(args.input_buffer_);
+  thread::Thread* context = args.context_;
+  storage::array::ArrayStorage array(args.engine_, input->id == 0 ? kName : kNameAnother);
+  xct::XctManager* xct_manager = args.engine_->get_xct_manager();
+  WRAP_ERROR_CODE(xct_manager->begin_xct(context, xct::kPinnedSnapshot));
+  uint64_t data = 0;
+  ErrorCode code = array.get_record_primitive<uint64_t>(context, 0, &data, 0);
+  WRAP_ERROR_CODE(xct_manager->abort_xct(context));
+  std::memcpy(args.output_buffer_, &code, sizeof(code));
+  *args.output_used_ = sizeof(code);
+  return kRetOk;
+}
+
+ErrorCode pinned_read(Engine* engine, uint32_t id) {
+  TaskInput input = {id, 0};
+  ErrorCode code = kErrorCodeOk;
+  thread::ImpersonateSession session;
+  EXPECT_TRUE(engine->get_thread_pool()->impersonate("pinned_read", &input, kInput, &session));
+  COERCE_ERROR(session.get_result());
+  std::memcpy(&code, session.get_raw_output_buffer(), sizeof(code));
+  session.release();
+  return code;
+}
+
+TEST(SnapshotArrayTest, SelectiveSnapshot) {
+  EngineOptions options = get_tiny_options();
+  const uint32_t records = kMoreRecords;
+  TaskInput input = {0, records};
+  {
+    Engine engine(options);
+    engine.get_proc_manager()->pre_register("increments", selective_increments_task);
+    engine.get_proc_manager()->pre_register("verify", selective_verify_task);
+    engine.get_proc_manager()->pre_register("pinned_read", pinned_read_task);
+    COERCE_ERROR(engine.initialize());
+    {
+      UninitializeGuard guard(&engine);
+      storage::array::ArrayStorage array;
+      storage::array::ArrayStorage another;
+      Epoch commit_epoch;
+      storage::array::ArrayMetadata meta(kName, sizeof(uint64_t), records);
+      COERCE_ERROR(engine.get_storage_manager()->create_array(&meta, &array, &commit_epoch));
+      storage::array::ArrayMetadata another_meta(kNameAnother, sizeof(uint64_t), records);
+      another_meta.snapshot_thresholds_.snapshot_trigger_threshold_ = records * 2U;
+      COERCE_ERROR(engine.get_storage_manager()->create_array(
+        &another_meta,
+        &another,
+        &commit_epoch));
+      storage::StorageControlBlock* block = engine.get_storage_manager()->get_storage(kName);
+      storage::StorageControlBlock* another_block
+        = engine.get_storage_manager()->get_storage(kNameAnother);
+
+      SnapshotManager* manager = engine.get_snapshot_manager();
+      Epoch first_snapshot_epoch;
+      for (uint32_t round = 1; round <= 4U; ++round) {
+        COERCE_ERROR(engine.get_thread_pool()->impersonate_synchronous(
+          "increments",
+          &input,
+          kInput));
+        manager->trigger_snapshot_immediate(true);
+        Epoch snapshot_epoch = manager->get_snapshot_epoch();
+        EXPECT_EQ(snapshot_epoch, Epoch(block->meta_.last_snapshot_epoch_)) << round;
+        EXPECT_EQ(kErrorCodeOk, pinned_read(&engine, 0)) << round;
+        if (round == 1U) {
+          // the first snapshot includes everything
+          first_snapshot_epoch = snapshot_epoch;
+          EXPECT_EQ(snapshot_epoch, Epoch(another_block->meta_.last_snapshot_epoch_));
+          EXPECT_EQ(kErrorCodeOk, pinned_read(&engine, 1));
+        } else if (round < 4U) {
+          // below the threshold. still as of the first snapshot
+          EXPECT_EQ(first_snapshot_epoch, Epoch(another_block->meta_.last_snapshot_epoch_))
+            << round;
+          // pinned reads must not see the old image mixed with the newer one of kName
+          EXPECT_EQ(kErrorCodeXctPinnedSnapshotDeferred, pinned_read(&engine, 1)) << round;
+        } else {
+          // crossed the threshold in the previous snapshot
+          EXPECT_EQ(snapshot_epoch, Epoch(another_block->meta_.last_snapshot_epoch_));
+          EXPECT_EQ(kErrorCodeOk, pinned_read(&engine, 1));
+        }
+
+        input.id = round;
+        COERCE_ERROR(engine.get_thread_pool()->impersonate_synchronous("verify", &input, kInput));
+      }
+      COERCE_ERROR(engine.uninitialize());
+    }
+  }
+  {
+    Engine engine(options);
+    engine.get_proc_manager()->pre_register("verify", selective_verify_task);
+    COERCE_ERROR(engine.initialize());
+    {
+      UninitializeGuard guard(&engine);
+      COERCE_ERROR(engine.get_thread_pool()->impersonate_synchronous("verify", &input, kInput));
+      COERCE_ERROR(engine.uninitialize());
+    }
+  }
+  cleanup_test(options);
+}
+
+/** Overwrites all records in small transactions. id is the value to write */
+ErrorStack many_overwrites_task(const proc::ProcArguments& args) {
+  EXPECT_EQ(kInput, args.input_len_);
+  const TaskInput* input = reinterpret_cast<const TaskInput*>(args.input_buffer_);
+  const uint32_t records = input->records;
+  const uint32_t kRecordsPerXct = 1024;
+
+  thread::Thread* context = args.context_;
+  storage::array::ArrayStorage array(args.engine_, kName);
+  xct::XctManager* xct_manager = args.engine_->get_xct_manager();
+  Epoch commit_epoch;
+  for (uint32_t from = 0; from < records; from += kRecordsPerXct) {
+    WRAP_ERROR_CODE(xct_manager->begin_xct(context, xct::kSerializable));
+    for (uint32_t i = from; i < records && i < from + kRecordsPerXct; ++i) {
+      uint64_t data = input->id + i;
+      WRAP_ERROR_CODE(array.overwrite_record_primitive<uint64_t>(context, i, data, 0));
+    }
+    WRAP_ERROR_CODE(xct_manager->precommit_xct(context, &commit_epoch));
+  }
+  WRAP_ERROR_CODE(xct_manager->wait_for_commit(commit_epoch));
+  return kRetOk;
+}
+
+ErrorStack many_verify_task(const proc::ProcArguments& args) {
+  EXPECT_EQ(kInput, args.input_len_);
+  const TaskInput* input = reinterpret_cast<const TaskInput*>(args.input_buffer_);
+  const uint32_t records = input->records;
+
+  thread::Thread* context = args.context_;
+  storage::array::ArrayStorage array(args.engine_, kName);
+  xct::XctManager* xct_manager = args.engine_->get_xct_manager();
+  WRAP_ERROR_CODE(xct_manager->begin_xct(context, xct::kDirtyRead));
+  for (uint32_t i = 0; i < records; ++i) {
+    uint64_t data = 0;
+    WRAP_ERROR_CODE(array.get_record_primitive<uint64_t>(context, i, &data, 0));
+    EXPECT_EQ(input->id + i, data) << i;
+  }
+  Epoch commit_epoch;
+  WRAP_ERROR_CODE(xct_manager->precommit_xct(context, &commit_epoch));
+  return kRetOk;
+}
+
+// Distinct keys, so that the mapper can't compact them. The logs fill the reducer buffer a few
+// times. The first sorted run is kept in memory and the rest are spilled to files,
+// so the composer merges both kinds of sorted runs.
+TEST(SnapshotArrayTest, InMemoryRuns) {
+  EngineOptions options = get_tiny_options();
+  options.memory_.page_pool_size_mb_per_node_ = 16;
+  options.snapshot_.log_reducer_in_memory_runs_mb_ = 1;
+  options.cache_.snapshot_cache_size_mb_per_node_ = 8;  // verify reads all leaf pages
+  const uint32_t records = 1U << 16;
+  TaskInput input = {123, records};
+  {
+    Engine engine(options);
+    engine.get_proc_manager()->pre_register("overwrites", many_overwrites_task);
+    engine.get_proc_manager()->pre_register("verify", many_verify_task);
+    COERCE_ERROR(engine.initialize());
+    {
+      UninitializeGuard guard(&engine);
+      storage::array::ArrayStorage array;
+      Epoch commit_epoch;
+      storage::array::ArrayMetadata meta(kName, sizeof(uint64_t), records);
+      COERCE_ERROR(engine.get_storage_manager()->create_array(&meta, &array, &commit_epoch));
+      COERCE_ERROR(engine.get_thread_pool()->impersonate_synchronous(
+        "overwrites",
+        &input,
+        kInput));
+      engine.get_snapshot_manager()->trigger_snapshot_immediate(true);
+      // The logs take a few sorted runs, more than the budget. Some of them stay in memory,
+      // the rest are spilled to files.
+      LogReducerRef reducer(&engine, 0);
+      EXPECT_GT(reducer.get_in_memory_sorted_runs(), 0U);
+      EXPECT_GT(reducer.get_dumped_sorted_runs(), 0U);
+      COERCE_ERROR(engine.get_thread_pool()->impersonate_synchronous("verify", &input, kInput));
+      COERCE_ERROR(engine.uninitialize());
+    }
+  }
+  {
+    Engine engine(options);
+    engine.get_proc_manager()->pre_register("verify", many_verify_task);
+    COERCE_ERROR(engine.initialize());
+    {
+      UninitializeGuard guard(&engine);
+      COERCE_ERROR(engine.get_thread_pool()->impersonate_synchronous("verify", &input, kInput));
+      COERCE_ERROR(engine.uninitialize());
+    }
+  }
+  cleanup_test(options);
+}
+
+/** Increments all records by input->id in small transactions. */
+ErrorStack many_increments_task(const proc::ProcArguments& args) {
+  EXPECT_EQ(kInput, args.input_len_);
+  const TaskInput* input = reinterpret_cast<const TaskInput*>(args.input_buffer_);
+  const uint32_t records = input->records;
+  const uint32_t kRecordsPerXct = 1024;
+
+  thread::Thread* context = args.context_;
+  storage::array::ArrayStorage array(args.engine_, kName);
+  xct::XctManager* xct_manager = args.engine_->get_xct_manager();
+  Epoch commit_epoch;
+  for (uint32_t from = 0; from < records; from += kRecordsPerXct) {
+    WRAP_ERROR_CODE(xct_manager->begin_xct(context, xct::kSerializable));
+    for (uint32_t i = from; i < records && i < from + kRecordsPerXct; ++i) {
+      uint64_t value = input->id;
+      WRAP_ERROR_CODE(array.increment_record_oneshot<uint64_t>(context, i, value, 0));
+    }
+    WRAP_ERROR_CODE(xct_manager->precommit_xct(context, &commit_epoch));
+  }
+  WRAP_ERROR_CODE(xct_manager->wait_for_commit(commit_epoch));
+  return kRetOk;
+}
+
+// The reducer object is reused for the second snapshot. It must start from zero sorted runs
+// and the full in-memory budget, otherwise the increments of the first snapshot are applied twice.
+TEST(SnapshotArrayTest, InMemoryRunsTwoSnapshots) {
+  EngineOptions options = get_tiny_options();
+  options.memory_.page_pool_size_mb_per_node_ = 16;
+  options.snapshot_.log_reducer_in_memory_runs_mb_ = 1;
+  options.cache_.snapshot_cache_size_mb_per_node_ = 8;  // increments read all leaf pages
+  const uint32_t records = 1U << 16;
+  const uint32_t kDelta = 1000;
+  TaskInput input = {123, records};
+  TaskInput delta = {kDelta, records};
+  TaskInput after_increment = {123 + kDelta, records};
+  {
+    Engine engine(options);
+    engine.get_proc_manager()->pre_register("overwrites", many_overwrites_task);
+    engine.get_proc_manager()->pre_register("increments", many_increments_task);
+    engine.get_proc_manager()->pre_register("verify", many_verify_task);
+    COERCE_ERROR(engine.initialize());
+    {
+      UninitializeGuard guard(&engine);
+      storage::array::ArrayStorage array;
+      Epoch commit_epoch;
+      storage::array::ArrayMetadata meta(kName, sizeof(uint64_t), records);
+      COERCE_ERROR(engine.get_storage_manager()->create_array(&meta, &array, &commit_epoch));
+      COERCE_ERROR(engine.get_thread_pool()->impersonate_synchronous(
+        "overwrites",
+        &input,
+        kInput));
+      engine.get_snapshot_manager()->trigger_snapshot_immediate(true);
+      LogReducerRef reducer(&engine, 0);
+      EXPECT_GT(reducer.get_in_memory_sorted_runs(), 0U);
+      COERCE_ERROR(engine.get_thread_pool()->impersonate_synchronous(
+        "increments",
+        &delta,
+        kInput));
+      engine.get_snapshot_manager()->trigger_snapshot_immediate(true);
+      // If the budget were not returned, all sorted runs of this snapshot would be spilled.
+      EXPECT_GT(reducer.get_in_memory_sorted_runs(), 0U);
+      COERCE_ERROR(engine.get_thread_pool()->impersonate_synchronous(
+        "verify",
+        &after_increment,
+        kInput));
+      COERCE_ERROR(engine.uninitialize());
+    }
+  }
+  {
+    Engine engine(options);
+    engine.get_proc_manager()->pre_register("verify", many_verify_task);
+    COERCE_ERROR(engine.initialize());
+    {
+      UninitializeGuard guard(&engine);
+      COERCE_ERROR(engine.get_thread_pool()->impersonate_synchronous(
+        "verify",
+        &after_increment,
+        kInput));
+      COERCE_ERROR(engine.uninitialize());
+    }
+  }
+  cleanup_test(options);
+}
+
+// With log_mapper_read_ahead_, mappers read durable logs before the snapshot is triggered.
+// The logs are larger than the mapper's IO buffer, so mappers also read the rest as usual.
+TEST(SnapshotArrayTest, ReadAhead) {
+  EngineOptions options = get_tiny_options();
+  options.memory_.page_pool_size_mb_per_node_ = 16;
+  options.snapshot_.log_mapper_read_ahead_ = true;
+  options.cache_.snapshot_cache_size_mb_per_node_ = 8;  // increments read all leaf pages
+  const uint32_t records = 1U << 16;
+  const uint32_t kDelta = 1000;
+  TaskInput input = {123, records};
+  TaskInput delta = {kDelta, records};
+  TaskInput after_increment = {123 + kDelta, records};
+  {
+    Engine engine(options);
+    engine.get_proc_manager()->pre_register("overwrites", many_overwrites_task);
+    engine.get_proc_manager()->pre_register("increments", many_increments_task);
+    engine.get_proc_manager()->pre_register("verify", many_verify_task);
+    COERCE_ERROR(engine.initialize());
+    {
+      UninitializeGuard guard(&engine);
+      storage::array::ArrayStorage array;
+      Epoch commit_epoch;
+      storage::array::ArrayMetadata meta(kName, sizeof(uint64_t), records);
+      COERCE_ERROR(engine.get_storage_manager()->create_array(&meta, &array, &commit_epoch));
+      LogGleanerRef gleaner(&engine);
+      COERCE_ERROR(engine.get_thread_pool()->impersonate_synchronous(
+        "overwrites",
+        &input,
+        kInput));
+      // the snapshot daemon reads ahead every 100ms
+      std::this_thread::sleep_for(std::chrono::milliseconds(500));
+      engine.get_snapshot_manager()->trigger_snapshot_immediate(true);
+      EXPECT_GT(gleaner.get_read_ahead_log_bytes(), 0U);
+      COERCE_ERROR(engine.get_thread_pool()->impersonate_synchronous(
+        "increments",
+        &delta,
+        kInput));
+      std::this_thread::sleep_for(std::chrono::milliseconds(500));
+      engine.get_snapshot_manager()->trigger_snapshot_immediate(true);
+      // this time mappers start from the middle of the log files
+      EXPECT_GT(gleaner.get_read_ahead_log_bytes(), 0U);
+      COERCE_ERROR(engine.get_thread_pool()->impersonate_synchronous(
+        "verify",
+        &after_increment,
+        kInput));
+      COERCE_ERROR(engine.uninitialize());
+    }
+  }
+  {
+    Engine engine(options);
+    engine.get_proc_manager()->pre_register("verify", many_verify_task);
+    COERCE_ERROR(engine.initialize());
+    {
+      UninitializeGuard guard(&engine);
+      COERCE_ERROR(engine.get_thread_pool()->impersonate_synchronous(
+        "verify",
+        &after_increment,
+        kInput));
+      COERCE_ERROR(engine.uninitialize());
+    }
+  }
+  cleanup_test(options);
+}
+
+/** many_verify_task that also outputs the number of snapshot cache misses during it */
+ErrorStack read_extent_verify_task(const proc::ProcArguments& args) {
+  const uint64_t misses_before = args.context_->get_snapshot_cache_misses();
+  CHECK_ERROR(many_verify_task(args));
+  uint64_t misses = args.context_->get_snapshot_cache_misses() - misses_before;
+  std::memcpy(args.output_buffer_, &misses, sizeof(misses));
+  *args.output_used_ = sizeof(misses);
+  return kRetOk;
+}
+
+// With snapshot_read_extent_, a cache miss on a leaf page also brings the following leaf pages.
+TEST(SnapshotArrayTest, ReadExtent) {
+  EngineOptions options = get_tiny_options();
+  const uint32_t records = 1U << 14;
+  const uint32_t kExtent = 8;
+  TaskInput input = {123, records};
+  {
+    Engine engine(options);
+    engine.get_proc_manager()->pre_register("overwrites", many_overwrites_task);
+    COERCE_ERROR(engine.initialize());
+    {
+      UninitializeGuard guard(&engine);
+      storage::array::ArrayStorage array;
+      Epoch commit_epoch;
+      storage::array::ArrayMetadata meta(kName, sizeof(uint64_t), records);
+      meta.snapshot_thresholds_.snapshot_read_extent_ = kExtent;
+      COERCE_ERROR(engine.get_storage_manager()->create_array(&meta, &array, &commit_epoch));
+      COERCE_ERROR(engine.get_thread_pool()->impersonate_synchronous(
+        "overwrites",
+        &input,
+        kInput));
+      engine.get_snapshot_manager()->trigger_snapshot_immediate(true);
+      COERCE_ERROR(engine.uninitialize());
+    }
+  }
+  {
+    // After restart, the array has only snapshot pages.
+    Engine engine(options);
+    engine.get_proc_manager()->pre_register("verify", read_extent_verify_task);
+    COERCE_ERROR(engine.initialize());
+    {
+      UninitializeGuard guard(&engine);
+      storage::array::ArrayStorage array(&engine, kName);
+      EXPECT_EQ(kExtent, array.get_metadata()->snapshot_thresholds_.snapshot_read_extent_);
+      const uint64_t leaf_pages
+        = assorted::int_div_ceil(records, storage::array::to_records_in_leaf(sizeof(uint64_t)));
+      EXPECT_GT(leaf_pages, kExtent * 4U);
+
+      thread::ImpersonateSession session;
+      EXPECT_TRUE(engine.get_thread_pool()->impersonate("verify", &input, kInput, &session));
+      COERCE_ERROR(session.get_result());
+      uint64_t misses = 0;
+      EXPECT_EQ(sizeof(misses), session.get_output_size());
+      session.get_output(&misses);
+      session.release();
+      // one miss per extent of leaf pages, plus a few intermediate pages
+      EXPECT_LT(misses, leaf_pages / 2U);
+      EXPECT_GT(misses, 0U);
+      COERCE_ERROR(engine.uninitialize());
+    }
+  }
+  cleanup_test(options);
+}
+
 // Also test 1-level case. It might have a bug specific to this case because
 // single-level array storage is treated differently in the composer. See Issue #127.
 TEST(SnapshotArrayTest, OverwritesOneLogger) { test_run(kOv, false, false, 1); }
@@ -346,6 +839,9 @@ TEST(SnapshotArrayTest, IncrementsTwoPartitions) { test_run(kInc, true, true, 1)
 TEST(SnapshotArrayTest, IncrementsTwiceOneLogger) { test_run(kInc2, false, false, 1); }
 TEST(SnapshotArrayTest, IncrementsTwiceTwoLoggers) { test_run(kInc2, true, false, 1); }
 TEST(SnapshotArrayTest, IncrementsTwiceTwoPartitions) { test_run(kInc2, true, true, 1); }
+TEST(SnapshotArrayTest, AddsOneLogger) { test_run(kAdd, false, false, 1); }
+TEST(SnapshotArrayTest, AddsTwoLoggers) { test_run(kAdd, true, false, 1); }
+TEST(SnapshotArrayTest, AddsTwoPartitions) { test_run(kAdd, true, true, 1); }
 TEST(SnapshotArrayTest, TwoArraysOneLogger) { test_run(kTwo, false, false, 1); }
 TEST(SnapshotArrayTest, TwoArraysTwoLoggers) { test_run(kTwo, true, false, 1); }
 TEST(SnapshotArrayTest, TwoArraysTwoPartitions) { test_run(kTwo, true, true, 1); }
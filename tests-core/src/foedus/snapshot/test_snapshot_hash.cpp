@@ -69,6 +69,48 @@ ErrorStack inserts_fixed_len_task(const proc::ProcArguments& args) {
   return kRetOk;
 }
 
+/** Same results as inserts_fixed_len_task, but with blind adds that the composer sums up. */
+ErrorStack inserts_adds_task(const proc::ProcArguments& args) {
+  EXPECT_EQ(sizeof(uint32_t), args.input_len_);
+  uint32_t id = *reinterpret_cast<const uint32_t*>(args.input_buffer_);
+  EXPECT_NE(id, 2U);
+
+  thread::Thread* context = args.context_;
+  storage::hash::HashStorage hash(args.engine_, kName);
+  ASSERT_ND(hash.exists());
+  xct::XctManager* xct_manager = args.engine_->get_xct_manager();
+  Epoch commit_epoch;
+  const uint64_t kOne = 1U;
+
+  WRAP_ERROR_CODE(xct_manager->begin_xct(context, xct::kSerializable));
+  for (uint32_t i = 0; i < kRecords / 2U; ++i) {
+    uint64_t key = id * kRecords / 2U + i;
+    WRAP_ERROR_CODE(hash.insert_record(context, &key, sizeof(key), &key, sizeof(key)));
+  }
+  WRAP_ERROR_CODE(xct_manager->precommit_xct(context, &commit_epoch));
+
+  WRAP_ERROR_CODE(xct_manager->begin_xct(context, xct::kSerializable));
+  for (uint32_t i = 0; i < kRecords / 2U; ++i) {
+    uint64_t key = id * kRecords / 2U + i;
+    WRAP_ERROR_CODE(hash.add_record(context, key, kDataAddendum - 1U, 0));
+  }
+  WRAP_ERROR_CODE(xct_manager->precommit_xct(context, &commit_epoch));
+
+  WRAP_ERROR_CODE(xct_manager->begin_xct(context, xct::kSerializable));
+  for (uint32_t i = 0; i < kRecords / 2U; ++i) {
+    uint64_t key = id * kRecords / 2U + i;
+    WRAP_ERROR_CODE(hash.add_record(context, key, kOne, 0));
+  }
+  // adds never create a record
+  uint64_t missing = kRecords + id;
+  EXPECT_EQ(
+    kErrorCodeStrKeyNotFound,
+    hash.add_record(context, missing, kOne, 0));
+  WRAP_ERROR_CODE(xct_manager->precommit_xct(context, &commit_epoch));
+  WRAP_ERROR_CODE(xct_manager->wait_for_commit(commit_epoch));
+  return kRetOk;
+}
+
 ErrorStack verify_task(const proc::ProcArguments& args) {
   thread::Thread* context = args.context_;
   storage::hash::HashStorage hash(args.engine_, kName);
@@ -186,6 +228,7 @@ void test_run(
     Engine engine(options);
     engine.get_proc_manager()->pre_register("inserts_fixed_len_task", inserts_fixed_len_task);
     engine.get_proc_manager()->pre_register("inserts_varlen_task", inserts_varlen_task);
+    engine.get_proc_manager()->pre_register("inserts_adds_task", inserts_adds_task);
     engine.get_proc_manager()->pre_register("verify_task", verify_task);
     engine.get_proc_manager()->pre_register("verify_varlen_task", verify_varlen_task);
     COERCE_ERROR(engine.initialize());
@@ -237,6 +280,7 @@ const uint8_t k2Lv = 12;
 
 const proc::ProcName kInsN("inserts_fixed_len_task");
 const proc::ProcName kInsV("inserts_varlen_task");
+const proc::ProcName kInsA("inserts_adds_task");
 const proc::ProcName kVerN("verify_task");
 const proc::ProcName kVerV("verify_varlen_task");
 
@@ -260,6 +304,10 @@ TEST(SnapshotHashTest, InsertsVarlenTwoLoggers2Lv) { test_run(kInsV, kVerV, k2Lv
 TEST(SnapshotHashTest, InsertsVarlenTwoPartitions1Lv) { test_run(kInsV, kVerV, k1Lv, true, true); }
 TEST(SnapshotHashTest, InsertsVarlenTwoPartitions2Lv) { test_run(kInsV, kVerV, k2Lv, true, true); }
 
+TEST(SnapshotHashTest, AddsOneLogger1Lv) { test_run(kInsA, kVerN, k1Lv, false, false); }
+TEST(SnapshotHashTest, AddsOneLogger2Lv) { test_run(kInsA, kVerN, k2Lv, false, false); }
+TEST(SnapshotHashTest, AddsTwoPartitions2Lv) { test_run(kInsA, kVerN, k2Lv, true, true); }
+
 }  // namespace snapshot
 }  // namespace foedus
 
@@ -17,6 +17,7 @@
  */
 #include <gtest/gtest.h>
 
+#include <cstring>
 #include <string>
 
 #include "foedus/engine.hpp"
@@ -27,11 +28,17 @@
 #include "foedus/snapshot/snapshot_id.hpp"
 #include "foedus/snapshot/snapshot_manager.hpp"
 #include "foedus/snapshot/snapshot_manager_pimpl.hpp"
+#include "foedus/soc/shared_memory_repo.hpp"
+#include "foedus/soc/shared_rendezvous.hpp"
+#include "foedus/soc/soc_manager.hpp"
 #include "foedus/storage/storage_manager.hpp"
+#include "foedus/storage/masstree/masstree_cursor.hpp"
 #include "foedus/storage/masstree/masstree_id.hpp"
 #include "foedus/storage/masstree/masstree_metadata.hpp"
 #include "foedus/storage/masstree/masstree_storage.hpp"
+#include "foedus/thread/thread.hpp"
 #include "foedus/thread/thread_pool.hpp"
+#include "foedus/xct/xct.hpp"
 #include "foedus/xct/xct_manager.hpp"
 
 /**
@@ -44,6 +51,8 @@ DEFINE_TEST_CASE_PACKAGE(SnapshotMasstreeTest, foedus.snapshot);
 const uint32_t kRecords = 1024;
 const uint32_t kThreads = 2;
 const storage::StorageName kName("test");
+/** Created after the first snapshot, so the snapshot does not know it */
+const storage::StorageName kLaterName("later");
 
 ErrorStack inserts_normalized_task(const proc::ProcArguments& args) {
   EXPECT_EQ(sizeof(uint32_t), args.input_len_);
@@ -230,6 +239,826 @@ void test_run(
   cleanup_test(options);
 }
 
+/** user memory has two rendezvous. [0]: reader pinned the snapshot. [1]: new snapshot taken */
+soc::SharedRendezvous* get_pinned_rendezvous(Engine* engine) {
+  void* user_memory = engine->get_soc_manager()->get_shared_memory_repo()->get_global_user_memory();
+  return reinterpret_cast<soc::SharedRendezvous*>(user_memory);
+}
+
+ErrorStack inserts_more_task(const proc::ProcArguments& args) {
+  thread::Thread* context = args.context_;
+  storage::masstree::MasstreeStorage masstree(args.engine_, kName);
+  xct::XctManager* xct_manager = args.engine_->get_xct_manager();
+  WRAP_ERROR_CODE(xct_manager->begin_xct(context, xct::kSerializable));
+  for (uint64_t rec = kRecords; rec < kRecords * 2U; ++rec) {
+    storage::masstree::KeySlice slice = storage::masstree::normalize_primitive<uint64_t>(rec);
+    WRAP_ERROR_CODE(masstree.insert_record_normalized(context, slice, &rec, sizeof(rec)));
+  }
+  storage::masstree::MasstreeStorage later(args.engine_, kLaterName);
+  uint64_t later_rec = 0;
+  WRAP_ERROR_CODE(later.insert_record_normalized(context, 0, &later_rec, sizeof(later_rec)));
+  Epoch commit_epoch;
+  WRAP_ERROR_CODE(xct_manager->precommit_xct(context, &commit_epoch));
+  WRAP_ERROR_CODE(xct_manager->wait_for_commit(commit_epoch));
+  return kRetOk;
+}
+
+/** Keys in [0, visible_records) must be found, and keys in [visible_records, kRecords*2) not */
+ErrorStack verify_pinned(thread::Thread* context, uint64_t visible_records) {
+  storage::masstree::MasstreeStorage masstree(context->get_engine(), kName);
+  for (uint64_t rec = 0; rec < kRecords * 2U; ++rec) {
+    storage::masstree::KeySlice slice = storage::masstree::normalize_primitive<uint64_t>(rec);
+    uint64_t data = 0;
+    ErrorCode ret = masstree.get_record_primitive_normalized<uint64_t>(
+      context,
+      slice,
+      &data,
+      0,
+      true);
+    if (rec < visible_records) {
+      EXPECT_EQ(kErrorCodeOk, ret) << rec;
+      EXPECT_EQ(rec, data) << rec;
+    } else {
+      EXPECT_EQ(kErrorCodeStrKeyNotFound, ret) << rec;
+    }
+  }
+  EXPECT_EQ(0U, context->get_current_xct().get_read_set_size());
+  EXPECT_EQ(0U, context->get_current_xct().get_pointer_set_size());
+  return kRetOk;
+}
+
+/** kLaterName must look empty if it didn't exist in the pinned snapshot, not expired */
+ErrorStack verify_pinned_later(thread::Thread* context, bool visible) {
+  storage::masstree::MasstreeStorage later(context->get_engine(), kLaterName);
+  uint64_t data = 0;
+  ErrorCode ret = later.get_record_primitive_normalized<uint64_t>(context, 0, &data, 0, true);
+  EXPECT_EQ(visible ? kErrorCodeOk : kErrorCodeStrKeyNotFound, ret);
+  storage::masstree::MasstreeCursor cursor(later, context);
+  WRAP_ERROR_CODE(cursor.open());
+  EXPECT_EQ(visible, cursor.is_valid_record());
+  return kRetOk;
+}
+
+ErrorStack pinned_read_task(const proc::ProcArguments& args) {
+  thread::Thread* context = args.context_;
+  soc::SharedRendezvous* rendezvous = get_pinned_rendezvous(args.engine_);
+  xct::XctManager* xct_manager = args.engine_->get_xct_manager();
+  WRAP_ERROR_CODE(xct_manager->begin_xct(context, xct::kPinnedSnapshot));
+  CHECK_ERROR(verify_pinned(context, kRecords));
+  rendezvous[0].signal();
+
+  // others insert more records and take a new snapshot meanwhile.
+  rendezvous[1].wait();
+  CHECK_ERROR(verify_pinned(context, kRecords));
+  CHECK_ERROR(verify_pinned_later(context, false));
+  storage::masstree::MasstreeStorage masstree(args.engine_, kName);
+  uint64_t data = 0;
+  EXPECT_EQ(
+    kErrorCodeXctPinnedSnapshotReadOnly,
+    masstree.overwrite_record_normalized(context, 0, &data, 0, sizeof(data)));
+  Epoch commit_epoch;
+  WRAP_ERROR_CODE(xct_manager->precommit_xct(context, &commit_epoch));
+
+  // a new pinned transaction sees the new snapshot
+  WRAP_ERROR_CODE(xct_manager->begin_xct(context, xct::kPinnedSnapshot));
+  CHECK_ERROR(verify_pinned(context, kRecords * 2U));
+  CHECK_ERROR(verify_pinned_later(context, true));
+  WRAP_ERROR_CODE(xct_manager->precommit_xct(context, &commit_epoch));
+  return kRetOk;
+}
+
+ErrorStack pin_without_snapshot_task(const proc::ProcArguments& args) {
+  xct::XctManager* xct_manager = args.engine_->get_xct_manager();
+  EXPECT_EQ(
+    kErrorCodeXctNoSnapshotToPin,
+    xct_manager->begin_xct(args.context_, xct::kPinnedSnapshot));
+  EXPECT_FALSE(args.context_->get_current_xct().is_active());
+  return kRetOk;
+}
+
+TEST(SnapshotMasstreeTest, PinnedSnapshot) {
+  EngineOptions options = get_tiny_options();
+  options.thread_.thread_count_per_group_ = kThreads;
+  {
+    Engine engine(options);
+    engine.get_proc_manager()->pre_register("inserts_normalized_task", inserts_normalized_task);
+    engine.get_proc_manager()->pre_register("inserts_more_task", inserts_more_task);
+    engine.get_proc_manager()->pre_register("pinned_read_task", pinned_read_task);
+    engine.get_proc_manager()->pre_register("pin_without_snapshot_task", pin_without_snapshot_task);
+    COERCE_ERROR(engine.initialize());
+    {
+      UninitializeGuard guard(&engine);
+      storage::masstree::MasstreeStorage out;
+      Epoch commit_epoch;
+      storage::masstree::MasstreeMetadata meta(kName);
+      COERCE_ERROR(engine.get_storage_manager()->create_masstree(&meta, &out, &commit_epoch));
+      thread::ThreadPool* pool = engine.get_thread_pool();
+      COERCE_ERROR(pool->impersonate_synchronous("pin_without_snapshot_task"));
+      for (uint32_t i = 0; i < kThreads; ++i) {
+        COERCE_ERROR(pool->impersonate_on_numa_core_synchronous(
+          i,
+          "inserts_normalized_task",
+          &i,
+          sizeof(i)));
+      }
+      engine.get_snapshot_manager()->trigger_snapshot_immediate(true);
+      storage::masstree::MasstreeMetadata later_meta(kLaterName);
+      COERCE_ERROR(engine.get_storage_manager()->create_masstree(&later_meta, &out, &commit_epoch));
+
+      soc::SharedRendezvous* rendezvous = get_pinned_rendezvous(&engine);
+      rendezvous[0].initialize();
+      rendezvous[1].initialize();
+      {
+        thread::ImpersonateSession session;
+        EXPECT_TRUE(pool->impersonate("pinned_read_task", nullptr, 0, &session));
+        rendezvous[0].wait();
+        COERCE_ERROR(pool->impersonate_synchronous("inserts_more_task"));
+        engine.get_snapshot_manager()->trigger_snapshot_immediate(true);
+        rendezvous[1].signal();
+        COERCE_ERROR(session.get_result());
+      }
+      rendezvous[0].uninitialize();
+      rendezvous[1].uninitialize();
+      COERCE_ERROR(engine.uninitialize());
+    }
+  }
+  cleanup_test(options);
+}
+
+const uint16_t kHistorySize = 3;
+
+/** Inserts one more record, kRecords * 2 + the given index */
+ErrorStack insert_one_task(const proc::ProcArguments& args) {
+  EXPECT_EQ(sizeof(uint32_t), args.input_len_);
+  uint64_t rec = kRecords * 2U + *reinterpret_cast<const uint32_t*>(args.input_buffer_);
+  thread::Thread* context = args.context_;
+  storage::masstree::MasstreeStorage masstree(args.engine_, kName);
+  xct::XctManager* xct_manager = args.engine_->get_xct_manager();
+  WRAP_ERROR_CODE(xct_manager->begin_xct(context, xct::kSerializable));
+  storage::masstree::KeySlice slice = storage::masstree::normalize_primitive<uint64_t>(rec);
+  WRAP_ERROR_CODE(masstree.insert_record_normalized(context, slice, &rec, sizeof(rec)));
+  Epoch commit_epoch;
+  WRAP_ERROR_CODE(xct_manager->precommit_xct(context, &commit_epoch));
+  WRAP_ERROR_CODE(xct_manager->wait_for_commit(commit_epoch));
+  return kRetOk;
+}
+
+ErrorStack pinned_history_task(const proc::ProcArguments& args) {
+  thread::Thread* context = args.context_;
+  soc::SharedRendezvous* rendezvous = get_pinned_rendezvous(args.engine_);
+  xct::XctManager* xct_manager = args.engine_->get_xct_manager();
+  WRAP_ERROR_CODE(xct_manager->begin_xct(context, xct::kPinnedSnapshot));
+  CHECK_ERROR(verify_pinned(context, kRecords));
+  rendezvous[0].signal();
+
+  // kHistorySize - 1 new snapshots are taken meanwhile. The pinned root is still remembered.
+  rendezvous[1].wait();
+  CHECK_ERROR(verify_pinned(context, kRecords));
+  rendezvous[2].signal();
+
+  // One more snapshot. Now the pinned root is forgotten.
+  rendezvous[3].wait();
+  storage::masstree::MasstreeStorage masstree(args.engine_, kName);
+  uint64_t data = 0;
+  EXPECT_EQ(
+    kErrorCodeXctPinnedSnapshotExpired,
+    masstree.get_record_primitive_normalized<uint64_t>(context, 0, &data, 0, true));
+  WRAP_ERROR_CODE(xct_manager->abort_xct(context));
+  return kRetOk;
+}
+
+TEST(SnapshotMasstreeTest, PinnedSnapshotHistory) {
+  EngineOptions options = get_tiny_options();
+  options.thread_.thread_count_per_group_ = kThreads;
+  options.storage_.snapshot_root_history_size_ = kHistorySize;
+  {
+    Engine engine(options);
+    engine.get_proc_manager()->pre_register("inserts_normalized_task", inserts_normalized_task);
+    engine.get_proc_manager()->pre_register("insert_one_task", insert_one_task);
+    engine.get_proc_manager()->pre_register("pinned_history_task", pinned_history_task);
+    COERCE_ERROR(engine.initialize());
+    {
+      UninitializeGuard guard(&engine);
+      storage::masstree::MasstreeStorage out;
+      Epoch commit_epoch;
+      storage::masstree::MasstreeMetadata meta(kName);
+      COERCE_ERROR(engine.get_storage_manager()->create_masstree(&meta, &out, &commit_epoch));
+      thread::ThreadPool* pool = engine.get_thread_pool();
+      for (uint32_t i = 0; i < kThreads; ++i) {
+        COERCE_ERROR(pool->impersonate_on_numa_core_synchronous(
+          i,
+          "inserts_normalized_task",
+          &i,
+          sizeof(i)));
+      }
+      engine.get_snapshot_manager()->trigger_snapshot_immediate(true);
+
+      soc::SharedRendezvous* rendezvous = get_pinned_rendezvous(&engine);
+      for (uint16_t i = 0; i < 4U; ++i) {
+        rendezvous[i].initialize();
+      }
+      {
+        thread::ImpersonateSession session;
+        EXPECT_TRUE(pool->impersonate("pinned_history_task", nullptr, 0, &session));
+        rendezvous[0].wait();
+        uint32_t index = 0;
+        for (; index + 1U < kHistorySize; ++index) {
+          COERCE_ERROR(pool->impersonate_synchronous("insert_one_task", &index, sizeof(index)));
+          engine.get_snapshot_manager()->trigger_snapshot_immediate(true);
+        }
+        rendezvous[1].signal();
+        rendezvous[2].wait();
+        COERCE_ERROR(pool->impersonate_synchronous("insert_one_task", &index, sizeof(index)));
+        engine.get_snapshot_manager()->trigger_snapshot_immediate(true);
+        rendezvous[3].signal();
+        COERCE_ERROR(session.get_result());
+      }
+      for (uint16_t i = 0; i < 4U; ++i) {
+        rendezvous[i].uninitialize();
+      }
+      COERCE_ERROR(engine.uninitialize());
+    }
+  }
+  cleanup_test(options);
+}
+
+ErrorStack updates_task(const proc::ProcArguments& args) {
+  thread::Thread* context = args.context_;
+  storage::masstree::MasstreeStorage masstree(args.engine_, kName);
+  xct::XctManager* xct_manager = args.engine_->get_xct_manager();
+  WRAP_ERROR_CODE(xct_manager->begin_xct(context, xct::kSerializable));
+  for (uint64_t rec = 0; rec < kRecords; ++rec) {
+    storage::masstree::KeySlice slice = storage::masstree::normalize_primitive<uint64_t>(rec);
+    if (rec % 4U == 0) {
+      WRAP_ERROR_CODE(masstree.delete_record_normalized(context, slice));
+    } else {
+      uint64_t data = rec * 3U;
+      WRAP_ERROR_CODE(masstree.upsert_record_normalized(context, slice, &data, sizeof(data)));
+    }
+  }
+  Epoch commit_epoch;
+  WRAP_ERROR_CODE(xct_manager->precommit_xct(context, &commit_epoch));
+  WRAP_ERROR_CODE(xct_manager->wait_for_commit(commit_epoch));
+  return kRetOk;
+}
+
+ErrorStack verify_updates_task(const proc::ProcArguments& args) {
+  thread::Thread* context = args.context_;
+  storage::masstree::MasstreeStorage masstree(args.engine_, kName);
+  CHECK_ERROR(masstree.verify_single_thread(context));
+  xct::XctManager* xct_manager = args.engine_->get_xct_manager();
+  WRAP_ERROR_CODE(xct_manager->begin_xct(context, xct::kSerializable));
+  for (uint64_t rec = 0; rec < kRecords; ++rec) {
+    storage::masstree::KeySlice slice = storage::masstree::normalize_primitive<uint64_t>(rec);
+    uint64_t data = 0;
+    ErrorCode ret = masstree.get_record_primitive_normalized<uint64_t>(
+      context,
+      slice,
+      &data,
+      0,
+      true);
+    if (rec % 4U == 0) {
+      EXPECT_EQ(kErrorCodeStrKeyNotFound, ret) << rec;
+    } else {
+      EXPECT_EQ(kErrorCodeOk, ret) << rec;
+      EXPECT_EQ(rec * 3U, data) << rec;
+    }
+  }
+  Epoch commit_epoch;
+  WRAP_ERROR_CODE(xct_manager->precommit_xct(context, &commit_epoch));
+  return kRetOk;
+}
+
+TEST(SnapshotMasstreeTest, Updates) {
+  // The second snapshot merges updates/deletes into pages of the first snapshot
+  EngineOptions options = get_tiny_options();
+  options.thread_.thread_count_per_group_ = kThreads;
+  {
+    Engine engine(options);
+    engine.get_proc_manager()->pre_register("inserts_normalized_task", inserts_normalized_task);
+    engine.get_proc_manager()->pre_register("updates_task", updates_task);
+    engine.get_proc_manager()->pre_register("verify_updates_task", verify_updates_task);
+    COERCE_ERROR(engine.initialize());
+    {
+      UninitializeGuard guard(&engine);
+      storage::masstree::MasstreeStorage out;
+      Epoch commit_epoch;
+      storage::masstree::MasstreeMetadata meta(kName);
+      COERCE_ERROR(engine.get_storage_manager()->create_masstree(&meta, &out, &commit_epoch));
+      thread::ThreadPool* pool = engine.get_thread_pool();
+      for (uint32_t i = 0; i < kThreads; ++i) {
+        COERCE_ERROR(pool->impersonate_on_numa_core_synchronous(
+          i,
+          "inserts_normalized_task",
+          &i,
+          sizeof(i)));
+      }
+      engine.get_snapshot_manager()->trigger_snapshot_immediate(true);
+      COERCE_ERROR(pool->impersonate_synchronous("updates_task"));
+      engine.get_snapshot_manager()->trigger_snapshot_immediate(true);
+      COERCE_ERROR(pool->impersonate_synchronous("verify_updates_task"));
+      COERCE_ERROR(engine.uninitialize());
+    }
+  }
+  {
+    // verify the snapshot pages after restart
+    Engine engine(options);
+    engine.get_proc_manager()->pre_register("verify_updates_task", verify_updates_task);
+    COERCE_ERROR(engine.initialize());
+    {
+      UninitializeGuard guard(&engine);
+      COERCE_ERROR(engine.get_thread_pool()->impersonate_synchronous("verify_updates_task"));
+      COERCE_ERROR(engine.uninitialize());
+    }
+  }
+  cleanup_test(options);
+}
+
+/**
+ * The following tests each merge one kind of logs into pages of a previous snapshot.
+ * The previous snapshot has only even keys, so that the merge has original records on both
+ * sides of each log.
+ */
+enum MergeKind {
+  kMergeOverwrites = 0,
+  kMergeDeletes,
+  kMergeInsertsBetween,
+};
+
+ErrorStack inserts_even_task(const proc::ProcArguments& args) {
+  thread::Thread* context = args.context_;
+  storage::masstree::MasstreeStorage masstree(args.engine_, kName);
+  xct::XctManager* xct_manager = args.engine_->get_xct_manager();
+  WRAP_ERROR_CODE(xct_manager->begin_xct(context, xct::kSerializable));
+  for (uint64_t rec = 0; rec < kRecords * 2U; rec += 2U) {
+    storage::masstree::KeySlice slice = storage::masstree::normalize_primitive<uint64_t>(rec);
+    WRAP_ERROR_CODE(masstree.insert_record_normalized(context, slice, &rec, sizeof(rec)));
+  }
+  Epoch commit_epoch;
+  WRAP_ERROR_CODE(xct_manager->precommit_xct(context, &commit_epoch));
+  WRAP_ERROR_CODE(xct_manager->wait_for_commit(commit_epoch));
+  return kRetOk;
+}
+
+ErrorStack merge_task(const proc::ProcArguments& args) {
+  EXPECT_EQ(sizeof(MergeKind), args.input_len_);
+  MergeKind kind = *reinterpret_cast<const MergeKind*>(args.input_buffer_);
+  thread::Thread* context = args.context_;
+  storage::masstree::MasstreeStorage masstree(args.engine_, kName);
+  xct::XctManager* xct_manager = args.engine_->get_xct_manager();
+  WRAP_ERROR_CODE(xct_manager->begin_xct(context, xct::kSerializable));
+  for (uint64_t rec = 0; rec < kRecords * 2U; rec += 2U) {
+    storage::masstree::KeySlice slice = storage::masstree::normalize_primitive<uint64_t>(rec);
+    if (kind == kMergeOverwrites && rec % 3U == 0) {
+      uint64_t data = rec * 5U;
+      WRAP_ERROR_CODE(masstree.overwrite_record_normalized(context, slice, &data, 0, sizeof(data)));
+    } else if (kind == kMergeDeletes && rec % 7U == 0) {
+      WRAP_ERROR_CODE(masstree.delete_record_normalized(context, slice));
+    } else if (kind == kMergeInsertsBetween) {
+      uint64_t odd = rec + 1U;
+      storage::masstree::KeySlice odd_slice = storage::masstree::normalize_primitive<uint64_t>(odd);
+      WRAP_ERROR_CODE(masstree.insert_record_normalized(context, odd_slice, &odd, sizeof(odd)));
+    }
+  }
+  Epoch commit_epoch;
+  WRAP_ERROR_CODE(xct_manager->precommit_xct(context, &commit_epoch));
+  WRAP_ERROR_CODE(xct_manager->wait_for_commit(commit_epoch));
+  return kRetOk;
+}
+
+ErrorStack verify_merge_task(const proc::ProcArguments& args) {
+  EXPECT_EQ(sizeof(MergeKind), args.input_len_);
+  MergeKind kind = *reinterpret_cast<const MergeKind*>(args.input_buffer_);
+  thread::Thread* context = args.context_;
+  storage::masstree::MasstreeStorage masstree(args.engine_, kName);
+  CHECK_ERROR(masstree.verify_single_thread(context));
+  xct::XctManager* xct_manager = args.engine_->get_xct_manager();
+  Epoch commit_epoch;
+  for (uint64_t rec = 0; rec < kRecords * 2U; ++rec) {
+    // commit every now and then not to overflow the page-version set with not-found keys
+    if (rec % 256U == 0) {
+      if (rec > 0) {
+        WRAP_ERROR_CODE(xct_manager->precommit_xct(context, &commit_epoch));
+      }
+      WRAP_ERROR_CODE(xct_manager->begin_xct(context, xct::kSerializable));
+    }
+    storage::masstree::KeySlice slice = storage::masstree::normalize_primitive<uint64_t>(rec);
+    uint64_t data = 0;
+    ErrorCode ret = masstree.get_record_primitive_normalized<uint64_t>(
+      context,
+      slice,
+      &data,
+      0,
+      true);
+    bool exists = rec % 2U == 0 || kind == kMergeInsertsBetween;
+    uint64_t expected = rec;
+    if (kind == kMergeDeletes && rec % 7U == 0) {
+      exists = false;
+    } else if (kind == kMergeOverwrites && rec % 3U == 0) {
+      expected = rec * 5U;
+    }
+    if (exists) {
+      EXPECT_EQ(kErrorCodeOk, ret) << rec;
+      EXPECT_EQ(expected, data) << rec;
+    } else {
+      EXPECT_EQ(kErrorCodeStrKeyNotFound, ret) << rec;
+    }
+  }
+  WRAP_ERROR_CODE(xct_manager->precommit_xct(context, &commit_epoch));
+  return kRetOk;
+}
+
+void test_merge(MergeKind kind) {
+  EngineOptions options = get_tiny_options();
+  {
+    Engine engine(options);
+    engine.get_proc_manager()->pre_register("inserts_even_task", inserts_even_task);
+    engine.get_proc_manager()->pre_register("merge_task", merge_task);
+    engine.get_proc_manager()->pre_register("verify_merge_task", verify_merge_task);
+    COERCE_ERROR(engine.initialize());
+    {
+      UninitializeGuard guard(&engine);
+      storage::masstree::MasstreeStorage out;
+      Epoch commit_epoch;
+      storage::masstree::MasstreeMetadata meta(kName);
+      COERCE_ERROR(engine.get_storage_manager()->create_masstree(&meta, &out, &commit_epoch));
+      thread::ThreadPool* pool = engine.get_thread_pool();
+      COERCE_ERROR(pool->impersonate_synchronous("inserts_even_task"));
+      engine.get_snapshot_manager()->trigger_snapshot_immediate(true);
+      COERCE_ERROR(pool->impersonate_synchronous("merge_task", &kind, sizeof(kind)));
+      engine.get_snapshot_manager()->trigger_snapshot_immediate(true);
+      COERCE_ERROR(pool->impersonate_synchronous("verify_merge_task", &kind, sizeof(kind)));
+      COERCE_ERROR(engine.uninitialize());
+    }
+  }
+  {
+    Engine engine(options);
+    engine.get_proc_manager()->pre_register("verify_merge_task", verify_merge_task);
+    COERCE_ERROR(engine.initialize());
+    {
+      UninitializeGuard guard(&engine);
+      COERCE_ERROR(engine.get_thread_pool()->impersonate_synchronous(
+        "verify_merge_task",
+        &kind,
+        sizeof(kind)));
+      COERCE_ERROR(engine.uninitialize());
+    }
+  }
+  cleanup_test(options);
+}
+
+TEST(SnapshotMasstreeTest, MergeOverwrites) { test_merge(kMergeOverwrites); }
+TEST(SnapshotMasstreeTest, MergeDeletes) { test_merge(kMergeDeletes); }
+TEST(SnapshotMasstreeTest, MergeInsertsBetween) { test_merge(kMergeInsertsBetween); }
+
+/** Overwrites and blind adds on the same keys, which the composer merges into one record. */
+ErrorStack adds_task(const proc::ProcArguments& args) {
+  thread::Thread* context = args.context_;
+  storage::masstree::MasstreeStorage masstree(args.engine_, kName);
+  xct::XctManager* xct_manager = args.engine_->get_xct_manager();
+  Epoch commit_epoch;
+  WRAP_ERROR_CODE(xct_manager->begin_xct(context, xct::kSerializable));
+  for (uint64_t rec = 0; rec < kRecords; rec += 5U) {
+    storage::masstree::KeySlice slice = storage::masstree::normalize_primitive<uint64_t>(rec);
+    WRAP_ERROR_CODE(masstree.overwrite_record_primitive_normalized<uint64_t>(
+      context,
+      slice,
+      100U,
+      0));
+  }
+  WRAP_ERROR_CODE(xct_manager->precommit_xct(context, &commit_epoch));
+
+  WRAP_ERROR_CODE(xct_manager->begin_xct(context, xct::kSerializable));
+  for (uint64_t rec = 0; rec < kRecords; ++rec) {
+    storage::masstree::KeySlice slice = storage::masstree::normalize_primitive<uint64_t>(rec);
+    WRAP_ERROR_CODE(masstree.add_record_normalized<uint64_t>(context, slice, rec, 0));
+  }
+  WRAP_ERROR_CODE(xct_manager->precommit_xct(context, &commit_epoch));
+
+  WRAP_ERROR_CODE(xct_manager->begin_xct(context, xct::kSerializable));
+  for (uint64_t rec = 0; rec < kRecords; rec += 2U) {
+    storage::masstree::KeySlice slice = storage::masstree::normalize_primitive<uint64_t>(rec);
+    WRAP_ERROR_CODE(masstree.add_record_normalized<uint64_t>(context, slice, 1U, 0));
+  }
+  // adds never create a record
+  storage::masstree::KeySlice missing
+    = storage::masstree::normalize_primitive<uint64_t>(kRecords);
+  EXPECT_EQ(
+    kErrorCodeStrKeyNotFound,
+    masstree.add_record_normalized<uint64_t>(context, missing, 1U, 0));
+  WRAP_ERROR_CODE(xct_manager->precommit_xct(context, &commit_epoch));
+  WRAP_ERROR_CODE(xct_manager->wait_for_commit(commit_epoch));
+  return kRetOk;
+}
+
+ErrorStack verify_adds_task(const proc::ProcArguments& args) {
+  thread::Thread* context = args.context_;
+  storage::masstree::MasstreeStorage masstree(args.engine_, kName);
+  CHECK_ERROR(masstree.verify_single_thread(context));
+  xct::XctManager* xct_manager = args.engine_->get_xct_manager();
+  WRAP_ERROR_CODE(xct_manager->begin_xct(context, xct::kSerializable));
+  for (uint64_t rec = 0; rec < kRecords; ++rec) {
+    storage::masstree::KeySlice slice = storage::masstree::normalize_primitive<uint64_t>(rec);
+    uint64_t data = 0;
+    WRAP_ERROR_CODE(masstree.get_record_primitive_normalized<uint64_t>(
+      context,
+      slice,
+      &data,
+      0,
+      true));
+    uint64_t expected = (rec % 5U == 0) ? 100U : rec;
+    expected += rec;
+    if (rec % 2U == 0) {
+      ++expected;
+    }
+    EXPECT_EQ(expected, data) << rec;
+  }
+  Epoch commit_epoch;
+  WRAP_ERROR_CODE(xct_manager->precommit_xct(context, &commit_epoch));
+  return kRetOk;
+}
+
+TEST(SnapshotMasstreeTest, Adds) {
+  // The second snapshot sums up blind adds into pages of the first snapshot
+  EngineOptions options = get_tiny_options();
+  options.thread_.thread_count_per_group_ = kThreads;
+  {
+    Engine engine(options);
+    engine.get_proc_manager()->pre_register("inserts_normalized_task", inserts_normalized_task);
+    engine.get_proc_manager()->pre_register("adds_task", adds_task);
+    engine.get_proc_manager()->pre_register("verify_adds_task", verify_adds_task);
+    COERCE_ERROR(engine.initialize());
+    {
+      UninitializeGuard guard(&engine);
+      storage::masstree::MasstreeStorage out;
+      Epoch commit_epoch;
+      storage::masstree::MasstreeMetadata meta(kName);
+      COERCE_ERROR(engine.get_storage_manager()->create_masstree(&meta, &out, &commit_epoch));
+      thread::ThreadPool* pool = engine.get_thread_pool();
+      for (uint32_t i = 0; i < kThreads; ++i) {
+        COERCE_ERROR(pool->impersonate_on_numa_core_synchronous(
+          i,
+          "inserts_normalized_task",
+          &i,
+          sizeof(i)));
+      }
+      engine.get_snapshot_manager()->trigger_snapshot_immediate(true);
+      COERCE_ERROR(pool->impersonate_synchronous("adds_task"));
+      engine.get_snapshot_manager()->trigger_snapshot_immediate(true);
+      COERCE_ERROR(pool->impersonate_synchronous("verify_adds_task"));
+      COERCE_ERROR(engine.uninitialize());
+    }
+  }
+  {
+    // verify the snapshot pages after restart
+    Engine engine(options);
+    engine.get_proc_manager()->pre_register("verify_adds_task", verify_adds_task);
+    COERCE_ERROR(engine.initialize());
+    {
+      UninitializeGuard guard(&engine);
+      COERCE_ERROR(engine.get_thread_pool()->impersonate_synchronous("verify_adds_task"));
+      COERCE_ERROR(engine.uninitialize());
+    }
+  }
+  cleanup_test(options);
+}
+
+/**
+ * The following test compacts a border page after a snapshot and then takes a snapshot
+ * whose valid_until_epoch_ is before a deletion in the page. The compaction must keep the
+ * deletion, otherwise the page is dropped and the deleted record is live in the snapshot page.
+ * 200 bytes payloads, so that a page is full with 13 records.
+ */
+const uint32_t kCompactPayload = 200;
+const uint64_t kCompactOldDeletes = 9;
+const uint64_t kCompactAbortedInserts = 8;
+
+ErrorStack compact_setup_task(const proc::ProcArguments& args) {
+  thread::Thread* context = args.context_;
+  storage::masstree::MasstreeStorage masstree(args.engine_, kName);
+  xct::XctManager* xct_manager = args.engine_->get_xct_manager();
+  char data[kCompactPayload];
+  std::memset(data, 0, sizeof(data));
+  Epoch commit_epoch;
+  WRAP_ERROR_CODE(xct_manager->begin_xct(context, xct::kSerializable));
+  for (uint64_t key = 0; key < 2U; ++key) {
+    storage::masstree::KeySlice slice = storage::masstree::normalize_primitive<uint64_t>(key);
+    WRAP_ERROR_CODE(masstree.insert_record_normalized(context, slice, data, sizeof(data)));
+  }
+  for (uint64_t key = 100; key < 100U + kCompactOldDeletes; ++key) {
+    storage::masstree::KeySlice slice = storage::masstree::normalize_primitive<uint64_t>(key);
+    WRAP_ERROR_CODE(masstree.insert_record_normalized(context, slice, data, sizeof(data)));
+  }
+  WRAP_ERROR_CODE(xct_manager->precommit_xct(context, &commit_epoch));
+
+  // these deletions will be in the first snapshot, so compaction can reclaim them.
+  WRAP_ERROR_CODE(xct_manager->begin_xct(context, xct::kSerializable));
+  for (uint64_t key = 100; key < 100U + kCompactOldDeletes; ++key) {
+    storage::masstree::KeySlice slice = storage::masstree::normalize_primitive<uint64_t>(key);
+    WRAP_ERROR_CODE(masstree.delete_record_normalized(context, slice));
+  }
+  WRAP_ERROR_CODE(xct_manager->precommit_xct(context, &commit_epoch));
+  WRAP_ERROR_CODE(xct_manager->wait_for_commit(commit_epoch));
+  return kRetOk;
+}
+
+/** Outputs the epochs of the insertion to the page and of the later deletion */
+ErrorStack compact_update_task(const proc::ProcArguments& args) {
+  thread::Thread* context = args.context_;
+  storage::masstree::MasstreeStorage masstree(args.engine_, kName);
+  xct::XctManager* xct_manager = args.engine_->get_xct_manager();
+  char data[kCompactPayload];
+  std::memset(data, 0, sizeof(data));
+  Epoch epochs[2];
+
+  // this insertion makes the second snapshot compose the page, and then drop it if possible.
+  xct_manager->advance_current_global_epoch();
+  WRAP_ERROR_CODE(xct_manager->begin_xct(context, xct::kSerializable));
+  storage::masstree::KeySlice slice = storage::masstree::normalize_primitive<uint64_t>(2U);
+  WRAP_ERROR_CODE(masstree.insert_record_normalized(context, slice, data, sizeof(data)));
+  WRAP_ERROR_CODE(xct_manager->precommit_xct(context, epochs));
+  WRAP_ERROR_CODE(xct_manager->wait_for_commit(epochs[0]));
+
+  // this deletion is after the second snapshot.
+  xct_manager->advance_current_global_epoch();
+  xct_manager->advance_current_global_epoch();
+  WRAP_ERROR_CODE(xct_manager->begin_xct(context, xct::kSerializable));
+  slice = storage::masstree::normalize_primitive<uint64_t>(1U);
+  WRAP_ERROR_CODE(masstree.delete_record_normalized(context, slice));
+  WRAP_ERROR_CODE(xct_manager->precommit_xct(context, epochs + 1));
+  WRAP_ERROR_CODE(xct_manager->wait_for_commit(epochs[1]));
+  std::memcpy(args.output_buffer_, epochs, sizeof(epochs));
+  *args.output_used_ = sizeof(epochs);
+  return kRetOk;
+}
+
+ErrorStack compact_fill_task(const proc::ProcArguments& args) {
+  thread::Thread* context = args.context_;
+  storage::masstree::MasstreeStorage masstree(args.engine_, kName);
+  xct::XctManager* xct_manager = args.engine_->get_xct_manager();
+  char data[kCompactPayload];
+  std::memset(data, 0, sizeof(data));
+  // Aborted inserts leave placeholders, which fill up the page and make it compacted.
+  // Placeholders have an old epoch, so they don't keep the page at the next snapshot.
+  for (uint64_t key = 200; key < 200U + kCompactAbortedInserts; ++key) {
+    storage::masstree::KeySlice slice = storage::masstree::normalize_primitive<uint64_t>(key);
+    WRAP_ERROR_CODE(xct_manager->begin_xct(context, xct::kSerializable));
+    WRAP_ERROR_CODE(masstree.insert_record_normalized(context, slice, data, sizeof(data)));
+    WRAP_ERROR_CODE(xct_manager->abort_xct(context));
+  }
+  return kRetOk;
+}
+
+ErrorStack verify_compact_task(const proc::ProcArguments& args) {
+  thread::Thread* context = args.context_;
+  storage::masstree::MasstreeStorage masstree(args.engine_, kName);
+  CHECK_ERROR(masstree.verify_single_thread(context));
+  xct::XctManager* xct_manager = args.engine_->get_xct_manager();
+  WRAP_ERROR_CODE(xct_manager->begin_xct(context, xct::kSerializable));
+  for (uint64_t key = 0; key < 200U + kCompactAbortedInserts; ++key) {
+    storage::masstree::KeySlice slice = storage::masstree::normalize_primitive<uint64_t>(key);
+    char data[kCompactPayload];
+    uint16_t capacity = sizeof(data);
+    ErrorCode ret = masstree.get_record_normalized(context, slice, data, &capacity, true);
+    if (key == 0 || key == 2U) {
+      EXPECT_EQ(kErrorCodeOk, ret) << key;
+    } else {
+      EXPECT_EQ(kErrorCodeStrKeyNotFound, ret) << key;
+    }
+  }
+  Epoch commit_epoch;
+  WRAP_ERROR_CODE(xct_manager->precommit_xct(context, &commit_epoch));
+  return kRetOk;
+}
+
+TEST(SnapshotMasstreeTest, CompactKeepsNewDeletes) {
+  EngineOptions options = get_tiny_options();
+  Engine engine(options);
+  engine.get_proc_manager()->pre_register("compact_setup_task", compact_setup_task);
+  engine.get_proc_manager()->pre_register("compact_update_task", compact_update_task);
+  engine.get_proc_manager()->pre_register("compact_fill_task", compact_fill_task);
+  engine.get_proc_manager()->pre_register("verify_compact_task", verify_compact_task);
+  COERCE_ERROR(engine.initialize());
+  {
+    UninitializeGuard guard(&engine);
+    storage::masstree::MasstreeStorage out;
+    Epoch commit_epoch;
+    storage::masstree::MasstreeMetadata meta(kName);
+    COERCE_ERROR(engine.get_storage_manager()->create_masstree(&meta, &out, &commit_epoch));
+    thread::ThreadPool* pool = engine.get_thread_pool();
+    SnapshotManager* snapshot_manager = engine.get_snapshot_manager();
+    COERCE_ERROR(pool->impersonate_synchronous("compact_setup_task"));
+    const Epoch first_epoch = engine.get_log_manager()->get_durable_global_epoch();
+
+    thread::ImpersonateSession session;
+    EXPECT_TRUE(pool->impersonate("compact_update_task", nullptr, 0, &session));
+    COERCE_ERROR(session.get_result());
+    Epoch epochs[2];
+    EXPECT_EQ(sizeof(epochs), session.get_output_size());
+    session.get_output(epochs);
+    session.release();
+    const Epoch insert_epoch = epochs[0];
+    const Epoch delete_epoch = epochs[1];
+    ASSERT_LT(first_epoch, insert_epoch);
+    ASSERT_LT(insert_epoch, delete_epoch);
+
+    // The page has newer records, so the first snapshot keeps it and the old deletions in it.
+    snapshot_manager->trigger_snapshot_immediate(true, first_epoch);
+    EXPECT_EQ(first_epoch, snapshot_manager->get_snapshot_epoch());
+
+    // compacts the page. only the deletions in the first snapshot can be reclaimed.
+    COERCE_ERROR(pool->impersonate_synchronous("compact_fill_task"));
+    snapshot_manager->trigger_snapshot_immediate(true, insert_epoch);
+    EXPECT_EQ(insert_epoch, snapshot_manager->get_snapshot_epoch());
+    COERCE_ERROR(pool->impersonate_synchronous("verify_compact_task"));
+    COERCE_ERROR(engine.uninitialize());
+  }
+  cleanup_test(options);
+}
+
+/** Reads all records and outputs the number of snapshot cache misses during it */
+ErrorStack read_extent_task(const proc::ProcArguments& args) {
+  thread::Thread* context = args.context_;
+  storage::masstree::MasstreeStorage masstree(args.engine_, kName);
+  const uint64_t misses_before = context->get_snapshot_cache_misses();
+  xct::XctManager* xct_manager = args.engine_->get_xct_manager();
+  WRAP_ERROR_CODE(xct_manager->begin_xct(context, xct::kSerializable));
+  for (uint64_t rec = 0; rec < kRecords; ++rec) {
+    storage::masstree::KeySlice slice = storage::masstree::normalize_primitive<uint64_t>(rec);
+    uint64_t data = 0;
+    WRAP_ERROR_CODE(masstree.get_record_primitive_normalized<uint64_t>(
+      context,
+      slice,
+      &data,
+      0,
+      true));
+    EXPECT_EQ(rec, data) << rec;
+  }
+  Epoch commit_epoch;
+  WRAP_ERROR_CODE(xct_manager->precommit_xct(context, &commit_epoch));
+  uint64_t misses = context->get_snapshot_cache_misses() - misses_before;
+  std::memcpy(args.output_buffer_, &misses, sizeof(misses));
+  *args.output_used_ = sizeof(misses);
+  return kRetOk;
+}
+
+uint64_t run_read_extent(uint32_t extent) {
+  EngineOptions options = get_tiny_options();
+  options.thread_.thread_count_per_group_ = kThreads;
+  {
+    Engine engine(options);
+    engine.get_proc_manager()->pre_register("inserts_normalized_task", inserts_normalized_task);
+    COERCE_ERROR(engine.initialize());
+    {
+      UninitializeGuard guard(&engine);
+      storage::masstree::MasstreeStorage out;
+      Epoch commit_epoch;
+      storage::masstree::MasstreeMetadata meta(kName);
+      meta.snapshot_thresholds_.snapshot_read_extent_ = extent;
+      COERCE_ERROR(engine.get_storage_manager()->create_masstree(&meta, &out, &commit_epoch));
+      thread::ThreadPool* pool = engine.get_thread_pool();
+      for (uint32_t i = 0; i < kThreads; ++i) {
+        COERCE_ERROR(pool->impersonate_on_numa_core_synchronous(
+          i,
+          "inserts_normalized_task",
+          &i,
+          sizeof(i)));
+      }
+      engine.get_snapshot_manager()->trigger_snapshot_immediate(true);
+      COERCE_ERROR(engine.uninitialize());
+    }
+  }
+  uint64_t misses = 0;
+  {
+    // After restart, the masstree has only snapshot pages.
+    Engine engine(options);
+    engine.get_proc_manager()->pre_register("read_extent_task", read_extent_task);
+    COERCE_ERROR(engine.initialize());
+    {
+      UninitializeGuard guard(&engine);
+      thread::ImpersonateSession session;
+      EXPECT_TRUE(engine.get_thread_pool()->impersonate("read_extent_task", nullptr, 0, &session));
+      COERCE_ERROR(session.get_result());
+      EXPECT_EQ(sizeof(misses), session.get_output_size());
+      session.get_output(&misses);
+      session.release();
+      COERCE_ERROR(engine.uninitialize());
+    }
+  }
+  cleanup_test(options);
+  return misses;
+}
+
+// With snapshot_read_extent_, a cache miss on a border page under a B-tree level-1
+// intermediate page also brings the following border pages.
+TEST(SnapshotMasstreeTest, ReadExtent) {
+  const uint64_t page_misses = run_read_extent(0);
+  const uint64_t extent_misses = run_read_extent(8U);
+  EXPECT_GT(page_misses, 8U);
+  EXPECT_GT(extent_misses, 0U);
+  EXPECT_LT(extent_misses * 2U, page_misses);
+}
+
 const proc::ProcName kInsN("inserts_normalized_task");
 const proc::ProcName kInsV("inserts_varlen_task");
 const proc::ProcName kVerN("verify_task");
@@ -110,6 +110,8 @@ HashStorage  tellers;
 sequential::SequentialStorage histories;
 bool          use_primitive_accessors = false;
 bool          use_increment = false;
+/** whether to blindly add to branch balances without reading them */
+bool          use_add = false;
 int thread_count;
 bool contended;
 soc::SharedRendezvous start_rendezvous;
@@ -257,7 +259,12 @@ class RunTpcbTask {
     WRAP_ERROR_CODE(xct_manager->begin_xct(context, xct::kSerializable));
 
     int64_t branch_balance_old = -1, branch_balance_new;
-    if (use_increment) {
+    if (use_add) {
+      // blind write. we don't know the old balance
+      WRAP_ERROR_CODE(branches.add_record<int64_t>(context, branch_id, amount, 0));
+      branch_balance_old = 0;
+      branch_balance_new = amount;
+    } else if (use_increment) {
       branch_balance_new = amount;
       WRAP_ERROR_CODE(branches.increment_record(context, branch_id, &branch_balance_new, 0));
       branch_balance_old = branch_balance_new - amount;
@@ -522,11 +529,12 @@ ErrorStack verify_tpcb_task(const proc::ProcArguments& args) {
 }
 
 void multi_thread_test(int thread_count_arg, bool contended_arg,
-             bool use_primitive = false, bool use_inc = false) {
+             bool use_primitive = false, bool use_inc = false, bool use_add_arg = false) {
   thread_count = thread_count_arg;
   contended = contended_arg;
   use_primitive_accessors = use_primitive;
   use_increment = use_inc;
+  use_add = use_add_arg;
   EngineOptions options = get_tiny_options();
   options.memory_.page_pool_size_mb_per_node_ = 32;
   options.memory_.page_pool_size_mb_per_node_ *= 2U;  // for rigorous_check
@@ -587,6 +595,26 @@ TEST(HashTpcbTest, FourThreadedNoContentionInc)   { multi_thread_test(4, false,
 TEST(HashTpcbTest, SingleThreadedContendedInc)    { multi_thread_test(1, true, true, true); }
 TEST(HashTpcbTest, TwoThreadedContendedInc)       { multi_thread_test(2, true, true, true); }
 TEST(HashTpcbTest, FourThreadedContendedInc)      { multi_thread_test(4, true, true, true); }
+
+TEST(HashTpcbTest, SingleThreadedNoContentionAdd) {
+  multi_thread_test(1, false, true, true, true);
+}
+TEST(HashTpcbTest, TwoThreadedNoContentionAdd) {
+  multi_thread_test(2, false, true, true, true);
+}
+TEST(HashTpcbTest, FourThreadedNoContentionAdd) {
+  multi_thread_test(4, false, true, true, true);
+}
+
+TEST(HashTpcbTest, SingleThreadedContendedAdd) {
+  multi_thread_test(1, true, true, true, true);
+}
+TEST(HashTpcbTest, TwoThreadedContendedAdd) {
+  multi_thread_test(2, true, true, true, true);
+}
+TEST(HashTpcbTest, FourThreadedContendedAdd) {
+  multi_thread_test(4, true, true, true, true);
+}
 }  // namespace hash
 }  // namespace storage
 }  // namespace foedus
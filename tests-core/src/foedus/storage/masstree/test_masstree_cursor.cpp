@@ -17,10 +17,13 @@
  */
 #include <gtest/gtest.h>
 
+#include <atomic>
+#include <chrono>
 #include <cstring>
 #include <iostream>
 #include <map>
 #include <string>
+#include <thread>
 
 #include "foedus/engine.hpp"
 #include "foedus/engine_options.hpp"
@@ -28,12 +31,14 @@
 #include "foedus/test_common.hpp"
 #include "foedus/assorted/uniform_random.hpp"
 #include "foedus/proc/proc_manager.hpp"
+#include "foedus/storage/record_filter.hpp"
 #include "foedus/storage/storage_manager.hpp"
 #include "foedus/storage/masstree/masstree_cursor.hpp"
 #include "foedus/storage/masstree/masstree_metadata.hpp"
 #include "foedus/storage/masstree/masstree_storage.hpp"
 #include "foedus/thread/thread.hpp"
 #include "foedus/thread/thread_pool.hpp"
+#include "foedus/xct/xct.hpp"
 #include "foedus/xct/xct_manager.hpp"
 
 namespace foedus {
@@ -152,6 +157,253 @@ TEST(MasstreeCursorTest, OnePage) {
   cleanup_test(options);
 }
 
+ErrorStack filter_task(const proc::ProcArguments& args) {
+  thread::Thread* context = args.context_;
+  MasstreeStorage masstree = context->get_engine()->get_storage_manager()->get_masstree("test2");
+  xct::XctManager* xct_manager = context->get_engine()->get_xct_manager();
+  Epoch commit_epoch;
+
+  struct Row {
+    uint64_t id_;
+    uint32_t category_;
+    uint32_t filler_;
+    uint64_t amount_;
+    uint64_t filler2_;
+  };
+  const uint16_t kCount = 300;
+  WRAP_ERROR_CODE(xct_manager->begin_xct(context, xct::kSerializable));
+  for (uint16_t i = 0; i < kCount; ++i) {
+    Row row;
+    std::memset(&row, 0, sizeof(row));
+    row.id_ = i;
+    row.category_ = i % 7U;
+    row.amount_ = i * 3U;
+    WRAP_ERROR_CODE(masstree.insert_record_normalized(context, i, &row, sizeof(row)));
+  }
+  WRAP_ERROR_CODE(xct_manager->precommit_xct(context, &commit_epoch));
+
+  // category == 3 && id < 200, returning only amount. the key range is [50, 250].
+  RecordFilter filter;
+  filter.clear();
+  EXPECT_TRUE(filter.add_term(8, 4, RecordFilter::kEqual, 3U));
+  EXPECT_TRUE(filter.add_term(0, 8, RecordFilter::kLess, 200U));
+  EXPECT_FALSE(filter.add_term(0, 3, RecordFilter::kLess, 200U));
+  filter.set_projection(16, 8);
+
+  WRAP_ERROR_CODE(xct_manager->begin_xct(context, xct::kSerializable));
+  MasstreeCursor cursor(masstree, context);
+  cursor.set_filter(&filter);
+  WRAP_ERROR_CODE(cursor.open_normalized(50, 250, true, false, true, true));
+  uint16_t count = 0;
+  uint64_t next_expected = 52;  // the smallest id >= 50 where id % 7 == 3
+  while (cursor.is_valid_record()) {
+    KeySlice key = cursor.get_normalized_key();
+    EXPECT_EQ(next_expected, key);
+    EXPECT_EQ(sizeof(Row), cursor.get_payload_length());
+    EXPECT_EQ(8U, cursor.get_projected_payload_length());
+    uint64_t amount = *reinterpret_cast<const uint64_t*>(cursor.get_projected_payload());
+    EXPECT_EQ(key * 3U, amount);
+    next_expected += 7U;
+    ++count;
+    WRAP_ERROR_CODE(cursor.next());
+  }
+  EXPECT_GE(next_expected, 200U);
+  EXPECT_EQ((199U - 52U) / 7U + 1U, count);
+  WRAP_ERROR_CODE(xct_manager->precommit_xct(context, &commit_epoch));
+  WRAP_ERROR_CODE(xct_manager->wait_for_commit(commit_epoch));
+  return foedus::kRetOk;
+}
+
+TEST(MasstreeCursorTest, Filter) {
+  EngineOptions options = get_tiny_options();
+  Engine engine(options);
+  engine.get_proc_manager()->pre_register("filter_task", filter_task);
+  COERCE_ERROR(engine.initialize());
+  {
+    UninitializeGuard guard(&engine);
+    MasstreeMetadata meta("test2");
+    MasstreeStorage storage;
+    Epoch epoch;
+    COERCE_ERROR(engine.get_storage_manager()->create_masstree(&meta, &storage, &epoch));
+    EXPECT_TRUE(storage.exists());
+    COERCE_ERROR(engine.get_thread_pool()->impersonate_synchronous("filter_task"));
+    COERCE_ERROR(engine.uninitialize());
+  }
+  cleanup_test(options);
+}
+
+ErrorStack page_level_read_set_task(const proc::ProcArguments& args) {
+  thread::Thread* context = args.context_;
+  MasstreeStorage masstree = context->get_engine()->get_storage_manager()->get_masstree("test2");
+  xct::XctManager* xct_manager = context->get_engine()->get_xct_manager();
+  xct::Xct& current_xct = context->get_current_xct();
+  Epoch commit_epoch;
+
+  const uint16_t kCount = 300;
+  WRAP_ERROR_CODE(xct_manager->begin_xct(context, xct::kSerializable));
+  for (uint16_t i = 0; i < kCount; ++i) {
+    uint64_t data = i;
+    WRAP_ERROR_CODE(masstree.insert_record_normalized(context, i, &data, sizeof(data)));
+  }
+  WRAP_ERROR_CODE(xct_manager->precommit_xct(context, &commit_epoch));
+  // Page read-set is taken only when the records are older than the previous epoch.
+  xct_manager->advance_current_global_epoch();
+  xct_manager->advance_current_global_epoch();
+
+  for (uint16_t rep = 0; rep < 2U; ++rep) {
+    WRAP_ERROR_CODE(xct_manager->begin_xct(context, xct::kSerializable));
+    MasstreeCursor cursor(masstree, context);
+    cursor.set_page_level_read_set(true);
+    WRAP_ERROR_CODE(cursor.open());
+    uint16_t count = 0;
+    while (cursor.is_valid_record()) {
+      EXPECT_EQ(count, cursor.get_normalized_key());
+      EXPECT_EQ(count, *reinterpret_cast<const uint64_t*>(cursor.get_payload()));
+      ++count;
+      WRAP_ERROR_CODE(cursor.next());
+    }
+    EXPECT_EQ(kCount, count);
+    if (rep == 0) {
+      EXPECT_EQ(0U, current_xct.get_read_set_size());
+      EXPECT_EQ(0U, current_xct.get_page_version_set_size());
+      EXPECT_GT(current_xct.get_page_read_set_size(), 0U);
+    } else {
+      // The page containing the recently updated record falls back to per-record read-set.
+      EXPECT_GT(current_xct.get_read_set_size(), 0U);
+      EXPECT_LT(current_xct.get_read_set_size(), kCount);
+    }
+    WRAP_ERROR_CODE(xct_manager->precommit_xct(context, &commit_epoch));
+
+    if (rep == 0) {
+      WRAP_ERROR_CODE(xct_manager->begin_xct(context, xct::kSerializable));
+      uint64_t data = kCount / 2U;
+      WRAP_ERROR_CODE(masstree.overwrite_record_normalized(
+        context,
+        kCount / 2U,
+        &data,
+        0,
+        sizeof(data)));
+      WRAP_ERROR_CODE(xct_manager->precommit_xct(context, &commit_epoch));
+    }
+  }
+
+  WRAP_ERROR_CODE(xct_manager->wait_for_commit(commit_epoch));
+  return foedus::kRetOk;
+}
+
+TEST(MasstreeCursorTest, PageLevelReadSet) {
+  EngineOptions options = get_tiny_options();
+  Engine engine(options);
+  engine.get_proc_manager()->pre_register("page_level_read_set_task", page_level_read_set_task);
+  COERCE_ERROR(engine.initialize());
+  {
+    UninitializeGuard guard(&engine);
+    MasstreeMetadata meta("test2");
+    MasstreeStorage storage;
+    Epoch epoch;
+    COERCE_ERROR(engine.get_storage_manager()->create_masstree(&meta, &storage, &epoch));
+    EXPECT_TRUE(storage.exists());
+    COERCE_ERROR(engine.get_thread_pool()->impersonate_synchronous("page_level_read_set_task"));
+    COERCE_ERROR(engine.uninitialize());
+  }
+  cleanup_test(options);
+}
+
+/** Set by the scanning task once it has taken the page read-set. */
+std::atomic<bool> phantom_scanned(false);
+/** Set by the inserting task once it has committed the insert. */
+std::atomic<bool> phantom_inserted(false);
+
+ErrorStack phantom_scan_task(const proc::ProcArguments& args) {
+  thread::Thread* context = args.context_;
+  MasstreeStorage masstree = context->get_engine()->get_storage_manager()->get_masstree("test2");
+  xct::XctManager* xct_manager = context->get_engine()->get_xct_manager();
+  xct::Xct& current_xct = context->get_current_xct();
+  Epoch commit_epoch;
+
+  // Few enough to fit in one border page.
+  const uint16_t kCount = 16;
+  WRAP_ERROR_CODE(xct_manager->begin_xct(context, xct::kSerializable));
+  for (uint16_t i = 0; i < kCount; ++i) {
+    uint64_t data = i;
+    WRAP_ERROR_CODE(masstree.insert_record_normalized(context, i, &data, sizeof(data)));
+  }
+  WRAP_ERROR_CODE(xct_manager->precommit_xct(context, &commit_epoch));
+  xct_manager->advance_current_global_epoch();
+  xct_manager->advance_current_global_epoch();
+
+  WRAP_ERROR_CODE(xct_manager->begin_xct(context, xct::kSerializable));
+  MasstreeCursor cursor(masstree, context);
+  cursor.set_page_level_read_set(true);
+  WRAP_ERROR_CODE(cursor.open());
+  uint16_t count = 0;
+  while (cursor.is_valid_record()) {
+    ++count;
+    WRAP_ERROR_CODE(cursor.next());
+  }
+  EXPECT_EQ(kCount, count);
+  EXPECT_EQ(0U, current_xct.get_read_set_size());
+  EXPECT_EQ(1U, current_xct.get_page_read_set_size());
+
+  // Another transaction appends a key to the page we read. It changes only the key count.
+  phantom_scanned.store(true);
+  while (!phantom_inserted.load()) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  EXPECT_EQ(kErrorCodeXctRaceAbort, xct_manager->precommit_xct(context, &commit_epoch));
+  return foedus::kRetOk;
+}
+
+ErrorStack phantom_insert_task(const proc::ProcArguments& args) {
+  thread::Thread* context = args.context_;
+  MasstreeStorage masstree = context->get_engine()->get_storage_manager()->get_masstree("test2");
+  xct::XctManager* xct_manager = context->get_engine()->get_xct_manager();
+  Epoch commit_epoch;
+  while (!phantom_scanned.load()) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  WRAP_ERROR_CODE(xct_manager->begin_xct(context, xct::kSerializable));
+  uint64_t data = 12345;
+  WRAP_ERROR_CODE(masstree.insert_record_normalized(context, 12345, &data, sizeof(data)));
+  WRAP_ERROR_CODE(xct_manager->precommit_xct(context, &commit_epoch));
+  phantom_inserted.store(true);
+  return foedus::kRetOk;
+}
+
+TEST(MasstreeCursorTest, PageLevelReadSetPhantom) {
+  EngineOptions options = get_tiny_options();
+  Engine engine(options);
+  engine.get_proc_manager()->pre_register("phantom_scan_task", phantom_scan_task);
+  engine.get_proc_manager()->pre_register("phantom_insert_task", phantom_insert_task);
+  COERCE_ERROR(engine.initialize());
+  {
+    UninitializeGuard guard(&engine);
+    MasstreeMetadata meta("test2");
+    MasstreeStorage storage;
+    Epoch epoch;
+    COERCE_ERROR(engine.get_storage_manager()->create_masstree(&meta, &storage, &epoch));
+    EXPECT_TRUE(storage.exists());
+    thread::ImpersonateSession scan_session;
+    thread::ImpersonateSession insert_session;
+    EXPECT_TRUE(engine.get_thread_pool()->impersonate(
+      "phantom_scan_task",
+      nullptr,
+      0,
+      &scan_session));
+    EXPECT_TRUE(engine.get_thread_pool()->impersonate(
+      "phantom_insert_task",
+      nullptr,
+      0,
+      &insert_session));
+    COERCE_ERROR(scan_session.get_result());
+    COERCE_ERROR(insert_session.get_result());
+    scan_session.release();
+    insert_session.release();
+    COERCE_ERROR(engine.uninitialize());
+  }
+  cleanup_test(options);
+}
+
 TEST(MasstreeCursorTest, OneLayer) {
   // TODO(Hideaki) write testcases!
 }
@@ -43,22 +43,30 @@ DEFINE_TEST_CASE_PACKAGE(MasstreePartitionerTest, foedus.storage.masstree);
 const char* kTableName = "test";
 KeySlice nm(uint64_t key) { return normalize_primitive<uint64_t>(key); }
 
+/** Input of populate_task */
+struct PopulateInput {
+  uint32_t table_size_;
+  /** Keys in [0, node0_records_) are inserted by node-0, others by node-1 */
+  uint32_t node0_records_;
+};
+
 /**
  * Populates the test table with records.
- * First half is done in node-0, second half is done in node-1.
+ * First part is done in node-0, second part is done in node-1.
  * So, this procedure is called twice.
  */
 ErrorStack populate_task(const proc::ProcArguments& args) {
   thread::Thread* context = args.context_;
-  EXPECT_EQ(sizeof(uint32_t), args.input_len_);
-  uint32_t table_size = *reinterpret_cast<const uint32_t*>(args.input_buffer_);
+  EXPECT_EQ(sizeof(PopulateInput), args.input_len_);
+  const PopulateInput* input = reinterpret_cast<const PopulateInput*>(args.input_buffer_);
   MasstreeStorage storage(context->get_engine(), kTableName);
   EXPECT_TRUE(storage.exists());
   xct::XctManager* xct_manager = context->get_engine()->get_xct_manager();
   Epoch commit_epoch;
   WRAP_ERROR_CODE(xct_manager->begin_xct(context, xct::kSerializable));
-  for (uint64_t i = 0; i < table_size / 2U; ++i) {
-    uint32_t id = i + (context->get_thread_id() == 0 ? 0 : table_size / 2U);
+  uint32_t from = context->get_thread_id() == 0 ? 0 : input->node0_records_;
+  uint32_t to = context->get_thread_id() == 0 ? input->node0_records_ : input->table_size_;
+  for (uint32_t id = from; id < to; ++id) {
     WRAP_ERROR_CODE(storage.insert_record_normalized(context, nm(id), &id, sizeof(id)));
   }
   WRAP_ERROR_CODE(xct_manager->precommit_xct(context, &commit_epoch));
@@ -72,7 +80,7 @@ ErrorStack populate_task(const proc::ProcArguments& args) {
 
 
 typedef void (*TestFunctor)(Partitioner partitioner);
-void execute_test(TestFunctor functor, uint32_t table_size = 1024) {
+void execute_test(TestFunctor functor, uint32_t table_size = 1024, uint32_t node0_percent = 50) {
   EngineOptions options = get_tiny_options();
   options.thread_.group_count_ = 2;  // otherwise we can't test partitioning
   options.thread_.thread_count_per_group_ = 1;
@@ -86,12 +94,13 @@ void execute_test(TestFunctor functor, uint32_t table_size = 1024) {
     MasstreeMetadata meta(kTableName);
     COERCE_ERROR(engine.get_storage_manager()->create_masstree(&meta, &out, &commit_epoch));
     EXPECT_TRUE(out.exists());
+    PopulateInput input = { table_size, table_size * node0_percent / 100U };
     for (uint16_t node = 0; node < 2U; ++node) {
       COERCE_ERROR(engine.get_thread_pool()->impersonate_on_numa_node_synchronous(
         node,
         "populate_task",
-        &table_size,
-        sizeof(table_size)));
+        &input,
+        sizeof(input)));
     }
     Partitioner partitioner(&engine, out.get_id());
     memory::AlignedMemory work_memory;
@@ -193,6 +202,27 @@ TEST(MasstreePartitionerTest, PartitionBasic) {
   execute_test(&PartitionBasicFunctor);
 }
 
+void PartitionBalancedFunctor(Partitioner partitioner) {
+  std::unique_ptr< Logs<64> > logs(new Logs<64>(partitioner));
+  for (int i = 0; i < 64; ++i) {
+    logs->add_log(2, i + 1, i * 64);
+  }
+  logs->partition_batch();
+  uint32_t counts[2] = {0, 0};
+  for (int i = 0; i < 64; ++i) {
+    ASSERT_LT(logs->partition_results_[i], 2U) << i;
+    ++counts[logs->partition_results_[i]];
+  }
+  // node-0 wrote most pages, but the partitioner moves some of them to node-1.
+  // again, the sampling is a bit inaccurate, so not 32 each.
+  EXPECT_GE(counts[0], 24U);
+  EXPECT_GE(counts[1], 24U);
+}
+
+TEST(MasstreePartitionerTest, PartitionBalanced) {
+  execute_test(&PartitionBalancedFunctor, 4096, 90);
+}
+
 
 void SortBasicFunctor(Partitioner partitioner) {
   std::unique_ptr< Logs<64> > logs(new Logs<64>(partitioner));
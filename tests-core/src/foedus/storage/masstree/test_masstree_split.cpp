@@ -27,6 +27,7 @@
 #include "foedus/test_common.hpp"
 #include "foedus/assorted/uniform_random.hpp"
 #include "foedus/proc/proc_manager.hpp"
+#include "foedus/snapshot/snapshot_manager.hpp"
 #include "foedus/storage/storage_manager.hpp"
 #include "foedus/storage/masstree/masstree_metadata.hpp"
 #include "foedus/storage/masstree/masstree_storage.hpp"
@@ -294,6 +295,156 @@ TEST(MasstreeSplitTest, SplitIntermediateSequentialWithHint) {
   test_split_intermediate_sequential(true);
 }
 
+// 200 bytes payload -> about 15 tuples per page.
+// We repeatedly insert and delete keys so that most records in the pages are deleted
+// when the pages become full. Once a snapshot covers the deletions, the pages should be
+// compacted rather than split.
+const uint32_t kCompactRounds = 8;
+const uint32_t kCompactKeysPerRound = 64;
+const uint32_t kCompactSurvivorsPerRound = 4;
+
+ErrorStack compact_border_task(const proc::ProcArguments& args) {
+  thread::Thread* context = args.context_;
+  MasstreeStorage masstree = context->get_engine()->get_storage_manager()->get_masstree("ggg");
+  xct::XctManager* xct_manager = context->get_engine()->get_xct_manager();
+  EXPECT_EQ(sizeof(uint32_t), args.input_len_);
+  const uint32_t round = *reinterpret_cast<const uint32_t*>(args.input_buffer_);
+  Epoch commit_epoch;
+  for (uint32_t i = 0; i < kCompactKeysPerRound; ++i) {
+    // keys of all rounds are interleaved in the same key range
+    KeySlice key = normalize_primitive<uint64_t>(i * kCompactRounds + round);
+    char data[200];
+    std::memset(data, 0, 200);
+    std::memcpy(data + 123, &key, sizeof(key));
+    WRAP_ERROR_CODE(xct_manager->begin_xct(context, xct::kSerializable));
+    WRAP_ERROR_CODE(masstree.insert_record_normalized(context, key, data, sizeof(data)));
+    WRAP_ERROR_CODE(xct_manager->precommit_xct(context, &commit_epoch));
+  }
+  for (uint32_t i = kCompactSurvivorsPerRound; i < kCompactKeysPerRound; ++i) {
+    KeySlice key = normalize_primitive<uint64_t>(i * kCompactRounds + round);
+    WRAP_ERROR_CODE(xct_manager->begin_xct(context, xct::kSerializable));
+    WRAP_ERROR_CODE(masstree.delete_record_normalized(context, key));
+    WRAP_ERROR_CODE(xct_manager->precommit_xct(context, &commit_epoch));
+  }
+  WRAP_ERROR_CODE(xct_manager->begin_xct(context, xct::kSerializable));
+  CHECK_ERROR(masstree.verify_single_thread(context));
+  WRAP_ERROR_CODE(xct_manager->precommit_xct(context, &commit_epoch));
+  WRAP_ERROR_CODE(xct_manager->wait_for_commit(commit_epoch));
+  return foedus::kRetOk;
+}
+
+ErrorStack compact_border_verify_task(const proc::ProcArguments& args) {
+  thread::Thread* context = args.context_;
+  MasstreeStorage masstree = context->get_engine()->get_storage_manager()->get_masstree("ggg");
+  xct::XctManager* xct_manager = context->get_engine()->get_xct_manager();
+  Epoch commit_epoch;
+  WRAP_ERROR_CODE(xct_manager->begin_xct(context, xct::kSerializable));
+  for (uint32_t round = 0; round < kCompactRounds; ++round) {
+    for (uint32_t i = 0; i < kCompactKeysPerRound; ++i) {
+      KeySlice key = normalize_primitive<uint64_t>(i * kCompactRounds + round);
+      char data[500];
+      uint16_t capacity = 500;
+      ErrorCode ret = masstree.get_record_normalized(context, key, data, &capacity, true);
+      if (i < kCompactSurvivorsPerRound) {
+        EXPECT_EQ(kErrorCodeOk, ret) << round << "," << i;
+        EXPECT_EQ(200, capacity);
+        char correct_data[200];
+        std::memset(correct_data, 0, 200);
+        std::memcpy(correct_data + 123, &key, sizeof(key));
+        EXPECT_EQ(std::string(correct_data, 200), std::string(data, capacity)) << round;
+      } else {
+        EXPECT_EQ(kErrorCodeStrKeyNotFound, ret) << round << "," << i;
+      }
+    }
+  }
+  WRAP_ERROR_CODE(xct_manager->precommit_xct(context, &commit_epoch));
+
+  WRAP_ERROR_CODE(xct_manager->begin_xct(context, xct::kSerializable));
+  CHECK_ERROR(masstree.verify_single_thread(context));
+  WRAP_ERROR_CODE(xct_manager->precommit_xct(context, &commit_epoch));
+  WRAP_ERROR_CODE(xct_manager->wait_for_commit(commit_epoch));
+  return foedus::kRetOk;
+}
+
+TEST(MasstreeSplitTest, CompactBorder) {
+  EngineOptions options = get_tiny_options();
+  Engine engine(options);
+  engine.get_proc_manager()->pre_register("the_task", compact_border_task);
+  engine.get_proc_manager()->pre_register("verify_task", compact_border_verify_task);
+  COERCE_ERROR(engine.initialize());
+  {
+    UninitializeGuard guard(&engine);
+    MasstreeMetadata meta("ggg");
+    // keep all volatile pages over snapshots so that the next round inserts into them
+    meta.snapshot_drop_volatile_pages_btree_levels_ = 0;
+    MasstreeStorage storage;
+    Epoch epoch;
+    COERCE_ERROR(engine.get_storage_manager()->create_masstree(&meta, &storage, &epoch));
+    EXPECT_TRUE(storage.exists());
+    for (uint32_t round = 0; round < kCompactRounds; ++round) {
+      COERCE_ERROR(engine.get_thread_pool()->impersonate_synchronous(
+        "the_task",
+        &round,
+        sizeof(round)));
+      // only deletions covered by a snapshot can be reclaimed by the next round
+      engine.get_snapshot_manager()->trigger_snapshot_immediate(true);
+    }
+    COERCE_ERROR(engine.get_thread_pool()->impersonate_synchronous("verify_task"));
+    COERCE_ERROR(engine.uninitialize());
+  }
+  cleanup_test(options);
+}
+
+ErrorStack early_split_sequential_task(const proc::ProcArguments& args) {
+  thread::Thread* context = args.context_;
+  MasstreeStorage masstree = context->get_engine()->get_storage_manager()->get_masstree("ggg");
+  xct::XctManager* xct_manager = context->get_engine()->get_xct_manager();
+  Epoch commit_epoch;
+  // small payloads, so that the early split threshold is hit well before pages become full.
+  const uint32_t kKeys = 2000;
+  for (uint32_t rep = 0; rep < kKeys; ++rep) {
+    KeySlice key = normalize_primitive<uint64_t>(rep);
+    WRAP_ERROR_CODE(xct_manager->begin_xct(context, xct::kSerializable));
+    WRAP_ERROR_CODE(masstree.insert_record_normalized(context, key, &rep, sizeof(rep)));
+    WRAP_ERROR_CODE(xct_manager->precommit_xct(context, &commit_epoch));
+  }
+
+  WRAP_ERROR_CODE(xct_manager->begin_xct(context, xct::kSerializable));
+  for (uint32_t rep = 0; rep < kKeys; ++rep) {
+    KeySlice key = normalize_primitive<uint64_t>(rep);
+    uint32_t data = 0;
+    uint16_t capacity = sizeof(data);
+    WRAP_ERROR_CODE(masstree.get_record_normalized(context, key, &data, &capacity, true));
+    EXPECT_EQ(sizeof(data), capacity);
+    EXPECT_EQ(rep, data);
+  }
+  WRAP_ERROR_CODE(xct_manager->precommit_xct(context, &commit_epoch));
+
+  WRAP_ERROR_CODE(xct_manager->begin_xct(context, xct::kSerializable));
+  CHECK_ERROR(masstree.verify_single_thread(context));
+  WRAP_ERROR_CODE(xct_manager->precommit_xct(context, &commit_epoch));
+  WRAP_ERROR_CODE(xct_manager->wait_for_commit(commit_epoch));
+  return foedus::kRetOk;
+}
+
+TEST(MasstreeSplitTest, EarlySplitSequential) {
+  EngineOptions options = get_tiny_options();
+  Engine engine(options);
+  engine.get_proc_manager()->pre_register("the_task", early_split_sequential_task);
+  COERCE_ERROR(engine.initialize());
+  {
+    UninitializeGuard guard(&engine);
+    MasstreeMetadata meta("ggg", 32);
+    MasstreeStorage storage;
+    Epoch epoch;
+    COERCE_ERROR(engine.get_storage_manager()->create_masstree(&meta, &storage, &epoch));
+    EXPECT_TRUE(storage.exists());
+    COERCE_ERROR(engine.get_thread_pool()->impersonate_synchronous("the_task"));
+    COERCE_ERROR(engine.uninitialize());
+  }
+  cleanup_test(options);
+}
+
 }  // namespace masstree
 }  // namespace storage
 }  // namespace foedus
@@ -112,6 +112,8 @@ MasstreeStorage  tellers;
 sequential::SequentialStorage histories;
 bool          use_primitive_accessors = false;
 bool          use_increment = false;
+/** whether to blindly add to branch balances without reading them */
+bool          use_add = false;
 int thread_count;
 bool contended;
 soc::SharedRendezvous start_rendezvous;
@@ -265,7 +267,16 @@ class RunTpcbTask {
     WRAP_ERROR_CODE(xct_manager->begin_xct(context, xct::kSerializable));
 
     int64_t branch_balance_old = -1, branch_balance_new;
-    if (use_increment) {
+    if (use_add) {
+      // blind write. we don't know the old balance
+      WRAP_ERROR_CODE(branches.add_record_normalized<int64_t>(
+        context,
+        nm(branch_id),
+        amount,
+        0));
+      branch_balance_old = 0;
+      branch_balance_new = amount;
+    } else if (use_increment) {
       branch_balance_new = amount;
       WRAP_ERROR_CODE(branches.increment_record_normalized(
         context,
@@ -552,11 +563,12 @@ ErrorStack verify_tpcb_task(const proc::ProcArguments& args) {
 }
 
 void multi_thread_test(int thread_count_arg, bool contended_arg,
-             bool use_primitive = false, bool use_inc = false) {
+             bool use_primitive = false, bool use_inc = false, bool use_add_arg = false) {
   thread_count = thread_count_arg;
   contended = contended_arg;
   use_primitive_accessors = use_primitive;
   use_increment = use_inc;
+  use_add = use_add_arg;
   EngineOptions options = get_tiny_options();
   options.log_.log_buffer_kb_ = 1 << 12;
   options.thread_.group_count_ = 1;
@@ -615,6 +627,26 @@ TEST(MasstreeTpcbTest, FourThreadedNoContentionInc)   { multi_thread_test(4, fal
 TEST(MasstreeTpcbTest, SingleThreadedContendedInc)    { multi_thread_test(1, true, true, true); }
 TEST(MasstreeTpcbTest, TwoThreadedContendedInc)       { multi_thread_test(2, true, true, true); }
 TEST(MasstreeTpcbTest, FourThreadedContendedInc)      { multi_thread_test(4, true, true, true); }
+
+TEST(MasstreeTpcbTest, SingleThreadedNoContentionAdd) {
+  multi_thread_test(1, false, true, true, true);
+}
+TEST(MasstreeTpcbTest, TwoThreadedNoContentionAdd) {
+  multi_thread_test(2, false, true, true, true);
+}
+TEST(MasstreeTpcbTest, FourThreadedNoContentionAdd) {
+  multi_thread_test(4, false, true, true, true);
+}
+
+TEST(MasstreeTpcbTest, SingleThreadedContendedAdd) {
+  multi_thread_test(1, true, true, true, true);
+}
+TEST(MasstreeTpcbTest, TwoThreadedContendedAdd) {
+  multi_thread_test(2, true, true, true, true);
+}
+TEST(MasstreeTpcbTest, FourThreadedContendedAdd) {
+  multi_thread_test(4, true, true, true, true);
+}
 }  // namespace masstree
 }  // namespace storage
 }  // namespace foedus
@@ -27,9 +27,12 @@
 #include "foedus/proc/proc_manager.hpp"
 #include "foedus/storage/storage_manager.hpp"
 #include "foedus/storage/sequential/sequential_metadata.hpp"
+#include "foedus/storage/sequential/sequential_page_impl.hpp"
 #include "foedus/storage/sequential/sequential_storage.hpp"
+#include "foedus/storage/sequential/sequential_storage_pimpl.hpp"
 #include "foedus/thread/thread.hpp"
 #include "foedus/thread/thread_pool.hpp"
+#include "foedus/xct/xct.hpp"
 #include "foedus/xct/xct_manager.hpp"
 
 namespace foedus {
@@ -106,6 +109,94 @@ TEST(SequentialBasicTest, CreateAndWrite) {
   cleanup_test(options);
 }
 
+const uint32_t kBatchRecords = 300;
+
+ErrorStack batch_write_task(const proc::ProcArguments& args) {
+  thread::Thread* context = args.context_;
+  SequentialStorage sequential
+    = context->get_engine()->get_storage_manager()->get_sequential("test4");
+  EXPECT_TRUE(sequential.exists());
+  // each record reads up to 32 bytes from its own position
+  char buf[kBatchRecords + 32];
+  for (uint32_t i = 0; i < sizeof(buf); ++i) {
+    buf[i] = static_cast<char>(i);
+  }
+  const void* payloads[kBatchRecords];
+  uint16_t payload_counts[kBatchRecords];
+  for (uint32_t i = 0; i < kBatchRecords; ++i) {
+    payloads[i] = buf + i;
+    payload_counts[i] = 1 + (i % 32);  // spans multiple pages
+  }
+  xct::XctManager* xct_manager = context->get_engine()->get_xct_manager();
+  WRAP_ERROR_CODE(xct_manager->begin_xct(context, xct::kSerializable));
+  payload_counts[kBatchRecords / 2] = kMaxPayload;
+  EXPECT_EQ(
+    kErrorCodeStrTooLongPayload,
+    sequential.append_records(context, payloads, payload_counts, kBatchRecords));
+  EXPECT_EQ(0U, context->get_current_xct().get_lock_free_write_set_size());
+  payload_counts[kBatchRecords / 2] = 0;
+  EXPECT_EQ(
+    kErrorCodeInvalidParameter,
+    sequential.append_records(context, payloads, payload_counts, kBatchRecords));
+  EXPECT_EQ(0U, context->get_current_xct().get_lock_free_write_set_size());
+  payload_counts[kBatchRecords / 2] = 1;
+  WRAP_ERROR_CODE(sequential.append_records(context, payloads, payload_counts, kBatchRecords));
+  EXPECT_EQ(kBatchRecords, context->get_current_xct().get_lock_free_write_set_size());
+
+  Epoch commit_epoch;
+  WRAP_ERROR_CODE(xct_manager->precommit_xct(context, &commit_epoch));
+  WRAP_ERROR_CODE(xct_manager->wait_for_commit(commit_epoch));
+  return foedus::kRetOk;
+}
+
+TEST(SequentialBasicTest, AppendRecords) {
+  EngineOptions options = get_tiny_options();
+  Engine engine(options);
+  engine.get_proc_manager()->pre_register(proc::ProcAndName("batch_write_task", batch_write_task));
+  COERCE_ERROR(engine.initialize());
+  {
+    UninitializeGuard guard(&engine);
+    SequentialMetadata meta("test4");
+    SequentialStorage storage;
+    Epoch epoch;
+    COERCE_ERROR(engine.get_storage_manager()->create_sequential(&meta, &storage, &epoch));
+    EXPECT_TRUE(storage.exists());
+    COERCE_ERROR(engine.get_thread_pool()->impersonate_synchronous("batch_write_task"));
+    uint32_t record_count = 0;
+    SequentialStoragePimpl pimpl(&storage);
+    COERCE_ERROR_CODE(pimpl.for_every_page([&record_count](SequentialPage* page){
+      record_count += page->get_record_count();
+      return kErrorCodeOk;
+    }));
+    EXPECT_EQ(kBatchRecords, record_count);
+    COERCE_ERROR(engine.uninitialize());
+  }
+  cleanup_test(options);
+}
+
+TEST(SequentialBasicTest, Truncate) {
+  EngineOptions options = get_tiny_options();
+  Engine engine(options);
+  COERCE_ERROR(engine.initialize());
+  {
+    UninitializeGuard guard(&engine);
+    SequentialMetadata meta("test5");
+    SequentialStorage storage;
+    Epoch epoch;
+    COERCE_ERROR(engine.get_storage_manager()->create_sequential(&meta, &storage, &epoch));
+    EXPECT_TRUE(storage.exists());
+    Epoch truncate_epoch = engine.get_current_global_epoch();
+    Epoch commit_epoch;
+    COERCE_ERROR(storage.truncate(truncate_epoch, &commit_epoch));
+    EXPECT_EQ(truncate_epoch, storage.get_truncate_epoch());
+    // truncating to the same epoch again is a no-op, and the lock must have been released.
+    COERCE_ERROR(storage.truncate(truncate_epoch, &commit_epoch));
+    EXPECT_EQ(truncate_epoch, storage.get_truncate_epoch());
+    COERCE_ERROR(engine.uninitialize());
+  }
+  cleanup_test(options);
+}
+
 }  // namespace sequential
 }  // namespace storage
 }  // namespace foedus
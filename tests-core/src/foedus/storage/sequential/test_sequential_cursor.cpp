@@ -31,6 +31,7 @@
 #include "foedus/memory/engine_memory.hpp"
 #include "foedus/proc/proc_manager.hpp"
 #include "foedus/snapshot/snapshot_manager.hpp"
+#include "foedus/storage/record_filter.hpp"
 #include "foedus/storage/storage_manager.hpp"
 #include "foedus/storage/sequential/sequential_cursor.hpp"
 #include "foedus/storage/sequential/sequential_metadata.hpp"
@@ -164,6 +165,43 @@ TEST(SequentialCursorTest, IteratorRawPage) {
     it.next();
     EXPECT_FALSE(it.is_valid());
   }
+
+  // read only "data_1*", projecting the digits
+  {
+    RecordFilter filter;
+    filter.clear();
+    EXPECT_TRUE(filter.add_term(5, 1, RecordFilter::kEqual, '1'));
+    filter.set_projection(5, 2);
+    SequentialRecordIterator it(batch, Epoch(1), Epoch(100), &filter);
+    const char* kExpected[] = {"1", "10", "11"};
+    for (uint16_t i = 0; i < 3U; ++i) {
+      EXPECT_TRUE(it.is_valid());
+      std::string projected(it.get_cur_projected_raw(), it.get_cur_projected_length());
+      EXPECT_EQ(std::string(kExpected[i]), projected) << i;
+      it.next();
+    }
+    EXPECT_FALSE(it.is_valid());
+    EXPECT_EQ(kRecords - 3U, it.get_stat_filtered_records());
+    EXPECT_EQ(0, it.get_stat_skipped_records());
+  }
+
+  // zero-length projection means the whole payload, whatever the offset is
+  {
+    RecordFilter filter;
+    filter.clear();
+    EXPECT_TRUE(filter.add_term(5, 1, RecordFilter::kEqual, '1'));
+    filter.set_projection(5, 0);
+    EXPECT_FALSE(filter.has_projection());
+    SequentialRecordIterator it(batch, Epoch(1), Epoch(100), &filter);
+    const char* kExpected[] = {"data_1", "data_10", "data_11"};
+    for (uint16_t i = 0; i < 3U; ++i) {
+      EXPECT_TRUE(it.is_valid());
+      std::string projected(it.get_cur_projected_raw(), it.get_cur_projected_length());
+      EXPECT_EQ(std::string(kExpected[i]), projected) << i;
+      it.next();
+    }
+    EXPECT_FALSE(it.is_valid());
+  }
 }
 
 const uint32_t kRecordsPerXct = 1 << 6;
@@ -516,6 +554,166 @@ ErrorStack scan_task(const proc::ProcArguments& args) {
   return foedus::kRetOk;
 }
 
+const uint16_t kPartitionsPerNode = 3;
+
+/** Output of partition_scan_task */
+struct PartitionScanResult {
+  uint64_t record_count_;
+  uint64_t data_sum_;
+};
+
+ErrorStack design_partitions_task(const proc::ProcArguments& args) {
+  thread::Thread* context = args.context_;
+  SequentialStorage sequential(context->get_engine(), kStorageName);
+  EXPECT_TRUE(sequential.exists());
+  std::vector<SequentialScanPartition> partitions;
+  WRAP_ERROR_CODE(SequentialCursor::design_scan_partitions(
+    context,
+    sequential,
+    kPartitionsPerNode,
+    &partitions));
+  uint32_t size = partitions.size() * sizeof(SequentialScanPartition);
+  ASSERT_ND(size <= args.output_buffer_size_);
+  std::memcpy(args.output_buffer_, &partitions[0], size);
+  *args.output_used_ = size;
+  return foedus::kRetOk;
+}
+
+ErrorStack partition_scan_task(const proc::ProcArguments& args) {
+  thread::Thread* context = args.context_;
+  SequentialStorage sequential(context->get_engine(), kStorageName);
+  EXPECT_TRUE(sequential.exists());
+  SharedData* shared_data = reinterpret_cast<SharedData*>(
+    context->get_engine()->get_memory_manager()->get_shared_user_memory());
+  ASSERT_ND(args.input_len_ == sizeof(SequentialScanPartition));
+  const SequentialScanPartition* partition
+    = reinterpret_cast<const SequentialScanPartition*>(args.input_buffer_);
+  EXPECT_EQ(partition->node_, context->get_numa_node());
+
+  xct::XctManager* xct_manager = context->get_engine()->get_xct_manager();
+  memory::AlignedMemory read_buffer(
+    1U << 13,
+    1U << 12,
+    memory::AlignedMemory::kNumaAllocOnnode,
+    context->get_numa_node());
+
+  PartitionScanResult result;
+  result.record_count_ = 0;
+  result.data_sum_ = 0;
+  WRAP_ERROR_CODE(xct_manager->begin_xct(context, xct::kSerializable));
+  SequentialCursor cursor(
+    context,
+    sequential,
+    read_buffer.get_block(),
+    read_buffer.get_size(),
+    *partition,
+    shared_data->begin_epoch_,
+    shared_data->end_epoch_);
+  while (cursor.is_valid()) {
+    SequentialRecordIterator it;
+    ErrorCode code = cursor.next_batch(&it);
+    if (code != kErrorCodeOk) {
+      WRAP_ERROR_CODE(xct_manager->abort_xct(context));
+      return ERROR_STACK(code);
+    }
+    while (it.is_valid()) {
+      uint64_t data = *reinterpret_cast<const uint64_t*>(it.get_cur_record_raw());
+      EXPECT_EQ(partition->node_, data / kRecordsPerNode) << data;
+      ++result.record_count_;
+      result.data_sum_ += data;
+      it.next();
+    }
+  }
+  Epoch commit_epoch;
+  WRAP_ERROR_CODE(xct_manager->precommit_xct(context, &commit_epoch));
+
+  ASSERT_ND(sizeof(result) <= args.output_buffer_size_);
+  std::memcpy(args.output_buffer_, &result, sizeof(result));
+  *args.output_used_ = sizeof(result);
+  return foedus::kRetOk;
+}
+
+std::vector<SequentialScanPartition> design_partitions(Engine* engine) {
+  SharedData* shared_data = reinterpret_cast<SharedData*>(
+    engine->get_memory_manager()->get_shared_user_memory());
+  std::vector<SequentialScanPartition> partitions;
+  thread::ImpersonateSession session;
+  EXPECT_TRUE(engine->get_thread_pool()->impersonate(
+    "design_partitions_task",
+    nullptr,
+    0,
+    &session));
+  COERCE_ERROR(session.get_result());
+  uint64_t size = session.get_output_size();
+  EXPECT_EQ(0, size % sizeof(SequentialScanPartition));
+  partitions.resize(size / sizeof(SequentialScanPartition));
+  session.get_output(&partitions[0]);
+  EXPECT_EQ(shared_data->node_count_ * kPartitionsPerNode, partitions.size());
+  return partitions;
+}
+
+/** Runs the partitioned scan on each partition's node and checks they cover all records. */
+void test_partitioned_scan(Engine* engine) {
+  SharedData* shared_data = reinterpret_cast<SharedData*>(
+    engine->get_memory_manager()->get_shared_user_memory());
+  thread::ThreadPool* pool = engine->get_thread_pool();
+
+  std::vector<SequentialScanPartition> partitions = design_partitions(engine);
+
+  uint64_t record_count = 0;
+  uint64_t data_sum = 0;
+  for (const SequentialScanPartition& partition : partitions) {
+    thread::ImpersonateSession session;
+    EXPECT_TRUE(pool->impersonate_on_numa_node(
+      partition.node_,
+      "partition_scan_task",
+      &partition,
+      sizeof(partition),
+      &session));
+    COERCE_ERROR(session.get_result());
+    PartitionScanResult result;
+    EXPECT_EQ(sizeof(result), session.get_output_size());
+    session.get_output(&result);
+    record_count += result.record_count_;
+    data_sum += result.data_sum_;
+  }
+
+  // each record has a unique data from 0 to total_records_-1.
+  const uint64_t total = shared_data->total_records_;
+  EXPECT_EQ(total, record_count);
+  EXPECT_EQ(total * (total - 1U) / 2U, data_sum);
+}
+
+/**
+ * A snapshot taken after the partitions were designed moves volatile records to snapshot pages.
+ * Cursors on the old partitions must reject the scan rather than miss or duplicate them.
+ */
+void test_stale_partitions(Engine* engine) {
+  std::vector<SequentialScanPartition> partitions = design_partitions(engine);
+
+  snapshot::SnapshotManager* snapshot_manager = engine->get_snapshot_manager();
+  const Epoch durable_epoch = engine->get_log_manager()->get_durable_global_epoch();
+  EXPECT_GT(durable_epoch, snapshot_manager->get_snapshot_epoch());
+  snapshot_manager->trigger_snapshot_immediate(true, durable_epoch);
+  EXPECT_EQ(durable_epoch, snapshot_manager->get_snapshot_epoch());
+
+  for (const SequentialScanPartition& partition : partitions) {
+    thread::ImpersonateSession session;
+    EXPECT_TRUE(engine->get_thread_pool()->impersonate_on_numa_node(
+      partition.node_,
+      "partition_scan_task",
+      &partition,
+      sizeof(partition),
+      &session));
+    ErrorStack result = session.get_result();
+    EXPECT_TRUE(result.is_error());
+    EXPECT_EQ(kErrorCodeStrSequentialScanPartitionStale, result.get_error_code());
+  }
+
+  // newly designed partitions work again
+  test_partitioned_scan(engine);
+}
+
 void test_cursor(
   bool has_volatile,
   bool has_snapshot,
@@ -537,6 +735,10 @@ void test_cursor(
   Engine engine(options);
   engine.get_proc_manager()->pre_register(proc::ProcAndName("load_task", load_task));
   engine.get_proc_manager()->pre_register(proc::ProcAndName("scan_task", scan_task));
+  engine.get_proc_manager()->pre_register(
+    proc::ProcAndName("design_partitions_task", design_partitions_task));
+  engine.get_proc_manager()->pre_register(
+    proc::ProcAndName("partition_scan_task", partition_scan_task));
   COERCE_ERROR(engine.initialize());
   {
     UninitializeGuard guard(&engine);
@@ -644,6 +846,10 @@ void test_cursor(
 
       // Finally, scan the outcomes!
       COERCE_ERROR(engine.get_thread_pool()->impersonate_synchronous("scan_task"));
+      test_partitioned_scan(&engine);
+      if (has_volatile && has_snapshot) {
+        test_stale_partitions(&engine);
+      }
     }
     COERCE_ERROR(engine.uninitialize());
   }
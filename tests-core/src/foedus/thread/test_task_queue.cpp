@@ -0,0 +1,354 @@
+/*
+ * Copyright (c) 2014-2015, Hewlett-Packard Development Company, LP.
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details. You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * HP designates this particular file as subject to the "Classpath" exception
+ * as provided by HP in the LICENSE.txt file that accompanied this code.
+ */
+#include <stdint.h>
+#include <gtest/gtest.h>
+
+#include <cstring>
+
+#include "foedus/engine.hpp"
+#include "foedus/engine_options.hpp"
+#include "foedus/epoch.hpp"
+#include "foedus/test_common.hpp"
+#include "foedus/proc/proc_manager.hpp"
+#include "foedus/snapshot/snapshot_manager.hpp"
+#include "foedus/storage/storage_manager.hpp"
+#include "foedus/storage/array/array_metadata.hpp"
+#include "foedus/storage/array/array_storage.hpp"
+#include "foedus/thread/task_queue.hpp"
+#include "foedus/thread/thread.hpp"
+#include "foedus/thread/thread_pool.hpp"
+#include "foedus/thread/thread_pool_pimpl.hpp"
+#include "foedus/thread/thread_ref.hpp"
+#include "foedus/xct/xct_manager.hpp"
+
+namespace foedus {
+namespace thread {
+DEFINE_TEST_CASE_PACKAGE(TaskQueueTest, foedus.thread);
+
+ErrorStack add_task(const proc::ProcArguments& args) {
+  EXPECT_EQ(sizeof(uint64_t) * 2U, args.input_len_);
+  const uint64_t* input = reinterpret_cast<const uint64_t*>(args.input_buffer_);
+  uint64_t sum = input[0] + input[1];
+  std::memcpy(args.output_buffer_, &sum, sizeof(sum));
+  *args.output_used_ = sizeof(sum);
+  return kRetOk;
+}
+
+ErrorStack fail_task(const proc::ProcArguments& /*args*/) {
+  return ERROR_STACK(kErrorCodeInvalidParameter);
+}
+
+ErrorStack session_task(const proc::ProcArguments& /*args*/) {
+  return kRetOk;
+}
+
+void push_add(TaskQueue* queue, uint64_t i) {
+  uint64_t input[2] = {i, i * 3U};
+  EXPECT_EQ(kErrorCodeOk, queue->push("add_task", input, sizeof(input)));
+}
+
+void pop_add(TaskQueue* queue, uint64_t i) {
+  ErrorCode result;
+  uint64_t output = 0;
+  uint32_t output_size = 0;
+  EXPECT_EQ(kErrorCodeOk, queue->pop(&result, &output, &output_size));
+  EXPECT_EQ(kErrorCodeOk, result);
+  EXPECT_EQ(sizeof(output), output_size);
+  EXPECT_EQ(i * 4U, output);
+}
+
+template <typename TEST>
+void run_test(TEST test) {
+  EngineOptions options = get_tiny_options();
+  options.thread_.thread_count_per_group_ = 1;
+  Engine engine(options);
+  engine.get_proc_manager()->pre_register("add_task", add_task);
+  engine.get_proc_manager()->pre_register("fail_task", fail_task);
+  engine.get_proc_manager()->pre_register("session_task", session_task);
+  COERCE_ERROR(engine.initialize());
+  {
+    UninitializeGuard guard(&engine);
+    test(&engine);
+    COERCE_ERROR(engine.uninitialize());
+  }
+  cleanup_test(options);
+}
+
+TEST(TaskQueueTest, Simple) {
+  run_test([](Engine* engine) {
+    TaskQueue queue;
+    EXPECT_FALSE(queue.is_open());
+    EXPECT_TRUE(engine->get_thread_pool()->impersonate_task_queue_on_numa_node(0, &queue));
+    EXPECT_TRUE(queue.is_open());
+    for (uint64_t i = 0; i < 100U; ++i) {
+      push_add(&queue, i);
+    }
+    EXPECT_EQ(100U, queue.get_pending_count());
+    for (uint64_t i = 0; i < 100U; ++i) {
+      pop_add(&queue, i);
+    }
+    EXPECT_EQ(0, queue.get_pending_count());
+    ErrorCode result;
+    EXPECT_EQ(kErrorCodeInvalidParameter, queue.pop(&result));
+    COERCE_ERROR(queue.close());
+    EXPECT_FALSE(queue.is_open());
+  });
+}
+
+TEST(TaskQueueTest, Many) {
+  run_test([](Engine* engine) {
+    TaskQueue queue;
+    EXPECT_TRUE(engine->get_thread_pool()->impersonate_task_queue_on_numa_node(0, &queue));
+    // keep a window of requests in flight. this wraps around the ring many times
+    const uint64_t kRequests = TaskQueue::kSlots * 20U;
+    const uint64_t kWindow = TaskQueue::kSlots / 2U;
+    for (uint64_t i = 0; i < kRequests; ++i) {
+      if (i >= kWindow) {
+        pop_add(&queue, i - kWindow);
+      }
+      push_add(&queue, i);
+    }
+    for (uint64_t i = kRequests - kWindow; i < kRequests; ++i) {
+      pop_add(&queue, i);
+    }
+    COERCE_ERROR(queue.close());
+  });
+}
+
+TEST(TaskQueueTest, Full) {
+  run_test([](Engine* engine) {
+    TaskQueue queue;
+    EXPECT_TRUE(engine->get_thread_pool()->impersonate_task_queue_on_numa_node(0, &queue));
+    for (uint64_t i = 0; i < TaskQueue::kSlots; ++i) {
+      push_add(&queue, i);
+    }
+    uint64_t input[2] = {0, 0};
+    EXPECT_EQ(kErrorCodeThrTaskQueueFull, queue.push("add_task", input, sizeof(input)));
+    pop_add(&queue, 0);
+    push_add(&queue, TaskQueue::kSlots);
+    for (uint64_t i = 1; i <= TaskQueue::kSlots; ++i) {
+      pop_add(&queue, i);
+    }
+
+    char too_large[TaskQueueRequest::kMaxInputSize + 1];
+    EXPECT_EQ(kErrorCodeInvalidParameter, queue.push("add_task", too_large, sizeof(too_large)));
+    COERCE_ERROR(queue.close());
+    EXPECT_EQ(kErrorCodeSessionExpired, queue.push("add_task", input, sizeof(input)));
+  });
+}
+
+TEST(TaskQueueTest, Errors) {
+  run_test([](Engine* engine) {
+    TaskQueue queue;
+    EXPECT_TRUE(engine->get_thread_pool()->impersonate_task_queue_on_numa_node(0, &queue));
+    push_add(&queue, 1);
+    EXPECT_EQ(kErrorCodeOk, queue.push("fail_task", nullptr, 0));
+    EXPECT_EQ(kErrorCodeOk, queue.push("no_such_task", nullptr, 0));
+    push_add(&queue, 2);
+
+    ErrorCode result;
+    pop_add(&queue, 1);
+    EXPECT_EQ(kErrorCodeOk, queue.pop(&result));
+    EXPECT_EQ(kErrorCodeInvalidParameter, result);
+    EXPECT_EQ(kErrorCodeOk, queue.pop(&result));
+    EXPECT_EQ(kErrorCodeProcNotFound, result);
+    pop_add(&queue, 2);
+    COERCE_ERROR(queue.close());
+  });
+}
+
+TEST(TaskQueueTest, CloseWithPending) {
+  run_test([](Engine* engine) {
+    // the queue occupies the only thread. the thread is again available after close()
+    TaskQueue queue;
+    EXPECT_TRUE(engine->get_thread_pool()->impersonate_task_queue_on_numa_node(0, &queue));
+    for (uint64_t i = 0; i < 10U; ++i) {
+      push_add(&queue, i);
+    }
+    ImpersonateSession session;
+    EXPECT_FALSE(engine->get_thread_pool()->impersonate("session_task", nullptr, 0, &session));
+    COERCE_ERROR(queue.close());
+    COERCE_ERROR(engine->get_thread_pool()->impersonate_synchronous("session_task"));
+
+    EXPECT_TRUE(engine->get_thread_pool()->impersonate_task_queue_on_numa_node(0, &queue));
+    push_add(&queue, 42);
+    pop_add(&queue, 42);
+  });
+}
+
+const storage::StorageName kArrayName("test");
+// Large records so that the requests below touch many different snapshot pages
+const uint16_t kPayloadSize = 1024;
+const storage::array::ArrayOffset kRecords = 64;
+
+ErrorStack populate_task(const proc::ProcArguments& args) {
+  thread::Thread* context = args.context_;
+  storage::array::ArrayStorage array(args.engine_, kArrayName);
+  xct::XctManager* xct_manager = args.engine_->get_xct_manager();
+  WRAP_ERROR_CODE(xct_manager->begin_xct(context, xct::kSerializable));
+  for (storage::array::ArrayOffset i = 0; i < kRecords; ++i) {
+    WRAP_ERROR_CODE(array.overwrite_record_primitive<uint64_t>(context, i, i * 7U, 0));
+  }
+  Epoch commit_epoch;
+  WRAP_ERROR_CODE(xct_manager->precommit_xct(context, &commit_epoch));
+  WRAP_ERROR_CODE(xct_manager->wait_for_commit(commit_epoch));
+  return kRetOk;
+}
+
+ErrorStack read_task(const proc::ProcArguments& args) {
+  thread::Thread* context = args.context_;
+  storage::array::ArrayStorage array(args.engine_, kArrayName);
+  xct::XctManager* xct_manager = args.engine_->get_xct_manager();
+  storage::array::ArrayOffset offset
+    = *reinterpret_cast<const storage::array::ArrayOffset*>(args.input_buffer_);
+  WRAP_ERROR_CODE(xct_manager->begin_xct(context, xct::kSerializable));
+  uint64_t value = 0;
+  WRAP_ERROR_CODE(array.get_record_primitive<uint64_t>(context, offset, &value, 0));
+  Epoch commit_epoch;
+  WRAP_ERROR_CODE(xct_manager->precommit_xct(context, &commit_epoch));
+  std::memcpy(args.output_buffer_, &value, sizeof(value));
+  *args.output_used_ = sizeof(value);
+  return kRetOk;
+}
+
+TEST(TaskQueueTest, Interleaved) {
+  EngineOptions options = get_tiny_options();
+  options.thread_.thread_count_per_group_ = 1;
+  {
+    Engine engine(options);
+    engine.get_proc_manager()->pre_register("populate_task", populate_task);
+    COERCE_ERROR(engine.initialize());
+    {
+      UninitializeGuard guard(&engine);
+      storage::array::ArrayStorage array;
+      Epoch commit_epoch;
+      storage::array::ArrayMetadata meta(kArrayName, kPayloadSize, kRecords);
+      COERCE_ERROR(engine.get_storage_manager()->create_array(&meta, &array, &commit_epoch));
+      COERCE_ERROR(engine.get_thread_pool()->impersonate_synchronous("populate_task"));
+      engine.get_snapshot_manager()->trigger_snapshot_immediate(true);
+      COERCE_ERROR(engine.uninitialize());
+    }
+  }
+
+  // After restart, the array has only snapshot pages. Every request initially misses the cache.
+  Engine engine(options);
+  engine.get_proc_manager()->pre_register("read_task", read_task);
+  COERCE_ERROR(engine.initialize());
+  {
+    UninitializeGuard guard(&engine);
+    TaskQueue queue;
+    queue.set_interleave_cache_misses(true);
+    EXPECT_TRUE(engine.get_thread_pool()->impersonate_task_queue_on_numa_node(0, &queue));
+    for (storage::array::ArrayOffset i = 0; i < kRecords; ++i) {
+      EXPECT_EQ(kErrorCodeOk, queue.push("read_task", &i, sizeof(i)));
+    }
+    for (storage::array::ArrayOffset i = 0; i < kRecords; ++i) {
+      ErrorCode result;
+      uint64_t output = 0;
+      EXPECT_EQ(kErrorCodeOk, queue.pop(&result, &output));
+      EXPECT_EQ(kErrorCodeOk, result) << i;
+      EXPECT_EQ(i * 7U, output) << i;
+    }
+    COERCE_ERROR(queue.close());
+    ThreadRef thread = engine.get_thread_pool()->get_pimpl()->get_thread_ref(0);
+    EXPECT_GT(thread.get_snapshot_cache_misses(), 0U);
+    EXPECT_GT(thread.get_task_queue_suspensions(), 0U);
+    COERCE_ERROR(engine.uninitialize());
+  }
+  cleanup_test(options);
+}
+
+/** Increments record-0 in the first transaction, then reads the given record in another one */
+ErrorStack increment_then_read_task(const proc::ProcArguments& args) {
+  thread::Thread* context = args.context_;
+  storage::array::ArrayStorage array(args.engine_, kArrayName);
+  xct::XctManager* xct_manager = args.engine_->get_xct_manager();
+  storage::array::ArrayOffset offset
+    = *reinterpret_cast<const storage::array::ArrayOffset*>(args.input_buffer_);
+  Epoch commit_epoch;
+  WRAP_ERROR_CODE(xct_manager->begin_xct(context, xct::kSerializable));
+  uint64_t one = 1;
+  WRAP_ERROR_CODE(array.increment_record_oneshot<uint64_t>(context, 0, one, 0));
+  WRAP_ERROR_CODE(xct_manager->precommit_xct(context, &commit_epoch));
+
+  WRAP_ERROR_CODE(xct_manager->begin_xct(context, xct::kSerializable));
+  uint64_t value = 0;
+  WRAP_ERROR_CODE(array.get_record_primitive<uint64_t>(context, offset, &value, 0));
+  WRAP_ERROR_CODE(xct_manager->precommit_xct(context, &commit_epoch));
+  std::memcpy(args.output_buffer_, &value, sizeof(value));
+  *args.output_used_ = sizeof(value);
+  return kRetOk;
+}
+
+// Cache misses after the first transaction committed must not restart the procedure,
+// otherwise the increment would be applied twice.
+TEST(TaskQueueTest, InterleavedTwoXcts) {
+  EngineOptions options = get_tiny_options();
+  options.thread_.thread_count_per_group_ = 1;
+  {
+    Engine engine(options);
+    engine.get_proc_manager()->pre_register("populate_task", populate_task);
+    COERCE_ERROR(engine.initialize());
+    {
+      UninitializeGuard guard(&engine);
+      storage::array::ArrayStorage array;
+      Epoch commit_epoch;
+      storage::array::ArrayMetadata meta(kArrayName, kPayloadSize, kRecords);
+      COERCE_ERROR(engine.get_storage_manager()->create_array(&meta, &array, &commit_epoch));
+      COERCE_ERROR(engine.get_thread_pool()->impersonate_synchronous("populate_task"));
+      engine.get_snapshot_manager()->trigger_snapshot_immediate(true);
+      COERCE_ERROR(engine.uninitialize());
+    }
+  }
+
+  Engine engine(options);
+  engine.get_proc_manager()->pre_register("increment_then_read_task", increment_then_read_task);
+  engine.get_proc_manager()->pre_register("read_task", read_task);
+  COERCE_ERROR(engine.initialize());
+  {
+    UninitializeGuard guard(&engine);
+    TaskQueue queue;
+    queue.set_interleave_cache_misses(true);
+    EXPECT_TRUE(engine.get_thread_pool()->impersonate_task_queue_on_numa_node(0, &queue));
+    for (storage::array::ArrayOffset i = 1; i < kRecords; ++i) {
+      EXPECT_EQ(kErrorCodeOk, queue.push("increment_then_read_task", &i, sizeof(i)));
+    }
+    for (storage::array::ArrayOffset i = 1; i < kRecords; ++i) {
+      ErrorCode result;
+      uint64_t output = 0;
+      EXPECT_EQ(kErrorCodeOk, queue.pop(&result, &output));
+      EXPECT_EQ(kErrorCodeOk, result) << i;
+      EXPECT_EQ(i * 7U, output) << i;
+    }
+    storage::array::ArrayOffset zero = 0;
+    EXPECT_EQ(kErrorCodeOk, queue.push("read_task", &zero, sizeof(zero)));
+    ErrorCode result;
+    uint64_t output = 0;
+    EXPECT_EQ(kErrorCodeOk, queue.pop(&result, &output));
+    EXPECT_EQ(kErrorCodeOk, result);
+    EXPECT_EQ(kRecords - 1U, output);
+    COERCE_ERROR(queue.close());
+    COERCE_ERROR(engine.uninitialize());
+  }
+  cleanup_test(options);
+}
+
+}  // namespace thread
+}  // namespace foedus
+
+TEST_MAIN_CAPTURE_SIGNALS(TaskQueueTest, foedus.thread);
@@ -0,0 +1,165 @@
+/*
+ * Copyright (c) 2014-2015, Hewlett-Packard Development Company, LP.
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details. You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * HP designates this particular file as subject to the "Classpath" exception
+ * as provided by HP in the LICENSE.txt file that accompanied this code.
+ */
+#include <stdint.h>
+#include <gtest/gtest.h>
+
+#include <cstring>
+
+#include "foedus/engine.hpp"
+#include "foedus/engine_options.hpp"
+#include "foedus/epoch.hpp"
+#include "foedus/test_common.hpp"
+#include "foedus/proc/proc_manager.hpp"
+#include "foedus/soc/shared_memory_repo.hpp"
+#include "foedus/soc/soc_manager.hpp"
+#include "foedus/storage/storage_manager.hpp"
+#include "foedus/storage/array/array_metadata.hpp"
+#include "foedus/storage/array/array_storage.hpp"
+#include "foedus/thread/thread_pool.hpp"
+#include "foedus/xct/xct_manager.hpp"
+#include "foedus/xct/xct_manager_pimpl.hpp"
+#include "foedus/xct/xct_options.hpp"
+
+namespace foedus {
+namespace xct {
+DEFINE_TEST_CASE_PACKAGE(EpochChimeTunerTest, foedus.xct);
+
+const uint32_t kBuckets = XctManagerControlBlock::kCommitLatencyBuckets;
+
+XctOptions get_adaptive_options() {
+  XctOptions options;
+  options.epoch_advance_interval_ms_ = 4;
+  options.epoch_advance_target_latency_us_ = 20000;
+  options.epoch_advance_min_interval_us_ = 1000;
+  return options;
+}
+
+TEST(EpochChimeTunerTest, Percentile) {
+  uint32_t histogram[kBuckets];
+  std::memset(histogram, 0, sizeof(histogram));
+  EXPECT_EQ(0, EpochChimeTuner::get_percentile_us(histogram, 99));
+  histogram[3] = 99;  // [8, 16)
+  histogram[10] = 1;  // [1024, 2048)
+  EXPECT_EQ(16U, EpochChimeTuner::get_percentile_us(histogram, 50));
+  EXPECT_EQ(16U, EpochChimeTuner::get_percentile_us(histogram, 99));
+  EXPECT_EQ(2048U, EpochChimeTuner::get_percentile_us(histogram, 100));
+}
+
+TEST(EpochChimeTunerTest, Initial) {
+  XctOptions options = get_adaptive_options();
+  EpochChimeTuner tuner(options);
+  EXPECT_EQ(4000U, tuner.get_interval_us());
+  EXPECT_TRUE(tuner.is_light_load());
+
+  // the configured interval is longer than half of the target
+  options.epoch_advance_interval_ms_ = 50;
+  EpochChimeTuner tuner2(options);
+  EXPECT_EQ(10000U, tuner2.get_interval_us());
+}
+
+TEST(EpochChimeTunerTest, ShortenOnLatency) {
+  EpochChimeTuner tuner(get_adaptive_options());
+  uint32_t histogram[kBuckets];
+  std::memset(histogram, 0, sizeof(histogram));
+  histogram[15] = 100;  // [32ms, 64ms), way above the target
+  const uint64_t kHeavy = EpochChimeTuner::kLightLoadBytesPerEpoch * 16ULL;
+  tuner.observe(kHeavy, 8, 1, histogram);
+  EXPECT_FALSE(tuner.is_light_load());
+  EXPECT_EQ(2000U, tuner.get_interval_us());
+  tuner.observe(kHeavy, 8, 1, histogram);
+  EXPECT_EQ(1000U, tuner.get_interval_us());
+  tuner.observe(kHeavy, 8, 1, histogram);
+  EXPECT_EQ(1000U, tuner.get_interval_us());  // min_interval
+}
+
+TEST(EpochChimeTunerTest, LengthenOnHeavyLoad) {
+  EpochChimeTuner tuner(get_adaptive_options());
+  uint32_t histogram[kBuckets];
+  std::memset(histogram, 0, sizeof(histogram));
+  histogram[12] = 100;  // [4ms, 8ms), well within the target
+  const uint64_t kHeavy = EpochChimeTuner::kLightLoadBytesPerEpoch * 16ULL;
+  uint32_t previous = tuner.get_interval_us();
+  for (int i = 0; i < 100; ++i) {
+    tuner.observe(kHeavy, 8, 1, histogram);
+    EXPECT_FALSE(tuner.is_light_load());
+    EXPECT_GE(tuner.get_interval_us(), previous);
+    previous = tuner.get_interval_us();
+  }
+  EXPECT_EQ(10000U, tuner.get_interval_us());  // half of the target
+
+  // the same bytes with more loggers is light load. drifts back to the configured interval
+  for (int i = 0; i < 100; ++i) {
+    tuner.observe(kHeavy, 8, 16, histogram);
+    EXPECT_TRUE(tuner.is_light_load());
+  }
+  EXPECT_EQ(4000U, tuner.get_interval_us());
+}
+
+TEST(EpochChimeTunerTest, KeepOnModerateLatency) {
+  EpochChimeTuner tuner(get_adaptive_options());
+  uint32_t histogram[kBuckets];
+  std::memset(histogram, 0, sizeof(histogram));
+  histogram[13] = 100;  // [8ms, 16ms). within the target, but not within 75% of it
+  const uint64_t kHeavy = EpochChimeTuner::kLightLoadBytesPerEpoch * 16ULL;
+  tuner.observe(kHeavy, 8, 1, histogram);
+  EXPECT_EQ(4000U, tuner.get_interval_us());
+}
+
+const storage::StorageName kName("test");
+
+ErrorStack commit_task(const proc::ProcArguments& args) {
+  thread::Thread* context = args.context_;
+  storage::array::ArrayStorage array(args.engine_, kName);
+  XctManager* xct_manager = args.engine_->get_xct_manager();
+  for (uint32_t i = 0; i < 64U; ++i) {
+    WRAP_ERROR_CODE(xct_manager->begin_xct(context, kSerializable));
+    WRAP_ERROR_CODE(array.increment_record_oneshot<uint64_t>(context, 0, 1U, 0));
+    Epoch commit_epoch;
+    WRAP_ERROR_CODE(xct_manager->precommit_xct(context, &commit_epoch));
+    WRAP_ERROR_CODE(xct_manager->wait_for_commit(commit_epoch));
+  }
+  return kRetOk;
+}
+
+TEST(EpochChimeTunerTest, Engine) {
+  EngineOptions options = get_tiny_options();
+  options.xct_ = get_adaptive_options();
+  Engine engine(options);
+  engine.get_proc_manager()->pre_register("commit_task", commit_task);
+  COERCE_ERROR(engine.initialize());
+  {
+    UninitializeGuard guard(&engine);
+    storage::array::ArrayStorage array;
+    Epoch commit_epoch;
+    storage::array::ArrayMetadata meta(kName, sizeof(uint64_t), 1);
+    COERCE_ERROR(engine.get_storage_manager()->create_array(&meta, &array, &commit_epoch));
+    COERCE_ERROR(engine.get_thread_pool()->impersonate_synchronous("commit_task"));
+
+    XctManagerControlBlock* block = engine.get_soc_manager()->get_shared_memory_repo()
+      ->get_global_memory_anchors()->xct_manager_memory_;
+    EXPECT_GE(block->epoch_advance_interval_us_, 1000U);
+    EXPECT_LE(block->epoch_advance_interval_us_, 10000U);
+    COERCE_ERROR(engine.uninitialize());
+  }
+  cleanup_test(options);
+}
+
+}  // namespace xct
+}  // namespace foedus
+
+TEST_MAIN_CAPTURE_SIGNALS(EpochChimeTunerTest, foedus.xct);
@@ -20,6 +20,7 @@
 
 #include <chrono>
 #include <cstring>
+#include <iostream>
 #include <thread>
 #include <vector>
 
@@ -27,6 +28,7 @@
 #include "foedus/engine_options.hpp"
 #include "foedus/epoch.hpp"
 #include "foedus/test_common.hpp"
+#include "foedus/assorted/hardware_transaction.hpp"
 #include "foedus/proc/proc_manager.hpp"
 #include "foedus/soc/shared_memory_repo.hpp"
 #include "foedus/soc/shared_rendezvous.hpp"
@@ -37,6 +39,8 @@
 #include "foedus/thread/rendezvous_impl.hpp"
 #include "foedus/thread/thread.hpp"
 #include "foedus/thread/thread_pool.hpp"
+#include "foedus/thread/thread_pool_pimpl.hpp"
+#include "foedus/thread/thread_ref.hpp"
 #include "foedus/xct/xct_access.hpp"
 #include "foedus/xct/xct_id.hpp"
 #include "foedus/xct/xct_manager.hpp"
@@ -195,9 +199,12 @@ void run_test(Engine *engine, ASSIGN_FUNC assign_func) {
 }
 
 template <typename ASSIGN_FUNC>
-void test_main(ASSIGN_FUNC assign_func) {
+void test_main(ASSIGN_FUNC assign_func, bool htm_precommit = false) {
   EngineOptions options = get_tiny_options();
   options.thread_.thread_count_per_group_ = kThreads;
+  if (htm_precommit) {
+    options.xct_.htm_precommit_max_write_set_size_ = 4;
+  }
   Engine engine(options);
   engine.get_proc_manager()->pre_register("init_task", init_task);
   engine.get_proc_manager()->pre_register("test_task", test_task);
@@ -206,6 +213,21 @@ void test_main(ASSIGN_FUNC assign_func) {
   {
     UninitializeGuard guard(&engine);
     run_test(&engine, assign_func);
+    if (htm_precommit) {
+      uint64_t elided_commits = 0;
+      for (int i = 0; i < kThreads; ++i) {
+        elided_commits += engine.get_thread_pool()->get_pimpl()->get_thread_ref(i)
+          .get_htm_elided_commits();
+      }
+      if (assorted::is_rtm_supported()) {
+        // Even with extreme conflict, the last committer finds no one else on the record.
+        EXPECT_GT(elided_commits, 0U);
+      } else {
+        std::cout << "This CPU doesn't support RTM, so we can't test lock elision. We just"
+          << " tested that precommit falls back to locks, skipping the check." << std::endl;
+        EXPECT_EQ(0U, elided_commits);
+      }
+    }
     COERCE_ERROR(engine.uninitialize());
   }
   cleanup_test(options);
@@ -227,6 +249,14 @@ TEST(XctCommitConflictTest, ExtremeConflict) {
   test_main([] (int /*i*/) { return 0; } );
 }
 
+TEST(XctCommitConflictTest, NoConflictHtm) {
+  test_main([] (int i) { return i; }, true);
+}
+
+TEST(XctCommitConflictTest, ExtremeConflictHtm) {
+  test_main([] (int /*i*/) { return 0; }, true);
+}
+
 }  // namespace xct
 }  // namespace foedus
 
@@ -291,11 +291,165 @@ struct Runner {
   }
 };
 
+/**
+ * Tests NUMA-aware handover, which needs threads in more than one node.
+ * Threads 0-3 are in node-0, 256-257 in node-1. The lock is in node-0.
+ * Thread-0 takes the lock first, then others line up in the order of kQueueOrder.
+ */
+struct NumaRunner {
+  static const int kNumaNodes = 2;
+  static const int kNumaThreadsPerNode = 4;
+  static const int kWaiters = 5;
+
+  McsMockContext<McsRwSimpleBlock> context;
+  thread::ThreadId  acquired_order[kWaiters + 1];
+  std::atomic<int>  acquired_count;
+  std::atomic<bool> signaled;
+
+  McsWwLock* get_lock() { return context.get_ww_lock_address(kDefaultNodeId, 0); }
+
+  void sleep_enough() {
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  }
+
+  void init(uint16_t handover_limit) {
+    context.init(kDummyStorageId, kNumaNodes, kNumaThreadsPerNode, 1U << 8, kKeys);
+    context.ww_numa_handover_limit_ = handover_limit;
+    context.ww_lock_stats_enabled_ = true;
+    get_lock()->reset();
+    acquired_count = 0;
+    signaled = false;
+  }
+
+  void task(thread::ThreadId id) {
+    McsMockAdaptor<McsRwSimpleBlock> adaptor(id, &context);
+    McsWwImpl< McsMockAdaptor<McsRwSimpleBlock> > impl(adaptor);
+    McsBlockIndex block = impl.acquire_unconditional(get_lock());
+    acquired_order[acquired_count] = id;  // protected by the lock itself
+    ++acquired_count;
+    while (id == 0 && !signaled) {
+      sleep_enough();
+    }
+    impl.release(get_lock(), block);
+  }
+
+  McsWwLockStat* get_stat(thread::ThreadId id) {
+    auto* thread = context.nodes_[thread::decompose_numa_node(id)].threads_.data()
+      + thread::decompose_numa_local_ordinal(id);
+    return find_mcs_ww_lock_stat(thread->mcs_ww_lock_stats_.data(), get_lock());
+  }
+
+  void run(uint16_t handover_limit) {
+    init(handover_limit);
+    const thread::ThreadId kQueueOrder[kWaiters] = { 256, 257, 1, 2, 3 };
+    std::vector<std::thread> sessions;
+    sessions.emplace_back(&NumaRunner::task, this, 0);
+    while (acquired_count < 1) {
+      sleep_enough();
+    }
+    for (int i = 0; i < kWaiters; ++i) {
+      sessions.emplace_back(&NumaRunner::task, this, kQueueOrder[i]);
+      while (get_lock()->get_tail_waiter() != kQueueOrder[i]) {
+        sleep_enough();
+      }
+      sleep_enough();  // so that it surely links itself to the predecessor
+    }
+    signaled = true;
+    for (auto& session : sessions) {
+      session.join();
+    }
+    EXPECT_EQ(kWaiters + 1, acquired_count);
+    EXPECT_FALSE(get_lock()->is_locked());
+  }
+
+  void test_fifo() {
+    run(0);
+    const thread::ThreadId kExpected[kWaiters + 1] = { 0, 256, 257, 1, 2, 3 };
+    for (int i = 0; i < kWaiters + 1; ++i) {
+      EXPECT_EQ(kExpected[i], acquired_order[i]) << i;
+    }
+    EXPECT_EQ(1U, get_stat(0)->acquires_);
+    EXPECT_EQ(0U, get_stat(0)->contended_acquires_);
+    EXPECT_EQ(1U, get_stat(0)->remote_handovers_);
+    EXPECT_EQ(0U, get_stat(0)->bypassed_handovers_);
+    EXPECT_EQ(1U, get_stat(256)->contended_acquires_);
+    EXPECT_GT(get_stat(256)->wait_cycles_, 0U);
+    EXPECT_EQ(1U, get_stat(256)->local_handovers_);
+    EXPECT_EQ(1U, get_stat(257)->remote_handovers_);
+  }
+
+  void test_numa() {
+    // A limit of 2 lets node-0 threads go ahead of 256 twice, but not thrice.
+    run(2);
+    const thread::ThreadId kExpected[kWaiters + 1] = { 0, 1, 2, 256, 257, 3 };
+    for (int i = 0; i < kWaiters + 1; ++i) {
+      EXPECT_EQ(kExpected[i], acquired_order[i]) << i;
+    }
+    EXPECT_EQ(1U, get_stat(0)->local_handovers_);
+    EXPECT_EQ(1U, get_stat(0)->bypassed_handovers_);
+    EXPECT_EQ(1U, get_stat(1)->bypassed_handovers_);
+    EXPECT_EQ(0U, get_stat(2)->local_handovers_);
+    EXPECT_EQ(1U, get_stat(2)->remote_handovers_);
+    EXPECT_EQ(1U, get_stat(256)->local_handovers_);
+    EXPECT_EQ(1U, get_stat(257)->remote_handovers_);
+    for (int i = 1; i <= kWaiters; ++i) {
+      EXPECT_EQ(1U, get_stat(kExpected[i])->contended_acquires_) << kExpected[i];
+    }
+  }
+
+  uint64_t          counters[kKeys];
+  std::atomic<int>  done_count;
+
+  void random_task(thread::ThreadId id) {
+    McsMockAdaptor<McsRwSimpleBlock> adaptor(id, &context);
+    McsWwImpl< McsMockAdaptor<McsRwSimpleBlock> > impl(adaptor);
+    assorted::UniformRandom r(id);
+    for (uint32_t i = 0; i < 1000; ++i) {
+      uint32_t k = r.uniform_within(0, 3);  // only a few keys to make long queues
+      McsBlockIndex block = impl.acquire_unconditional(context.get_ww_lock_address(0, k));
+      uint64_t value = counters[k];
+      assorted::memory_fence_seq_cst();
+      counters[k] = value + 1U;
+      impl.release(context.get_ww_lock_address(0, k), block);
+    }
+    ++done_count;
+  }
+
+  void test_random() {
+    context.init(kDummyStorageId, kNumaNodes, kNumaThreadsPerNode, 1U << 16, kKeys);
+    context.ww_numa_handover_limit_ = 3;
+    for (int i = 0; i < kKeys; ++i) {
+      context.get_ww_lock_address(0, i)->reset();
+      counters[i] = 0;
+    }
+    done_count = 0;
+    std::vector<std::thread> sessions;
+    for (int n = 0; n < kNumaNodes; ++n) {
+      for (int t = 0; t < kNumaThreadsPerNode; ++t) {
+        sessions.emplace_back(&NumaRunner::random_task, this, thread::compose_thread_id(n, t));
+      }
+    }
+    for (auto& session : sessions) {
+      session.join();
+    }
+    EXPECT_EQ(kNumaNodes * kNumaThreadsPerNode, done_count);
+    uint64_t total = 0;
+    for (int i = 0; i < kKeys; ++i) {
+      EXPECT_FALSE(context.get_ww_lock_address(0, i)->is_locked()) << i;
+      total += counters[i];
+    }
+    EXPECT_EQ(kNumaNodes * kNumaThreadsPerNode * 1000U, total);
+  }
+};
+
 TEST(XctMcsImplWwTest, Instantiate) { Runner::test_instantiate(); }
 TEST(XctMcsImplWwTest, NoConflict) { Runner().test_no_conflict(); }
 TEST(XctMcsImplWwTest, Conflict) { Runner().test_conflict(); }
 TEST(XctMcsImplWwTest, Initial) { Runner().test_initial(); }
 TEST(XctMcsImplWwTest, Random) { Runner().test_random(); }
+TEST(XctMcsImplWwTest, NumaFifo) { NumaRunner().test_fifo(); }
+TEST(XctMcsImplWwTest, NumaHandover) { NumaRunner().test_numa(); }
+TEST(XctMcsImplWwTest, NumaRandom) { NumaRunner().test_random(); }
 
 }  // namespace xct
 }  // namespace foedus
@@ -0,0 +1,160 @@
+/*
+ * Copyright (c) 2014-2015, Hewlett-Packard Development Company, LP.
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details. You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * HP designates this particular file as subject to the "Classpath" exception
+ * as provided by HP in the LICENSE.txt file that accompanied this code.
+ */
+#include <stdint.h>
+#include <gtest/gtest.h>
+
+#include "foedus/engine.hpp"
+#include "foedus/engine_options.hpp"
+#include "foedus/epoch.hpp"
+#include "foedus/test_common.hpp"
+#include "foedus/proc/proc_manager.hpp"
+#include "foedus/storage/storage_manager.hpp"
+#include "foedus/storage/array/array_metadata.hpp"
+#include "foedus/storage/array/array_storage.hpp"
+#include "foedus/thread/thread.hpp"
+#include "foedus/thread/thread_pool.hpp"
+#include "foedus/xct/xct.hpp"
+#include "foedus/xct/xct_access.hpp"
+#include "foedus/xct/xct_id.hpp"
+#include "foedus/xct/xct_manager.hpp"
+
+/**
+ * @file test_xct_read_set_verify.cpp
+ * Read-set verification in precommit checks entries in blocks. These testcases use a read-set
+ * that spans many blocks, and tamper one entry at block boundaries to see that the
+ * verification catches it wherever it is.
+ */
+namespace foedus {
+namespace xct {
+DEFINE_TEST_CASE_PACKAGE(XctReadSetVerifyTest, foedus.xct);
+
+/** 62 full blocks and one partial block. */
+const uint32_t kRecords = 1000;
+/** Not tampering any entry. */
+const uint32_t kNoTamper = 0xFFFFFFFFU;
+
+enum TamperType {
+  kChangeOrdinal = 0,
+  kBeingWritten,
+};
+
+struct VerifyInput {
+  uint32_t    tamper_index_;
+  TamperType  tamper_type_;
+  /** Whether the transaction also writes, so that it takes the read-write path. */
+  bool        write_;
+};
+
+ErrorStack init_task(const proc::ProcArguments& args) {
+  thread::Thread* context = args.context_;
+  xct::XctManager* xct_manager = context->get_engine()->get_xct_manager();
+  storage::StorageManager* str_manager = context->get_engine()->get_storage_manager();
+  Epoch commit_epoch;
+  storage::array::ArrayStorage storage;
+  // One more record for the blind write, which is not in the read-set.
+  storage::array::ArrayMetadata meta("test", sizeof(uint64_t), kRecords + 1U);
+  CHECK_ERROR(str_manager->create_array(&meta, &storage, &commit_epoch));
+
+  CHECK_ERROR(xct_manager->begin_xct(context, kSerializable));
+  for (uint32_t i = 0; i <= kRecords; ++i) {
+    uint64_t data = i;
+    CHECK_ERROR(storage.overwrite_record(context, i, &data));
+  }
+  CHECK_ERROR(xct_manager->precommit_xct(context, &commit_epoch));
+  return kRetOk;
+}
+
+ErrorStack verify_task(const proc::ProcArguments& args) {
+  thread::Thread* context = args.context_;
+  EXPECT_EQ(sizeof(VerifyInput), args.input_len_);
+  const VerifyInput* input = reinterpret_cast<const VerifyInput*>(args.input_buffer_);
+  xct::XctManager* xct_manager = context->get_engine()->get_xct_manager();
+  storage::array::ArrayStorage storage
+    = context->get_engine()->get_storage_manager()->get_array("test");
+  CHECK_ERROR(xct_manager->begin_xct(context, kSerializable));
+  for (uint32_t i = 0; i < kRecords; ++i) {
+    uint64_t data;
+    CHECK_ERROR(storage.get_record(context, i, &data));
+    EXPECT_EQ(i, data);
+  }
+  if (input->write_) {
+    uint64_t data = kRecords;
+    CHECK_ERROR(storage.overwrite_record(context, kRecords, &data));
+  }
+
+  Xct& current_xct = context->get_current_xct();
+  EXPECT_EQ(kRecords, current_xct.get_read_set_size());
+  if (input->tamper_index_ != kNoTamper) {
+    // as if another transaction has modified the record after we read it
+    XctId* observed = &current_xct.get_read_set()[input->tamper_index_].observed_owner_id_;
+    if (input->tamper_type_ == kChangeOrdinal) {
+      observed->set(observed->get_epoch_int(), observed->get_ordinal() + 1U);
+    } else {
+      observed->set_being_written();
+    }
+  }
+
+  Epoch commit_epoch;
+  ErrorCode result = xct_manager->precommit_xct(context, &commit_epoch);
+  if (input->tamper_index_ == kNoTamper) {
+    EXPECT_EQ(kErrorCodeOk, result);
+    EXPECT_TRUE(commit_epoch.is_valid());
+  } else {
+    EXPECT_EQ(kErrorCodeXctRaceAbort, result);
+    if (context->is_running_xct()) {
+      CHECK_ERROR(xct_manager->abort_xct(context));
+    }
+  }
+  return kRetOk;
+}
+
+void test_main(bool write, TamperType tamper_type) {
+  EngineOptions options = get_tiny_options();
+  Engine engine(options);
+  engine.get_proc_manager()->pre_register("init_task", init_task);
+  engine.get_proc_manager()->pre_register("verify_task", verify_task);
+  COERCE_ERROR(engine.initialize());
+  {
+    UninitializeGuard guard(&engine);
+    COERCE_ERROR(engine.get_thread_pool()->impersonate_synchronous("init_task"));
+    // the first and last entries of a block, the middle of the read-set, and the last entry
+    const uint32_t kTamperIndexes[] = {kNoTamper, 0, 15, 16, 31, 500, kRecords - 1U, kNoTamper};
+    for (uint32_t tamper_index : kTamperIndexes) {
+      VerifyInput input;
+      input.tamper_index_ = tamper_index;
+      input.tamper_type_ = tamper_type;
+      input.write_ = write;
+      COERCE_ERROR(engine.get_thread_pool()->impersonate_synchronous(
+        "verify_task",
+        &input,
+        sizeof(input)));
+    }
+    COERCE_ERROR(engine.uninitialize());
+  }
+  cleanup_test(options);
+}
+
+TEST(XctReadSetVerifyTest, ReadOnlyChanged) { test_main(false, kChangeOrdinal); }
+TEST(XctReadSetVerifyTest, ReadOnlyBeingWritten) { test_main(false, kBeingWritten); }
+TEST(XctReadSetVerifyTest, ReadWriteChanged) { test_main(true, kChangeOrdinal); }
+TEST(XctReadSetVerifyTest, ReadWriteBeingWritten) { test_main(true, kBeingWritten); }
+
+}  // namespace xct
+}  // namespace foedus
+
+TEST_MAIN_CAPTURE_SIGNALS(XctReadSetVerifyTest, foedus.xct);